@@ -0,0 +1,220 @@
+/* bench_bigint -- time each bigint multiplication algorithm by size.
+   Copyright (C) 2015-2017 Gregory Kikola.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Written by Gregory Kikola <gkikola@gmail.com>. */
+
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "bigint.h"
+
+#define RUNS 9
+#define MIN_RUN_NS 20000000
+#define MAX_SCHOOLBOOK_LIMBS 8192
+
+//Times a multiplication of random operands at each size as each
+//algorithm is enabled in turn, the ones below it keeping their default
+//thresholds, which is where the thresholds in bigint.c come from: each
+//should sit about where its column starts to beat the one before it.
+//The transform is not recursive, so its column forces it at every size.
+//Division by Newton's method and radix conversion are timed at the
+//default thresholds against their schoolbook forms.
+
+typedef struct {
+  char *name;
+  size_t karatsuba;
+  size_t toom3;
+  size_t ntt;
+} algorithm;
+
+algorithm algorithms[] = {
+  { "schoolbook", SIZE_MAX, SIZE_MAX, SIZE_MAX },
+  { "karatsuba", 32, SIZE_MAX, SIZE_MAX },
+  { "toom3", 32, 256, SIZE_MAX },
+  { "ntt", 32, 256, 4 },
+};
+
+size_t sizes[] = { 8, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096, 16384,
+                   65536 };
+
+#define NUM_ALGORITHMS ((int)(sizeof(algorithms) / sizeof(algorithm)))
+#define NUM_SIZES ((int)(sizeof(sizes) / sizeof(size_t)))
+
+long now_ns();
+void random_bigint(bigint *x, size_t length);
+double time_multiply(bigint *a, bigint *b);
+double time_divide(bigint *a, bigint *b);
+double time_digits(bigint *a);
+int compare_double(const void *a, const void *b);
+
+int main(int argc, char *argv[]) {
+  size_t karatsuba = karatsuba_threshold, toom3 = toom3_threshold;
+  size_t ntt = ntt_threshold, newton = newton_threshold;
+  size_t radix = radix_threshold;
+  bigint a, b;
+  big_init(&a);
+  big_init(&b);
+
+  (void)argc;
+  (void)argv;
+
+  printf("%-8s", "limbs");
+  for (int i = 0; i < NUM_ALGORITHMS; i++)
+    printf(" %14s", algorithms[i].name);
+  printf("   (median ns per multiplication)\n");
+
+  for (int i = 0; i < NUM_SIZES; i++) {
+    random_bigint(&a, sizes[i]);
+    random_bigint(&b, sizes[i]);
+    printf("%-8zu", sizes[i]);
+
+    for (int j = 0; j < NUM_ALGORITHMS; j++) {
+      karatsuba_threshold = algorithms[j].karatsuba;
+      toom3_threshold = algorithms[j].toom3;
+      ntt_threshold = algorithms[j].ntt;
+
+      if (j == 0 && sizes[i] > MAX_SCHOOLBOOK_LIMBS)
+        printf(" %14s", "-");
+      else
+        printf(" %14.0f", time_multiply(&a, &b));
+      fflush(stdout);
+    }
+    printf("\n");
+  }
+
+  karatsuba_threshold = karatsuba;
+  toom3_threshold = toom3;
+  ntt_threshold = ntt;
+
+  printf("\n%-8s %14s %14s %14s %14s   (median ns)\n", "limbs",
+         "divide", "newton", "digits", "recursive");
+  for (int i = 2; i < NUM_SIZES - 1; i++) {
+    random_bigint(&a, 2 * sizes[i]);
+    random_bigint(&b, sizes[i]);
+    printf("%-8zu", sizes[i]);
+
+    newton_threshold = radix_threshold = SIZE_MAX;
+    printf(" %14.0f", time_divide(&a, &b));
+    newton_threshold = newton;
+    printf(" %14.0f", time_divide(&a, &b));
+    printf(" %14.0f", time_digits(&b));
+    radix_threshold = radix;
+    printf(" %14.0f\n", time_digits(&b));
+    fflush(stdout);
+  }
+
+  big_free(&a);
+  big_free(&b);
+  return 0;
+}
+
+long now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+void random_bigint(bigint *x, size_t length) {
+  uint64_t *limbs = malloc(length * sizeof(uint64_t));
+  if (!limbs) {
+    fprintf(stderr, "Error: out of memory\n");
+    exit(1);
+  }
+
+  //xorshift64*, so that every run sees the same operands
+  static uint64_t state = 0x9e3779b97f4a7c15;
+  for (size_t i = 0; i < length; i++) {
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    limbs[i] = state * 0x2545f4914f6cdd1d;
+  }
+  limbs[length - 1] |= 1; //no leading zero
+
+  bigint view = { limbs, length, 0, false };
+  big_copy(x, &view);
+  free(limbs);
+}
+
+//the median over RUNS runs, each repeated until it is long enough to time
+double time_multiply(bigint *a, bigint *b) {
+  double samples[RUNS];
+  bigint r;
+  big_init(&r);
+
+  long count = 1;
+  for (;;) {
+    long start = now_ns();
+    for (long i = 0; i < count; i++)
+      big_multiply(&r, a, b);
+    long elapsed = now_ns() - start;
+    if (elapsed >= MIN_RUN_NS / RUNS || count > (1L << 30))
+      break;
+    count *= 2;
+  }
+
+  for (int run = 0; run < RUNS; run++) {
+    long start = now_ns();
+    for (long i = 0; i < count; i++)
+      big_multiply(&r, a, b);
+    samples[run] = (double)(now_ns() - start) / count;
+  }
+
+  big_free(&r);
+  qsort(samples, RUNS, sizeof(double), compare_double);
+  return samples[RUNS / 2];
+}
+
+double time_divide(bigint *a, bigint *b) {
+  double samples[RUNS];
+  bigint q, r;
+  big_init(&q);
+  big_init(&r);
+
+  for (int run = 0; run < RUNS; run++) {
+    long start = now_ns();
+    big_divide(&q, &r, a, b);
+    samples[run] = now_ns() - start;
+  }
+
+  big_free(&q);
+  big_free(&r);
+  qsort(samples, RUNS, sizeof(double), compare_double);
+  return samples[RUNS / 2];
+}
+
+double time_digits(bigint *a) {
+  double samples[RUNS];
+
+  for (int run = 0; run < RUNS; run++) {
+    size_t num_digits;
+    long start = now_ns();
+    free(big_to_digits(a, 10, &num_digits));
+    samples[run] = now_ns() - start;
+  }
+
+  qsort(samples, RUNS, sizeof(double), compare_double);
+  return samples[RUNS / 2];
+}
+
+int compare_double(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
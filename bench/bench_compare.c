@@ -0,0 +1,353 @@
+/* bench_compare -- find significant changes between benchmark results.
+   Copyright (C) 2015-2017 Gregory Kikola.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Written by Gregory Kikola <gkikola@gmail.com>. */
+
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFAULT_THRESHOLD 5.0 //percent
+#define ALPHA 0.05
+#define RESAMPLES 2000
+#define LINE_SIZE 65536
+#define NAME_SIZE 128
+
+//Compares two JSON files written by bench_startup or bench_throughput,
+//which hold one result per line with the raw samples behind it. The
+//machines we run on are too noisy to trust a difference in medians alone,
+//so each pair is put to a Mann-Whitney U test, which assumes nothing about
+//how the samples are distributed, and the change in the median is given
+//with a bootstrap confidence interval. A result is a regression when the
+//difference is significant and even the low end of the interval is slower
+//by more than the threshold; the exit status is 1 if there is any, so the
+//comparison can gate a merge.
+
+typedef struct {
+  char name[NAME_SIZE];
+  double *samples;
+  int count;
+} result;
+
+typedef struct {
+  result *results;
+  int count;
+} result_set;
+
+void read_results(char *file_name, result_set *set);
+bool parse_result(char *line, result *res);
+result *find_result(result_set *set, char *name);
+double median(double values[], int count);
+double select_kth(double values[], int count, int k);
+double mann_whitney(double a[], int m, double b[], int n);
+void bootstrap(double a[], int m, double b[], int n, double *low,
+               double *high);
+uint64_t next_random(uint64_t *state);
+int compare_double(const void *a, const void *b);
+
+int main(int argc, char *argv[]) {
+  result_set base, head;
+  double threshold = (argc > 3) ? atof(argv[3]) : DEFAULT_THRESHOLD;
+  int regressions = 0;
+
+  if (argc < 3) {
+    fprintf(stderr, "Usage: bench_compare BASE.json HEAD.json "
+            "[THRESHOLD]\n");
+    return 2;
+  }
+
+  read_results(argv[1], &base);
+  read_results(argv[2], &head);
+
+  printf("%-28s %12s %12s %8s %18s %8s\n", "benchmark", "base", "head",
+         "change", "95% interval", "p");
+
+  for (int i = 0; i < head.count; i++) {
+    result *now = &head.results[i];
+    result *then = find_result(&base, now->name);
+    if (!then) {
+      printf("%-28s %12s (not in %s)\n", now->name, "", argv[1]);
+      continue;
+    }
+
+    double base_median = median(then->samples, then->count);
+    double head_median = median(now->samples, now->count);
+    double change = 100 * (head_median / base_median - 1);
+    double p = mann_whitney(then->samples, then->count, now->samples,
+                            now->count);
+    double low, high;
+    bootstrap(then->samples, then->count, now->samples, now->count, &low,
+              &high);
+
+    char *verdict = "";
+    if (p < ALPHA && low > threshold) {
+      verdict = "REGRESSION";
+      regressions++;
+    } else if (p < ALPHA && high < -threshold) {
+      verdict = "improvement";
+    }
+
+    printf("%-28s %12.1f %12.1f %+7.1f%% [%+6.1f%%, %+6.1f%%] %8.4f %s\n",
+           now->name, base_median, head_median, change, low, high, p,
+           verdict);
+  }
+
+  printf("%d regression%s above %.1f%% at p < %.2f\n", regressions,
+         regressions == 1 ? "" : "s", threshold, ALPHA);
+  return regressions > 0;
+}
+
+void read_results(char *file_name, result_set *set) {
+  FILE *file = fopen(file_name, "r");
+  static char line[LINE_SIZE];
+  int max_count = 16;
+
+  set->count = 0;
+  set->results = malloc(max_count * sizeof(result));
+  if (!file || !set->results) {
+    fprintf(stderr, "Error: could not read '%s'\n", file_name);
+    exit(2);
+  }
+
+  while (fgets(line, sizeof(line), file)) {
+    if (!strchr(line, '\n') && !feof(file)) {
+      fprintf(stderr, "Error: line too long in '%s'\n", file_name);
+      exit(2);
+    }
+
+    if (set->count == max_count) {
+      max_count *= 2;
+      set->results = realloc(set->results, max_count * sizeof(result));
+      if (!set->results) {
+        fprintf(stderr, "Error: memory allocation failure\n");
+        exit(2);
+      }
+    }
+
+    if (parse_result(line, &set->results[set->count]))
+      set->count++;
+  }
+  fclose(file);
+
+  if (set->count == 0) {
+    fprintf(stderr, "Error: no results with samples in '%s'\n", file_name);
+    exit(2);
+  }
+}
+
+//Reads one line of the form { "key": "text", "key": 1.5, ...,
+//"samples": [1, 2, 3] }. The string values, in order, make up the name of
+//the result; lines without samples are not results.
+bool parse_result(char *line, result *res) {
+  char *samples = strstr(line, "\"samples\": [");
+  if (!samples)
+    return false;
+
+  int length = 0;
+  res->name[0] = '\0';
+  for (char *pos = strstr(line, "\": \""); pos && pos < samples;
+       pos = strstr(pos, "\": \"")) {
+    pos += 4;
+    char *end = strchr(pos, '"');
+    if (!end)
+      break;
+    length += snprintf(res->name + length, NAME_SIZE - length, "%s%.*s",
+                       length ? " " : "", (int)(end - pos), pos);
+    if (length >= NAME_SIZE)
+      length = NAME_SIZE - 1;
+    pos = end + 1;
+  }
+
+  int max_count = 64;
+  res->count = 0;
+  res->samples = malloc(max_count * sizeof(double));
+
+  char *pos = samples + strlen("\"samples\": [");
+  while (res->samples) {
+    char *end;
+    double sample = strtod(pos, &end);
+    if (end == pos)
+      break;
+
+    if (res->count == max_count) {
+      max_count *= 2;
+      res->samples = realloc(res->samples, max_count * sizeof(double));
+      if (!res->samples)
+        break;
+    }
+    res->samples[res->count++] = sample;
+
+    pos = end;
+    while (*pos == ',' || *pos == ' ')
+      pos++;
+  }
+
+  if (!res->samples) {
+    fprintf(stderr, "Error: memory allocation failure\n");
+    exit(2);
+  }
+  return res->count > 0;
+}
+
+result *find_result(result_set *set, char *name) {
+  for (int i = 0; i < set->count; i++) {
+    if (!strcmp(set->results[i].name, name))
+      return &set->results[i];
+  }
+  return NULL;
+}
+
+double median(double values[], int count) {
+  double *copy = malloc(count * sizeof(double));
+  if (!copy) {
+    fprintf(stderr, "Error: memory allocation failure\n");
+    exit(2);
+  }
+
+  memcpy(copy, values, count * sizeof(double));
+  double result = select_kth(copy, count, count / 2);
+  if (count % 2 == 0)
+    result = (result + select_kth(copy, count, count / 2 - 1)) / 2;
+
+  free(copy);
+  return result;
+}
+
+//finds the kth smallest value, reordering values around it
+double select_kth(double values[], int count, int k) {
+  int left = 0, right = count - 1;
+
+  while (left < right) {
+    double pivot = values[(left + right) / 2];
+    int i = left, j = right;
+
+    while (i <= j) {
+      while (values[i] < pivot)
+        i++;
+      while (values[j] > pivot)
+        j--;
+      if (i <= j) {
+        double swap = values[i];
+        values[i++] = values[j];
+        values[j--] = swap;
+      }
+    }
+
+    if (k <= j)
+      right = j;
+    else if (k >= i)
+      left = i;
+    else
+      break;
+  }
+  return values[k];
+}
+
+//Returns the two-sided p-value of the Mann-Whitney U test that a and b
+//come from the same distribution, by the normal approximation with a
+//correction for ties.
+double mann_whitney(double a[], int m, double b[], int n) {
+  int total = m + n;
+  double (*pooled)[2] = malloc(total * sizeof(*pooled));
+  if (!pooled) {
+    fprintf(stderr, "Error: memory allocation failure\n");
+    exit(2);
+  }
+
+  //each entry is a value and whether it came from a; compare_double
+  //orders them by the value
+  for (int i = 0; i < total; i++) {
+    pooled[i][0] = i < m ? a[i] : b[i - m];
+    pooled[i][1] = i < m;
+  }
+  qsort(pooled, total, sizeof(*pooled), compare_double);
+
+  double rank_sum = 0, ties = 0;
+  for (int i = 0; i < total;) {
+    int j = i;
+    while (j < total && pooled[j][0] == pooled[i][0])
+      j++;
+
+    double rank = (i + 1 + j) / 2.0; //the average of ranks i+1 to j
+    for (int k = i; k < j; k++) {
+      if (pooled[k][1])
+        rank_sum += rank;
+    }
+    ties += pow(j - i, 3) - (j - i);
+    i = j;
+  }
+  free(pooled);
+
+  double u = rank_sum - m * (m + 1) / 2.0;
+  double mean = m * (double)n / 2;
+  double variance = m * (double)n / 12
+    * ((total + 1) - ties / (total * (double)(total - 1)));
+  if (variance <= 0)
+    return 1;
+
+  double z = (fabs(u - mean) - 0.5) / sqrt(variance);
+  if (z < 0)
+    z = 0;
+  return erfc(z / sqrt(2));
+}
+
+//Estimates a 95% interval for the change in the median, in percent, by
+//resampling each set with replacement. The seed is fixed, so the same
+//files always give the same interval.
+void bootstrap(double a[], int m, double b[], int n, double *low,
+               double *high) {
+  double *changes = malloc(RESAMPLES * sizeof(double));
+  double *resample = malloc((m > n ? m : n) * sizeof(double));
+  uint64_t state = 88172645463325252UL;
+  if (!changes || !resample) {
+    fprintf(stderr, "Error: memory allocation failure\n");
+    exit(2);
+  }
+
+  for (int r = 0; r < RESAMPLES; r++) {
+    for (int i = 0; i < m; i++)
+      resample[i] = a[next_random(&state) % m];
+    double base_median = median(resample, m);
+    for (int i = 0; i < n; i++)
+      resample[i] = b[next_random(&state) % n];
+    double head_median = median(resample, n);
+    changes[r] = 100 * (head_median / base_median - 1);
+  }
+
+  qsort(changes, RESAMPLES, sizeof(double), compare_double);
+  *low = changes[(int)(RESAMPLES * 0.025)];
+  *high = changes[(int)(RESAMPLES * 0.975)];
+
+  free(resample);
+  free(changes);
+}
+
+uint64_t next_random(uint64_t *state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 7;
+  *state ^= *state << 17;
+  return *state;
+}
+
+int compare_double(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
@@ -0,0 +1,247 @@
+/* bench_daemon -- compare ccalc daemon latency with cold starts.
+   Copyright (C) 2015-2017 Gregory Kikola.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Written by Gregory Kikola <gkikola@gmail.com>. */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "ring.h"
+
+#define DEFAULT_RUNS 2000
+#define BUF_SIZE 4096
+
+char *expression = "2 + 3 * 4 - sqrt(16)";
+
+long now_ns();
+void run_program(char *prog, char *args[]);
+pid_t start_daemon(char *prog, char *socket_path);
+int connect_daemon(char *socket_path);
+void round_trip(int fd, char *request, char *reply);
+void report(char *name, long samples[], int count);
+int compare_long(const void *a, const void *b);
+
+int main(int argc, char *argv[]) {
+  char *prog = (argc > 1) ? argv[1] : "../src/ccalc";
+  int runs = (argc > 2) ? atoi(argv[2]) : DEFAULT_RUNS;
+  char socket_path[108];
+  long *samples = malloc(runs * sizeof(long));
+
+  if (!samples || runs <= 0) {
+    fprintf(stderr, "Error: bad run count\n");
+    return 1;
+  }
+
+  snprintf(socket_path, sizeof(socket_path), "/tmp/bench_ccalc.%d.sock",
+           (int)getpid());
+  pid_t daemon = start_daemon(prog, socket_path);
+
+  printf("%-20s %8s %10s %10s %10s %10s\n", "mode", "runs",
+         "p50 (us)", "p90 (us)", "p99 (us)", "max (us)");
+
+  //cold start: exec a fresh ccalc for every expression
+  for (int i = 0; i < runs; i++) {
+    char *args[] = { prog, "--", expression, NULL };
+    long start = now_ns();
+    run_program(prog, args);
+    samples[i] = now_ns() - start;
+  }
+  report("cold exec", samples, runs);
+
+  //exec a thin client that forwards to the daemon
+  for (int i = 0; i < runs; i++) {
+    char *args[] = { prog, "--connect", socket_path, "--", expression, NULL };
+    long start = now_ns();
+    run_program(prog, args);
+    samples[i] = now_ns() - start;
+  }
+  report("exec --connect", samples, runs);
+
+  //one request at a time over a persistent connection
+  int fd = connect_daemon(socket_path);
+  char request[BUF_SIZE];
+  char reply[BUF_SIZE];
+  snprintf(request, BUF_SIZE, "%s\n", expression);
+  for (int i = 0; i < runs; i++) {
+    long start = now_ns();
+    round_trip(fd, request, reply);
+    samples[i] = now_ns() - start;
+  }
+  report("daemon round trip", samples, runs);
+
+  //pipelined: write every request up front, then collect the replies
+  long start = now_ns();
+  for (int i = 0; i < runs; i++) {
+    if (write(fd, request, strlen(request)) < 0) {
+      fprintf(stderr, "Error: %s\n", strerror(errno));
+      return 1;
+    }
+  }
+  int lines = 0;
+  while (lines < runs) {
+    ssize_t count = read(fd, reply, BUF_SIZE);
+    if (count <= 0)
+      break;
+    for (ssize_t j = 0; j < count; j++)
+      lines += reply[j] == '\n';
+  }
+  long elapsed = now_ns() - start;
+  printf("%-20s %8d %10.3f us/request, %.0f requests/s\n", "daemon pipelined",
+         lines, elapsed / 1000.0 / lines, lines * 1.e9 / elapsed);
+
+  close(fd);
+
+  //shared-memory ring, first one request at a time...
+  ring_client client;
+  char response[RING_TEXT_SIZE];
+  if (ring_connect(&client, socket_path) < 0) {
+    fprintf(stderr, "Error: could not set up ring: %s\n", strerror(errno));
+    return 1;
+  }
+  for (int i = 0; i < runs; i++) {
+    start = now_ns();
+    ring_submit(&client, expression);
+    ring_collect(&client, response, sizeof(response));
+    samples[i] = now_ns() - start;
+  }
+  report("ring round trip", samples, runs);
+
+  //...then with every slot in flight
+  start = now_ns();
+  for (lines = 0; lines < runs; lines++) {
+    while (ring_submit(&client, expression) < 0)
+      ring_collect(&client, response, sizeof(response));
+  }
+  while (client.tail != client.head)
+    ring_collect(&client, response, sizeof(response));
+  elapsed = now_ns() - start;
+  printf("%-20s %8d %10.3f us/request, %.0f requests/s\n", "ring pipelined",
+         lines, elapsed / 1000.0 / lines, lines * 1.e9 / elapsed);
+  ring_disconnect(&client);
+
+  kill(daemon, SIGTERM);
+  waitpid(daemon, NULL, 0);
+  free(samples);
+  return 0;
+}
+
+long now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+void run_program(char *prog, char *args[]) {
+  pid_t pid = fork();
+
+  if (pid == 0) {
+    int null_fd = open("/dev/null", O_WRONLY);
+    dup2(null_fd, STDOUT_FILENO);
+    execv(prog, args);
+    _exit(127);
+  }
+
+  int status;
+  waitpid(pid, &status, 0);
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    fprintf(stderr, "Error: '%s' failed\n", prog);
+    exit(1);
+  }
+}
+
+pid_t start_daemon(char *prog, char *socket_path) {
+  pid_t pid = fork();
+
+  if (pid == 0) {
+    execl(prog, prog, "--daemon", socket_path, (char *)NULL);
+    _exit(127);
+  }
+
+  //wait for the socket to come up
+  for (int tries = 0; tries < 200; tries++) {
+    struct timespec delay = { 0, 10000000 };
+    int fd = connect_daemon(socket_path);
+    if (fd >= 0) {
+      close(fd);
+      return pid;
+    }
+    nanosleep(&delay, NULL);
+  }
+
+  fprintf(stderr, "Error: daemon did not start\n");
+  exit(1);
+}
+
+int connect_daemon(char *socket_path) {
+  struct sockaddr_un addr;
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+
+  if (fd >= 0 && connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+void round_trip(int fd, char *request, char *reply) {
+  int length = 0;
+
+  if (write(fd, request, strlen(request)) < 0) {
+    fprintf(stderr, "Error: %s\n", strerror(errno));
+    exit(1);
+  }
+
+  while (length == 0 || reply[length - 1] != '\n') {
+    ssize_t count = read(fd, reply + length, BUF_SIZE - length);
+    if (count <= 0) {
+      fprintf(stderr, "Error: daemon closed the connection\n");
+      exit(1);
+    }
+    length += count;
+  }
+}
+
+void report(char *name, long samples[], int count) {
+  qsort(samples, count, sizeof(long), compare_long);
+
+  printf("%-20s %8d %10.1f %10.1f %10.1f %10.1f\n", name, count,
+         samples[count / 2] / 1000.0, samples[count * 90 / 100] / 1000.0,
+         samples[count * 99 / 100] / 1000.0, samples[count - 1] / 1000.0);
+}
+
+int compare_long(const void *a, const void *b) {
+  long x = *(const long *)a;
+  long y = *(const long *)b;
+  return (x > y) - (x < y);
+}
@@ -0,0 +1,159 @@
+/* bench_daemon -- compare ccalc daemon latency with cold starts.
+   Copyright (C) 2015-2017 Gregory Kikola.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Written by Gregory Kikola <gkikola@gmail.com>. */
+
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "nanbox.h"
+#include "value.h"
+
+#define MIN_BITS 10
+#define MAX_BITS 23
+#define STEPS (1L << 24)
+
+//Compares reading bindings stored as 16-byte tagged values against the
+//same bindings NaN-boxed into 8 bytes. Each value holds the index of the
+//next one to read, so every step waits on a load; once the array
+//outgrows a level of cache, the boxed array still keeps twice as many
+//values there.
+
+long now_ns();
+uint64_t next_random(uint64_t *state);
+void fill(value *vals, boxed_value *boxes, long count, bool shuffle);
+long chase_values(value *vals, long steps);
+long chase_boxes(boxed_value *boxes, long steps);
+
+int main(int argc, char *argv[]) {
+  int max_bits = (argc > 1) ? atoi(argv[1]) : MAX_BITS;
+  if (max_bits < MIN_BITS || max_bits > 30) {
+    fprintf(stderr, "Error: bad size\n");
+    return 1;
+  }
+
+  long max_count = 1L << max_bits;
+  value *vals = malloc(max_count * sizeof(value));
+  boxed_value *boxes = malloc(max_count * sizeof(boxed_value));
+  if (!vals || !boxes) {
+    fprintf(stderr, "Error: memory allocation failure\n");
+    return 1;
+  }
+
+  printf("%10s %10s %12s %12s %12s %12s\n", "values", "value KB",
+         "seq value", "seq boxed", "rand value", "rand boxed");
+
+  for (int bits = MIN_BITS; bits <= max_bits; bits++) {
+    long count = 1L << bits;
+    double ns[4];
+
+    //walk the array in order first, then along a random cycle
+    for (int i = 0; i < 4; i++) {
+      if (i % 2 == 0)
+        fill(vals, boxes, count, i >= 2);
+
+      long start = now_ns(), last;
+      if (i % 2 == 0)
+        last = chase_values(vals, STEPS);
+      else
+        last = chase_boxes(boxes, STEPS);
+      ns[i] = (double)(now_ns() - start) / STEPS;
+
+      if (last < 0 || last >= count) {
+        fprintf(stderr, "Error: bad index\n");
+        return 1;
+      }
+    }
+
+    printf("%10ld %10ld %9.2f ns %9.2f ns %9.2f ns %9.2f ns\n", count,
+           count * (long)sizeof(value) / 1024, ns[0], ns[1], ns[2], ns[3]);
+  }
+
+  free(vals);
+  free(boxes);
+  return 0;
+}
+
+long now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+uint64_t next_random(uint64_t *state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 7;
+  *state ^= *state << 17;
+  return *state;
+}
+
+void fill(value *vals, boxed_value *boxes, long count, bool shuffle) {
+  uint64_t state = 88172645463325252UL;
+  long *order = malloc(count * sizeof(long));
+  if (!order)
+    return;
+
+  //Sattolo's shuffle gives a single cycle through every index
+  for (long i = 0; i < count; i++)
+    order[i] = i;
+  for (long i = count - 1; shuffle && i > 0; i--) {
+    long j = next_random(&state) % i;
+    long swap = order[i];
+    order[i] = order[j];
+    order[j] = swap;
+  }
+
+  //store some of the links as floats, so that both tags get read
+  for (long i = 0; i < count; i++) {
+    long from = order[i], to = order[(i + 1) % count];
+    if (next_random(&state) % 4 == 0) {
+      vals[from].type = FLOAT;
+      vals[from].data.fvalue = to;
+      boxes[from] = box_float(to);
+    } else {
+      vals[from].type = INT;
+      vals[from].data.ivalue = to;
+      boxes[from] = box_int(to);
+    }
+  }
+
+  free(order);
+}
+
+long chase_values(value *vals, long steps) {
+  long index = 0;
+
+  for (long i = 0; i < steps; i++) {
+    value *val = &vals[index];
+    index = (val->type == FLOAT) ? (long)val->data.fvalue : val->data.ivalue;
+  }
+  return index;
+}
+
+long chase_boxes(boxed_value *boxes, long steps) {
+  long index = 0;
+
+  for (long i = 0; i < steps; i++) {
+    boxed_value box = boxes[index];
+    index = box_is_int(box) ? unbox_int(box) : (long)unbox_float(box);
+  }
+  return index;
+}
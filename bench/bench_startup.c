@@ -0,0 +1,188 @@
+/* bench_startup -- measure how long ccalc takes to start and exit.
+   Copyright (C) 2015-2017 Gregory Kikola.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Written by Gregory Kikola <gkikola@gmail.com>. */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define DEFAULT_RUNS 2000
+#define MAX_ARGS 4
+
+//Times a fresh ccalc process from fork to exit for expressions so small
+//that almost all of the time goes to starting up, which is what a shell
+//script calling ccalc once per line pays. The same runs of /bin/true show
+//how much of that is the cost of any process at all.
+
+typedef struct {
+  char *name;
+  char *args[MAX_ARGS]; //after the program name
+} startup_case;
+
+typedef struct {
+  char *name;
+  int runs;
+  long min, p50, p90, p99, max;
+  double mean;
+  long *samples; //every run, for bench_compare
+} result;
+
+long now_ns();
+long run_program(char *prog, char *args[]);
+void run_case(char *prog, startup_case *c, long samples[], int runs,
+              result *res);
+int compare_long(const void *a, const void *b);
+void write_json(char *file_name, char *prog, result results[], int count);
+
+startup_case cases[] = {
+  { "true", { NULL } },
+  { "integer", { "--", "1", NULL } },
+  { "arithmetic", { "--", "2 + 3 * 4", NULL } },
+  { "split arguments", { "--", "2 +", "3 * 4", NULL } },
+  { "function", { "--", "sqrt(2)", NULL } },
+  { "hexadecimal", { "--hexadecimal", "--", "255", NULL } },
+};
+
+#define NUM_CASES ((int)(sizeof(cases) / sizeof(startup_case)))
+
+int main(int argc, char *argv[]) {
+  char *prog = (argc > 1) ? argv[1] : "../src/ccalc";
+  char *json = (argc > 2) ? argv[2] : "bench_startup.json";
+  int runs = (argc > 3) ? atoi(argv[3]) : DEFAULT_RUNS;
+  long *samples = malloc(runs * sizeof(long));
+  result results[NUM_CASES];
+
+  if (!samples || runs <= 0) {
+    fprintf(stderr, "Error: bad run count\n");
+    return 1;
+  }
+
+  printf("%-20s %8s %10s %10s %10s %10s %10s\n", "expression", "runs",
+         "min (us)", "p50 (us)", "p90 (us)", "p99 (us)", "mean (us)");
+
+  for (int i = 0; i < NUM_CASES; i++) {
+    char *case_prog = i == 0 ? "/bin/true" : prog;
+    result *res = &results[i];
+
+    run_case(case_prog, &cases[i], samples, runs, res);
+    printf("%-20s %8d %10.1f %10.1f %10.1f %10.1f %10.1f\n", res->name,
+           res->runs, res->min / 1000.0, res->p50 / 1000.0, res->p90 / 1000.0,
+           res->p99 / 1000.0, res->mean / 1000.0);
+  }
+
+  write_json(json, prog, results, NUM_CASES);
+  printf("results written to %s\n", json);
+  free(samples);
+  return 0;
+}
+
+long now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+//runs prog with output discarded and returns the time from fork until it
+//has been reaped, in nanoseconds
+long run_program(char *prog, char *args[]) {
+  long start = now_ns();
+  pid_t pid = fork();
+
+  if (pid == 0) {
+    int null_fd = open("/dev/null", O_WRONLY);
+    dup2(null_fd, STDOUT_FILENO);
+    execv(prog, args);
+    _exit(127);
+  }
+
+  int status;
+  waitpid(pid, &status, 0);
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    fprintf(stderr, "Error: '%s' failed\n", prog);
+    exit(1);
+  }
+  return now_ns() - start;
+}
+
+void run_case(char *prog, startup_case *c, long samples[], int runs,
+              result *res) {
+  char *args[MAX_ARGS + 1] = { prog };
+  memcpy(args + 1, c->args, sizeof(c->args));
+
+  //one untimed run, so that the program is in the page cache
+  run_program(prog, args);
+
+  double sum = 0;
+  for (int i = 0; i < runs; i++) {
+    samples[i] = run_program(prog, args);
+    sum += samples[i];
+  }
+  qsort(samples, runs, sizeof(long), compare_long);
+
+  res->name = c->name;
+  res->runs = runs;
+  res->min = samples[0];
+  res->p50 = samples[runs / 2];
+  res->p90 = samples[(long)runs * 90 / 100];
+  res->p99 = samples[(long)runs * 99 / 100];
+  res->max = samples[runs - 1];
+  res->mean = sum / runs;
+
+  res->samples = malloc(runs * sizeof(long));
+  if (!res->samples) {
+    fprintf(stderr, "Error: memory allocation failure\n");
+    exit(1);
+  }
+  memcpy(res->samples, samples, runs * sizeof(long));
+}
+
+int compare_long(const void *a, const void *b) {
+  long x = *(const long *)a, y = *(const long *)b;
+  return (x > y) - (x < y);
+}
+
+void write_json(char *file_name, char *prog, result results[], int count) {
+  FILE *file = fopen(file_name, "w");
+
+  if (!file) {
+    fprintf(stderr, "Error: could not write '%s'\n", file_name);
+    exit(1);
+  }
+
+  fprintf(file, "{\n  \"program\": \"%s\",\n  \"results\": [\n", prog);
+  for (int i = 0; i < count; i++) {
+    result *res = &results[i];
+    fprintf(file, "    { \"expression\": \"%s\", \"runs\": %d, "
+            "\"min_ns\": %ld, \"p50_ns\": %ld, \"p90_ns\": %ld, "
+            "\"p99_ns\": %ld, \"max_ns\": %ld, \"mean_ns\": %.0f, "
+            "\"samples\": [", res->name, res->runs, res->min, res->p50,
+            res->p90, res->p99, res->max, res->mean);
+    for (int j = 0; j < res->runs; j++)
+      fprintf(file, "%s%ld", j ? ", " : "", res->samples[j]);
+    fprintf(file, "] }%s\n", i + 1 < count ? "," : "");
+    free(res->samples);
+  }
+  fprintf(file, "  ]\n}\n");
+  fclose(file);
+}
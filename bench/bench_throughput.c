@@ -0,0 +1,361 @@
+/* bench_throughput -- measure ccalc throughput on synthetic input.
+   Copyright (C) 2015-2017 Gregory Kikola.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Written by Gregory Kikola <gkikola@gmail.com>. */
+
+#define _GNU_SOURCE
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define DEFAULT_LINES 100000
+#define RUNS 5
+#define SINGLE_LINES 200
+#define LINE_SIZE 1024
+#define NESTING_DEPTH 24
+
+//Generates one corpus of expressions for each kind of work ccalc does and
+//times it two ways: every line piped through one process on standard
+//input, and a fresh process for each of the first few lines. The corpora
+//come from a fixed seed, so every run and every build sees the same input.
+
+typedef struct {
+  char *name;
+  char *option; //given to ccalc along with the corpus, or NULL
+  void (*generate)(char *line, int size, uint64_t *state);
+} corpus;
+
+typedef struct {
+  char *corpus;
+  char *path;
+  long lines;
+  long ns; //median over the runs
+  long min_ns;
+  long samples[RUNS]; //every run, for bench_compare
+} result;
+
+long now_ns();
+uint64_t next_random(uint64_t *state);
+long random_int(uint64_t *state, long low, long high);
+int append(char *line, int size, int length, char *format, ...);
+void short_arithmetic(char *line, int size, uint64_t *state);
+void literal_heavy(char *line, int size, uint64_t *state);
+void function_heavy(char *line, int size, uint64_t *state);
+void deeply_nested(char *line, int size, uint64_t *state);
+void integer_radix(char *line, int size, uint64_t *state);
+void float_output(char *line, int size, uint64_t *state);
+void write_corpus(corpus *c, char *file_name, long lines);
+char **read_lines(char *file_name, long count);
+long run_program(char *prog, char *args[], char *input);
+void run_stdin(char *prog, corpus *c, char *file_name, long lines,
+               result *res);
+void run_single(char *prog, corpus *c, char *file_name, result *res);
+int compare_long(const void *a, const void *b);
+void print_result(result *res);
+void write_json(char *file_name, char *prog, result results[], int count);
+
+corpus corpora[] = {
+  { "short", NULL, short_arithmetic },
+  { "literals", NULL, literal_heavy },
+  { "functions", NULL, function_heavy },
+  { "nested", NULL, deeply_nested },
+  { "radix", "--hexadecimal", integer_radix },
+  { "float", "--precision=12", float_output },
+};
+
+#define NUM_CORPORA ((int)(sizeof(corpora) / sizeof(corpus)))
+
+int main(int argc, char *argv[]) {
+  char *prog = (argc > 1) ? argv[1] : "../src/ccalc";
+  char *json = (argc > 2) ? argv[2] : "bench_throughput.json";
+  long lines = (argc > 3) ? atol(argv[3]) : DEFAULT_LINES;
+  result results[2 * NUM_CORPORA];
+  int count = 0;
+
+  if (lines < SINGLE_LINES) {
+    fprintf(stderr, "Error: need at least %d lines\n", SINGLE_LINES);
+    return 1;
+  }
+
+  printf("%-10s %-8s %8s %12s %12s %14s\n", "corpus", "path", "lines",
+         "ns/line", "min ns/line", "lines/s");
+
+  for (int i = 0; i < NUM_CORPORA; i++) {
+    char file_name[64];
+    snprintf(file_name, sizeof(file_name), "corpus-%s.txt", corpora[i].name);
+    write_corpus(&corpora[i], file_name, lines);
+
+    run_stdin(prog, &corpora[i], file_name, lines, &results[count]);
+    print_result(&results[count++]);
+    run_single(prog, &corpora[i], file_name, &results[count]);
+    print_result(&results[count++]);
+  }
+
+  write_json(json, prog, results, count);
+  printf("results written to %s\n", json);
+  return 0;
+}
+
+long now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+uint64_t next_random(uint64_t *state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 7;
+  *state ^= *state << 17;
+  return *state;
+}
+
+long random_int(uint64_t *state, long low, long high) {
+  return low + (long)(next_random(state) % (uint64_t)(high - low + 1));
+}
+
+int append(char *line, int size, int length, char *format, ...) {
+  va_list args;
+
+  if (length >= size)
+    return length;
+  va_start(args, format);
+  length += vsnprintf(line + length, size - length, format, args);
+  va_end(args);
+  return length;
+}
+
+//two or three small integers, the bulk of interactive use
+void short_arithmetic(char *line, int size, uint64_t *state) {
+  static char *ops[] = { "+", "-", "*" };
+  int length = snprintf(line, size, "%ld %s %ld", random_int(state, 1, 999),
+                        ops[next_random(state) % 3],
+                        random_int(state, 1, 999));
+  if (next_random(state) % 2)
+    append(line, size, length, " %s %ld", ops[next_random(state) % 3],
+           random_int(state, 1, 999));
+}
+
+//many literals and few operators, so lexing and number parsing dominate
+void literal_heavy(char *line, int size, uint64_t *state) {
+  int length = 0;
+
+  for (int i = 0; i < 16; i++) {
+    if (i > 0)
+      length = append(line, size, length, " %c ",
+                      next_random(state) % 2 ? '+' : '-');
+    if (next_random(state) % 2)
+      length = append(line, size, length, "%ld",
+                      random_int(state, 0, 99999999));
+    else
+      length = append(line, size, length, "%ld.%03ld",
+                      random_int(state, 0, 99999), random_int(state, 0, 999));
+  }
+}
+
+//calls to the math library with arguments in their domains
+void function_heavy(char *line, int size, uint64_t *state) {
+  snprintf(line, size, "sqrt(%ld) + sin(%ld.%ld) * log(%ld) - cos(%ld) + "
+           "exp(%ld / 100.0) + atan2(%ld, %ld)", random_int(state, 0, 9999),
+           random_int(state, 0, 99), random_int(state, 0, 9),
+           random_int(state, 1, 9999), random_int(state, 0, 999),
+           random_int(state, -500, 500), random_int(state, -99, 99),
+           random_int(state, 1, 99));
+}
+
+//parentheses nested on both sides, to exercise recursion in the parser
+void deeply_nested(char *line, int size, uint64_t *state) {
+  int length = 0;
+
+  for (int i = 0; i < NESTING_DEPTH / 2; i++)
+    length = append(line, size, length, "(");
+  for (int i = 0; i < NESTING_DEPTH; i++)
+    length = append(line, size, length, "(%ld %c ",
+                    random_int(state, 1, 99),
+                    next_random(state) % 2 ? '+' : '-');
+  length = append(line, size, length, "%ld", random_int(state, 1, 99));
+  for (int i = 0; i < NESTING_DEPTH; i++)
+    length = append(line, size, length, ")");
+  for (int i = 0; i < NESTING_DEPTH / 2; i++)
+    length = append(line, size, length, " %c %ld)",
+                    next_random(state) % 2 ? '+' : '-',
+                    random_int(state, 1, 99));
+}
+
+//wide integer results, printed in hexadecimal
+void integer_radix(char *line, int size, uint64_t *state) {
+  snprintf(line, size, "%ld * %ld + %ld", random_int(state, 1, 999999999),
+           random_int(state, 1, 999999), random_int(state, 0, 999999999));
+}
+
+//quotients printed with many digits
+void float_output(char *line, int size, uint64_t *state) {
+  snprintf(line, size, "%ld.%ld / %ld.%ld", random_int(state, 0, 99999),
+           random_int(state, 0, 999), random_int(state, 1, 999),
+           random_int(state, 1, 99));
+}
+
+void write_corpus(corpus *c, char *file_name, long lines) {
+  FILE *file = fopen(file_name, "w");
+  uint64_t state = 88172645463325252UL;
+  char line[LINE_SIZE];
+
+  if (!file) {
+    fprintf(stderr, "Error: could not write '%s'\n", file_name);
+    exit(1);
+  }
+
+  for (long i = 0; i < lines; i++) {
+    c->generate(line, sizeof(line), &state);
+    fprintf(file, "%s\n", line);
+  }
+  fclose(file);
+}
+
+char **read_lines(char *file_name, long count) {
+  FILE *file = fopen(file_name, "r");
+  char **lines = malloc(count * sizeof(char *));
+  char line[LINE_SIZE];
+
+  if (!file || !lines) {
+    fprintf(stderr, "Error: could not read '%s'\n", file_name);
+    exit(1);
+  }
+
+  for (long i = 0; i < count && fgets(line, sizeof(line), file); i++) {
+    line[strcspn(line, "\n")] = '\0';
+    lines[i] = strdup(line);
+  }
+  fclose(file);
+  return lines;
+}
+
+//runs prog with input (or nothing) on standard input and returns the time
+//it took, in nanoseconds
+long run_program(char *prog, char *args[], char *input) {
+  long start = now_ns();
+  pid_t pid = fork();
+
+  if (pid == 0) {
+    int null_fd = open("/dev/null", O_WRONLY);
+    int in_fd = open(input ? input : "/dev/null", O_RDONLY);
+    dup2(null_fd, STDOUT_FILENO);
+    dup2(in_fd, STDIN_FILENO);
+    execv(prog, args);
+    _exit(127);
+  }
+
+  int status;
+  waitpid(pid, &status, 0);
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    fprintf(stderr, "Error: '%s' failed\n", prog);
+    exit(1);
+  }
+  return now_ns() - start;
+}
+
+void run_stdin(char *prog, corpus *c, char *file_name, long lines,
+               result *res) {
+  char *args[] = { prog, c->option, NULL };
+  long samples[RUNS];
+
+  for (int i = 0; i < RUNS; i++)
+    samples[i] = run_program(prog, args, file_name);
+  qsort(samples, RUNS, sizeof(long), compare_long);
+  memcpy(res->samples, samples, sizeof(samples));
+
+  res->corpus = c->name;
+  res->path = "stdin";
+  res->lines = lines;
+  res->ns = samples[RUNS / 2];
+  res->min_ns = samples[0];
+}
+
+void run_single(char *prog, corpus *c, char *file_name, result *res) {
+  char **lines = read_lines(file_name, SINGLE_LINES);
+  long samples[RUNS];
+
+  for (int i = 0; i < RUNS; i++) {
+    samples[i] = 0;
+    for (int j = 0; j < SINGLE_LINES; j++) {
+      char *args[] = { prog, "--", lines[j], NULL, NULL };
+      if (c->option) { //options go before the expression
+        args[1] = c->option;
+        args[2] = "--";
+        args[3] = lines[j];
+      }
+      samples[i] += run_program(prog, args, NULL);
+    }
+  }
+  qsort(samples, RUNS, sizeof(long), compare_long);
+  memcpy(res->samples, samples, sizeof(samples));
+
+  res->corpus = c->name;
+  res->path = "single";
+  res->lines = SINGLE_LINES;
+  res->ns = samples[RUNS / 2];
+  res->min_ns = samples[0];
+
+  for (int j = 0; j < SINGLE_LINES; j++)
+    free(lines[j]);
+  free(lines);
+}
+
+int compare_long(const void *a, const void *b) {
+  long x = *(const long *)a, y = *(const long *)b;
+  return (x > y) - (x < y);
+}
+
+void print_result(result *res) {
+  printf("%-10s %-8s %8ld %12.1f %12.1f %14.0f\n", res->corpus, res->path,
+         res->lines, (double)res->ns / res->lines,
+         (double)res->min_ns / res->lines, res->lines * 1.e9 / res->ns);
+}
+
+void write_json(char *file_name, char *prog, result results[], int count) {
+  FILE *file = fopen(file_name, "w");
+
+  if (!file) {
+    fprintf(stderr, "Error: could not write '%s'\n", file_name);
+    exit(1);
+  }
+
+  fprintf(file, "{\n  \"program\": \"%s\",\n  \"runs\": %d,\n"
+          "  \"results\": [\n", prog, RUNS);
+  for (int i = 0; i < count; i++) {
+    result *res = &results[i];
+    fprintf(file, "    { \"corpus\": \"%s\", \"path\": \"%s\", "
+            "\"lines\": %ld, \"ns_per_line\": %.1f, "
+            "\"min_ns_per_line\": %.1f, \"lines_per_sec\": %.0f, "
+            "\"samples\": [", res->corpus, res->path, res->lines,
+            (double)res->ns / res->lines, (double)res->min_ns / res->lines,
+            res->lines * 1.e9 / res->ns);
+    for (int j = 0; j < RUNS; j++)
+      fprintf(file, "%s%.1f", j ? ", " : "",
+              (double)res->samples[j] / res->lines);
+    fprintf(file, "] }%s\n", i + 1 < count ? "," : "");
+  }
+  fprintf(file, "  ]\n}\n");
+  fclose(file);
+}
@@ -0,0 +1,238 @@
+/* bench_value -- time value.c primitives, lookups and formatting.
+   Copyright (C) 2015-2017 Gregory Kikola.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Written by Gregory Kikola <gkikola@gmail.com>. */
+
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "evaluate.h"
+#include "options.h"
+#include "output.h"
+#include "value.h"
+
+#define RUNS 31
+#define MIN_RUN_NS 200000
+#define MAX_ARGS 8
+
+#define INT_VALUE(x) { { .ivalue = (x) }, INT }
+#define FLOAT_VALUE(x) { { .fvalue = (x) }, FLOAT }
+
+//Times the building blocks every evaluation is made of, one at a time and
+//in process, so that a change to dispatch or formatting shows up here
+//before it is lost in the noise of a whole run. Each case is repeated in
+//a loop long enough to time, and the loop is run RUNS times.
+
+typedef enum {
+  BINARY, //op on two values
+  ROUND, //round_to_int
+  CONSTANT, //get_constant on text
+  FUNCTION, //call_function on text
+  LITERAL, //evaluate text, a bare literal
+  PRINT, //print_value with the options in text
+} case_kind;
+
+typedef struct {
+  char *name;
+  case_kind kind;
+  void (*op)(value *, value *, value *);
+  char *text;
+  int argc;
+  value args[3];
+} bench_case;
+
+long now_ns();
+long run_case(bench_case *c, options *opts, FILE *sink, long count);
+void read_case_options(char *text, options *opts);
+int compare_long(const void *a, const void *b);
+
+bench_case cases[] = {
+  { "add int", BINARY, add, NULL, 2, { INT_VALUE(12345), INT_VALUE(678) } },
+  { "add float", BINARY, add, NULL, 2,
+    { FLOAT_VALUE(1.5), INT_VALUE(678) } },
+  { "add int overflow", BINARY, add, NULL, 2,
+    { INT_VALUE(9223372036854775807L), INT_VALUE(1) } },
+  { "subtract int", BINARY, subtract, NULL, 2,
+    { INT_VALUE(12345), INT_VALUE(678) } },
+  { "multiply int", BINARY, multiply, NULL, 2,
+    { INT_VALUE(12345), INT_VALUE(678) } },
+  { "multiply float", BINARY, multiply, NULL, 2,
+    { FLOAT_VALUE(1.5), FLOAT_VALUE(2.25) } },
+  { "divide int exact", BINARY, divide, NULL, 2,
+    { INT_VALUE(12344), INT_VALUE(8) } },
+  { "divide int inexact", BINARY, divide, NULL, 2,
+    { INT_VALUE(12345), INT_VALUE(8) } },
+  { "divide float", BINARY, divide, NULL, 2,
+    { FLOAT_VALUE(1.5), FLOAT_VALUE(2.25) } },
+  { "int_divide", BINARY, int_divide, NULL, 2,
+    { INT_VALUE(12345), INT_VALUE(8) } },
+  { "modulo", BINARY, modulo, NULL, 2, { INT_VALUE(12345), INT_VALUE(8) } },
+  { "power int", BINARY, power, NULL, 2, { INT_VALUE(3), INT_VALUE(13) } },
+  { "power float", BINARY, power, NULL, 2,
+    { FLOAT_VALUE(2.5), FLOAT_VALUE(1.5) } },
+  { "power negative", BINARY, power, NULL, 2,
+    { INT_VALUE(2), INT_VALUE(-3) } },
+  { "power int overflow", BINARY, power, NULL, 2,
+    { INT_VALUE(3), INT_VALUE(41) } },
+  { "shift left", BINARY, bit_shift_left, NULL, 2,
+    { INT_VALUE(12345), INT_VALUE(7) } },
+  { "shift right", BINARY, bit_shift_right, NULL, 2,
+    { INT_VALUE(12345), INT_VALUE(7) } },
+  { "equal int", BINARY, equal, NULL, 2,
+    { INT_VALUE(12345), INT_VALUE(678) } },
+  { "less_than int", BINARY, less_than, NULL, 2,
+    { INT_VALUE(12345), INT_VALUE(678) } },
+  { "less_than float", BINARY, less_than, NULL, 2,
+    { FLOAT_VALUE(1.5), INT_VALUE(678) } },
+  { "round_to_int float", ROUND, NULL, NULL, 1, { FLOAT_VALUE(1234.75) } },
+  { "round_to_int int", ROUND, NULL, NULL, 1, { INT_VALUE(1234) } },
+  { "constant PI (first)", CONSTANT, NULL, "PI", 0, { } },
+  { "constant USHRT_MAX (last)", CONSTANT, NULL, "USHRT_MAX", 0, { } },
+  { "function pow (first)", FUNCTION, NULL, "pow", 2,
+    { INT_VALUE(3), INT_VALUE(13) } },
+  { "function sqrt", FUNCTION, NULL, "sqrt", 1, { FLOAT_VALUE(2.0) } },
+  { "function powmod", FUNCTION, NULL, "powmod", 3,
+    { INT_VALUE(3), INT_VALUE(1000000), INT_VALUE(1000000007) } },
+  { "function min (last)", FUNCTION, NULL, "min", 2,
+    { INT_VALUE(3), INT_VALUE(13) } },
+  { "literal int", LITERAL, NULL, "1234567", 0, { } },
+  { "literal float", LITERAL, NULL, "1234.5678", 0, { } },
+  { "literal exponent", LITERAL, NULL, "1.25e-7", 0, { } },
+  { "literal hex", LITERAL, NULL, "0x1f2e3d", 0, { } },
+  { "print int", PRINT, NULL, "", 1, { INT_VALUE(1234567) } },
+  { "print int hex", PRINT, NULL, "--hexadecimal", 1,
+    { INT_VALUE(1234567) } },
+  { "print int binary", PRINT, NULL, "--binary", 1, { INT_VALUE(1234567) } },
+  { "print int grouped", PRINT, NULL, "--grouping=3", 1,
+    { INT_VALUE(1234567) } },
+  { "print float", PRINT, NULL, "", 1, { FLOAT_VALUE(1234.5678) } },
+  { "print float precise", PRINT, NULL, "--precision=15", 1,
+    { FLOAT_VALUE(1234.5678) } },
+  { "print float scientific", PRINT, NULL, "--scientific-notation", 1,
+    { FLOAT_VALUE(1234.5678) } },
+};
+
+#define NUM_CASES ((int)(sizeof(cases) / sizeof(bench_case)))
+
+static arena wide_values;
+
+int main(int argc, char *argv[]) {
+  char *filter = (argc > 1) ? argv[1] : NULL;
+  FILE *sink = fopen("/dev/null", "w");
+  long samples[RUNS];
+
+  if (!sink) {
+    fprintf(stderr, "Error: could not open /dev/null\n");
+    return 1;
+  }
+
+  printf("%-28s %12s %12s %12s\n", "operation", "ops/run", "min ns/op",
+         "median ns/op");
+
+  //overflowing cases make a 128-bit result every time round the loop
+  arena_init(&wide_values, 4096);
+  set_wide_arena(&wide_values);
+
+  for (int i = 0; i < NUM_CASES; i++) {
+    bench_case *c = &cases[i];
+    options opts;
+
+    if (filter && !strstr(c->name, filter))
+      continue;
+    read_case_options(c->text && c->kind == PRINT ? c->text : "", &opts);
+
+    //grow the loop until one run is long enough to time reliably
+    long count = 1000;
+    while (run_case(c, &opts, sink, count) < MIN_RUN_NS)
+      count *= 2;
+
+    for (int run = 0; run < RUNS; run++)
+      samples[run] = run_case(c, &opts, sink, count);
+    qsort(samples, RUNS, sizeof(long), compare_long);
+
+    printf("%-28s %12ld %12.2f %12.2f\n", c->name, count,
+           (double)samples[0] / count, (double)samples[RUNS / 2] / count);
+  }
+
+  fclose(sink);
+  arena_free(&wide_values);
+  return 0;
+}
+
+long now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+//runs the case count times and returns the time it took in nanoseconds
+long run_case(bench_case *c, options *opts, FILE *sink, long count) {
+  value args[MAX_ARGS], result;
+  long start = now_ns();
+
+  switch (c->kind) {
+  case BINARY:
+    for (long i = 0; i < count; i++)
+      c->op(&c->args[0], &c->args[1], &result);
+    break;
+  case ROUND:
+    for (long i = 0; i < count; i++) {
+      result = c->args[0];
+      round_to_int(&result);
+    }
+    break;
+  case CONSTANT:
+    for (long i = 0; i < count; i++)
+      get_constant(c->text, &result);
+    break;
+  case FUNCTION:
+    for (long i = 0; i < count; i++) {
+      //call_function may write over its arguments
+      memcpy(args, c->args, c->argc * sizeof(value));
+      call_function(c->text, &result, c->argc, args, false);
+    }
+    break;
+  case LITERAL:
+    for (long i = 0; i < count; i++)
+      evaluate(c->text, &result, opts);
+    break;
+  case PRINT:
+    for (long i = 0; i < count; i++)
+      print_value(sink, &c->args[0], opts);
+    break;
+  }
+
+  long elapsed = now_ns() - start;
+  arena_reset(&wide_values);
+  return elapsed;
+}
+
+void read_case_options(char *text, options *opts) {
+  char *argv[] = { "bench_value", text, NULL };
+  int expr_index;
+
+  read_options(*text ? 2 : 1, argv, &expr_index, opts);
+}
+
+int compare_long(const void *a, const void *b) {
+  long x = *(const long *)a, y = *(const long *)b;
+  return (x > y) - (x < y);
+}
@@ -0,0 +1,131 @@
+/* ccalc -- evaluate C-style expressions from the command line.
+   Copyright (C) 2015-2017 Gregory Kikola.
+
+   This file is part of ccalc.
+
+   ccalc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   ccalc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with ccalc.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Written by Gregory Kikola <gkikola@gmail.com>. */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "error.h"
+
+arena_chunk *new_chunk(arena *mem, size_t size);
+
+void arena_init(arena *mem, size_t chunk_size) {
+  mem->first = NULL;
+  mem->current = NULL;
+  mem->chunk_size = chunk_size;
+  mem->used = 0;
+  mem->peak = 0;
+  mem->allocations = 0;
+  mem->heap_allocations = 0;
+  mem->resets = 0;
+}
+
+void arena_free(arena *mem) {
+  arena_chunk *chunk = mem->first;
+  while (chunk) {
+    arena_chunk *next = chunk->next;
+    free(chunk);
+    chunk = next;
+  }
+
+  mem->first = mem->current = NULL;
+}
+
+void arena_reset(arena *mem) {
+  //keep every chunk for the next round
+  for (arena_chunk *chunk = mem->first; chunk; chunk = chunk->next)
+    chunk->used = 0;
+
+  mem->current = mem->first;
+  mem->used = 0;
+  mem->resets++;
+}
+
+void *arena_alloc(arena *mem, size_t size) {
+  size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+
+  //move on to a later chunk, or a new one, if this one is full
+  arena_chunk *chunk = mem->current;
+  while (chunk && chunk->size - chunk->used < size)
+    chunk = chunk->next;
+  if (!chunk)
+    chunk = new_chunk(mem, size);
+
+  void *ptr = chunk->data + chunk->used;
+  chunk->used += size;
+  mem->current = chunk;
+
+  mem->used += size;
+  if (mem->used > mem->peak)
+    mem->peak = mem->used;
+  mem->allocations++;
+  return ptr;
+}
+
+void *arena_grow(arena *mem, void *ptr, size_t old_size, size_t new_size) {
+  arena_chunk *chunk = mem->current;
+  old_size = (old_size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+  new_size = (new_size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+  if (new_size <= old_size)
+    return ptr;
+
+  //the most recent allocation can be extended where it lies
+  if (ptr && chunk && (char *)ptr + old_size == chunk->data + chunk->used
+      && chunk->size - chunk->used >= new_size - old_size) {
+    chunk->used += new_size - old_size;
+    mem->used += new_size - old_size;
+    if (mem->used > mem->peak)
+      mem->peak = mem->used;
+    return ptr;
+  }
+
+  void *new_ptr = arena_alloc(mem, new_size);
+  if (ptr)
+    memcpy(new_ptr, ptr, old_size);
+  return new_ptr;
+}
+
+arena_chunk *new_chunk(arena *mem, size_t size) {
+  //each new chunk at least doubles, so that a long line needs only a few
+  //of them and the chunks kept never add up to much more than the peak
+  if (size < mem->chunk_size)
+    size = mem->chunk_size;
+  if (mem->current && size < 2 * mem->current->size)
+    size = 2 * mem->current->size;
+
+  arena_chunk *chunk = malloc(sizeof(arena_chunk) + size);
+  if (!chunk)
+    raise_error(ERROR_SYS, "memory allocation failure");
+
+  chunk->size = size;
+  chunk->used = 0;
+  mem->heap_allocations++;
+
+  //chain it after the current chunk so a reset finds it again
+  if (mem->current) {
+    chunk->next = mem->current->next;
+    mem->current->next = chunk;
+  } else {
+    chunk->next = mem->first;
+    mem->first = chunk;
+  }
+  return chunk;
+}
@@ -0,0 +1,58 @@
+/* ccalc -- evaluate C-style expressions from the command line.
+   Copyright (C) 2015-2017 Gregory Kikola.
+
+   This file is part of ccalc.
+
+   ccalc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   ccalc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with ccalc.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Written by Gregory Kikola <gkikola@gmail.com>. */
+
+#ifndef CCALC_ARENA_H
+#define CCALC_ARENA_H
+
+#include <stddef.h>
+
+#define ARENA_ALIGN 16 //enough for a 128-bit integer
+
+//A bump allocator for memory that only lives until the next reset, such
+//as everything belonging to one line of input. Allocating moves a
+//pointer along the current chunk, and a reset makes every chunk free
+//again at once without returning them to the heap.
+typedef struct arena_chunk {
+  struct arena_chunk *next;
+  size_t size;
+  size_t used;
+  _Alignas(ARENA_ALIGN) char data[];
+} arena_chunk;
+
+typedef struct {
+  arena_chunk *first;
+  arena_chunk *current;
+  size_t chunk_size;
+  size_t used; //bytes handed out since the last reset
+  size_t peak;
+  long allocations;
+  long heap_allocations; //chunks taken from malloc
+  long resets;
+} arena;
+
+void arena_init(arena *mem, size_t chunk_size);
+void arena_free(arena *mem);
+void arena_reset(arena *mem);
+
+void *arena_alloc(arena *mem, size_t size);
+void *arena_grow(arena *mem, void *ptr, size_t old_size, size_t new_size);
+
+#endif
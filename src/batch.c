@@ -0,0 +1,672 @@
+/* ccalc -- evaluate C-style expressions from the command line.
+   Copyright (C) 2015-2017 Gregory Kikola.
+
+   This file is part of ccalc.
+
+   ccalc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   ccalc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with ccalc.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Written by Gregory Kikola <gkikola@gmail.com>. */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "batch.h"
+#include "error.h"
+#include "vmath.h"
+
+#ifndef PI
+#define PI 3.141592653589793238462643
+#endif
+
+#define BINARY_KERNEL(name, out_type, in_type, op)                      \
+  KERNEL void name(out_type *restrict out, in_type *restrict left,       \
+                   in_type *restrict right, int count) {                 \
+    for (int i = 0; i < count; i++)                                      \
+      out[i] = left[i] op right[i];                                      \
+  }
+
+//integer arithmetic that reports whether any lane overflowed, so that the
+//block can be redone a lane at a time with wider values
+#define CHECKED_KERNEL(name, builtin)                                   \
+  KERNEL bool name(long *restrict out, long *restrict left,              \
+                   long *restrict right, int count) {                    \
+    bool overflow = false;                                               \
+    for (int i = 0; i < count; i++)                                      \
+      overflow |= builtin(left[i], right[i], &out[i]);                   \
+    return !overflow;                                                    \
+  }
+
+#define UNARY_KERNEL(name, out_type, in_type, op)                       \
+  KERNEL void name(out_type *restrict out, in_type *restrict right,      \
+                   int count) {                                          \
+    for (int i = 0; i < count; i++)                                      \
+      out[i] = op right[i];                                              \
+  }
+
+int count_nodes(expr_node *node);
+void fill_constants(block_program *prog, expr_node *node, int *next);
+void box_lanes(value_block *block, int count);
+boxed_value box_integer(value_block *block, value *val);
+value_block *run_node(block_program *prog, expr_node *node, int *next,
+                      value_block columns[], int num_columns, int count,
+                      options *opts);
+double *float_lanes(block_program *prog, value_block *block, int slot,
+                    int count);
+bool run_float_kernel(operator_type op, double *left, double *right,
+                      value_block *out, int count);
+bool run_int_kernel(operator_type op, long *left, long *right,
+                    value_block *out, int count);
+bool run_unary_kernel(operator_type op, value_block *right,
+                      value_block *out, int count);
+void run_operator(block_program *prog, operator_type op, value_block *left,
+                  value_block *right, value_block *out, int count);
+void run_lanes(operator_type op, value_block *left, value_block *right,
+               value_block *out, int count);
+void run_conditional(value_block *argv[], value_block *out, int count);
+void run_function(block_program *prog, expr_node *node, value_block *argv[],
+                  value_block *out, int count, options *opts);
+bool run_vector_function(block_program *prog, expr_node *node,
+                         value_block *argv[], value_block *out, int count,
+                         options *opts);
+vector_function find_vector_function(char *identifier);
+
+BINARY_KERNEL(add_float, double, double, +)
+BINARY_KERNEL(subtract_float, double, double, -)
+BINARY_KERNEL(multiply_float, double, double, *)
+BINARY_KERNEL(divide_float, double, double, /)
+BINARY_KERNEL(equal_float, long, double, ==)
+BINARY_KERNEL(not_equal_float, long, double, !=)
+BINARY_KERNEL(less_than_float, long, double, <)
+BINARY_KERNEL(less_than_eq_float, long, double, <=)
+BINARY_KERNEL(greater_than_float, long, double, >)
+BINARY_KERNEL(greater_than_eq_float, long, double, >=)
+BINARY_KERNEL(and_float, long, double, &&)
+BINARY_KERNEL(or_float, long, double, ||)
+UNARY_KERNEL(negate_float, double, double, -)
+UNARY_KERNEL(not_float, long, double, !)
+
+CHECKED_KERNEL(add_int, __builtin_add_overflow)
+CHECKED_KERNEL(subtract_int, __builtin_sub_overflow)
+CHECKED_KERNEL(multiply_int, __builtin_mul_overflow)
+BINARY_KERNEL(equal_int, long, long, ==)
+BINARY_KERNEL(not_equal_int, long, long, !=)
+BINARY_KERNEL(less_than_int, long, long, <)
+BINARY_KERNEL(less_than_eq_int, long, long, <=)
+BINARY_KERNEL(greater_than_int, long, long, >)
+BINARY_KERNEL(greater_than_eq_int, long, long, >=)
+BINARY_KERNEL(and_int, long, long, &&)
+BINARY_KERNEL(or_int, long, long, ||)
+BINARY_KERNEL(bit_and_int, long, long, &)
+BINARY_KERNEL(bit_or_int, long, long, |)
+BINARY_KERNEL(bit_xor_int, long, long, ^)
+BINARY_KERNEL(bit_shift_right_int, long, long, >>)
+UNARY_KERNEL(not_int, long, long, !)
+UNARY_KERNEL(bit_not_int, long, long, ~)
+UNARY_KERNEL(int_to_float, double, long, (double))
+
+KERNEL bool negate_int(long *restrict out, long *restrict right, int count) {
+  bool overflow = false;
+  for (int i = 0; i < count; i++)
+    overflow |= __builtin_sub_overflow(0L, right[i], &out[i]);
+  return !overflow;
+}
+
+KERNEL bool bit_shift_left_int(long *restrict out, long *restrict left,
+                               long *restrict right, int count) {
+  //a shift that loses bits overflowed, like a multiplication
+  bool overflow = false;
+  for (int i = 0; i < count; i++) {
+    out[i] = (unsigned long)left[i] << right[i];
+    overflow |= out[i] >> right[i] != left[i];
+  }
+  return !overflow;
+}
+
+KERNEL void scale_float(double *restrict out, double *restrict right,
+                        double factor, int count) {
+  for (int i = 0; i < count; i++)
+    out[i] = right[i] * factor;
+}
+
+KERNEL bool any_zero(double *restrict right, int count) {
+  bool zero = false;
+  for (int i = 0; i < count; i++)
+    zero |= right[i] == 0;
+  return zero;
+}
+
+KERNEL bool all_finite(double *restrict right, int count) {
+  bool finite = true;
+  for (int i = 0; i < count; i++)
+    finite &= isfinite(right[i]);
+  return finite;
+}
+
+KERNEL bool shifts_in_range(long *restrict right, int count) {
+  //leave out-of-range shift counts to the scalar operator
+  bool valid = true;
+  for (int i = 0; i < count; i++)
+    valid &= right[i] >= 0 && right[i] < 64;
+  return valid;
+}
+
+KERNEL void select_int(long *restrict out, long *restrict condition,
+                       long *restrict on_true, long *restrict on_false,
+                       int count) {
+  for (int i = 0; i < count; i++)
+    out[i] = condition[i] ? on_true[i] : on_false[i];
+}
+
+KERNEL void select_float(double *restrict out, long *restrict condition,
+                         double *restrict on_true, double *restrict on_false,
+                         int count) {
+  for (int i = 0; i < count; i++)
+    out[i] = condition[i] ? on_true[i] : on_false[i];
+}
+
+block_program *new_block_program(expr_node *tree) {
+  block_program *prog = malloc(sizeof(block_program));
+  if (!prog)
+    raise_error(ERROR_SYS, "memory allocation failure");
+
+  //every node gets its own block for its results
+  prog->tree = tree;
+  prog->num_nodes = count_nodes(tree);
+  prog->blocks = malloc(prog->num_nodes * sizeof(value_block));
+  prog->scratch = malloc(2 * BLOCK_ROWS * sizeof(double));
+  if (!prog->blocks || !prog->scratch)
+    raise_error(ERROR_SYS, "memory allocation failure");
+
+  for (int i = 0; i < prog->num_nodes; i++)
+    block_init(&prog->blocks[i]);
+
+  int next = 0;
+  fill_constants(prog, tree, &next);
+  return prog;
+}
+
+void free_block_program(block_program *prog) {
+  if (!prog)
+    return;
+
+  for (int i = 0; i < prog->num_nodes; i++)
+    block_release(&prog->blocks[i]);
+  free(prog->blocks);
+  free(prog->scratch);
+  free(prog);
+}
+
+void block_init(value_block *block) {
+  block->kind = LANES_INT;
+  block->overflow = NULL;
+  block->num_overflow = 0;
+}
+
+void block_release(value_block *block) {
+  free(block->overflow);
+  block->overflow = NULL;
+}
+
+int count_nodes(expr_node *node) {
+  int count = 1;
+  for (int i = 0; i < node->argc; i++)
+    count += count_nodes(node->args[i]);
+  return count;
+}
+
+void fill_constants(block_program *prog, expr_node *node, int *next) {
+  value_block *block = &prog->blocks[(*next)++];
+
+  if (node->type == NODE_CONSTANT) {
+    for (int i = 0; i < BLOCK_ROWS; i++)
+      block_set_lane(block, i, &node->val);
+  }
+
+  for (int i = 0; i < node->argc; i++)
+    fill_constants(prog, node->args[i], next);
+}
+
+void block_get_lane(value_block *block, int lane, value *val) {
+  boxed_value box;
+
+  switch (block->kind) {
+  case LANES_INT:
+    value_set_int(val, block->ivalue[lane]);
+    break;
+  case LANES_FLOAT:
+    value_set_float(val, block->fvalue[lane]);
+    break;
+  case LANES_MIXED:
+    box = block->boxed[lane];
+    if (box_is_int(box))
+      value_set_int(val, unbox_int(box));
+    else if (box_is_big(box))
+      *val = block->overflow[unbox_big(box)];
+    else
+      value_set_float(val, unbox_float(box));
+    break;
+  }
+}
+
+void block_set_lane(value_block *block, int lane, value *val) {
+  //a wide integer can only be kept boxed
+  lane_kind kind = (val->type == FLOAT) ? LANES_FLOAT
+    : (val->type == INT) ? LANES_INT : LANES_MIXED;
+
+  //lanes are filled in order, so the first one decides the kind
+  if (lane == 0) {
+    block->kind = kind;
+    block->num_overflow = 0;
+  } else if (block->kind != kind && block->kind != LANES_MIXED) {
+    box_lanes(block, lane);
+  }
+
+  if (block->kind != LANES_MIXED) {
+    if (kind == LANES_FLOAT)
+      block->fvalue[lane] = val->data.fvalue;
+    else
+      block->ivalue[lane] = val->data.ivalue;
+  } else if (kind == LANES_FLOAT) {
+    block->boxed[lane] = box_float(val->data.fvalue);
+  } else {
+    block->boxed[lane] = box_integer(block, val);
+  }
+}
+
+void box_lanes(value_block *block, int count) {
+  //rewrite the lanes so far in place, now that the block is mixed
+  lane_kind kind = block->kind;
+  block->kind = LANES_MIXED;
+
+  value val;
+  for (int i = 0; i < count; i++) {
+    if (kind == LANES_FLOAT) {
+      block->boxed[i] = box_float(block->fvalue[i]);
+    } else {
+      value_set_int(&val, block->ivalue[i]);
+      block->boxed[i] = box_integer(block, &val);
+    }
+  }
+}
+
+boxed_value box_integer(value_block *block, value *val) {
+  if (val->type == INT && box_fits_int(val->data.ivalue))
+    return box_int(val->data.ivalue);
+
+  //wider integers go in the side table
+  if (!block->overflow) {
+    block->overflow = malloc(BLOCK_ROWS * sizeof(value));
+    if (!block->overflow)
+      raise_error(ERROR_SYS, "memory allocation failure");
+  }
+
+  block->overflow[block->num_overflow] = *val;
+  return box_big(block->num_overflow++);
+}
+
+value_block *execute_block(block_program *prog, value_block columns[],
+                           int num_columns, int count, options *opts) {
+  int next = 0;
+  return run_node(prog, prog->tree, &next, columns, num_columns, count,
+                  opts);
+}
+
+value_block *run_node(block_program *prog, expr_node *node, int *next,
+                      value_block columns[], int num_columns, int count,
+                      options *opts) {
+  value_block *out = &prog->blocks[(*next)++];
+  value_block *argv[MAX_ARGUMENTS];
+
+  //operands are executed left to right, as in execute()
+  for (int i = 0; i < node->argc; i++)
+    argv[i] = run_node(prog, node->args[i], next, columns, num_columns,
+                       count, opts);
+
+  switch (node->type) {
+  case NODE_CONSTANT: //filled in when the program was built
+    break;
+
+  case NODE_VARIABLE:
+    if (node->index >= num_columns)
+      raise_error(ERROR_EXPR, "no value for column $%d", node->index + 1);
+    out = &columns[node->index];
+    break;
+
+  case NODE_OPERATOR:
+    if (node->op == OP_COMMA)
+      out = argv[1];
+    else if (is_unary_operator(node->op))
+      run_operator(prog, node->op, NULL, argv[0], out, count);
+    else
+      run_operator(prog, node->op, argv[0], argv[1], out, count);
+    break;
+
+  case NODE_CONDITIONAL:
+    run_conditional(argv, out, count);
+    break;
+
+  case NODE_FUNCTION:
+    run_function(prog, node, argv, out, count, opts);
+    break;
+  }
+
+  return out;
+}
+
+void run_operator(block_program *prog, operator_type op, value_block *left,
+                  value_block *right, value_block *out, int count) {
+  //blocks holding both kinds of value go through the scalar operators
+  if (right->kind == LANES_MIXED || (left && left->kind == LANES_MIXED)) {
+    run_lanes(op, left, right, out, count);
+    return;
+  }
+
+  if (!left) {
+    if (!run_unary_kernel(op, right, out, count))
+      run_lanes(op, left, right, out, count);
+  } else if (left->kind == LANES_FLOAT || right->kind == LANES_FLOAT) {
+    if (!run_float_kernel(op, float_lanes(prog, left, 0, count),
+                          float_lanes(prog, right, 1, count), out, count))
+      run_lanes(op, left, right, out, count);
+  } else {
+    if (!run_int_kernel(op, left->ivalue, right->ivalue, out, count))
+      run_lanes(op, left, right, out, count);
+  }
+}
+
+double *float_lanes(block_program *prog, value_block *block, int slot,
+                    int count) {
+  if (block->kind == LANES_FLOAT)
+    return block->fvalue;
+
+  //integer blocks are converted into one of the scratch vectors
+  double *lanes = prog->scratch + slot * BLOCK_ROWS;
+  int_to_float(lanes, block->ivalue, count);
+  return lanes;
+}
+
+bool run_float_kernel(operator_type op, double *left, double *right,
+                      value_block *out, int count) {
+  out->kind = LANES_INT;
+
+  switch (op) {
+  case OP_ADD:
+    add_float(out->fvalue, left, right, count);
+    break;
+  case OP_SUBTRACT:
+    subtract_float(out->fvalue, left, right, count);
+    break;
+  case OP_MULTIPLY:
+    multiply_float(out->fvalue, left, right, count);
+    break;
+  case OP_DIVIDE:
+    if (any_zero(right, count)) //let divide() report it
+      return false;
+    divide_float(out->fvalue, left, right, count);
+    break;
+  case OP_POWER:
+    vector_pow(out->fvalue, left, right, count);
+    break;
+  case OP_EQUAL:
+    equal_float(out->ivalue, left, right, count);
+    return true;
+  case OP_NOT_EQUAL:
+    not_equal_float(out->ivalue, left, right, count);
+    return true;
+  case OP_LESS_THAN:
+    less_than_float(out->ivalue, left, right, count);
+    return true;
+  case OP_LESS_THAN_EQ:
+    less_than_eq_float(out->ivalue, left, right, count);
+    return true;
+  case OP_GREATER_THAN:
+    greater_than_float(out->ivalue, left, right, count);
+    return true;
+  case OP_GREATER_THAN_EQ:
+    greater_than_eq_float(out->ivalue, left, right, count);
+    return true;
+  case OP_AND:
+    and_float(out->ivalue, left, right, count);
+    return true;
+  case OP_OR:
+    or_float(out->ivalue, left, right, count);
+    return true;
+  default:
+    return false;
+  }
+
+  out->kind = LANES_FLOAT;
+  return true;
+}
+
+bool run_int_kernel(operator_type op, long *left, long *right,
+                    value_block *out, int count) {
+  switch (op) {
+  case OP_ADD:
+    if (!add_int(out->ivalue, left, right, count))
+      return false;
+    break;
+  case OP_SUBTRACT:
+    if (!subtract_int(out->ivalue, left, right, count))
+      return false;
+    break;
+  case OP_MULTIPLY:
+    if (!multiply_int(out->ivalue, left, right, count))
+      return false;
+    break;
+  case OP_EQUAL:
+    equal_int(out->ivalue, left, right, count);
+    break;
+  case OP_NOT_EQUAL:
+    not_equal_int(out->ivalue, left, right, count);
+    break;
+  case OP_LESS_THAN:
+    less_than_int(out->ivalue, left, right, count);
+    break;
+  case OP_LESS_THAN_EQ:
+    less_than_eq_int(out->ivalue, left, right, count);
+    break;
+  case OP_GREATER_THAN:
+    greater_than_int(out->ivalue, left, right, count);
+    break;
+  case OP_GREATER_THAN_EQ:
+    greater_than_eq_int(out->ivalue, left, right, count);
+    break;
+  case OP_AND:
+    and_int(out->ivalue, left, right, count);
+    break;
+  case OP_OR:
+    or_int(out->ivalue, left, right, count);
+    break;
+  case OP_BIT_AND:
+    bit_and_int(out->ivalue, left, right, count);
+    break;
+  case OP_BIT_OR:
+    bit_or_int(out->ivalue, left, right, count);
+    break;
+  case OP_BIT_XOR:
+    bit_xor_int(out->ivalue, left, right, count);
+    break;
+  case OP_BIT_SHIFT_LEFT:
+    if (!shifts_in_range(right, count)
+        || !bit_shift_left_int(out->ivalue, left, right, count))
+      return false;
+    break;
+  case OP_BIT_SHIFT_RIGHT:
+    if (!shifts_in_range(right, count))
+      return false;
+    bit_shift_right_int(out->ivalue, left, right, count);
+    break;
+  default: //division, modulo and powers are done one lane at a time
+    return false;
+  }
+
+  out->kind = LANES_INT;
+  return true;
+}
+
+bool run_unary_kernel(operator_type op, value_block *right,
+                      value_block *out, int count) {
+  bool is_float = (right->kind == LANES_FLOAT);
+
+  switch (op) {
+  case OP_NEGATE:
+    if (is_float)
+      negate_float(out->fvalue, right->fvalue, count);
+    else if (!negate_int(out->ivalue, right->ivalue, count))
+      return false;
+    out->kind = right->kind;
+    return true;
+  case OP_NOT:
+    if (is_float)
+      not_float(out->ivalue, right->fvalue, count);
+    else
+      not_int(out->ivalue, right->ivalue, count);
+    out->kind = LANES_INT;
+    return true;
+  case OP_BIT_NOT:
+    if (is_float) //let bit_not() report it
+      return false;
+    bit_not_int(out->ivalue, right->ivalue, count);
+    out->kind = LANES_INT;
+    return true;
+  default:
+    return false;
+  }
+}
+
+void run_lanes(operator_type op, value_block *left, value_block *right,
+               value_block *out, int count) {
+  value lval, rval, result;
+
+  for (int i = 0; i < count; i++) {
+    if (left)
+      block_get_lane(left, i, &lval);
+    block_get_lane(right, i, &rval);
+
+    apply_operator(op, left ? &lval : NULL, &rval, &result);
+    block_set_lane(out, i, &result);
+  }
+}
+
+void run_conditional(value_block *argv[], value_block *out, int count) {
+  value_block *condition = argv[0];
+  value_block *on_true = argv[1];
+  value_block *on_false = argv[2];
+
+  if (condition->kind == LANES_INT && on_true->kind == on_false->kind
+      && on_true->kind != LANES_MIXED) {
+    if (on_true->kind == LANES_FLOAT)
+      select_float(out->fvalue, condition->ivalue, on_true->fvalue,
+                   on_false->fvalue, count);
+    else
+      select_int(out->ivalue, condition->ivalue, on_true->ivalue,
+                 on_false->ivalue, count);
+    out->kind = on_true->kind;
+    return;
+  }
+
+  value vals[3], result;
+  for (int i = 0; i < count; i++) {
+    for (int j = 0; j < 3; j++)
+      block_get_lane(argv[j], i, &vals[j]);
+
+    conditional(&vals[0], &vals[1], &vals[2], &result);
+    block_set_lane(out, i, &result);
+  }
+}
+
+void run_function(block_program *prog, expr_node *node, value_block *argv[],
+                  value_block *out, int count, options *opts) {
+  value args[MAX_ARGUMENTS], result;
+
+  if (run_vector_function(prog, node, argv, out, count, opts))
+    return;
+
+  for (int i = 0; i < count; i++) {
+    for (int j = 0; j < node->argc; j++)
+      block_get_lane(argv[j], i, &args[j]);
+
+    call_function(node->id, &result, node->argc, args, opts->degrees);
+    block_set_lane(out, i, &result);
+  }
+}
+
+bool run_vector_function(block_program *prog, expr_node *node,
+                         value_block *argv[], value_block *out, int count,
+                         options *opts) {
+  for (int i = 0; i < node->argc; i++) {
+    if (argv[i]->kind == LANES_MIXED)
+      return false;
+  }
+
+  char *id = node->id;
+  if (node->argc == 2 && !strcmp(id, "pow")) {
+    //integer powers are left to power()
+    if (argv[0]->kind == LANES_INT && argv[1]->kind == LANES_INT)
+      return false;
+    vector_pow(out->fvalue, float_lanes(prog, argv[0], 0, count),
+               float_lanes(prog, argv[1], 1, count), count);
+  } else if (node->argc == 1 && !strcmp(id, "exp2")) {
+    if (argv[0]->kind == LANES_INT)
+      return false;
+    vector_exp2(out->fvalue, argv[0]->fvalue, count);
+  } else if (node->argc == 1 && find_vector_function(id)) {
+    double *arg = float_lanes(prog, argv[0], 0, count);
+    double *scaled = prog->scratch + BLOCK_ROWS;
+
+    if (opts->degrees && (!strcmp(id, "sin") || !strcmp(id, "cos")
+                          || !strcmp(id, "tan"))) {
+      scale_float(scaled, arg, PI / 180, count);
+      arg = scaled;
+    }
+    find_vector_function(id)(out->fvalue, arg, count);
+  } else {
+    return false;
+  }
+
+  //call_function() reports the first row that has no finite result
+  out->kind = LANES_FLOAT;
+  return all_finite(out->fvalue, count);
+}
+
+vector_function find_vector_function(char *identifier) {
+  if (!strcmp(identifier, "sqrt"))
+    return vector_sqrt;
+  else if (!strcmp(identifier, "exp"))
+    return vector_exp;
+  else if (!strcmp(identifier, "log"))
+    return vector_log;
+  else if (!strcmp(identifier, "log2"))
+    return vector_log2;
+  else if (!strcmp(identifier, "log10"))
+    return vector_log10;
+  else if (!strcmp(identifier, "sin"))
+    return vector_sin;
+  else if (!strcmp(identifier, "cos"))
+    return vector_cos;
+  else if (!strcmp(identifier, "tan"))
+    return vector_tan;
+  else if (!strcmp(identifier, "erf"))
+    return vector_erf;
+  else
+    return NULL;
+}
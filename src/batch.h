@@ -0,0 +1,75 @@
+/* ccalc -- evaluate C-style expressions from the command line.
+   Copyright (C) 2015-2017 Gregory Kikola.
+
+   This file is part of ccalc.
+
+   ccalc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   ccalc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with ccalc.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Written by Gregory Kikola <gkikola@gmail.com>. */
+
+#ifndef CCALC_BATCH_H
+#define CCALC_BATCH_H
+
+#include <stdbool.h>
+
+#include "compile.h"
+#include "nanbox.h"
+#include "options.h"
+#include "value.h"
+
+#define BLOCK_ROWS 1024
+
+typedef enum {
+  LANES_INT,
+  LANES_FLOAT,
+  LANES_MIXED
+} lane_kind;
+
+//A block holds one value for each row of a batch, eight bytes per row.
+//When every lane has the same type the block is a plain vector of longs
+//or doubles that operators can run over directly. A block holding both
+//kinds is NaN-boxed instead, with any integers too wide to box, including
+//WIDE values, kept in the overflow table.
+typedef struct {
+  lane_kind kind;
+  union {
+    long int ivalue[BLOCK_ROWS];
+    double fvalue[BLOCK_ROWS];
+    boxed_value boxed[BLOCK_ROWS];
+  };
+  value *overflow;
+  int num_overflow;
+} value_block;
+
+typedef struct {
+  expr_node *tree;
+  int num_nodes;
+  value_block *blocks;
+  double *scratch; //integer operands converted for float kernels
+} block_program;
+
+block_program *new_block_program(expr_node *tree);
+void free_block_program(block_program *prog);
+
+void block_init(value_block *block);
+void block_release(value_block *block);
+
+void block_get_lane(value_block *block, int lane, value *val);
+void block_set_lane(value_block *block, int lane, value *val);
+
+value_block *execute_block(block_program *prog, value_block columns[],
+                           int num_columns, int count, options *opts);
+
+#endif
@@ -0,0 +1,1659 @@
+/* ccalc -- evaluate C-style expressions from the command line.
+   Copyright (C) 2015-2017 Gregory Kikola.
+
+   This file is part of ccalc.
+
+   ccalc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   ccalc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with ccalc.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Written by Gregory Kikola <gkikola@gmail.com>. */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "bigfloat.h"
+#include "error.h"
+
+//The elementary functions work in fixed point, on integers standing for
+//themselves times 2^-frac, and carry a few guard bits beyond the
+//precision asked of them so that what they return is good to about an
+//ulp. Each first reduces its argument: exp by a multiple of ln 2, the
+//trigonometric functions by a multiple of pi/2, log to near 1, and exp
+//and cos halve what is left several times over and undo it afterward,
+//which shortens their series much more than it costs. The constants
+//they need are kept at the largest precision computed so far.
+
+#define GUARD_BITS 32
+#define MAX_THREADS 16
+#define MAX_REDUCTION_BITS (1L << 20)
+
+//as many bits as any sum or difference needs, for exact results
+#define EXACT_BITS ((size_t)1 << 60)
+
+//Chudnovsky: 640320^3 / 24, and the bits each term adds
+#define CHUDNOVSKY_C3_24 10939058860032000
+#define CHUDNOVSKY_TERM_BITS 47.11
+
+#define LOG10_2 0.30102999566398120
+
+typedef struct {
+  bigfloat value;
+  size_t bits;
+} constant;
+
+typedef struct chudnovsky_split {
+  unsigned long from, to;
+  int threads;
+  bool need_p;
+  bigint p, q, t;
+} chudnovsky_split;
+
+typedef struct {
+  bigint *r;
+  const bigint *a, *b;
+} product;
+
+size_t parallel_terms = 1024;
+int max_threads = 0;
+
+static constant pi_cache, e_cache, ln2_cache, ln10_cache, phi_cache;
+
+static int sign_of(const bigfloat *x);
+static bigfloat view(const bigint *mantissa, long exponent);
+static void set_int(bigfloat *x, long value);
+static void move_into(bigfloat *r, bigfloat *t);
+static void strip_zeros(bigfloat *x);
+static bool bit_set(const bigint *x, size_t i);
+static bool low_bits_nonzero(const bigint *x, size_t count);
+static void round_in_place(bigfloat *x, size_t bits);
+static void add_signed(bigfloat *r, const bigfloat *a, const bigfloat *b,
+                       size_t bits, bool negate_b);
+static void remainder_of(bigfloat *r, const bigfloat *a, const bigfloat *b,
+                         size_t bits, bool nearest);
+
+static bool cached(constant *c, bigfloat *r, size_t bits);
+static void cache(constant *c, const bigfloat *x, size_t bits);
+static void *chudnovsky(void *arg);
+static void *multiply_product(void *arg);
+static void e_series(bigint *p, bigint *q, unsigned long from,
+                     unsigned long to);
+static void atanh_series(bigint *b, bigint *q, bigint *t, unsigned long n,
+                         unsigned long from, unsigned long to);
+static void atanh_inverse(bigfloat *r, unsigned long n, size_t bits);
+static void ln2(bigfloat *r, size_t bits);
+static void ln10(bigfloat *r, size_t bits);
+
+static void to_fixed(bigint *r, const bigfloat *x, size_t frac);
+static void from_fixed(bigfloat *r, const bigint *x, size_t frac,
+                       size_t bits);
+static void divide_by(bigint *x, uint64_t divisor);
+static uint64_t series_divisor(uint64_t i, char kind);
+static void fixed_series(bigint *sum, const bigint *x, size_t frac,
+                         char kind);
+static size_t halvings(size_t bits);
+static bool sin_cos(bigfloat *sine, bigfloat *cosine, const bigfloat *x,
+                    size_t bits);
+static size_t tiny_bits(const bigfloat *x);
+
+void bf_init(bigfloat *x) {
+  big_init(&x->mantissa);
+  x->exponent = 0;
+}
+
+void bf_free(bigfloat *x) {
+  big_free(&x->mantissa);
+  x->exponent = 0;
+}
+
+void bf_copy(bigfloat *r, const bigfloat *x) {
+  long exponent = x->exponent;
+  big_copy(&r->mantissa, &x->mantissa);
+  r->exponent = exponent;
+}
+
+void bf_set_big(bigfloat *r, const bigint *mantissa, long exponent) {
+  big_copy(&r->mantissa, mantissa);
+  r->exponent = exponent;
+  strip_zeros(r);
+}
+
+void bf_set_double(bigfloat *r, double d) {
+  int exponent;
+  double fraction = frexp(fabs(d), &exponent);
+  __int128 mantissa = (__int128)ldexp(fraction, 53);
+  big_set_wide(&r->mantissa, (d < 0) ? -mantissa : mantissa);
+  r->exponent = exponent - 53;
+  strip_zeros(r);
+}
+
+//from the top 128 bits, the rest being too few to change the rounding
+//but once in a great while
+double bf_get_double(const bigfloat *x) {
+  bigint top = x->mantissa;
+  top.capacity = 0;
+  top.negative = false;
+  size_t n = big_bits(&top);
+  long exponent = x->exponent;
+  double result;
+
+  if (n > 128) {
+    big_init(&top);
+    bigint magnitude = x->mantissa;
+    magnitude.capacity = 0;
+    magnitude.negative = false;
+    big_shift_right(&top, &magnitude, n - 128);
+    exponent += n - 128;
+    result = big_get_double(&top);
+    big_free(&top);
+  } else {
+    result = big_get_double(&top);
+  }
+
+  if (exponent > 4096)
+    exponent = 4096;
+  else if (exponent < -4096)
+    exponent = -4096;
+  result = ldexp(result, exponent);
+  return x->mantissa.negative ? -result : result;
+}
+
+//x made an integer: toward negative infinity for 'f', positive infinity
+//for 'c' and zero for 't', or to nearest with halves away from zero for
+//'r', as floor(), ceil(), trunc() and round() do
+void bf_get_integer(bigint *r, const bigfloat *x, char mode) {
+  if (x->exponent >= 0) {
+    big_shift_left(r, &x->mantissa, x->exponent);
+    return;
+  }
+
+  bigint magnitude = x->mantissa;
+  magnitude.capacity = 0;
+  magnitude.negative = false;
+  size_t cut = -x->exponent;
+  bool negative = x->mantissa.negative;
+  bool fraction = low_bits_nonzero(&magnitude, cut);
+  bool half = bit_set(&magnitude, cut - 1);
+
+  big_shift_right(r, &magnitude, cut);
+  bool up = (mode == 'r') ? half
+    : (mode == 'f') ? negative && fraction
+    : (mode == 'c') ? !negative && fraction
+    : false;
+  if (up) {
+    bigint one = { (uint64_t[]){ 1 }, 1, 0, false };
+    big_add(r, r, &one);
+  }
+  r->negative = negative && r->length;
+}
+
+//the power of two just above |x|, or LONG_MIN for zero
+long bf_magnitude(const bigfloat *x) {
+  if (!x->mantissa.length)
+    return LONG_MIN;
+  return x->exponent + (long)big_bits(&x->mantissa);
+}
+
+int bf_compare(const bigfloat *a, const bigfloat *b) {
+  int sa = sign_of(a), sb = sign_of(b);
+  if (sa != sb)
+    return (sa > sb) ? 1 : -1;
+  if (sa == 0)
+    return 0;
+
+  long ma = bf_magnitude(a), mb = bf_magnitude(b);
+  if (ma != mb)
+    return (ma > mb) ? sa : -sa;
+
+  //the same magnitude, so aligning them shifts by no more than their bits
+  long exponent = (a->exponent < b->exponent) ? a->exponent : b->exponent;
+  bigint x, y;
+  big_init(&x);
+  big_init(&y);
+  big_shift_left(&x, &a->mantissa, a->exponent - exponent);
+  big_shift_left(&y, &b->mantissa, b->exponent - exponent);
+  int result = big_compare(&x, &y);
+  big_free(&x);
+  big_free(&y);
+  return result;
+}
+
+void bf_round(bigfloat *r, const bigfloat *x, size_t bits) {
+  bf_copy(r, x);
+  round_in_place(r, bits);
+}
+
+void bf_add(bigfloat *r, const bigfloat *a, const bigfloat *b, size_t bits) {
+  add_signed(r, a, b, bits, false);
+}
+
+void bf_subtract(bigfloat *r, const bigfloat *a, const bigfloat *b,
+                 size_t bits) {
+  add_signed(r, a, b, bits, true);
+}
+
+void bf_multiply(bigfloat *r, const bigfloat *a, const bigfloat *b,
+                 size_t bits) {
+  bigfloat t;
+  bf_init(&t);
+  big_multiply(&t.mantissa, &a->mantissa, &b->mantissa);
+  t.exponent = a->exponent + b->exponent;
+  round_in_place(&t, bits);
+  move_into(r, &t);
+}
+
+//b is not zero
+void bf_divide(bigfloat *r, const bigfloat *a, const bigfloat *b,
+               size_t bits) {
+  bigfloat t;
+  bf_init(&t);
+  if (!a->mantissa.length) {
+    move_into(r, &t);
+    return;
+  }
+
+  //a quotient of two bits more than wanted, and a last bit that is set
+  //if anything remains, so that it rounds as the exact quotient would
+  long shift = (long)bits + 2 + (long)big_bits(&b->mantissa)
+    - (long)big_bits(&a->mantissa);
+  if (shift < 0)
+    shift = 0;
+
+  bigint rem;
+  big_init(&rem);
+  big_shift_left(&t.mantissa, &a->mantissa, shift);
+  big_divide(&t.mantissa, &rem, &t.mantissa, &b->mantissa);
+  bool negative = t.mantissa.negative;
+  t.mantissa.negative = false;
+  big_shift_left(&t.mantissa, &t.mantissa, 1);
+  if (rem.length) {
+    bigint one = { (uint64_t[]){ 1 }, 1, 0, false };
+    big_add(&t.mantissa, &t.mantissa, &one);
+  }
+  t.mantissa.negative = negative;
+  t.exponent = a->exponent - b->exponent - shift - 1;
+  big_free(&rem);
+
+  round_in_place(&t, bits);
+  move_into(r, &t);
+}
+
+void bf_negate(bigfloat *r, const bigfloat *a) {
+  bf_copy(r, a);
+  r->mantissa.negative = r->mantissa.length && !a->mantissa.negative;
+}
+
+void bf_shift(bigfloat *r, const bigfloat *a, long count) {
+  bf_copy(r, a);
+  if (r->mantissa.length)
+    r->exponent += count;
+}
+
+//by squaring, with enough guard bits for the roundings along the way
+void bf_power(bigfloat *r, const bigfloat *base, long exp, size_t bits) {
+  unsigned long count = (exp < 0) ? -(unsigned long)exp : (unsigned long)exp;
+  size_t work = bits + GUARD_BITS + 64;
+  bigfloat result, factor;
+  bf_init(&result);
+  bf_init(&factor);
+  set_int(&result, 1);
+  bf_round(&factor, base, work);
+
+  while (count) {
+    if (count & 1)
+      bf_multiply(&result, &result, &factor, work);
+    count >>= 1;
+    if (count)
+      bf_multiply(&factor, &factor, &factor, work);
+  }
+
+  if (exp < 0) {
+    set_int(&factor, 1);
+    bf_divide(&result, &factor, &result, bits);
+  } else {
+    round_in_place(&result, bits);
+  }
+  bf_free(&factor);
+  move_into(r, &result);
+}
+
+//b is not zero, here and for bf_remainder
+void bf_fmod(bigfloat *r, const bigfloat *a, const bigfloat *b, size_t bits) {
+  remainder_of(r, a, b, bits, false);
+}
+
+void bf_remainder(bigfloat *r, const bigfloat *a, const bigfloat *b,
+                  size_t bits) {
+  remainder_of(r, a, b, bits, true);
+}
+
+
+//426880 sqrt(10005) / pi is a series whose terms each add about 47 bits,
+//summed by binary splitting
+void bf_pi(bigfloat *r, size_t bits) {
+  if (cached(&pi_cache, r, bits))
+    return;
+
+  size_t work = bits + GUARD_BITS;
+  long threads = max_threads ? max_threads : sysconf(_SC_NPROCESSORS_ONLN);
+  chudnovsky_split all = {
+    .to = work / CHUDNOVSKY_TERM_BITS + 2,
+    .threads = (threads < 1) ? 1
+      : (threads > MAX_THREADS) ? MAX_THREADS : threads
+  };
+  chudnovsky(&all);
+
+  bigfloat x, y;
+  bf_init(&x);
+  bf_init(&y);
+  set_int(&x, 10005);
+  bf_sqrt(&x, &x, work);
+  set_int(&y, 426880);
+  bf_multiply(&x, &x, &y, work);
+  bf_set_big(&y, &all.q, 0);
+  round_in_place(&y, work);
+  bf_multiply(&x, &x, &y, work);
+  bf_set_big(&y, &all.t, 0);
+  round_in_place(&y, work);
+  bf_divide(&x, &x, &y, work);
+
+  cache(&pi_cache, &x, work);
+  bf_round(r, &x, bits);
+  bf_free(&x);
+  bf_free(&y);
+  big_free(&all.q);
+  big_free(&all.t);
+}
+
+//the sum of 1/k!, by binary splitting
+void bf_e(bigfloat *r, size_t bits) {
+  if (cached(&e_cache, r, bits))
+    return;
+
+  //terms until k! passes 2^work
+  size_t work = bits + GUARD_BITS;
+  unsigned long terms = 1;
+  for (double size = 0; size < work; terms++)
+    size += log2(terms + 1);
+
+  bigint p, q;
+  big_init(&p);
+  big_init(&q);
+  e_series(&p, &q, 0, terms);
+  big_add(&p, &p, &q);
+
+  bigfloat x, y;
+  bf_init(&x);
+  bf_init(&y);
+  bf_set_big(&x, &p, 0);
+  bf_set_big(&y, &q, 0);
+  bf_divide(&x, &x, &y, work);
+
+  cache(&e_cache, &x, work);
+  bf_round(r, &x, bits);
+  bf_free(&x);
+  bf_free(&y);
+  big_free(&p);
+  big_free(&q);
+}
+
+void bf_phi(bigfloat *r, size_t bits) {
+  if (cached(&phi_cache, r, bits))
+    return;
+
+  size_t work = bits + GUARD_BITS;
+  bigfloat x, one;
+  bf_init(&x);
+  bf_init(&one);
+  set_int(&x, 5);
+  set_int(&one, 1);
+  bf_sqrt(&x, &x, work);
+  bf_add(&x, &x, &one, work);
+  bf_shift(&x, &x, -1);
+
+  cache(&phi_cache, &x, work);
+  bf_round(r, &x, bits);
+  bf_free(&x);
+  bf_free(&one);
+}
+
+bool bf_sqrt(bigfloat *r, const bigfloat *x, size_t bits) {
+  if (x->mantissa.negative)
+    return false;
+
+  bigfloat t;
+  bf_init(&t);
+  if (!x->mantissa.length) {
+    move_into(r, &t);
+    return true;
+  }
+
+  //an even exponent, and twice the bits wanted and two more in the
+  //mantissa, whose integer root then has a sticky last bit as in division
+  long shift = 2 * ((long)bits + 2) - (long)big_bits(&x->mantissa);
+  if (shift < 0)
+    shift = 0;
+  if ((x->exponent - shift) & 1)
+    shift++;
+
+  bigint square;
+  big_init(&square);
+  big_shift_left(&square, &x->mantissa, shift);
+  big_sqrt(&t.mantissa, &square);
+  t.exponent = (x->exponent - shift) / 2;
+
+  bigint check;
+  big_init(&check);
+  big_multiply(&check, &t.mantissa, &t.mantissa);
+  if (big_compare(&check, &square) != 0) {
+    bigint one = { (uint64_t[]){ 1 }, 1, 0, false };
+    big_shift_left(&t.mantissa, &t.mantissa, 1);
+    big_add(&t.mantissa, &t.mantissa, &one);
+    t.exponent--;
+  }
+  big_free(&check);
+  big_free(&square);
+
+  round_in_place(&t, bits);
+  move_into(r, &t);
+  return true;
+}
+
+bool bf_cbrt(bigfloat *r, const bigfloat *x, size_t bits) {
+  size_t work = bits + GUARD_BITS;
+  bigfloat t, three;
+  bf_init(&t);
+  bf_init(&three);
+
+  if (x->mantissa.length) {
+    bigfloat magnitude = view(&x->mantissa, x->exponent);
+    magnitude.mantissa.negative = false;
+    set_int(&three, 3);
+    bf_log(&t, &magnitude, work);
+    bf_divide(&t, &t, &three, work);
+    if (!bf_exp(&t, &t, bits)) {
+      bf_free(&t);
+      bf_free(&three);
+      return false;
+    }
+    if (x->mantissa.negative)
+      bf_negate(&t, &t);
+  }
+
+  bf_free(&three);
+  move_into(r, &t);
+  return true;
+}
+
+//x less a multiple k of ln 2 leaves |r| <= ln(2)/2, which is halved
+//before the series and squared back afterward, and 2^k scales the result
+bool bf_exp(bigfloat *r, const bigfloat *x, size_t bits) {
+  if (!x->mantissa.length) {
+    set_int(r, 1);
+    return true;
+  }
+  if (bf_magnitude(x) > 62)
+    return false;
+
+  size_t work = bits + GUARD_BITS;
+  long k = lround(bf_get_double(x) / M_LN2);
+  bigfloat reduced;
+  bf_init(&reduced);
+  if (k == 0) {
+    bf_copy(&reduced, x);
+  } else {
+    size_t p = work + 64;
+    bigfloat multiple, kf;
+    bf_init(&multiple);
+    bf_init(&kf);
+    ln2(&multiple, p);
+    set_int(&kf, k);
+    bf_multiply(&multiple, &multiple, &kf, p);
+    bf_subtract(&reduced, x, &multiple, p);
+    bf_free(&multiple);
+    bf_free(&kf);
+  }
+
+  size_t s = halvings(work);
+  size_t frac = work + s + GUARD_BITS;
+  bigint t, sum;
+  big_init(&t);
+  big_init(&sum);
+  to_fixed(&t, &reduced, frac - s);
+  fixed_series(&sum, &t, frac, 'e');
+  for (size_t i = 0; i < s; i++) {
+    big_multiply(&sum, &sum, &sum);
+    big_shift_right(&sum, &sum, frac);
+  }
+
+  from_fixed(r, &sum, frac, bits);
+  r->exponent += k;
+  big_free(&t);
+  big_free(&sum);
+  bf_free(&reduced);
+  return true;
+}
+
+//exp(x) - 1, with as many more bits as cancel for a small x
+bool bf_expm1(bigfloat *r, const bigfloat *x, size_t bits) {
+  size_t work = bits + GUARD_BITS + tiny_bits(x);
+  bigfloat t, one;
+  bf_init(&t);
+  bf_init(&one);
+  bool ok = bf_exp(&t, x, work);
+  if (ok) {
+    set_int(&one, 1);
+    bf_subtract(r, &t, &one, bits);
+  }
+  bf_free(&t);
+  bf_free(&one);
+  return ok;
+}
+
+//x = y 2^m with y near 1, and log y by Newton's method on exp(z) = y,
+//z + 2 (y - e^z) / (y + e^z) tripling the correct bits each step, so
+//that the precision can triple too, starting from the double result
+bool bf_log(bigfloat *r, const bigfloat *x, size_t bits) {
+  if (!x->mantissa.length || x->mantissa.negative)
+    return false;
+
+  size_t work = bits + GUARD_BITS;
+  long m = bf_magnitude(x);
+  bigfloat y, z, e, d, one;
+  bf_init(&y);
+  bf_init(&z);
+  bf_init(&e);
+  bf_init(&d);
+  bf_init(&one);
+  bf_shift(&y, x, -m);
+  if (bf_get_double(&y) < M_SQRT1_2) {
+    bf_shift(&y, &y, 1);
+    m--;
+  }
+
+  //as many more bits as lead y - 1 with zeros
+  set_int(&one, 1);
+  bf_subtract(&d, &y, &one, EXACT_BITS);
+  size_t target = work + tiny_bits(&d);
+
+  if (d.mantissa.length) {
+    bf_set_double(&z, log(bf_get_double(&y)));
+    for (size_t p = 48; p < target;) {
+      p = (3 * p < target) ? 3 * p : target;
+      size_t q = p + GUARD_BITS;
+      bf_exp(&e, &z, q);
+      bf_subtract(&d, &y, &e, q);
+      bf_add(&e, &y, &e, q);
+      bf_divide(&d, &d, &e, q);
+      bf_shift(&d, &d, 1);
+      bf_add(&z, &z, &d, q);
+    }
+  }
+
+  if (m) {
+    ln2(&e, work + 64);
+    set_int(&d, m);
+    bf_multiply(&e, &e, &d, work + 64);
+    bf_add(&z, &z, &e, work);
+  }
+  round_in_place(&z, bits);
+  move_into(r, &z);
+
+  bf_free(&y);
+  bf_free(&e);
+  bf_free(&d);
+  bf_free(&one);
+  return true;
+}
+
+//exact for powers of two
+bool bf_log2(bigfloat *r, const bigfloat *x, size_t bits) {
+  if (x->mantissa.length == 1 && x->mantissa.limbs[0] == 1
+      && !x->mantissa.negative) {
+    set_int(r, x->exponent);
+    return true;
+  }
+
+  size_t work = bits + GUARD_BITS;
+  bigfloat t, base;
+  bf_init(&t);
+  bf_init(&base);
+  bool ok = bf_log(&t, x, work);
+  if (ok) {
+    ln2(&base, work);
+    bf_divide(r, &t, &base, bits);
+  }
+  bf_free(&t);
+  bf_free(&base);
+  return ok;
+}
+
+bool bf_log10(bigfloat *r, const bigfloat *x, size_t bits) {
+  size_t work = bits + GUARD_BITS;
+  bigfloat t, base;
+  bf_init(&t);
+  bf_init(&base);
+  bool ok = bf_log(&t, x, work);
+  if (ok) {
+    ln10(&base, work);
+    bf_divide(r, &t, &base, bits);
+  }
+  bf_free(&t);
+  bf_free(&base);
+  return ok;
+}
+
+//1 + x is exact, and bf_log finds the bits that cancel in it
+bool bf_log1p(bigfloat *r, const bigfloat *x, size_t bits) {
+  bigfloat t, one;
+  bf_init(&t);
+  bf_init(&one);
+  set_int(&one, 1);
+  bf_add(&t, &one, x, EXACT_BITS);
+  bool ok = bf_log(r, &t, bits);
+  bf_free(&t);
+  bf_free(&one);
+  return ok;
+}
+
+//exp(exp log(base)) for a positive base, the product needing as many
+//more bits as it has integer bits
+bool bf_pow(bigfloat *r, const bigfloat *base, const bigfloat *exp,
+            size_t bits) {
+  if (!base->mantissa.length || base->mantissa.negative)
+    return false;
+
+  size_t work = bits + GUARD_BITS + 64;
+  bigfloat t;
+  bf_init(&t);
+  bf_log(&t, base, work);
+  bf_multiply(&t, &t, exp, work);
+  bool ok = bf_exp(&t, &t, bits);
+  if (ok)
+    move_into(r, &t);
+  else
+    bf_free(&t);
+  return ok;
+}
+
+bool bf_sin(bigfloat *r, const bigfloat *x, size_t bits) {
+  return sin_cos(r, NULL, x, bits);
+}
+
+bool bf_cos(bigfloat *r, const bigfloat *x, size_t bits) {
+  return sin_cos(NULL, r, x, bits);
+}
+
+bool bf_tan(bigfloat *r, const bigfloat *x, size_t bits) {
+  size_t work = bits + GUARD_BITS;
+  bigfloat s, c;
+  bf_init(&s);
+  bf_init(&c);
+  bool ok = sin_cos(&s, &c, x, work);
+  if (ok)
+    bf_divide(r, &s, &c, bits);
+  bf_free(&s);
+  bf_free(&c);
+  return ok;
+}
+
+//atan(x / sqrt((1 - x)(1 + x))), where both factors are exact
+bool bf_asin(bigfloat *r, const bigfloat *x, size_t bits) {
+  bigfloat one, a, b;
+  bf_init(&one);
+  bf_init(&a);
+  bf_init(&b);
+  set_int(&one, 1);
+  bf_subtract(&a, &one, x, EXACT_BITS);
+  bf_add(&b, &one, x, EXACT_BITS);
+
+  bool ok = !a.mantissa.negative && !b.mantissa.negative;
+  if (ok && (!a.mantissa.length || !b.mantissa.length)) {
+    bf_pi(r, bits);
+    bf_shift(r, r, -1);
+    if (!b.mantissa.length)
+      bf_negate(r, r);
+  } else if (ok) {
+    size_t work = bits + GUARD_BITS + tiny_bits(&a) + tiny_bits(&b);
+    bf_multiply(&a, &a, &b, work);
+    bf_sqrt(&a, &a, work);
+    bf_divide(&a, x, &a, work);
+    bf_atan(r, &a, bits);
+  }
+
+  bf_free(&one);
+  bf_free(&a);
+  bf_free(&b);
+  return ok;
+}
+
+//2 atan(sqrt((1 - x) / (1 + x)))
+bool bf_acos(bigfloat *r, const bigfloat *x, size_t bits) {
+  bigfloat one, a, b;
+  bf_init(&one);
+  bf_init(&a);
+  bf_init(&b);
+  set_int(&one, 1);
+  bf_subtract(&a, &one, x, EXACT_BITS);
+  bf_add(&b, &one, x, EXACT_BITS);
+
+  bool ok = !a.mantissa.negative && !b.mantissa.negative;
+  if (ok && !b.mantissa.length) {
+    bf_pi(r, bits);
+  } else if (ok) {
+    size_t work = bits + GUARD_BITS + tiny_bits(&a) + tiny_bits(&b);
+    bf_divide(&a, &a, &b, work);
+    bf_sqrt(&a, &a, work);
+    bf_atan(&a, &a, work);
+    bf_shift(r, &a, 1);
+    round_in_place(r, bits);
+  }
+
+  bf_free(&one);
+  bf_free(&a);
+  bf_free(&b);
+  return ok;
+}
+
+//pi/2 - atan(1/x) above 1, and below it Newton's method on tan(y) = x:
+//y + atan((x cos y - sin y) / (cos y + x sin y)) is exact, and leaving
+//out the outer atan still triples the correct bits each step
+bool bf_atan(bigfloat *r, const bigfloat *x, size_t bits) {
+  if (!x->mantissa.length) {
+    set_int(r, 0);
+    return true;
+  }
+
+  size_t work = bits + GUARD_BITS;
+  bigfloat a, y, s, c, num, den;
+  bf_init(&a);
+  bf_init(&y);
+  bf_init(&s);
+  bf_init(&c);
+  bf_init(&num);
+  bf_init(&den);
+
+  bf_copy(&a, x);
+  a.mantissa.negative = false;
+  set_int(&y, 1);
+  bool invert = bf_compare(&a, &y) > 0;
+  if (invert)
+    bf_divide(&a, &y, &a, work + GUARD_BITS);
+
+  //atan a = a - a^3/3 + ..., which is a start as good as a double for a
+  //tiny a, and better where a double would underflow
+  size_t tiny = tiny_bits(&a);
+  size_t p = 48;
+  if (tiny > 24) {
+    bf_copy(&y, &a);
+    p = 2 * tiny;
+  } else {
+    bf_set_double(&y, atan(bf_get_double(&a)));
+  }
+
+  while (p < work) {
+    p = (3 * p < work) ? 3 * p : work;
+    size_t q = p + GUARD_BITS;
+    sin_cos(&s, &c, &y, q);
+    bf_multiply(&num, &a, &c, q);
+    bf_subtract(&num, &num, &s, q);
+    bf_multiply(&den, &a, &s, q);
+    bf_add(&den, &den, &c, q);
+    bf_divide(&num, &num, &den, q);
+    bf_add(&y, &y, &num, q + tiny);
+  }
+
+  if (invert) {
+    bf_pi(&s, work);
+    bf_shift(&s, &s, -1);
+    bf_subtract(&y, &s, &y, work);
+  }
+  if (x->mantissa.negative)
+    bf_negate(&y, &y);
+  round_in_place(&y, bits);
+  move_into(r, &y);
+
+  bf_free(&a);
+  bf_free(&s);
+  bf_free(&c);
+  bf_free(&num);
+  bf_free(&den);
+  return true;
+}
+
+void bf_atan2(bigfloat *r, const bigfloat *y, const bigfloat *x,
+              size_t bits) {
+  size_t work = bits + GUARD_BITS;
+  bigfloat t, pi;
+  bf_init(&t);
+  bf_init(&pi);
+
+  if (!x->mantissa.length) {
+    if (y->mantissa.length) {
+      bf_pi(&t, bits);
+      bf_shift(&t, &t, -1);
+      if (y->mantissa.negative)
+        bf_negate(&t, &t);
+    }
+  } else {
+    bf_divide(&t, y, x, work);
+    bf_atan(&t, &t, work);
+    if (x->mantissa.negative) {
+      bf_pi(&pi, work);
+      if (y->mantissa.negative)
+        bf_subtract(&t, &t, &pi, work);
+      else
+        bf_add(&t, &t, &pi, work);
+    }
+    round_in_place(&t, bits);
+  }
+
+  bf_free(&pi);
+  move_into(r, &t);
+}
+
+void bf_hypot(bigfloat *r, const bigfloat *a, const bigfloat *b,
+              size_t bits) {
+  bigfloat t, u;
+  bf_init(&t);
+  bf_init(&u);
+  bf_multiply(&t, a, a, EXACT_BITS);
+  bf_multiply(&u, b, b, EXACT_BITS);
+  bf_add(&t, &t, &u, bits + GUARD_BITS);
+  bf_sqrt(r, &t, bits);
+  bf_free(&t);
+  bf_free(&u);
+}
+
+//(e^x - e^-x) / 2, with as many more bits as cancel for a small x
+bool bf_sinh(bigfloat *r, const bigfloat *x, size_t bits) {
+  size_t work = bits + GUARD_BITS + tiny_bits(x);
+  bigfloat t, u;
+  bf_init(&t);
+  bf_init(&u);
+  bool ok = bf_exp(&t, x, work);
+  if (ok) {
+    set_int(&u, 1);
+    bf_divide(&u, &u, &t, work);
+    bf_subtract(&t, &t, &u, work);
+    bf_shift(&t, &t, -1);
+    bf_round(r, &t, bits);
+  }
+  bf_free(&t);
+  bf_free(&u);
+  return ok;
+}
+
+bool bf_cosh(bigfloat *r, const bigfloat *x, size_t bits) {
+  size_t work = bits + GUARD_BITS;
+  bigfloat t, u;
+  bf_init(&t);
+  bf_init(&u);
+  bool ok = bf_exp(&t, x, work);
+  if (ok) {
+    set_int(&u, 1);
+    bf_divide(&u, &u, &t, work);
+    bf_add(&t, &t, &u, work);
+    bf_shift(&t, &t, -1);
+    bf_round(r, &t, bits);
+  }
+  bf_free(&t);
+  bf_free(&u);
+  return ok;
+}
+
+//(e^2x - 1) / (e^2x + 1), which is within an ulp of 1 once 2|x| passes
+//the precision times ln 2
+bool bf_tanh(bigfloat *r, const bigfloat *x, size_t bits) {
+  size_t work = bits + GUARD_BITS + tiny_bits(x);
+  if (bf_magnitude(x) > log2(work) + 1) {
+    set_int(r, x->mantissa.negative ? -1 : 1);
+    return true;
+  }
+
+  bigfloat t, one, u;
+  bf_init(&t);
+  bf_init(&one);
+  bf_init(&u);
+  bf_shift(&t, x, 1);
+  bf_exp(&t, &t, work);
+  set_int(&one, 1);
+  bf_subtract(&u, &t, &one, work);
+  bf_add(&t, &t, &one, work);
+  bf_divide(r, &u, &t, bits);
+  bf_free(&t);
+  bf_free(&one);
+  bf_free(&u);
+  return true;
+}
+
+//log(|x| + sqrt(x^2 + 1)), with the sign of x
+bool bf_asinh(bigfloat *r, const bigfloat *x, size_t bits) {
+  size_t work = bits + GUARD_BITS + tiny_bits(x);
+  bigfloat a, t, one;
+  bf_init(&a);
+  bf_init(&t);
+  bf_init(&one);
+  bf_copy(&a, x);
+  a.mantissa.negative = false;
+  set_int(&one, 1);
+  bf_multiply(&t, &a, &a, work);
+  bf_add(&t, &t, &one, work);
+  bf_sqrt(&t, &t, work);
+  bf_add(&t, &t, &a, work);
+  bf_log(&t, &t, work);
+  if (x->mantissa.negative)
+    bf_negate(&t, &t);
+  bf_round(r, &t, bits);
+  bf_free(&a);
+  bf_free(&t);
+  bf_free(&one);
+  return true;
+}
+
+//log(x + sqrt((x - 1)(x + 1))), where x - 1 is exact
+bool bf_acosh(bigfloat *r, const bigfloat *x, size_t bits) {
+  bigfloat a, b, one;
+  bf_init(&a);
+  bf_init(&b);
+  bf_init(&one);
+  set_int(&one, 1);
+  bf_subtract(&a, x, &one, EXACT_BITS);
+  bool ok = !a.mantissa.negative;
+
+  if (ok) {
+    size_t work = bits + GUARD_BITS + tiny_bits(&a);
+    bf_add(&b, x, &one, work);
+    bf_multiply(&a, &a, &b, work);
+    bf_sqrt(&a, &a, work);
+    bf_add(&a, &a, x, work);
+    bf_log(r, &a, bits);
+  }
+  bf_free(&a);
+  bf_free(&b);
+  bf_free(&one);
+  return ok;
+}
+
+//log((1 + x) / (1 - x)) / 2
+bool bf_atanh(bigfloat *r, const bigfloat *x, size_t bits) {
+  bigfloat a, b, one;
+  bf_init(&a);
+  bf_init(&b);
+  bf_init(&one);
+  set_int(&one, 1);
+  bf_add(&a, &one, x, EXACT_BITS);
+  bf_subtract(&b, &one, x, EXACT_BITS);
+  bool ok = sign_of(&a) > 0 && sign_of(&b) > 0;
+
+  if (ok) {
+    size_t work = bits + GUARD_BITS + tiny_bits(x) + tiny_bits(&b);
+    bf_divide(&a, &a, &b, work);
+    bf_log(&a, &a, work);
+    bf_shift(&a, &a, -1);
+    bf_round(r, &a, bits);
+  }
+  bf_free(&a);
+  bf_free(&b);
+  bf_free(&one);
+  return ok;
+}
+
+//digits * 10^exp10
+void bf_from_decimal(bigfloat *r, const bigint *digits, long exp10,
+                     size_t bits) {
+  bigint power;
+  big_init(&power);
+  big_set_wide(&power, 10);
+  big_power(&power, &power, labs(exp10));
+
+  if (exp10 >= 0) {
+    big_multiply(&power, &power, digits);
+    bf_set_big(r, &power, 0);
+    round_in_place(r, bits);
+  } else {
+    bigfloat a = view(digits, 0), b = view(&power, 0);
+    bf_divide(r, &a, &b, bits);
+  }
+  big_free(&power);
+}
+
+//The first num_digits decimal digits of |x|, rounded, the first of them
+//standing for 10^exp10. The estimate of exp10 from the magnitude of x is
+//at most one too low, and rounding up can carry into another digit, so
+//the digits are found again if there are too many or too few.
+int *bf_to_decimal(const bigfloat *x, size_t num_digits, long *exp10) {
+  *exp10 = 0;
+  if (!x->mantissa.length) {
+    int *digits = calloc(num_digits, sizeof(int));
+    if (!digits)
+      raise_error(ERROR_SYS, "memory allocation failure");
+    return digits;
+  }
+
+  bigint ten, low, high, num, den, t;
+  big_init(&ten);
+  big_init(&low);
+  big_init(&high);
+  big_init(&num);
+  big_init(&den);
+  big_init(&t);
+  big_set_wide(&ten, 10);
+  big_power(&low, &ten, num_digits - 1);
+  big_multiply(&high, &low, &ten);
+
+  bigint magnitude = x->mantissa;
+  magnitude.capacity = 0;
+  magnitude.negative = false;
+  long estimate = floor((bf_magnitude(x) - 1) * LOG10_2);
+
+  for (;;) {
+    //round(|x| 10^k) for the first digit to land in the ones place
+    long k = (long)num_digits - 1 - estimate;
+    big_power(&t, &ten, labs(k));
+    big_copy(&num, &magnitude);
+    big_set_wide(&den, 1);
+    if (k >= 0)
+      big_multiply(&num, &num, &t);
+    else
+      big_copy(&den, &t);
+    if (x->exponent >= 0)
+      big_shift_left(&num, &num, x->exponent);
+    else
+      big_shift_left(&den, &den, -x->exponent);
+
+    big_shift_left(&num, &num, 1);
+    big_add(&num, &num, &den);
+    big_shift_left(&den, &den, 1);
+    big_divide(&t, NULL, &num, &den);
+
+    if (big_compare(&t, &high) >= 0)
+      estimate++;
+    else if (big_compare(&t, &low) < 0)
+      estimate--;
+    else
+      break;
+  }
+
+  size_t count;
+  int *digits = big_to_digits(&t, 10, &count);
+  *exp10 = estimate;
+
+  big_free(&ten);
+  big_free(&low);
+  big_free(&high);
+  big_free(&num);
+  big_free(&den);
+  big_free(&t);
+  return digits;
+}
+
+static int sign_of(const bigfloat *x) {
+  if (!x->mantissa.length)
+    return 0;
+  return x->mantissa.negative ? -1 : 1;
+}
+
+//a read-only bigfloat on limbs that belong to someone else
+static bigfloat view(const bigint *mantissa, long exponent) {
+  bigfloat x = { *mantissa, exponent };
+  x.mantissa.capacity = 0;
+  return x;
+}
+
+static void set_int(bigfloat *x, long value) {
+  big_set_wide(&x->mantissa, value);
+  x->exponent = 0;
+  strip_zeros(x);
+}
+
+//frees r and moves t into it
+static void move_into(bigfloat *r, bigfloat *t) {
+  if (r == t)
+    return;
+  bf_free(r);
+  *r = *t;
+}
+
+//trailing zero bits go into the exponent
+static void strip_zeros(bigfloat *x) {
+  if (!x->mantissa.length) {
+    x->exponent = 0;
+    return;
+  }
+
+  size_t zeros = 0, i = 0;
+  while (x->mantissa.limbs[i] == 0) {
+    zeros += 64;
+    i++;
+  }
+  zeros += __builtin_ctzll(x->mantissa.limbs[i]);
+  if (zeros) {
+    big_shift_right(&x->mantissa, &x->mantissa, zeros);
+    x->exponent += zeros;
+  }
+}
+
+static bool bit_set(const bigint *x, size_t i) {
+  return i / 64 < x->length && (x->limbs[i / 64] >> (i % 64) & 1);
+}
+
+static bool low_bits_nonzero(const bigint *x, size_t count) {
+  size_t limbs = count / 64;
+  for (size_t i = 0; i < limbs && i < x->length; i++)
+    if (x->limbs[i])
+      return true;
+  if (limbs < x->length && count % 64)
+    return (x->limbs[limbs] & ((UINT64_C(1) << count % 64) - 1)) != 0;
+  return false;
+}
+
+//to nearest, halves away from zero
+static void round_in_place(bigfloat *x, size_t bits) {
+  size_t n = big_bits(&x->mantissa);
+  if (n > bits) {
+    size_t cut = n - bits;
+    bool up = bit_set(&x->mantissa, cut - 1);
+    bool negative = x->mantissa.negative;
+    x->mantissa.negative = false;
+    big_shift_right(&x->mantissa, &x->mantissa, cut);
+    if (up) {
+      bigint one = { (uint64_t[]){ 1 }, 1, 0, false };
+      big_add(&x->mantissa, &x->mantissa, &one);
+    }
+    x->mantissa.negative = negative && x->mantissa.length;
+    x->exponent += cut;
+  }
+  strip_zeros(x);
+}
+
+//An operand that lies wholly below the last bit of the other can only
+//round it, so it is left out rather than aligned.
+static void add_signed(bigfloat *r, const bigfloat *a, const bigfloat *b,
+                       size_t bits, bool negate_b) {
+  bigfloat y = view(&b->mantissa, b->exponent);
+  if (negate_b)
+    y.mantissa.negative = y.mantissa.length && !y.mantissa.negative;
+
+  if (!a->mantissa.length || !y.mantissa.length) {
+    bf_round(r, a->mantissa.length ? a : &y, bits);
+    return;
+  }
+  long ma = bf_magnitude(a), mb = bf_magnitude(&y);
+  if (ma > mb + (long)bits + 2 || mb > ma + (long)bits + 2) {
+    bf_round(r, (ma > mb) ? a : &y, bits);
+    return;
+  }
+
+  long exponent = (a->exponent < y.exponent) ? a->exponent : y.exponent;
+  bigfloat t;
+  bigint u;
+  bf_init(&t);
+  big_init(&u);
+  big_shift_left(&t.mantissa, &a->mantissa, a->exponent - exponent);
+  big_shift_left(&u, &y.mantissa, y.exponent - exponent);
+  big_add(&t.mantissa, &t.mantissa, &u);
+  t.exponent = exponent;
+  big_free(&u);
+
+  round_in_place(&t, bits);
+  move_into(r, &t);
+}
+
+//a - n b, with n the quotient a / b truncated as fmod() does, or
+//rounded to nearest with ties to even as remainder() does. It is exact
+//until the rounding at the end.
+static void remainder_of(bigfloat *r, const bigfloat *a, const bigfloat *b,
+                         size_t bits, bool nearest) {
+  long exponent = (a->exponent < b->exponent) ? a->exponent : b->exponent;
+  bigint x, y, q;
+  big_init(&x);
+  big_init(&y);
+  big_init(&q);
+  big_shift_left(&x, &a->mantissa, a->exponent - exponent);
+  big_shift_left(&y, &b->mantissa, b->exponent - exponent);
+  big_divide(&q, &x, &x, &y);
+  y.negative = false;
+
+  if (nearest && x.length) {
+    //twice the remainder against the divisor says which way is nearer
+    bigint twice;
+    big_init(&twice);
+    big_shift_left(&twice, &x, 1);
+    twice.negative = false;
+    int c = big_compare(&twice, &y);
+    if (c > 0 || (c == 0 && q.length && (q.limbs[0] & 1))) {
+      if (x.negative)
+        big_add(&x, &x, &y);
+      else
+        big_subtract(&x, &x, &y);
+    }
+    big_free(&twice);
+  }
+
+  bigfloat t = { x, exponent };
+  round_in_place(&t, bits);
+  big_free(&y);
+  big_free(&q);
+  move_into(r, &t);
+}
+
+//a constant from its cache, if it has been found to at least bits
+static bool cached(constant *c, bigfloat *r, size_t bits) {
+  if (c->bits < bits)
+    return false;
+  bf_round(r, &c->value, bits);
+  return true;
+}
+
+static void cache(constant *c, const bigfloat *x, size_t bits) {
+  bf_copy(&c->value, x);
+  c->bits = bits;
+}
+
+//Binary splitting of the Chudnovsky series over terms [from, to): p and
+//q are the products of the numerators and denominators of the ratios
+//between terms, and t the sum of the terms scaled by q. The two halves
+//run on separate threads while there are threads to spare and terms
+//enough to share, and so do the products that join them.
+static void *chudnovsky(void *arg) {
+  chudnovsky_split *s = arg;
+  big_init(&s->p);
+  big_init(&s->q);
+  big_init(&s->t);
+
+  if (s->to - s->from == 1) {
+    unsigned long k = s->from;
+    bigint a;
+    big_init(&a);
+    if (k == 0) {
+      big_set_wide(&s->p, 1);
+      big_set_wide(&s->q, 1);
+    } else {
+      big_set_wide(&s->p, (__int128)(6 * k - 5) * (2 * k - 1) * (6 * k - 1));
+      big_set_wide(&s->q, (__int128)k * k * k * CHUDNOVSKY_C3_24);
+    }
+    big_set_wide(&a, 13591409 + (__int128)545140134 * k);
+    big_multiply(&s->t, &s->p, &a);
+    if (k & 1)
+      big_negate(&s->t, &s->t);
+    big_free(&a);
+    return NULL;
+  }
+
+  unsigned long middle = s->from + (s->to - s->from) / 2;
+  chudnovsky_split left = { .from = s->from, .to = middle,
+                            .threads = s->threads - s->threads / 2,
+                            .need_p = true };
+  chudnovsky_split right = { .from = middle, .to = s->to,
+                             .threads = s->threads / 2,
+                             .need_p = s->need_p };
+  pthread_t thread;
+  bool threaded = s->threads > 1 && s->to - s->from >= 2 * parallel_terms
+    && pthread_create(&thread, NULL, chudnovsky, &right) == 0;
+  chudnovsky(&left);
+  if (threaded)
+    pthread_join(thread, NULL);
+  else
+    chudnovsky(&right);
+
+  //q = q_left q_right, and t = t_left q_right + p_left t_right
+  product q_product = { &s->q, &left.q, &right.q };
+  threaded = threaded
+    && pthread_create(&thread, NULL, multiply_product, &q_product) == 0;
+  if (!threaded)
+    multiply_product(&q_product);
+
+  bigint u;
+  big_init(&u);
+  big_multiply(&s->t, &left.t, &right.q);
+  big_multiply(&u, &left.p, &right.t);
+  big_add(&s->t, &s->t, &u);
+  if (s->need_p)
+    big_multiply(&s->p, &left.p, &right.p);
+  if (threaded)
+    pthread_join(thread, NULL);
+
+  big_free(&u);
+  big_free(&left.p);
+  big_free(&left.q);
+  big_free(&left.t);
+  big_free(&right.p);
+  big_free(&right.q);
+  big_free(&right.t);
+  return NULL;
+}
+
+static void *multiply_product(void *arg) {
+  product *x = arg;
+  big_multiply(x->r, x->a, x->b);
+  return NULL;
+}
+
+//the sum over k in (from, to] of from!/k!, as p/q with q = to!/from!
+static void e_series(bigint *p, bigint *q, unsigned long from,
+                     unsigned long to) {
+  if (to - from == 1) {
+    big_set_wide(p, 1);
+    big_set_wide(q, to);
+    return;
+  }
+
+  unsigned long middle = from + (to - from) / 2;
+  bigint p2, q2;
+  big_init(&p2);
+  big_init(&q2);
+  e_series(p, q, from, middle);
+  e_series(&p2, &q2, middle, to);
+  big_multiply(p, p, &q2);
+  big_add(p, p, &p2);
+  big_multiply(q, q, &q2);
+  big_free(&p2);
+  big_free(&q2);
+}
+
+//n atanh(1/n) is the sum of 1 / ((2k + 1) n^2k), split over terms
+//[from, to) into the product b of the 2k + 1, the product q of the n^2,
+//and t, the sum scaled by both
+static void atanh_series(bigint *b, bigint *q, bigint *t, unsigned long n,
+                         unsigned long from, unsigned long to) {
+  if (to - from == 1) {
+    big_set_wide(b, 2 * (__int128)from + 1);
+    big_set_wide(q, from ? (__int128)n * n : 1);
+    big_set_wide(t, 1);
+    return;
+  }
+
+  unsigned long middle = from + (to - from) / 2;
+  bigint b2, q2, t2;
+  big_init(&b2);
+  big_init(&q2);
+  big_init(&t2);
+  atanh_series(b, q, t, n, from, middle);
+  atanh_series(&b2, &q2, &t2, n, middle, to);
+  big_multiply(t, t, &b2);
+  big_multiply(t, t, &q2);
+  big_multiply(&t2, &t2, b);
+  big_add(t, t, &t2);
+  big_multiply(b, b, &b2);
+  big_multiply(q, q, &q2);
+  big_free(&b2);
+  big_free(&q2);
+  big_free(&t2);
+}
+
+static void atanh_inverse(bigfloat *r, unsigned long n, size_t bits) {
+  unsigned long terms = bits / (2 * log2(n)) + 2;
+  bigint b, q, t;
+  big_init(&b);
+  big_init(&q);
+  big_init(&t);
+  atanh_series(&b, &q, &t, n, 0, terms);
+
+  bigint n_big = { (uint64_t[]){ n }, 1, 0, false };
+  big_multiply(&b, &b, &q);
+  big_multiply(&b, &b, &n_big);
+  bigfloat num = view(&t, 0), den = view(&b, 0);
+  bf_divide(r, &num, &den, bits);
+  big_free(&b);
+  big_free(&q);
+  big_free(&t);
+}
+
+//18 atanh(1/26) - 2 atanh(1/4801) + 8 atanh(1/8749)
+static void ln2(bigfloat *r, size_t bits) {
+  if (cached(&ln2_cache, r, bits))
+    return;
+
+  size_t work = bits + GUARD_BITS;
+  unsigned long n[] = { 26, 4801, 8749 };
+  long factor[] = { 18, -2, 8 };
+  bigfloat x, term, f;
+  bf_init(&x);
+  bf_init(&term);
+  bf_init(&f);
+  for (int i = 0; i < 3; i++) {
+    atanh_inverse(&term, n[i], work);
+    set_int(&f, factor[i]);
+    bf_multiply(&term, &term, &f, work);
+    bf_add(&x, &x, &term, work);
+  }
+
+  cache(&ln2_cache, &x, work);
+  bf_round(r, &x, bits);
+  bf_free(&x);
+  bf_free(&term);
+  bf_free(&f);
+}
+
+//3 ln 2 + 2 atanh(1/9), since 10 = 2^3 (1 + 1/9) / (1 - 1/9)
+static void ln10(bigfloat *r, size_t bits) {
+  if (cached(&ln10_cache, r, bits))
+    return;
+
+  size_t work = bits + GUARD_BITS;
+  bigfloat x, t;
+  bf_init(&x);
+  bf_init(&t);
+  ln2(&x, work);
+  set_int(&t, 3);
+  bf_multiply(&x, &x, &t, work);
+  atanh_inverse(&t, 9, work);
+  bf_shift(&t, &t, 1);
+  bf_add(&x, &x, &t, work);
+
+  cache(&ln10_cache, &x, work);
+  bf_round(r, &x, bits);
+  bf_free(&x);
+  bf_free(&t);
+}
+
+//x as a fixed-point integer with frac fractional bits, rounded down
+static void to_fixed(bigint *r, const bigfloat *x, size_t frac) {
+  long shift = x->exponent + (long)frac;
+  if (shift >= 0)
+    big_shift_left(r, &x->mantissa, shift);
+  else
+    big_shift_right(r, &x->mantissa, -shift);
+}
+
+static void from_fixed(bigfloat *r, const bigint *x, size_t frac,
+                       size_t bits) {
+  bf_set_big(r, x, -(long)frac);
+  round_in_place(r, bits);
+}
+
+static void divide_by(bigint *x, uint64_t divisor) {
+  bigint d = { &divisor, 1, 0, false };
+  big_divide(x, NULL, x, &d);
+}
+
+//between terms i - 1 and i: i for exp, (2i - 1) 2i for cos in -x^2
+static uint64_t series_divisor(uint64_t i, char kind) {
+  return (kind == 'e') ? i : (2 * i - 1) * (2 * i);
+}
+
+//The sum over i >= 0 of x^i / (d(1) d(2) ... d(i)), with d from
+//series_divisor, in fixed point. Rectangular splitting takes the terms m
+//at a time, m near the square root of their number: x^0 to x^m are
+//found once, and each block of m then costs one full multiplication and
+//m divisions by small integers, where term by term each would cost a
+//full multiplication.
+static void fixed_series(bigint *sum, const bigint *x, size_t frac,
+                         char kind) {
+  //terms until they fall below the last bit
+  size_t n = 0;
+  if (x->length) {
+    double step = (double)big_bits(x) - frac;
+    for (double size = 0; size > -(double)frac - 2;) {
+      n++;
+      size += step - log2(series_divisor(n, kind));
+    }
+  }
+
+  size_t m = ceil(sqrt(n));
+  if (m < 1)
+    m = 1;
+  bigint *powers = malloc((m + 1) * sizeof(bigint));
+  if (!powers)
+    raise_error(ERROR_SYS, "memory allocation failure");
+  for (size_t j = 0; j <= m; j++)
+    big_init(&powers[j]);
+  big_set_wide(&powers[0], 1);
+  big_shift_left(&powers[0], &powers[0], frac);
+  big_copy(&powers[1], x);
+  for (size_t j = 2; j <= m; j++) {
+    big_multiply(&powers[j], &powers[j - 1], x);
+    big_shift_right(&powers[j], &powers[j], frac);
+  }
+
+  //each block's terms by Horner's rule, the later blocks folded in first
+  bigint acc;
+  big_init(&acc);
+  for (size_t block = n / m + 1; block-- > 0;) {
+    if (acc.length) {
+      big_multiply(&acc, &acc, &powers[m]);
+      big_shift_right(&acc, &acc, frac);
+    }
+    for (size_t j = m; j > 0; j--) {
+      divide_by(&acc, series_divisor(block * m + j, kind));
+      big_add(&acc, &acc, &powers[j - 1]);
+    }
+  }
+
+  for (size_t j = 0; j <= m; j++)
+    big_free(&powers[j]);
+  free(powers);
+  big_free(sum);
+  *sum = acc;
+}
+
+//how many times exp and cos halve their argument: each halving costs a
+//squaring and saves a few terms, and about the cube root of the
+//precision balances the two
+static size_t halvings(size_t bits) {
+  return cbrt(bits);
+}
+
+//x less the nearest multiple k of pi/2 leaves |r| <= pi/4, found with as
+//many more bits as cancel in the subtraction. 1 - cos(r / 2^s) from its
+//series is then doubled s times by 1 - cos 2t = 2 v (2 - v), and
+//cos r = 1 - v and sin r = sqrt(v (2 - v)); k mod 4 swaps and negates
+//them.
+static bool sin_cos(bigfloat *sine, bigfloat *cosine, const bigfloat *x,
+                    size_t bits) {
+  long magnitude = bf_magnitude(x);
+  if (magnitude > MAX_REDUCTION_BITS)
+    return false;
+
+  size_t work = bits + GUARD_BITS;
+  size_t integer_bits = (magnitude > 0) ? magnitude : 0;
+  bigfloat half_pi, reduced, t;
+  bigint k;
+  bf_init(&half_pi);
+  bf_init(&reduced);
+  bf_init(&t);
+  big_init(&k);
+
+  for (size_t extra = GUARD_BITS;;) {
+    size_t p = work + integer_bits + extra;
+    bf_pi(&half_pi, p);
+    bf_shift(&half_pi, &half_pi, -1);
+    bf_divide(&t, x, &half_pi, integer_bits + GUARD_BITS);
+    bf_get_integer(&k, &t, 'r');
+    bf_set_big(&t, &k, 0);
+    bf_multiply(&t, &t, &half_pi, p);
+    bf_subtract(&reduced, x, &t, p);
+
+    long lost = -bf_magnitude(&reduced);
+    if (!k.length || lost + GUARD_BITS <= (long)extra)
+      break;
+    extra = lost + 2 * GUARD_BITS;
+  }
+
+  int quadrant = k.length ? (k.limbs[0] & 3) : 0;
+  if (k.negative)
+    quadrant = (4 - quadrant) & 3;
+
+  size_t s = halvings(work);
+  size_t frac = work + 2 * s + 2 * tiny_bits(&reduced) + GUARD_BITS;
+  bigint y, v, one, u, c;
+  big_init(&y);
+  big_init(&v);
+  big_init(&one);
+  big_init(&u);
+  big_init(&c);
+
+  to_fixed(&y, &reduced, frac - s);
+  big_multiply(&y, &y, &y);
+  big_shift_right(&y, &y, frac);
+  big_negate(&y, &y);
+  fixed_series(&v, &y, frac, 'c');
+  big_set_wide(&one, 1);
+  big_shift_left(&one, &one, frac);
+  big_subtract(&v, &one, &v);
+
+  for (size_t i = 0; i < s; i++) {
+    big_shift_left(&u, &one, 1);
+    big_subtract(&u, &u, &v);
+    big_multiply(&v, &v, &u);
+    big_shift_right(&v, &v, frac - 1);
+  }
+  if (v.negative)
+    big_set_wide(&v, 0);
+
+  big_subtract(&c, &one, &v);
+  big_shift_left(&u, &one, 1);
+  big_subtract(&u, &u, &v);
+  big_multiply(&u, &u, &v);
+  big_sqrt(&u, &u);
+  if (reduced.mantissa.negative)
+    big_negate(&u, &u);
+
+  //sin(r + q pi/2) and cos(r + q pi/2) for each quadrant q
+  if (sine) {
+    from_fixed(sine, (quadrant & 1) ? &c : &u, frac, bits);
+    if (quadrant >= 2)
+      bf_negate(sine, sine);
+  }
+  if (cosine) {
+    from_fixed(cosine, (quadrant & 1) ? &u : &c, frac, bits);
+    if (quadrant == 1 || quadrant == 2)
+      bf_negate(cosine, cosine);
+  }
+
+  bf_free(&half_pi);
+  bf_free(&reduced);
+  bf_free(&t);
+  big_free(&k);
+  big_free(&y);
+  big_free(&v);
+  big_free(&one);
+  big_free(&u);
+  big_free(&c);
+  return true;
+}
+
+//the leading zero bits of a fraction below 1, or 0 for anything larger
+static size_t tiny_bits(const bigfloat *x) {
+  long magnitude = bf_magnitude(x);
+  return (magnitude < 0 && x->mantissa.length) ? -magnitude : 0;
+}
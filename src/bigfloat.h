@@ -0,0 +1,110 @@
+/* ccalc -- evaluate C-style expressions from the command line.
+   Copyright (C) 2015-2017 Gregory Kikola.
+
+   This file is part of ccalc.
+
+   ccalc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   ccalc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with ccalc.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Written by Gregory Kikola <gkikola@gmail.com>. */
+
+#ifndef CCALC_BIGFLOAT_H
+#define CCALC_BIGFLOAT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "bigint.h"
+
+//A binary floating-point number of any precision, mantissa * 2^exponent.
+//Results have odd mantissas, so that each number has one form and zero
+//has exponent 0, but operands need not: an integer can be passed as its
+//bigint with exponent 0. Each operation rounds its result to nearest at
+//the number of bits it is given.
+typedef struct bigfloat {
+  bigint mantissa;
+  long exponent;
+} bigfloat;
+
+//Chudnovsky terms below which the series for pi is no longer split
+//across threads, and the most threads it is split across, 0 meaning one
+//for each processor. They are variables so that the tests can force the
+//threads on and check them against a single one.
+extern size_t parallel_terms;
+extern int max_threads;
+
+void bf_init(bigfloat *x);
+void bf_free(bigfloat *x);
+void bf_copy(bigfloat *r, const bigfloat *x);
+void bf_set_big(bigfloat *r, const bigint *mantissa, long exponent);
+void bf_set_double(bigfloat *r, double d);
+double bf_get_double(const bigfloat *x);
+void bf_get_integer(bigint *r, const bigfloat *x, char mode);
+long bf_magnitude(const bigfloat *x);
+int bf_compare(const bigfloat *a, const bigfloat *b);
+void bf_round(bigfloat *r, const bigfloat *x, size_t bits);
+
+void bf_add(bigfloat *r, const bigfloat *a, const bigfloat *b, size_t bits);
+void bf_subtract(bigfloat *r, const bigfloat *a, const bigfloat *b,
+                 size_t bits);
+void bf_multiply(bigfloat *r, const bigfloat *a, const bigfloat *b,
+                 size_t bits);
+void bf_divide(bigfloat *r, const bigfloat *a, const bigfloat *b,
+               size_t bits);
+void bf_negate(bigfloat *r, const bigfloat *a);
+void bf_shift(bigfloat *r, const bigfloat *a, long count);
+void bf_power(bigfloat *r, const bigfloat *base, long exp, size_t bits);
+void bf_fmod(bigfloat *r, const bigfloat *a, const bigfloat *b, size_t bits);
+void bf_remainder(bigfloat *r, const bigfloat *a, const bigfloat *b,
+                  size_t bits);
+
+void bf_atan2(bigfloat *r, const bigfloat *y, const bigfloat *x,
+              size_t bits);
+void bf_hypot(bigfloat *r, const bigfloat *a, const bigfloat *b,
+              size_t bits);
+
+void bf_pi(bigfloat *r, size_t bits);
+void bf_e(bigfloat *r, size_t bits);
+void bf_phi(bigfloat *r, size_t bits);
+
+//These return false, leaving r alone, where the result is undefined or
+//too far out of range to be worth computing
+bool bf_sqrt(bigfloat *r, const bigfloat *x, size_t bits);
+bool bf_cbrt(bigfloat *r, const bigfloat *x, size_t bits);
+bool bf_exp(bigfloat *r, const bigfloat *x, size_t bits);
+bool bf_expm1(bigfloat *r, const bigfloat *x, size_t bits);
+bool bf_log(bigfloat *r, const bigfloat *x, size_t bits);
+bool bf_log2(bigfloat *r, const bigfloat *x, size_t bits);
+bool bf_log10(bigfloat *r, const bigfloat *x, size_t bits);
+bool bf_log1p(bigfloat *r, const bigfloat *x, size_t bits);
+bool bf_pow(bigfloat *r, const bigfloat *base, const bigfloat *exp,
+            size_t bits);
+bool bf_sin(bigfloat *r, const bigfloat *x, size_t bits);
+bool bf_cos(bigfloat *r, const bigfloat *x, size_t bits);
+bool bf_tan(bigfloat *r, const bigfloat *x, size_t bits);
+bool bf_asin(bigfloat *r, const bigfloat *x, size_t bits);
+bool bf_acos(bigfloat *r, const bigfloat *x, size_t bits);
+bool bf_atan(bigfloat *r, const bigfloat *x, size_t bits);
+bool bf_sinh(bigfloat *r, const bigfloat *x, size_t bits);
+bool bf_cosh(bigfloat *r, const bigfloat *x, size_t bits);
+bool bf_tanh(bigfloat *r, const bigfloat *x, size_t bits);
+bool bf_asinh(bigfloat *r, const bigfloat *x, size_t bits);
+bool bf_acosh(bigfloat *r, const bigfloat *x, size_t bits);
+bool bf_atanh(bigfloat *r, const bigfloat *x, size_t bits);
+
+void bf_from_decimal(bigfloat *r, const bigint *digits, long exp10,
+                     size_t bits);
+int *bf_to_decimal(const bigfloat *x, size_t num_digits, long *exp10);
+
+#endif
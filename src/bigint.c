@@ -0,0 +1,1192 @@
+/* ccalc -- evaluate C-style expressions from the command line.
+   Copyright (C) 2015-2017 Gregory Kikola.
+
+   This file is part of ccalc.
+
+   ccalc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   ccalc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with ccalc.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Written by Gregory Kikola <gkikola@gmail.com>. */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bigint.h"
+#include "error.h"
+
+//Every public function works on signed bigints and writes its result to
+//a fresh bigint before replacing r, so r may be one of the operands.
+//Underneath, the limbs_* functions work on plain magnitudes, where the
+//multiplication algorithms live. Limb arrays passed to them may have
+//leading zeros.
+
+//the prime 2^64 - 2^32 + 1, whose multiplicative group has a subgroup of
+//order 2^32 generated by powers of 7
+#define NTT_PRIME 0xffffffff00000001UL
+#define NTT_GENERATOR 7
+#define NTT_PIECE_BITS 16 //small enough that no coefficient reaches the prime
+
+#define LIMB_BITS 64
+
+size_t karatsuba_threshold = 32;
+size_t toom3_threshold = 256;
+size_t ntt_threshold = 40000;
+size_t newton_threshold = 1536;
+size_t radix_threshold = 768;
+
+void reserve(bigint *x, size_t length);
+void replace(bigint *r, bigint *t);
+void normalize(bigint *x);
+bigint borrow_limbs(const uint64_t *limbs, size_t length);
+size_t strip(const uint64_t *limbs, size_t length);
+void copy_limbs(uint64_t *r, const uint64_t *x, size_t length);
+
+int limbs_compare(const uint64_t *a, size_t an, const uint64_t *b,
+                  size_t bn);
+uint64_t limbs_add_to(uint64_t *r, size_t rn, const uint64_t *b, size_t bn);
+uint64_t limbs_subtract_from(uint64_t *r, size_t rn, const uint64_t *b,
+                             size_t bn);
+uint64_t limbs_multiply_small(uint64_t *r, const uint64_t *a, size_t n,
+                              uint64_t factor, uint64_t carry);
+uint64_t limbs_divide_small(uint64_t *q, const uint64_t *a, size_t n,
+                            uint64_t divisor);
+void limbs_multiply(uint64_t *r, const uint64_t *a, size_t an,
+                    const uint64_t *b, size_t bn);
+void multiply_schoolbook(uint64_t *r, const uint64_t *a, size_t an,
+                         const uint64_t *b, size_t bn);
+void multiply_karatsuba(uint64_t *r, const uint64_t *a, size_t an,
+                        const uint64_t *b, size_t bn);
+void multiply_toom3(uint64_t *r, const uint64_t *a, size_t an,
+                    const uint64_t *b, size_t bn);
+void multiply_ntt(uint64_t *r, const uint64_t *a, size_t an,
+                  const uint64_t *b, size_t bn);
+void divide_schoolbook(uint64_t *q, uint64_t *rem, const uint64_t *a,
+                       size_t an, const uint64_t *b, size_t bn);
+
+void add_magnitudes(bigint *r, const bigint *a, const bigint *b);
+void subtract_magnitudes(bigint *r, const bigint *a, const bigint *b);
+void add_signed(bigint *r, const bigint *a, const bigint *b, bool negate_b);
+void divide_small(bigint *r, const bigint *a, uint64_t divisor);
+void divide_plain(bigint *q, bigint *rem, const bigint *a,
+                  const bigint *b);
+void divide_magnitudes(bigint *q, bigint *rem, const bigint *a,
+                       const bigint *b);
+void reciprocal(bigint *x, const bigint *d, size_t k);
+void power_of_two(bigint *r, size_t exponent);
+
+uint64_t ntt_reduce(unsigned __int128 x);
+uint64_t ntt_multiply(uint64_t a, uint64_t b);
+uint64_t ntt_power(uint64_t base, uint64_t exp);
+void ntt_transform(uint64_t *a, size_t n, bool inverse);
+
+void to_twos_complement(uint64_t *t, const bigint *x, size_t length);
+void digits_schoolbook(const bigint *x, int radix, int chunk_digits,
+                       uint64_t chunk, int *digits, size_t width);
+void digits_recursive(const bigint *x, int radix, int chunk_digits,
+                      uint64_t chunk, bigint powers[], int level,
+                      int *digits);
+
+void big_init(bigint *x) {
+  x->limbs = NULL;
+  x->length = 0;
+  x->capacity = 0;
+  x->negative = false;
+}
+
+void big_free(bigint *x) {
+  if (x->capacity)
+    free(x->limbs);
+  big_init(x);
+}
+
+void big_copy(bigint *r, const bigint *x) {
+  bigint t;
+  big_init(&t);
+  reserve(&t, x->length);
+  copy_limbs(t.limbs, x->limbs, x->length);
+  t.length = x->length;
+  t.negative = x->negative;
+  replace(r, &t);
+}
+
+void big_set_wide(bigint *x, __int128 wvalue) {
+  unsigned __int128 magnitude = (wvalue < 0) ? -(unsigned __int128)wvalue
+    : (unsigned __int128)wvalue;
+
+  reserve(x, 2);
+  x->limbs[0] = (uint64_t)magnitude;
+  x->limbs[1] = (uint64_t)(magnitude >> 64);
+  x->length = 2;
+  x->negative = wvalue < 0;
+  normalize(x);
+}
+
+bool big_fits_wide(const bigint *x) {
+  if (x->length < 2 || (x->length == 2 && !(x->limbs[1] >> 63)))
+    return true;
+
+  //-2^127 is the one magnitude with the top bit set that fits
+  return x->length == 2 && x->negative && x->limbs[1] == 1UL << 63
+    && x->limbs[0] == 0;
+}
+
+//the low 128 bits, in two's complement, as a conversion in C would give
+__int128 big_get_wide(const bigint *x) {
+  unsigned __int128 magnitude = 0;
+  if (x->length > 0)
+    magnitude = x->limbs[0];
+  if (x->length > 1)
+    magnitude |= (unsigned __int128)x->limbs[1] << 64;
+
+  return (__int128)(x->negative ? -magnitude : magnitude);
+}
+
+//Rounded correctly: the top 128 bits are converted with one more bit set
+//below them if anything further down is nonzero, so that the conversion
+//sees which side of a halfway point the whole number lies.
+double big_get_double(const bigint *x) {
+  if (x->length <= 2) {
+    unsigned __int128 magnitude = (x->length > 0) ? x->limbs[0] : 0;
+    if (x->length > 1)
+      magnitude |= (unsigned __int128)x->limbs[1] << 64;
+    return x->negative ? -(double)magnitude : (double)magnitude;
+  }
+
+  size_t bits = big_bits(x);
+  size_t shift = bits - 128;
+  size_t limb = shift / LIMB_BITS;
+  int offset = shift % LIMB_BITS;
+
+  unsigned __int128 top = (unsigned __int128)x->limbs[limb + 1] << 64
+    | x->limbs[limb];
+  bool sticky = false;
+  if (offset) {
+    top = top >> offset
+      | (unsigned __int128)x->limbs[limb + 2] << (128 - offset);
+    sticky = x->limbs[limb] << (LIMB_BITS - offset);
+  }
+  for (size_t i = 0; i < limb && !sticky; i++)
+    sticky = x->limbs[i] != 0;
+
+  double result = ldexp((double)(top | sticky), shift);
+  return x->negative ? -result : result;
+}
+
+size_t big_bits(const bigint *x) {
+  if (x->length == 0)
+    return 0;
+  return x->length * LIMB_BITS - __builtin_clzl(x->limbs[x->length - 1]);
+}
+
+int big_compare(const bigint *a, const bigint *b) {
+  if (a->negative != b->negative)
+    return a->negative ? -1 : 1;
+
+  int result = limbs_compare(a->limbs, a->length, b->limbs, b->length);
+  return a->negative ? -result : result;
+}
+
+void big_add(bigint *r, const bigint *a, const bigint *b) {
+  add_signed(r, a, b, false);
+}
+
+void big_subtract(bigint *r, const bigint *a, const bigint *b) {
+  add_signed(r, a, b, true);
+}
+
+void big_multiply(bigint *r, const bigint *a, const bigint *b) {
+  bigint t;
+  big_init(&t);
+
+  if (a->length && b->length) {
+    reserve(&t, a->length + b->length);
+    limbs_multiply(t.limbs, a->limbs, a->length, b->limbs, b->length);
+    t.length = a->length + b->length;
+    t.negative = a->negative != b->negative;
+    normalize(&t);
+  }
+  replace(r, &t);
+}
+
+//Truncating division, as in C: the quotient is rounded toward zero and
+//the remainder takes the sign of the dividend. Either result may be NULL.
+//The divisor must not be zero.
+void big_divide(bigint *q, bigint *rem, const bigint *a, const bigint *b) {
+  bigint qt, rt;
+  big_init(&qt);
+  big_init(&rt);
+
+  bigint abs_a = *a, abs_b = *b;
+  abs_a.negative = abs_b.negative = false;
+  divide_magnitudes(&qt, &rt, &abs_a, &abs_b);
+
+  qt.negative = qt.length && a->negative != b->negative;
+  rt.negative = rt.length && a->negative;
+  if (q)
+    replace(q, &qt);
+  else
+    big_free(&qt);
+  if (rem)
+    replace(rem, &rt);
+  else
+    big_free(&rt);
+}
+
+void big_negate(bigint *r, const bigint *a) {
+  big_copy(r, a);
+  r->negative = r->length && !a->negative;
+}
+
+//by squaring, which the subquadratic algorithms make much faster than
+//multiplying by the base over and over
+void big_power(bigint *r, const bigint *base, unsigned long exp) {
+  bigint result, factor;
+  big_init(&result);
+  big_init(&factor);
+  big_set_wide(&result, 1);
+  big_copy(&factor, base);
+
+  while (exp) {
+    if (exp & 1)
+      big_multiply(&result, &result, &factor);
+    exp >>= 1;
+    if (exp)
+      big_multiply(&factor, &factor, &factor);
+  }
+
+  big_free(&factor);
+  replace(r, &result);
+}
+
+//The floor of the square root of a nonnegative a. The root of the top
+//half of a, shifted into place, is within a few units of the answer
+//from below, so that one step of Newton's method overshoots it and one
+//or two more settle on it: each level costs a few divisions at its own
+//size, and the levels halve.
+void big_sqrt(bigint *r, const bigint *a) {
+  size_t n = big_bits(a);
+  bigint x, t;
+  big_init(&x);
+  big_init(&t);
+
+  if (n <= 104) {
+    unsigned __int128 v = big_get_wide(a);
+    unsigned __int128 root = sqrt((double)v);
+    while (root * root > v)
+      root--;
+    while ((root + 1) * (root + 1) <= v)
+      root++;
+    big_set_wide(&x, root);
+  } else {
+    size_t k = n / 4;
+    big_shift_right(&t, a, 2 * k);
+    big_sqrt(&x, &t);
+    big_shift_left(&x, &x, k);
+
+    for (bool first = true;; first = false) {
+      big_divide(&t, NULL, a, &x);
+      big_add(&t, &t, &x);
+      big_shift_right(&t, &t, 1);
+      if (!first && big_compare(&t, &x) >= 0)
+        break;
+      big_copy(&x, &t);
+    }
+  }
+
+  big_free(&t);
+  replace(r, &x);
+}
+
+void big_shift_left(bigint *r, const bigint *a, size_t count) {
+  bigint t;
+  big_init(&t);
+
+  if (a->length) {
+    size_t limbs = count / LIMB_BITS;
+    int bits = count % LIMB_BITS;
+
+    reserve(&t, a->length + limbs + 1);
+    memset(t.limbs, 0, limbs * sizeof(uint64_t));
+    uint64_t carry = 0;
+    for (size_t i = 0; i < a->length; i++) {
+      t.limbs[limbs + i] = a->limbs[i] << bits | carry;
+      carry = bits ? a->limbs[i] >> (LIMB_BITS - bits) : 0;
+    }
+    t.limbs[limbs + a->length] = carry;
+    t.length = a->length + limbs + 1;
+    t.negative = a->negative;
+    normalize(&t);
+  }
+  replace(r, &t);
+}
+
+//rounds toward negative infinity, as >> does for a negative long int
+void big_shift_right(bigint *r, const bigint *a, size_t count) {
+  bigint t;
+  big_init(&t);
+
+  size_t limbs = count / LIMB_BITS;
+  int bits = count % LIMB_BITS;
+  bool lost = false;
+
+  for (size_t i = 0; i < limbs && i < a->length && !lost; i++)
+    lost = a->limbs[i] != 0;
+
+  if (limbs < a->length) {
+    if (bits)
+      lost |= (a->limbs[limbs] << (LIMB_BITS - bits)) != 0;
+
+    reserve(&t, a->length - limbs + 1);
+    for (size_t i = limbs; i < a->length; i++) {
+      uint64_t high = (bits && i + 1 < a->length)
+        ? a->limbs[i + 1] << (LIMB_BITS - bits) : 0;
+      t.limbs[i - limbs] = a->limbs[i] >> bits | high;
+    }
+    t.length = a->length - limbs;
+    normalize(&t);
+  }
+
+  if (a->negative && lost) {
+    bigint one = borrow_limbs((uint64_t[]){ 1 }, 1);
+    add_magnitudes(&t, &t, &one);
+  }
+  t.negative = a->negative && t.length;
+  replace(r, &t);
+}
+
+//&, | or ^ on two's complement representations one limb wider than
+//either operand, so that the sign bits take part
+void big_bitwise(bigint *r, const bigint *a, const bigint *b, char op) {
+  size_t length = ((a->length > b->length) ? a->length : b->length) + 1;
+  uint64_t *x = malloc(length * sizeof(uint64_t));
+  uint64_t *y = malloc(length * sizeof(uint64_t));
+  if (!x || !y)
+    raise_error(ERROR_SYS, "memory allocation failure");
+
+  to_twos_complement(x, a, length);
+  to_twos_complement(y, b, length);
+  for (size_t i = 0; i < length; i++) {
+    if (op == '&')
+      x[i] &= y[i];
+    else if (op == '|')
+      x[i] |= y[i];
+    else
+      x[i] ^= y[i];
+  }
+
+  bigint t;
+  big_init(&t);
+  reserve(&t, length);
+  bool negative = x[length - 1] >> 63;
+  for (size_t i = 0; i < length; i++)
+    t.limbs[i] = negative ? ~x[i] : x[i];
+  t.length = length;
+  normalize(&t);
+  if (negative) { //the magnitude of a negative number is ~x + 1
+    bigint one = borrow_limbs((uint64_t[]){ 1 }, 1);
+    add_magnitudes(&t, &t, &one);
+    t.negative = true;
+  }
+
+  free(x);
+  free(y);
+  replace(r, &t);
+}
+
+//The product of every integer from from to to, split in halves so that
+//the two factors of each multiplication are about the same size and the
+//fast algorithms get to work on them.
+void big_product_range(bigint *r, unsigned long from, unsigned long to) {
+  bigint t;
+  big_init(&t);
+
+  if (from > to) {
+    big_set_wide(&t, 1);
+  } else if (to - from < 16) {
+    reserve(&t, to - from + 2);
+    t.limbs[0] = from;
+    t.length = 1;
+    for (unsigned long i = from + 1; i <= to && i > from; i++) {
+      uint64_t carry = limbs_multiply_small(t.limbs, t.limbs, t.length, i, 0);
+      if (carry)
+        t.limbs[t.length++] = carry;
+    }
+    normalize(&t);
+  } else {
+    bigint high;
+    big_init(&high);
+    unsigned long middle = from + (to - from) / 2;
+    big_product_range(&t, from, middle);
+    big_product_range(&high, middle + 1, to);
+    big_multiply(&t, &t, &high);
+    big_free(&high);
+  }
+  replace(r, &t);
+}
+
+//The digits of |x| in the given radix, most significant first and with no
+//leading zeros, in an array the caller frees. Digits are peeled off in
+//chunks of as many as fit in one limb. Large numbers are split in two by
+//dividing by radix^(chunk * 2^k) for a k that halves them, which turns
+//the quadratic conversion into a few multiplications' worth of work.
+int *big_to_digits(const bigint *x, int radix, size_t *num_digits) {
+  int chunk_digits = 1;
+  uint64_t chunk = radix;
+  while (chunk <= UINT64_MAX / radix) {
+    chunk *= radix;
+    chunk_digits++;
+  }
+
+  //powers[k] is chunk^(2^k); stop at the first one greater than x
+  bigint powers[LIMB_BITS];
+  int levels = 0;
+  big_init(&powers[0]);
+  big_set_wide(&powers[0], chunk);
+  while (limbs_compare(powers[levels].limbs, powers[levels].length,
+                       x->limbs, x->length) <= 0) {
+    big_init(&powers[levels + 1]);
+    big_multiply(&powers[levels + 1], &powers[levels], &powers[levels]);
+    levels++;
+  }
+
+  size_t width = (size_t)chunk_digits << levels;
+  int *digits = malloc(width * sizeof(int));
+  if (!digits)
+    raise_error(ERROR_SYS, "memory allocation failure");
+
+  bigint magnitude = *x;
+  magnitude.negative = false;
+  digits_recursive(&magnitude, radix, chunk_digits, chunk, powers, levels,
+                   digits);
+  for (int i = 0; i <= levels; i++)
+    big_free(&powers[i]);
+
+  size_t start = 0;
+  while (start + 1 < width && digits[start] == 0)
+    start++;
+  memmove(digits, digits + start, (width - start) * sizeof(int));
+  *num_digits = width - start;
+  return digits;
+}
+
+void reserve(bigint *x, size_t length) {
+  if (x->capacity >= length)
+    return;
+
+  uint64_t *limbs = malloc(length * sizeof(uint64_t));
+  if (!limbs)
+    raise_error(ERROR_SYS, "memory allocation failure");
+  if (x->length)
+    memcpy(limbs, x->limbs, x->length * sizeof(uint64_t));
+  if (x->capacity)
+    free(x->limbs);
+  x->limbs = limbs;
+  x->capacity = length;
+}
+
+//frees r and moves t into it
+void replace(bigint *r, bigint *t) {
+  if (r == t)
+    return;
+  big_free(r);
+  *r = *t;
+}
+
+void normalize(bigint *x) {
+  x->length = strip(x->limbs, x->length);
+  if (x->length == 0)
+    x->negative = false;
+}
+
+bigint borrow_limbs(const uint64_t *limbs, size_t length) {
+  bigint x = { (uint64_t *)limbs, strip(limbs, length), 0, false };
+  return x;
+}
+
+size_t strip(const uint64_t *limbs, size_t length) {
+  while (length > 0 && limbs[length - 1] == 0)
+    length--;
+  return length;
+}
+
+//zero has no limbs, and may have a null pointer for them
+void copy_limbs(uint64_t *r, const uint64_t *x, size_t length) {
+  if (length)
+    memcpy(r, x, length * sizeof(uint64_t));
+}
+
+int limbs_compare(const uint64_t *a, size_t an, const uint64_t *b,
+                  size_t bn) {
+  an = strip(a, an);
+  bn = strip(b, bn);
+  if (an != bn)
+    return (an > bn) ? 1 : -1;
+
+  for (size_t i = an; i-- > 0; )
+    if (a[i] != b[i])
+      return (a[i] > b[i]) ? 1 : -1;
+  return 0;
+}
+
+//r += b, for rn >= bn; returns the carry out of r
+uint64_t limbs_add_to(uint64_t *r, size_t rn, const uint64_t *b, size_t bn) {
+  uint64_t carry = 0;
+  size_t i;
+
+  for (i = 0; i < bn; i++) {
+    unsigned __int128 sum = (unsigned __int128)r[i] + b[i] + carry;
+    r[i] = (uint64_t)sum;
+    carry = sum >> 64;
+  }
+  for (; carry && i < rn; i++)
+    carry = ++r[i] == 0;
+  return carry;
+}
+
+//r -= b, for rn >= bn; returns the borrow out of r
+uint64_t limbs_subtract_from(uint64_t *r, size_t rn, const uint64_t *b,
+                             size_t bn) {
+  uint64_t borrow = 0;
+  size_t i;
+
+  for (i = 0; i < bn; i++) {
+    unsigned __int128 diff = (unsigned __int128)r[i] - b[i] - borrow;
+    r[i] = (uint64_t)diff;
+    borrow = (diff >> 64) != 0;
+  }
+  for (; borrow && i < rn; i++)
+    borrow = r[i]-- == 0;
+  return borrow;
+}
+
+//r = a * factor + carry, n limbs; returns the limb carried out
+uint64_t limbs_multiply_small(uint64_t *r, const uint64_t *a, size_t n,
+                              uint64_t factor, uint64_t carry) {
+  for (size_t i = 0; i < n; i++) {
+    unsigned __int128 product = (unsigned __int128)a[i] * factor + carry;
+    r[i] = (uint64_t)product;
+    carry = product >> 64;
+  }
+  return carry;
+}
+
+//q = a / divisor, n limbs; returns the remainder. A divisor below 2^32
+//divides each limb as two 32-bit halves, in the processor's own 64-bit
+//division rather than the compiler's much slower 128-bit one.
+uint64_t limbs_divide_small(uint64_t *q, const uint64_t *a, size_t n,
+                            uint64_t divisor) {
+  if (divisor >> 32 == 0) {
+    uint64_t rem = 0;
+    for (size_t i = n; i-- > 0; ) {
+      uint64_t part = rem << 32 | a[i] >> 32;
+      uint64_t high = part / divisor;
+      rem = part - high * divisor;
+      part = rem << 32 | (a[i] & UINT32_MAX);
+      uint64_t low = part / divisor;
+      rem = part - low * divisor;
+      if (q)
+        q[i] = high << 32 | low;
+    }
+    return rem;
+  }
+
+  unsigned __int128 rem = 0;
+  for (size_t i = n; i-- > 0; ) {
+    unsigned __int128 part = rem << 64 | a[i];
+    uint64_t digit = part / divisor;
+    if (q)
+      q[i] = digit;
+    rem = part - (unsigned __int128)digit * divisor;
+  }
+  return (uint64_t)rem;
+}
+
+//r = a * b, an + bn limbs, where r does not overlap a or b
+void limbs_multiply(uint64_t *r, const uint64_t *a, size_t an,
+                    const uint64_t *b, size_t bn) {
+  if (an < bn) {
+    const uint64_t *swap = a;
+    a = b;
+    b = swap;
+    size_t swap_n = an;
+    an = bn;
+    bn = swap_n;
+  }
+
+  if (bn == 0) {
+    memset(r, 0, an * sizeof(uint64_t));
+  } else if (bn < karatsuba_threshold) {
+    multiply_schoolbook(r, a, an, b, bn);
+  } else if (bn >= ntt_threshold) {
+    multiply_ntt(r, a, an, b, bn);
+  } else if (an >= 2 * bn) {
+    //an unbalanced product is taken a slice of a at a time
+    uint64_t *slice = malloc(2 * bn * sizeof(uint64_t));
+    if (!slice)
+      raise_error(ERROR_SYS, "memory allocation failure");
+
+    memset(r, 0, (an + bn) * sizeof(uint64_t));
+    for (size_t offset = 0; offset < an; offset += bn) {
+      size_t length = (an - offset < bn) ? an - offset : bn;
+      limbs_multiply(slice, a + offset, length, b, bn);
+      limbs_add_to(r + offset, an + bn - offset, slice, length + bn);
+    }
+    free(slice);
+  } else if (bn < toom3_threshold) {
+    multiply_karatsuba(r, a, an, b, bn);
+  } else {
+    multiply_toom3(r, a, an, b, bn);
+  }
+}
+
+void multiply_schoolbook(uint64_t *r, const uint64_t *a, size_t an,
+                         const uint64_t *b, size_t bn) {
+  memset(r, 0, (an + bn) * sizeof(uint64_t));
+
+  for (size_t i = 0; i < bn; i++) {
+    uint64_t carry = 0;
+    for (size_t j = 0; j < an; j++) {
+      unsigned __int128 t = (unsigned __int128)a[j] * b[i] + r[i + j] + carry;
+      r[i + j] = (uint64_t)t;
+      carry = t >> 64;
+    }
+    r[i + an] = carry;
+  }
+}
+
+//With a and b split at h limbs, a * b = z2 B^2h + z1 B^h + z0, where
+//z1 = (a0 + a1)(b0 + b1) - z0 - z2 costs one multiplication instead of
+//two. Needs bn <= an < 2 bn, so that b has a high half.
+void multiply_karatsuba(uint64_t *r, const uint64_t *a, size_t an,
+                        const uint64_t *b, size_t bn) {
+  size_t h = (an + 1) / 2;
+  size_t a1n = an - h, b1n = bn - h;
+
+  memset(r, 0, (an + bn) * sizeof(uint64_t));
+  limbs_multiply(r, a, h, b, h);
+  limbs_multiply(r + 2 * h, a + h, a1n, b + h, b1n);
+
+  uint64_t *sums = malloc((4 * h + 4) * sizeof(uint64_t));
+  if (!sums)
+    raise_error(ERROR_SYS, "memory allocation failure");
+  uint64_t *sa = sums, *sb = sums + h + 1, *z1 = sums + 2 * h + 2;
+
+  memcpy(sa, a, h * sizeof(uint64_t));
+  sa[h] = limbs_add_to(sa, h, a + h, a1n);
+  memcpy(sb, b, h * sizeof(uint64_t));
+  sb[h] = limbs_add_to(sb, h, b + h, b1n);
+
+  limbs_multiply(z1, sa, h + 1, sb, h + 1);
+  limbs_subtract_from(z1, 2 * h + 2, r, 2 * h);
+  limbs_subtract_from(z1, 2 * h + 2, r + 2 * h, a1n + b1n);
+  limbs_add_to(r + h, an + bn - h, z1, strip(z1, 2 * h + 2));
+
+  free(sums);
+}
+
+//Toom-Cook 3-way: a and b are split in three and seen as polynomials in
+//B^k, whose product is found from its values at 0, 1, -1, -2 and
+//infinity with five multiplications of a third the size. The values at
+//-1 and -2 can be negative, so this part works on signed bigints and
+//interpolates with Bodrato's sequence of exact divisions.
+void multiply_toom3(uint64_t *r, const uint64_t *a, size_t an,
+                    const uint64_t *b, size_t bn) {
+  size_t k = (an + 2) / 3;
+  bigint a_part[3], b_part[3];
+  for (int i = 0; i < 3; i++) {
+    size_t start = i * k;
+    size_t a_end = (start + k < an) ? start + k : an;
+    size_t b_end = (start + k < bn) ? start + k : bn;
+    a_part[i] = borrow_limbs(a + start, (start < an) ? a_end - start : 0);
+    b_part[i] = borrow_limbs(b + start, (start < bn) ? b_end - start : 0);
+  }
+
+  //values at 1, -1 and -2 of each operand, and the five products
+  bigint at_a[3], at_b[3], prod[5], t;
+  for (int i = 0; i < 3; i++) {
+    big_init(&at_a[i]);
+    big_init(&at_b[i]);
+  }
+  for (int i = 0; i < 5; i++)
+    big_init(&prod[i]);
+  big_init(&t);
+
+  bigint *part[2] = { a_part, b_part }, *at[2] = { at_a, at_b };
+  for (int n = 0; n < 2; n++) {
+    big_add(&t, &part[n][0], &part[n][2]); //p = x0 + x2
+    big_add(&at[n][0], &t, &part[n][1]); //x(1) = p + x1
+    big_subtract(&at[n][1], &t, &part[n][1]); //x(-1) = p - x1
+    big_add(&t, &at[n][1], &part[n][2]);
+    big_shift_left(&t, &t, 1);
+    big_subtract(&at[n][2], &t, &part[n][0]); //x(-2) = 2(x(-1) + x2) - x0
+  }
+
+  big_multiply(&prod[0], &a_part[0], &b_part[0]); //r(0)
+  big_multiply(&prod[1], &at_a[0], &at_b[0]); //r(1)
+  big_multiply(&prod[2], &at_a[1], &at_b[1]); //r(-1)
+  big_multiply(&prod[3], &at_a[2], &at_b[2]); //r(-2)
+  big_multiply(&prod[4], &a_part[2], &b_part[2]); //r(inf)
+
+  //prod[1..3] become the coefficients of B^k, B^2k and B^3k
+  bigint r1, r2, r3;
+  big_init(&r1);
+  big_init(&r2);
+  big_init(&r3);
+  big_subtract(&r3, &prod[3], &prod[1]);
+  divide_small(&r3, &r3, 3); //r3 = (r(-2) - r(1)) / 3
+  big_subtract(&r1, &prod[1], &prod[2]);
+  big_shift_right(&r1, &r1, 1); //r1 = (r(1) - r(-1)) / 2
+  big_subtract(&r2, &prod[2], &prod[0]); //r2 = r(-1) - r(0)
+  big_subtract(&r3, &r2, &r3);
+  big_shift_right(&r3, &r3, 1);
+  big_shift_left(&t, &prod[4], 1);
+  big_add(&r3, &r3, &t); //r3 = (r2 - r3) / 2 + 2 r(inf)
+  big_add(&r2, &r2, &r1);
+  big_subtract(&r2, &r2, &prod[4]); //r2 = r2 + r1 - r(inf)
+  big_subtract(&r1, &r1, &r3); //r1 = r1 - r3
+
+  memset(r, 0, (an + bn) * sizeof(uint64_t));
+  bigint *coeff[5] = { &prod[0], &r1, &r2, &r3, &prod[4] };
+  for (int i = 0; i < 5; i++)
+    if (coeff[i]->length)
+      limbs_add_to(r + i * k, an + bn - i * k, coeff[i]->limbs,
+                   coeff[i]->length);
+
+  for (int i = 0; i < 3; i++) {
+    big_free(&at_a[i]);
+    big_free(&at_b[i]);
+  }
+  for (int i = 0; i < 5; i++)
+    big_free(&prod[i]);
+  big_free(&r1);
+  big_free(&r2);
+  big_free(&r3);
+  big_free(&t);
+}
+
+//Each limb is cut into 16-bit pieces, which makes every coefficient of
+//the product less than n * 2^32 and so exact modulo the 64-bit prime for
+//any transform length n up to 2^31. The product is a convolution of the
+//pieces, done as a pointwise product between two transforms.
+void multiply_ntt(uint64_t *r, const uint64_t *a, size_t an,
+                  const uint64_t *b, size_t bn) {
+  int per_limb = LIMB_BITS / NTT_PIECE_BITS;
+  uint64_t mask = (1UL << NTT_PIECE_BITS) - 1;
+  size_t n = 1;
+  while (n < per_limb * (an + bn))
+    n <<= 1;
+  if (n > 1UL << 31)
+    raise_error(ERROR_EXPR, "integer is too large to multiply");
+
+  bool square = a == b && an == bn;
+  uint64_t *fa = calloc(n, sizeof(uint64_t));
+  uint64_t *fb = square ? fa : calloc(n, sizeof(uint64_t));
+  if (!fa || !fb)
+    raise_error(ERROR_SYS, "memory allocation failure");
+
+  for (size_t i = 0; i < an * per_limb; i++)
+    fa[i] = a[i / per_limb] >> (i % per_limb * NTT_PIECE_BITS) & mask;
+  ntt_transform(fa, n, false);
+  if (!square) {
+    for (size_t i = 0; i < bn * per_limb; i++)
+      fb[i] = b[i / per_limb] >> (i % per_limb * NTT_PIECE_BITS) & mask;
+    ntt_transform(fb, n, false);
+  }
+
+  for (size_t i = 0; i < n; i++)
+    fa[i] = ntt_multiply(fa[i], fb[i]);
+  ntt_transform(fa, n, true);
+
+  unsigned __int128 carry = 0;
+  for (size_t i = 0; i < an + bn; i++) {
+    for (int j = 0; j < per_limb; j++)
+      carry += (unsigned __int128)fa[i * per_limb + j]
+        << (j * NTT_PIECE_BITS);
+    r[i] = (uint64_t)carry;
+    carry >>= 64;
+  }
+
+  if (!square)
+    free(fb);
+  free(fa);
+}
+
+//Knuth's algorithm D, for bn >= 2: q gets an - bn + 1 limbs and rem gets
+//bn. Each quotient limb is estimated from the top two limbs of the
+//remainder and the top limb of b, after shifting both so that the top
+//bit of b is set, which makes the estimate at most two too large.
+void divide_schoolbook(uint64_t *q, uint64_t *rem, const uint64_t *a,
+                       size_t an, const uint64_t *b, size_t bn) {
+  int shift = __builtin_clzl(b[bn - 1]);
+  uint64_t *u = malloc((an + 1 + bn) * sizeof(uint64_t));
+  if (!u)
+    raise_error(ERROR_SYS, "memory allocation failure");
+  uint64_t *v = u + an + 1;
+
+  for (size_t i = bn; i-- > 0; )
+    v[i] = b[i] << shift | ((shift && i) ? b[i - 1] >> (LIMB_BITS - shift)
+                            : 0);
+  u[an] = shift ? a[an - 1] >> (LIMB_BITS - shift) : 0;
+  for (size_t i = an; i-- > 0; )
+    u[i] = a[i] << shift | ((shift && i) ? a[i - 1] >> (LIMB_BITS - shift)
+                            : 0);
+
+  for (size_t j = an - bn + 1; j-- > 0; ) {
+    unsigned __int128 top = (unsigned __int128)u[j + bn] << 64
+      | u[j + bn - 1];
+    unsigned __int128 qhat = top / v[bn - 1];
+    unsigned __int128 rhat = top % v[bn - 1];
+    while (qhat >> 64
+           || qhat * v[bn - 2] > (rhat << 64 | u[j + bn - 2])) {
+      qhat--;
+      rhat += v[bn - 1];
+      if (rhat >> 64)
+        break;
+    }
+
+    //u -= qhat * v, shifted j limbs
+    uint64_t carry = 0, borrow = 0;
+    for (size_t i = 0; i < bn; i++) {
+      unsigned __int128 product = qhat * v[i] + carry;
+      carry = product >> 64;
+      unsigned __int128 diff = (unsigned __int128)u[i + j]
+        - (uint64_t)product - borrow;
+      u[i + j] = (uint64_t)diff;
+      borrow = (diff >> 64) != 0;
+    }
+    unsigned __int128 diff = (unsigned __int128)u[j + bn] - carry - borrow;
+    u[j + bn] = (uint64_t)diff;
+
+    //the estimate was one too large: add v back
+    if (diff >> 64) {
+      qhat--;
+      u[j + bn] += limbs_add_to(u + j, bn, v, bn);
+    }
+    if (q)
+      q[j] = (uint64_t)qhat;
+  }
+
+  if (rem)
+    for (size_t i = 0; i < bn; i++)
+      rem[i] = u[i] >> shift | (shift ? u[i + 1] << (LIMB_BITS - shift) : 0);
+  free(u);
+}
+
+//r = |a| + |b|
+void add_magnitudes(bigint *r, const bigint *a, const bigint *b) {
+  if (a->length < b->length) {
+    const bigint *swap = a;
+    a = b;
+    b = swap;
+  }
+
+  bigint t;
+  big_init(&t);
+  reserve(&t, a->length + 1);
+  copy_limbs(t.limbs, a->limbs, a->length);
+  t.limbs[a->length] = limbs_add_to(t.limbs, a->length, b->limbs,
+                                    b->length);
+  t.length = a->length + 1;
+  normalize(&t);
+  replace(r, &t);
+}
+
+//r = |a| - |b|, for |a| >= |b|
+void subtract_magnitudes(bigint *r, const bigint *a, const bigint *b) {
+  bigint t;
+  big_init(&t);
+  reserve(&t, a->length);
+  copy_limbs(t.limbs, a->limbs, a->length);
+  limbs_subtract_from(t.limbs, a->length, b->limbs, b->length);
+  t.length = a->length;
+  normalize(&t);
+  replace(r, &t);
+}
+
+void add_signed(bigint *r, const bigint *a, const bigint *b, bool negate_b) {
+  bool a_negative = a->negative;
+  bool b_negative = b->negative != negate_b;
+
+  if (a_negative == b_negative) {
+    add_magnitudes(r, a, b);
+    r->negative = r->length && a_negative;
+  } else if (limbs_compare(a->limbs, a->length, b->limbs, b->length) >= 0) {
+    subtract_magnitudes(r, a, b);
+    r->negative = r->length && a_negative;
+  } else {
+    subtract_magnitudes(r, b, a);
+    r->negative = r->length && b_negative;
+  }
+}
+
+//for a divisor that divides a exactly, or when truncation is wanted
+void divide_small(bigint *r, const bigint *a, uint64_t divisor) {
+  bigint t;
+  big_init(&t);
+  reserve(&t, a->length);
+  limbs_divide_small(t.limbs, a->limbs, a->length, divisor);
+  t.length = a->length;
+  t.negative = a->negative;
+  normalize(&t);
+  replace(r, &t);
+}
+
+void divide_plain(bigint *q, bigint *rem, const bigint *a,
+                  const bigint *b) {
+  if (limbs_compare(a->limbs, a->length, b->limbs, b->length) < 0) {
+    big_copy(rem, a);
+    big_set_wide(q, 0);
+  } else if (b->length == 1) {
+    reserve(q, a->length);
+    uint64_t r = limbs_divide_small(q->limbs, a->limbs, a->length,
+                                    b->limbs[0]);
+    q->length = a->length;
+    normalize(q);
+    big_set_wide(rem, r);
+  } else {
+    size_t qn = a->length - b->length + 1;
+    reserve(q, qn);
+    reserve(rem, b->length);
+    divide_schoolbook(q->limbs, rem->limbs, a->limbs, a->length, b->limbs,
+                      b->length);
+    q->length = qn;
+    rem->length = b->length;
+    normalize(q);
+    normalize(rem);
+  }
+}
+
+//Schoolbook division costs the size of b times the size of the quotient,
+//so once both are large the quotient is instead taken from a reciprocal
+//of b found by Newton's method, which costs a few multiplications.
+void divide_magnitudes(bigint *q, bigint *rem, const bigint *a,
+                       const bigint *b) {
+  size_t qn = (a->length >= b->length) ? a->length - b->length + 1 : 0;
+  if (b->length < newton_threshold || qn < newton_threshold) {
+    divide_plain(q, rem, a, b);
+    return;
+  }
+
+  //q = a * 2^k / b / 2^k is off by a few units at most, which the
+  //remainder then corrects
+  size_t k = big_bits(a);
+  bigint x, t;
+  big_init(&x);
+  big_init(&t);
+  reciprocal(&x, b, k);
+  big_multiply(&t, a, &x);
+  big_shift_right(q, &t, k);
+  big_multiply(&t, q, b);
+  big_subtract(rem, a, &t);
+
+  bigint one = borrow_limbs((uint64_t[]){ 1 }, 1);
+  while (rem->negative) {
+    big_subtract(q, q, &one);
+    big_add(rem, rem, b);
+  }
+  while (big_compare(rem, b) >= 0) {
+    big_add(q, q, &one);
+    big_subtract(rem, rem, b);
+  }
+
+  big_free(&x);
+  big_free(&t);
+}
+
+//Close to 2^k / d, for d of n bits and k >= n. A reciprocal good to h
+//bits only depends on the top h bits or so of d, so d is cut down to
+//those first. Then one Newton step, x + x (2^k - d x) / 2^k, doubles the
+//number of correct bits in a reciprocal found to half the precision.
+void reciprocal(bigint *x, const bigint *d, size_t k) {
+  size_t n = big_bits(d);
+  size_t h = k - n;
+  size_t guard = 2 * LIMB_BITS;
+
+  if (n > h + guard + LIMB_BITS) {
+    bigint top;
+    size_t cut = n - (h + guard);
+    big_init(&top);
+    big_shift_right(&top, d, cut);
+    reciprocal(x, &top, k - cut);
+    big_free(&top);
+    return;
+  }
+
+  bigint t, e;
+  big_init(&t);
+  big_init(&e);
+
+  if (h <= newton_threshold * LIMB_BITS) {
+    power_of_two(&t, k);
+    divide_plain(x, &e, &t, d);
+  } else {
+    size_t half = h / 2 + LIMB_BITS;
+    reciprocal(&t, d, n + half);
+    big_shift_left(x, &t, h - half);
+
+    power_of_two(&e, k);
+    big_multiply(&t, d, x);
+    big_subtract(&e, &e, &t);
+    big_multiply(&t, x, &e);
+    big_shift_right(&t, &t, k);
+    big_add(x, x, &t);
+  }
+
+  big_free(&t);
+  big_free(&e);
+}
+
+void power_of_two(bigint *r, size_t exponent) {
+  bigint one = borrow_limbs((uint64_t[]){ 1 }, 1);
+  big_shift_left(r, &one, exponent);
+}
+
+//x mod p for x < 2^128, using 2^64 = 2^32 - 1 and 2^96 = -1 (mod p)
+uint64_t ntt_reduce(unsigned __int128 x) {
+  uint64_t low = (uint64_t)x, high = x >> 64;
+  uint64_t high_high = high >> 32, high_low = high & 0xffffffff;
+  uint64_t t0, t2;
+
+  if (__builtin_sub_overflow(low, high_high, &t0))
+    t0 -= 0xffffffff;
+  uint64_t t1 = high_low * 0xffffffff;
+  if (__builtin_add_overflow(t0, t1, &t2))
+    t2 += 0xffffffff;
+  return (t2 >= NTT_PRIME) ? t2 - NTT_PRIME : t2;
+}
+
+uint64_t ntt_multiply(uint64_t a, uint64_t b) {
+  return ntt_reduce((unsigned __int128)a * b);
+}
+
+uint64_t ntt_power(uint64_t base, uint64_t exp) {
+  uint64_t result = 1;
+  while (exp) {
+    if (exp & 1)
+      result = ntt_multiply(result, base);
+    base = ntt_multiply(base, base);
+    exp >>= 1;
+  }
+  return result;
+}
+
+//an iterative radix-2 transform over the integers modulo NTT_PRIME
+void ntt_transform(uint64_t *a, size_t n, bool inverse) {
+  for (size_t i = 1, j = 0; i < n; i++) {
+    size_t bit = n >> 1;
+    for (; j & bit; bit >>= 1)
+      j ^= bit;
+    j ^= bit;
+    if (i < j) {
+      uint64_t swap = a[i];
+      a[i] = a[j];
+      a[j] = swap;
+    }
+  }
+
+  uint64_t *twiddle = malloc((n / 2 + 1) * sizeof(uint64_t));
+  if (!twiddle)
+    raise_error(ERROR_SYS, "memory allocation failure");
+
+  for (size_t length = 2; length <= n; length <<= 1) {
+    uint64_t root = ntt_power(NTT_GENERATOR, (NTT_PRIME - 1) / length);
+    if (inverse)
+      root = ntt_power(root, NTT_PRIME - 2);
+
+    size_t half = length / 2;
+    twiddle[0] = 1;
+    for (size_t i = 1; i < half; i++)
+      twiddle[i] = ntt_multiply(twiddle[i - 1], root);
+
+    for (size_t start = 0; start < n; start += length) {
+      uint64_t *low = a + start, *high = a + start + half;
+      for (size_t i = 0; i < half; i++) {
+        uint64_t u = low[i], v = ntt_multiply(high[i], twiddle[i]);
+        uint64_t sum = u + v;
+        if (sum < u || sum >= NTT_PRIME)
+          sum -= NTT_PRIME;
+        low[i] = sum;
+        high[i] = (u >= v) ? u - v : u - v + NTT_PRIME;
+      }
+    }
+  }
+  free(twiddle);
+
+  if (inverse) {
+    uint64_t scale = ntt_power(n % NTT_PRIME, NTT_PRIME - 2);
+    for (size_t i = 0; i < n; i++)
+      a[i] = ntt_multiply(a[i], scale);
+  }
+}
+
+void to_twos_complement(uint64_t *t, const bigint *x, size_t length) {
+  memset(t, 0, length * sizeof(uint64_t));
+  copy_limbs(t, x->limbs, x->length);
+
+  if (x->negative) { //~(|x| - 1)
+    limbs_subtract_from(t, length, (uint64_t[]){ 1 }, 1);
+    for (size_t i = 0; i < length; i++)
+      t[i] = ~t[i];
+  }
+}
+
+//the last width digits of x, from repeated division by a chunk of digits
+void digits_schoolbook(const bigint *x, int radix, int chunk_digits,
+                       uint64_t chunk, int *digits, size_t width) {
+  uint64_t *rest = malloc((x->length + 1) * sizeof(uint64_t));
+  if (!rest)
+    raise_error(ERROR_SYS, "memory allocation failure");
+  copy_limbs(rest, x->limbs, x->length);
+  size_t length = x->length;
+
+  size_t place = width;
+  while (place > 0) {
+    uint64_t part = length ? limbs_divide_small(rest, rest, length, chunk)
+      : 0;
+    length = strip(rest, length);
+    for (int i = 0; i < chunk_digits && place > 0; i++) {
+      digits[--place] = part % radix;
+      part /= radix;
+    }
+  }
+  free(rest);
+}
+
+//x < powers[level], written as exactly chunk_digits * 2^level digits
+void digits_recursive(const bigint *x, int radix, int chunk_digits,
+                      uint64_t chunk, bigint powers[], int level,
+                      int *digits) {
+  size_t width = (size_t)chunk_digits << level;
+
+  if (level == 0 || x->length <= radix_threshold) {
+    digits_schoolbook(x, radix, chunk_digits, chunk, digits, width);
+    return;
+  }
+
+  bigint high, low;
+  big_init(&high);
+  big_init(&low);
+  divide_magnitudes(&high, &low, x, &powers[level - 1]);
+  digits_recursive(&high, radix, chunk_digits, chunk, powers, level - 1,
+                   digits);
+  digits_recursive(&low, radix, chunk_digits, chunk, powers, level - 1,
+                   digits + width / 2);
+  big_free(&high);
+  big_free(&low);
+}
@@ -0,0 +1,75 @@
+/* ccalc -- evaluate C-style expressions from the command line.
+   Copyright (C) 2015-2017 Gregory Kikola.
+
+   This file is part of ccalc.
+
+   ccalc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   ccalc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with ccalc.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Written by Gregory Kikola <gkikola@gmail.com>. */
+
+#ifndef CCALC_BIGINT_H
+#define CCALC_BIGINT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+//An integer of any size, as a sign and a magnitude in 64-bit limbs, least
+//significant first. There are never leading zero limbs, so zero has no
+//limbs at all. A bigint whose capacity is 0 only borrows its limbs, from
+//a value or from part of another bigint, and is never freed or resized.
+typedef struct bigint {
+  uint64_t *limbs;
+  size_t length;
+  size_t capacity;
+  bool negative;
+} bigint;
+
+//Operand sizes, in limbs, at which multiplication moves from schoolbook
+//to Karatsuba, Toom-3 and then a number-theoretic transform, and at
+//which division moves from schoolbook to Newton's method. They are
+//variables so that the tests can force each algorithm and check it
+//against the others.
+extern size_t karatsuba_threshold;
+extern size_t toom3_threshold;
+extern size_t ntt_threshold;
+extern size_t newton_threshold;
+extern size_t radix_threshold;
+
+void big_init(bigint *x);
+void big_free(bigint *x);
+void big_copy(bigint *r, const bigint *x);
+void big_set_wide(bigint *x, __int128 wvalue);
+bool big_fits_wide(const bigint *x);
+__int128 big_get_wide(const bigint *x);
+double big_get_double(const bigint *x);
+size_t big_bits(const bigint *x);
+int big_compare(const bigint *a, const bigint *b);
+
+void big_add(bigint *r, const bigint *a, const bigint *b);
+void big_subtract(bigint *r, const bigint *a, const bigint *b);
+void big_multiply(bigint *r, const bigint *a, const bigint *b);
+void big_divide(bigint *q, bigint *rem, const bigint *a, const bigint *b);
+void big_negate(bigint *r, const bigint *a);
+void big_power(bigint *r, const bigint *base, unsigned long exp);
+void big_sqrt(bigint *r, const bigint *a);
+void big_shift_left(bigint *r, const bigint *a, size_t count);
+void big_shift_right(bigint *r, const bigint *a, size_t count);
+void big_bitwise(bigint *r, const bigint *a, const bigint *b, char op);
+void big_product_range(bigint *r, unsigned long from, unsigned long to);
+
+int *big_to_digits(const bigint *x, int radix, size_t *num_digits);
+
+#endif
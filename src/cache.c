@@ -0,0 +1,187 @@
+/* ccalc -- evaluate C-style expressions from the command line.
+   Copyright (C) 2015-2017 Gregory Kikola.
+
+   This file is part of ccalc.
+
+   ccalc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   ccalc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with ccalc.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Written by Gregory Kikola <gkikola@gmail.com>. */
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cache.h"
+#include "error.h"
+#include "plan.h"
+
+size_t cache_length(uint32_t capacity);
+
+cache_file *open_cache(char *path, int capacity) {
+  cache_file *cache = malloc(sizeof(cache_file));
+  if (!cache)
+    raise_error(ERROR_SYS, "memory allocation failure");
+
+  int fd = open(path, O_RDWR | O_CREAT, 0666);
+  if (fd < 0)
+    raise_error(ERROR_SYS, "cannot open cache file '%s'", path);
+
+  //only one process gets to lay out a new file
+  flock(fd, LOCK_EX);
+
+  struct stat st;
+  cache_header header;
+  bool created = false;
+  if (fstat(fd, &st) < 0)
+    raise_error(ERROR_SYS, "cannot open cache file '%s'", path);
+
+  if (st.st_size == 0) {
+    header.capacity = 1;
+    while (header.capacity < (uint32_t)capacity)
+      header.capacity *= 2;
+
+    if (ftruncate(fd, cache_length(header.capacity)) < 0)
+      raise_error(ERROR_SYS, "cannot create cache file '%s'", path);
+    created = true;
+  } else if (pread(fd, &header, sizeof(header), 0) != sizeof(header)
+             || header.magic != CACHE_MAGIC
+             || header.version != CACHE_VERSION
+             || header.slot_size != sizeof(cache_slot)
+             || (size_t)st.st_size != cache_length(header.capacity)) {
+    raise_error(ERROR_SYS, "'%s' is not a ccalc cache file", path);
+  }
+
+  cache->length = cache_length(header.capacity);
+  cache->header = mmap(NULL, cache->length, PROT_READ | PROT_WRITE,
+                       MAP_SHARED, fd, 0);
+  if (cache->header == MAP_FAILED)
+    raise_error(ERROR_SYS, "cannot map cache file '%s'", path);
+
+  //the new file is all zeros, which is an empty table
+  if (created) {
+    cache->header->magic = CACHE_MAGIC;
+    cache->header->version = CACHE_VERSION;
+    cache->header->slot_size = sizeof(cache_slot);
+    cache->header->capacity = header.capacity;
+  }
+
+  flock(fd, LOCK_UN);
+  close(fd);
+
+  cache->path = path;
+  return cache;
+}
+
+void close_cache(cache_file *cache) {
+  if (!cache)
+    return;
+
+  munmap(cache->header, cache->length);
+  free(cache);
+}
+
+size_t cache_length(uint32_t capacity) {
+  return sizeof(cache_header) + (size_t)capacity * sizeof(cache_slot);
+}
+
+bool cache_lookup(cache_file *cache, char *key, value *result) {
+  cache_header *header = cache->header;
+  unsigned long hash = hash_key(key);
+
+  for (int i = 0; i < MEMO_PROBES; i++) {
+    cache_slot *slot = &header->slot[(hash + i) & (header->capacity - 1)];
+    uint64_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+    if (seq == 0) //nothing is stored past an empty slot
+      break;
+    if ((seq & 1) || slot->hash != hash) //being written, or someone else
+      continue;
+
+    value found = slot->result;
+    bool same = !strncmp(slot->key, key, MEMO_KEY_SIZE);
+
+    //a writer may have started on the slot while we were reading it
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&slot->seq, memory_order_relaxed) != seq)
+      continue;
+
+    //a WIDE value points into the process that stored it, so only plain
+    //numbers are shared
+    if (same && (found.type == INT || found.type == FLOAT)) {
+      *result = found;
+      atomic_fetch_add_explicit(&header->hits, 1, memory_order_relaxed);
+      return true;
+    }
+  }
+
+  atomic_fetch_add_explicit(&header->misses, 1, memory_order_relaxed);
+  return false;
+}
+
+void cache_store(cache_file *cache, char *key, value *result) {
+  if (result->type != INT && result->type != FLOAT)
+    return;
+
+  cache_header *header = cache->header;
+  unsigned long hash = hash_key(key);
+
+  cache_slot *slot = NULL;
+  for (int i = 0; i < MEMO_PROBES && !slot; i++) {
+    cache_slot *probe = &header->slot[(hash + i) & (header->capacity - 1)];
+    if (atomic_load_explicit(&probe->seq, memory_order_relaxed) == 0)
+      slot = probe;
+  }
+  if (!slot) //no room nearby, so give up the home slot
+    slot = &header->slot[hash & (header->capacity - 1)];
+
+  //claim the slot, unless another process is already writing it
+  uint64_t seq = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+  if ((seq & 1)
+      || !atomic_compare_exchange_strong_explicit(&slot->seq, &seq, seq + 1,
+                                                  memory_order_acquire,
+                                                  memory_order_relaxed))
+    return;
+  atomic_thread_fence(memory_order_release); //odd before any of the data
+
+  if (seq == 0)
+    atomic_fetch_add_explicit(&header->size, 1, memory_order_relaxed);
+
+  slot->hash = hash;
+  slot->result = *result;
+  strcpy(slot->key, key); //memo_key() keeps keys short enough
+
+  //publish it
+  atomic_store_explicit(&slot->seq, seq + 2, memory_order_release);
+}
+
+void print_cache_stats(FILE *stream, cache_file *cache) {
+  cache_header *header = cache->header;
+  uint64_t hits = atomic_load(&header->hits);
+  uint64_t misses = atomic_load(&header->misses);
+  uint64_t lookups = hits + misses;
+
+  fprintf(stream, "cache file: %s\n", cache->path);
+  fprintf(stream, "entries: %lu of %u (%zu bytes)\n",
+          (unsigned long)atomic_load(&header->size), header->capacity,
+          cache->length);
+  fprintf(stream, "lookups: %lu hits, %lu misses (%.1f%% hit ratio)\n",
+          (unsigned long)hits, (unsigned long)misses,
+          lookups ? 100.0 * hits / lookups : 0.0);
+}
@@ -0,0 +1,78 @@
+/* ccalc -- evaluate C-style expressions from the command line.
+   Copyright (C) 2015-2017 Gregory Kikola.
+
+   This file is part of ccalc.
+
+   ccalc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   ccalc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with ccalc.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Written by Gregory Kikola <gkikola@gmail.com>. */
+
+#ifndef CCALC_CACHE_H
+#define CCALC_CACHE_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "memo.h"
+#include "value.h"
+
+//A cache file holds results of pure expressions for every ccalc process
+//that opens it. It is an open-addressing table like the memo, mapped
+//into each process. A slot's sequence number is odd while a process is
+//writing it; readers copy the slot and check that the number did not
+//change meanwhile, so nobody ever waits and a torn slot only costs a
+//miss.
+
+#define CACHE_MAGIC 0x63636163
+#define CACHE_VERSION 3
+#define DEFAULT_CACHE_SIZE 16384
+
+typedef struct {
+  _Atomic uint64_t seq; //zero while the slot has never been written
+  unsigned long hash;
+  value result;
+  char key[MEMO_KEY_SIZE];
+} cache_slot;
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t slot_size;
+  uint32_t capacity;
+
+  _Atomic uint64_t size;
+  _Atomic uint64_t hits;
+  _Atomic uint64_t misses;
+
+  cache_slot slot[] __attribute__((aligned(64)));
+} cache_header;
+
+typedef struct {
+  cache_header *header;
+  size_t length;
+  char *path;
+} cache_file;
+
+cache_file *open_cache(char *path, int capacity);
+void close_cache(cache_file *cache);
+
+bool cache_lookup(cache_file *cache, char *key, value *result);
+void cache_store(cache_file *cache, char *key, value *result);
+
+void print_cache_stats(FILE *stream, cache_file *cache);
+
+#endif
@@ -0,0 +1,403 @@
+/* ccalc -- evaluate C-style expressions from the command line.
+   Copyright (C) 2015-2017 Gregory Kikola.
+
+   This file is part of ccalc.
+
+   ccalc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   ccalc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with ccalc.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Written by Gregory Kikola <gkikola@gmail.com>. */
+
+#include <errno.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "batch.h"
+#include "columns.h"
+#include "compile.h"
+#include "error.h"
+#include "evaluate.h"
+#include "explain.h"
+#include "output.h"
+#include "profile.h"
+#include "stats.h"
+
+#define READ_SIZE 65536
+#define BLOCK_ARENA_SIZE 4096
+
+typedef struct {
+  options *opts;
+  char *expression;
+  expr_node *tree;
+  block_program *prog;
+  long line_num;
+
+  //rows are gathered into blocks and evaluated together; every row in a
+  //block has the same number of fields
+  value_block *columns;
+  int num_columns;
+  int block_fields;
+  int block_rows;
+  int block_limit;
+  long block_bytes; //for --stats
+  arena block_arena; //WIDE results, until the block is printed
+} column_state;
+
+void process_row(column_state *state, char *line, char *end);
+void flush_block(column_state *state);
+void compile_for_row(column_state *state, char *line, char *end);
+char *next_field(char *pos, char *end, char separator, char **field_start,
+                 char **field_end);
+bool parse_field(char *start, char *end, value *val);
+bool parse_integer(char *start, char *end, int base, bool negative,
+                   value *val);
+
+void run_columns(char *expression, options *opts) {
+  column_state state;
+  state.opts = opts;
+  state.expression = expression;
+  state.tree = NULL;
+  state.prog = NULL;
+  state.line_num = 0;
+  state.columns = NULL;
+  state.num_columns = 0;
+  state.block_fields = 0;
+  state.block_rows = 0;
+  state.block_limit = BLOCK_ROWS;
+  state.block_bytes = 0;
+  arena_init(&state.block_arena, BLOCK_ARENA_SIZE);
+  arena *prev_arena = set_wide_arena(&state.block_arena);
+
+  //read big blocks and parse each complete line where it lies
+  size_t size = READ_SIZE;
+  size_t length = 0;
+  char *buffer = malloc(size + 1);
+  bool at_eof = false;
+
+  if (!buffer)
+    raise_error(ERROR_SYS, "memory allocation failure");
+
+  while (!at_eof) {
+    if (length == size) { //a single line fills the whole buffer
+      size *= 2;
+      buffer = realloc(buffer, size + 1);
+      if (!buffer)
+        raise_error(ERROR_SYS, "memory allocation failure");
+    }
+
+    phase previous = profile_switch(PHASE_IO);
+    errno = 0;
+    size_t count = fread(buffer + length, 1, size - length, stdin);
+    bool interrupted = ferror(stdin) && errno == EINTR; //by SIGUSR1
+    if (interrupted)
+      clearerr(stdin);
+    if (interrupted && count == 0) {
+      profile_switch(previous);
+      check_stats();
+      continue;
+    }
+    profile_switch(PHASE_LEX); //splitting rows into fields
+    length += count;
+    if (count == 0) {
+      at_eof = true;
+      if (length > 0 && buffer[length - 1] != '\n')
+        buffer[length++] = '\n';
+    }
+
+    char *pos = buffer;
+    char *end = buffer + length;
+    char *newline;
+    while ((newline = memchr(pos, '\n', end - pos))) {
+      state.line_num++;
+      process_row(&state, pos, newline);
+      pos = newline + 1;
+    }
+
+    length = end - pos;
+    memmove(buffer, pos, length);
+    profile_switch(previous);
+    if (interrupted) //once the rows read so far are counted
+      check_stats();
+  }
+
+  flush_block(&state);
+
+  free_block_program(state.prog);
+  free_node(state.tree);
+  for (int i = 0; i < state.num_columns; i++)
+    block_release(&state.columns[i]);
+  free(state.columns);
+  free(buffer);
+  set_wide_arena(prev_arena);
+  arena_free(&state.block_arena);
+}
+
+void process_row(column_state *state, char *line, char *end) {
+  if (end > line && end[-1] == '\r')
+    end--;
+  if (end == line) //skip blank lines
+    return;
+
+  if (!state->tree) {
+    phase previous = profile_switch(PHASE_PARSE);
+    compile_for_row(state, line, end);
+    state->prog = new_block_program(state->tree);
+    profile_switch(previous);
+    if (!is_pure_tree(state->tree)) //keep rand() calls in row order
+      state->block_limit = 1;
+
+    if (state->line_num == 0) //that was the header
+      return;
+  }
+
+  stats.lines++;
+
+  //store the fields straight into the next lane of each column
+  int lane = state->block_rows;
+  int num_fields = 0;
+  char *pos = line;
+  while (pos <= end) {
+    char *start, *stop;
+    value val;
+    pos = next_field(pos, end, state->opts->column_separator, &start, &stop);
+
+    if (num_fields == state->num_columns) {
+      int old_size = state->num_columns;
+      state->num_columns = old_size ? 2 * old_size : 8;
+      state->columns = realloc(state->columns,
+                               state->num_columns * sizeof(value_block));
+      if (!state->columns)
+        raise_error(ERROR_SYS, "memory allocation failure");
+
+      for (int i = old_size; i < state->num_columns; i++)
+        block_init(&state->columns[i]);
+    }
+
+    if (!parse_field(start, stop, &val)) {
+      flush_block(state); //finish the rows before this one first
+      raise_error(ERROR_EXPR, "row %ld: column %d is not a number",
+                  state->line_num, num_fields + 1);
+    }
+    block_set_lane(&state->columns[num_fields++], lane, &val);
+  }
+
+  if (lane > 0 && num_fields != state->block_fields) {
+    //this row starts a new block
+    flush_block(state);
+    for (int i = 0; i < num_fields; i++) {
+      value val;
+      block_get_lane(&state->columns[i], lane, &val);
+      block_set_lane(&state->columns[i], 0, &val);
+    }
+  }
+
+  state->block_fields = num_fields;
+  state->block_bytes += end - line + 1;
+  if (++state->block_rows == state->block_limit)
+    flush_block(state);
+}
+
+void flush_block(column_state *state) {
+  int count = state->block_rows;
+  if (count == 0)
+    return;
+  state->block_rows = 0;
+  long bytes = state->block_bytes;
+  state->block_bytes = 0;
+  uint64_t start = stats.enabled ? read_clock() : 0;
+
+  jmp_buf trap;
+  jmp_buf *prev_trap = error_trap;
+  value result;
+
+  phase previous = profile_switch(PHASE_EVALUATE);
+  error_trap = &trap;
+  if (!setjmp(trap)) {
+    value_block *results = execute_block(state->prog, state->columns,
+                                         state->block_fields, count,
+                                         state->opts);
+    error_trap = prev_trap;
+
+    profile_switch(PHASE_FORMAT);
+    for (int i = 0; i < count; i++) {
+      block_get_lane(results, i, &result);
+      print_value(stdout, &result, state->opts);
+      putchar('\n');
+    }
+    profile_switch(previous);
+    record_rows(state->expression, bytes, count,
+                stats.enabled ? read_clock() - start : 0);
+    arena_reset(&state->block_arena);
+    return;
+  }
+  error_trap = prev_trap;
+
+  //some row failed, so go through the block one row at a time to print
+  //everything up to that row and report the same error it would have
+  value row[state->block_fields];
+  for (int i = 0; i < count; i++) {
+    for (int j = 0; j < state->block_fields; j++)
+      block_get_lane(&state->columns[j], i, &row[j]);
+
+    execute(state->tree, row, state->block_fields, state->opts, &result);
+    print_value(stdout, &result, state->opts);
+    putchar('\n');
+    arena_reset(&state->block_arena);
+  }
+  profile_switch(previous);
+  record_rows(state->expression, bytes, count,
+              stats.enabled ? read_clock() - start : 0);
+}
+
+void compile_for_row(column_state *state, char *line, char *end) {
+  //the first row is a header unless every field in it is a number
+  int num_fields = 0;
+  bool header = false;
+  char *pos = line;
+  while (pos <= end) {
+    char *start, *stop;
+    value val;
+    pos = next_field(pos, end, state->opts->column_separator, &start, &stop);
+
+    num_fields++;
+    if (!parse_field(start, stop, &val))
+      header = true;
+  }
+
+  if (!header) {
+    state->tree = compile_expression(state->expression, state->opts, NULL, 0);
+    if (state->opts->explain)
+      explain(stdout, state->expression, state->opts, NULL, 0);
+    return;
+  }
+
+  char *names[num_fields];
+  int i = 0;
+  pos = line;
+  while (pos <= end) {
+    char *start, *stop;
+    pos = next_field(pos, end, state->opts->column_separator, &start, &stop);
+
+    while (start < stop && is_whitespace(*start))
+      start++;
+    while (stop > start && is_whitespace(stop[-1]))
+      stop--;
+
+    names[i] = malloc(stop - start + 1);
+    if (!names[i])
+      raise_error(ERROR_SYS, "memory allocation failure");
+    memcpy(names[i], start, stop - start);
+    names[i++][stop - start] = '\0';
+  }
+
+  state->tree = compile_expression(state->expression, state->opts, names,
+                                   num_fields);
+  state->line_num = 0;
+  if (state->opts->explain)
+    explain(stdout, state->expression, state->opts, names, num_fields);
+
+  for (i = 0; i < num_fields; i++)
+    free(names[i]);
+}
+
+char *next_field(char *pos, char *end, char separator, char **field_start,
+                 char **field_end) {
+  char *sep;
+
+  if (*pos == '"') { //quoted field, which may contain the separator
+    *field_start = ++pos;
+    while (pos < end && (*pos != '"' || (pos + 1 < end && pos[1] == '"')))
+      pos += (*pos == '"') ? 2 : 1;
+    *field_end = pos;
+
+    sep = memchr(pos, separator, end - pos);
+  } else {
+    *field_start = pos;
+    sep = memchr(pos, separator, end - pos);
+    *field_end = sep ? sep : end;
+  }
+
+  return sep ? sep + 1 : end + 1;
+}
+
+bool parse_field(char *start, char *end, value *val) {
+  char *stop;
+
+  while (start < end && is_whitespace(*start))
+    start++;
+  while (end > start && is_whitespace(end[-1]))
+    end--;
+
+  //numbers only; this also keeps strtod away from "inf" and "nan"
+  char *digits = (*start == '-' || *start == '+') ? start + 1 : start;
+  if (digits >= end || !((*digits >= '0' && *digits <= '9')
+                         || *digits == '.'))
+    return false;
+
+  //0x starts a hexadecimal and 0b a binary integer, as in expressions, but
+  //other leading zeros are padding in data files and are read as decimal
+  int base = 10;
+  if (end - digits > 1 && digits[0] == '0') {
+    if (digits[1] == 'x' || digits[1] == 'X')
+      base = 16;
+    else if (digits[1] == 'b' || digits[1] == 'B')
+      base = 2;
+  }
+  if (base != 10)
+    return parse_integer(digits + 2, end, base, *start == '-', val);
+
+  errno = 0;
+  long ivalue = strtol(start, &stop, 10);
+  if (stop == end && errno == 0) {
+    value_set_int(val, ivalue);
+    return true;
+  }
+
+  double fvalue = strtod(start, &stop);
+  if (stop == end) {
+    value_set_float(val, fvalue);
+    return true;
+  }
+
+  return false;
+}
+
+bool parse_integer(char *start, char *end, int base, bool negative,
+                   value *val) {
+  long ivalue = 0;
+
+  if (start >= end)
+    return false;
+
+  for (char *pos = start; pos < end; pos++) {
+    int digit = base;
+    if (*pos >= '0' && *pos <= '9')
+      digit = *pos - '0';
+    else if (*pos >= 'a' && *pos <= 'f')
+      digit = 10 + *pos - 'a';
+    else if (*pos >= 'A' && *pos <= 'F')
+      digit = 10 + *pos - 'A';
+
+    if (digit >= base || ivalue > (LONG_MAX - digit) / base)
+      return false;
+    ivalue = ivalue * base + digit;
+  }
+
+  value_set_int(val, negative ? -ivalue : ivalue);
+  return true;
+}
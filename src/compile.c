@@ -0,0 +1,248 @@
+/* ccalc -- evaluate C-style expressions from the command line.
+   Copyright (C) 2015-2017 Gregory Kikola.
+
+   This file is part of ccalc.
+
+   ccalc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   ccalc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with ccalc.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Written by Gregory Kikola <gkikola@gmail.com>. */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "compile.h"
+#include "error.h"
+
+void comma(value *left, value *right, value *result);
+
+expr_node *new_node(node_type type) {
+  expr_node *node = malloc(sizeof(expr_node));
+
+  if (!node)
+    raise_error(ERROR_SYS, "memory allocation failure");
+
+  node->type = type;
+  node->argc = 0;
+  node->index = 0;
+  node->id[0] = '\0';
+  value_set_int(&node->val, 0);
+  return node;
+}
+
+void free_node(expr_node *node) {
+  if (!node)
+    return;
+
+  for (int i = 0; i < node->argc; i++)
+    free_node(node->args[i]);
+  free(node);
+}
+
+bool is_unary_operator(operator_type op) {
+  return op == OP_NEGATE || op == OP_NOT || op == OP_BIT_NOT;
+}
+
+char *operator_symbol(operator_type op) {
+  static char *symbols[] = {
+    ",", "||", "&&", "|", "^", "&", "==", "!=", "<", "<=", ">", ">=", "<<",
+    ">>", "+", "-", "*", "/", "//", "%", "**", "-", "!", "~"
+  };
+  return symbols[op];
+}
+
+//a short name for the node, as the expression would have written it
+void node_label(char *label, int size, expr_node *node, value vars[]) {
+  value *val = &node->val;
+
+  switch (node->type) {
+  case NODE_VARIABLE:
+    if (!vars) {
+      snprintf(label, size, "$%d", node->index + 1);
+      break;
+    }
+    val = &vars[node->index]; //show the value bound to it
+    //fall through
+  case NODE_CONSTANT:
+    if (val->type == INT)
+      snprintf(label, size, "%ld", val->data.ivalue);
+    else if (val->type == WIDE)
+      wide_to_string(value_get_wide(val), label, size);
+    else if (val->type == BIG)
+      big_to_string(val->data.bvalue, label, size);
+    else if (val->type == BIGFLOAT)
+      bigfloat_to_string(val->data.bfvalue, label, size);
+    else
+      snprintf(label, size, "%g", val->data.fvalue);
+    break;
+  case NODE_OPERATOR:
+    if (node->op == OP_NEGATE)
+      snprintf(label, size, "unary -");
+    else
+      snprintf(label, size, "%s", operator_symbol(node->op));
+    break;
+  case NODE_CONDITIONAL:
+    snprintf(label, size, "?:");
+    break;
+  case NODE_FUNCTION:
+    snprintf(label, size, "%s()", node->id);
+    break;
+  }
+}
+
+bool is_pure_function(char *identifier) {
+  //rand() must be called again every time the expression is executed
+  return strcmp(identifier, "rand") != 0;
+}
+
+bool is_pure_tree(expr_node *node) {
+  if (node->type == NODE_FUNCTION && !is_pure_function(node->id))
+    return false;
+
+  for (int i = 0; i < node->argc; i++) {
+    if (!is_pure_tree(node->args[i]))
+      return false;
+  }
+  return true;
+}
+
+void apply_operator(operator_type op, value *left, value *right,
+                    value *result) {
+  switch (op) {
+  case OP_COMMA:
+    comma(left, right, result);
+    break;
+  case OP_OR:
+    or(left, right, result);
+    break;
+  case OP_AND:
+    and(left, right, result);
+    break;
+  case OP_BIT_OR:
+    bit_or(left, right, result);
+    break;
+  case OP_BIT_XOR:
+    bit_xor(left, right, result);
+    break;
+  case OP_BIT_AND:
+    bit_and(left, right, result);
+    break;
+  case OP_EQUAL:
+    equal(left, right, result);
+    break;
+  case OP_NOT_EQUAL:
+    not_equal(left, right, result);
+    break;
+  case OP_LESS_THAN:
+    less_than(left, right, result);
+    break;
+  case OP_LESS_THAN_EQ:
+    less_than_eq(left, right, result);
+    break;
+  case OP_GREATER_THAN:
+    greater_than(left, right, result);
+    break;
+  case OP_GREATER_THAN_EQ:
+    greater_than_eq(left, right, result);
+    break;
+  case OP_BIT_SHIFT_LEFT:
+    bit_shift_left(left, right, result);
+    break;
+  case OP_BIT_SHIFT_RIGHT:
+    bit_shift_right(left, right, result);
+    break;
+  case OP_ADD:
+    add(left, right, result);
+    break;
+  case OP_SUBTRACT:
+    subtract(left, right, result);
+    break;
+  case OP_MULTIPLY:
+    multiply(left, right, result);
+    break;
+  case OP_DIVIDE:
+    divide(left, right, result);
+    break;
+  case OP_INT_DIVIDE:
+    int_divide(left, right, result);
+    break;
+  case OP_MODULO:
+    modulo(left, right, result);
+    break;
+  case OP_POWER:
+    power(left, right, result);
+    break;
+  case OP_NEGATE: //unary operators take their operand on the right
+    negate(right, result);
+    break;
+  case OP_NOT:
+    not(right, result);
+    break;
+  case OP_BIT_NOT:
+    bit_not(right, result);
+    break;
+  }
+}
+
+void comma(value *left, value *right, value *result) {
+  //left side is only evaluated for its errors
+  (void)left;
+  *result = *right;
+}
+
+void execute(expr_node *node, value vars[], int num_vars, options *opts,
+             value *result) {
+  value argv[MAX_ARGUMENTS];
+
+  switch (node->type) {
+  case NODE_CONSTANT:
+    *result = node->val;
+    if (result->type == WIDE) //the tree's copy goes when the tree does
+      value_set_wide(result, *node->val.data.wvalue);
+    break;
+
+  case NODE_VARIABLE:
+    if (node->index >= num_vars)
+      raise_error(ERROR_EXPR, "no value for column $%d", node->index + 1);
+    *result = vars[node->index];
+    break;
+
+  case NODE_OPERATOR:
+    //operands are executed left to right, as the parser would have
+    for (int i = 0; i < node->argc; i++)
+      execute(node->args[i], vars, num_vars, opts, &argv[i]);
+
+    if (is_unary_operator(node->op))
+      apply_operator(node->op, NULL, &argv[0], result);
+    else
+      apply_operator(node->op, &argv[0], &argv[1], result);
+    break;
+
+  case NODE_CONDITIONAL:
+    for (int i = 0; i < 3; i++)
+      execute(node->args[i], vars, num_vars, opts, &argv[i]);
+
+    conditional(&argv[0], &argv[1], &argv[2], result);
+    break;
+
+  case NODE_FUNCTION:
+    for (int i = 0; i < node->argc; i++)
+      execute(node->args[i], vars, num_vars, opts, &argv[i]);
+
+    call_function(node->id, result, node->argc, argv, opts->degrees);
+    break;
+  }
+}
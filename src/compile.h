@@ -0,0 +1,95 @@
+/* ccalc -- evaluate C-style expressions from the command line.
+   Copyright (C) 2015-2017 Gregory Kikola.
+
+   This file is part of ccalc.
+
+   ccalc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   ccalc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with ccalc.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Written by Gregory Kikola <gkikola@gmail.com>. */
+
+#ifndef CCALC_COMPILE_H
+#define CCALC_COMPILE_H
+
+#include "options.h"
+#include "value.h"
+
+#define MAX_IDENTIFIER_LENGTH 32
+#define MAX_ARGUMENTS 8
+
+typedef enum {
+  OP_COMMA,
+  OP_OR,
+  OP_AND,
+  OP_BIT_OR,
+  OP_BIT_XOR,
+  OP_BIT_AND,
+  OP_EQUAL,
+  OP_NOT_EQUAL,
+  OP_LESS_THAN,
+  OP_LESS_THAN_EQ,
+  OP_GREATER_THAN,
+  OP_GREATER_THAN_EQ,
+  OP_BIT_SHIFT_LEFT,
+  OP_BIT_SHIFT_RIGHT,
+  OP_ADD,
+  OP_SUBTRACT,
+  OP_MULTIPLY,
+  OP_DIVIDE,
+  OP_INT_DIVIDE,
+  OP_MODULO,
+  OP_POWER,
+  OP_NEGATE,
+  OP_NOT,
+  OP_BIT_NOT,
+} operator_type;
+
+typedef enum {
+  NODE_CONSTANT,
+  NODE_VARIABLE,
+  NODE_OPERATOR,
+  NODE_CONDITIONAL,
+  NODE_FUNCTION,
+} node_type;
+
+//A compiled expression is a tree of nodes. Subexpressions that do not
+//depend on a variable are folded into constants while parsing, so the
+//tree only holds the work that has to be redone for each set of bindings.
+typedef struct expr_node {
+  node_type type;
+  operator_type op;
+  value val;
+  wide_int wide; //where a WIDE val is kept, for as long as the tree
+  int index;
+  char id[MAX_IDENTIFIER_LENGTH + 1];
+
+  int argc;
+  struct expr_node *args[MAX_ARGUMENTS];
+} expr_node;
+
+expr_node *new_node(node_type type);
+void free_node(expr_node *node);
+
+bool is_unary_operator(operator_type op);
+char *operator_symbol(operator_type op);
+void node_label(char *label, int size, expr_node *node, value vars[]);
+bool is_pure_function(char *identifier);
+bool is_pure_tree(expr_node *node);
+void apply_operator(operator_type op, value *left, value *right,
+                    value *result);
+
+void execute(expr_node *node, value vars[], int num_vars, options *opts,
+             value *result);
+
+#endif
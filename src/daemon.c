@@ -0,0 +1,825 @@
+/* ccalc -- evaluate C-style expressions from the command line.
+   Copyright (C) 2015-2017 Gregory Kikola.
+
+   This file is part of ccalc.
+
+   ccalc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   ccalc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with ccalc.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Written by Gregory Kikola <gkikola@gmail.com>. */
+
+#define _GNU_SOURCE
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/time.h>
+#include <unistd.h>
+
+#ifdef HAVE_DAEMON
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+#include "daemon.h"
+#include "error.h"
+#include "evaluate.h"
+#include "output.h"
+#include "ring.h"
+
+#define MAX_REQUEST_ARGS 64
+#define MAX_REQUEST_LENGTH 65536
+#define MAX_PENDING_INPUT (4 * MAX_REQUEST_LENGTH)
+#define MAX_PENDING_OUTPUT (1 << 20)
+#define MAX_EVENTS 64
+#define READ_SIZE 16384
+#define REQUEST_ARENA_SIZE 1024
+
+typedef struct {
+  int fd;
+  bool closing;
+  bool handed_off; //fd now belongs to a ring thread
+
+  char *in;
+  size_t in_len;
+  size_t in_size;
+
+  char *out;
+  size_t out_len;
+  size_t out_pos;
+  size_t out_size;
+} connection;
+
+typedef struct {
+  int fd;
+  ring_header *ring;
+} ring_service;
+
+volatile sig_atomic_t stop_daemon = 0;
+
+void handle_stop_signal(int signum);
+int open_socket(char *socket_path);
+void accept_connections(int listen_fd, int epoll_fd);
+void close_connection(connection *conn);
+bool read_requests(connection *conn, FILE *stream, char **response);
+bool flush_responses(connection *conn);
+void append_output(connection *conn, char *data, size_t length);
+bool output_backed_up(connection *conn);
+void write_all(int fd, char *data, size_t length);
+bool start_ring(int fd);
+void *serve_ring(void *arg);
+bool client_gone(int fd);
+int run_ring_client(char *socket_path, char *expression, char *prefix);
+
+void serve_request(char *request, FILE *stream) {
+  jmp_buf trap;
+  jmp_buf *prev_trap = error_trap;
+  long mark = ftell(stream);
+
+  //split a copy of the request into words so that read_options can
+  //process any leading options, just like on the command line
+  int length = strnlen(request, MAX_REQUEST_LENGTH + 1);
+  if (length > MAX_REQUEST_LENGTH) {
+    fprintf(stream, "Error: request is too long\n");
+    return;
+  }
+
+  char *args = malloc(length + 1);
+  if (!args) {
+    fprintf(stream, "Error: memory allocation failure\n");
+    return;
+  }
+  char *argv[MAX_REQUEST_ARGS + 1];
+  int offset[MAX_REQUEST_ARGS + 1];
+  int argc = 1;
+  int pos = 0;
+
+  strcpy(args, request);
+  argv[0] = "ccalc";
+  offset[0] = 0;
+  while (argc < MAX_REQUEST_ARGS) {
+    while (pos < length && is_whitespace(args[pos]))
+      pos++;
+    if (pos >= length)
+      break;
+
+    argv[argc] = args + pos;
+    offset[argc++] = pos;
+    while (pos < length && !is_whitespace(args[pos]))
+      pos++;
+    args[pos++] = '\0';
+  }
+  offset[argc] = (pos < length) ? pos : length;
+  argv[argc] = NULL;
+
+  //128-bit integers made by the request live until it is answered
+  arena mem;
+  arena_init(&mem, REQUEST_ARENA_SIZE);
+  arena *prev_arena = set_wide_arena(&mem);
+
+  error_trap = &trap;
+  if (setjmp(trap)) { //discard any partial output and report the error
+    fseek(stream, mark, SEEK_SET);
+    fprintf(stream, "Error: %s\n", error_message);
+    error_trap = prev_trap;
+    set_wide_arena(prev_arena);
+    arena_free(&mem);
+    free(args);
+    return;
+  }
+
+  options opts;
+  int expr_index;
+  read_options(argc, argv, &expr_index, &opts);
+
+  if (opts.show_help || opts.show_usage || opts.show_version
+      || opts.daemon_socket || opts.connect_socket || opts.column_separator
+      || opts.bigint || opts.digits)
+    raise_error(ERROR_SYS, "option is not available in daemon requests");
+  if (opts.precision < 0)
+    raise_error(ERROR_EXPR, "precision cannot be less than 0");
+
+  value result;
+  struct timeval tv_start, tv_end;
+  value_set_int(&result, 0);
+
+  if (opts.show_time)
+    gettimeofday(&tv_start, NULL);
+
+  evaluate(request + offset[expr_index], &result, &opts);
+
+  if (opts.show_time)
+    gettimeofday(&tv_end, NULL);
+
+  print_value(stream, &result, &opts);
+  if (opts.show_time)
+    print_elapsed(stream, &tv_start, &tv_end);
+  fprintf(stream, "\n");
+
+  error_trap = prev_trap;
+  set_wide_arena(prev_arena);
+  arena_free(&mem);
+  free(args);
+}
+
+#ifdef HAVE_DAEMON
+
+void run_daemon(char *socket_path) {
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = handle_stop_signal;
+  sigaction(SIGINT, &action, NULL);
+  sigaction(SIGTERM, &action, NULL);
+  signal(SIGPIPE, SIG_IGN);
+
+  int listen_fd = open_socket(socket_path);
+  int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if (epoll_fd < 0)
+    raise_error(ERROR_SYS, "could not create epoll instance: %s",
+                strerror(errno));
+
+  struct epoll_event event;
+  event.events = EPOLLIN;
+  event.data.ptr = NULL; //the listening socket has no connection
+  if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &event) < 0)
+    raise_error(ERROR_SYS, "could not watch socket: %s", strerror(errno));
+
+  //responses are formatted into one reusable memory stream
+  char *response = NULL;
+  size_t response_size = 0;
+  FILE *stream = open_memstream(&response, &response_size);
+  if (!stream)
+    raise_error(ERROR_SYS, "memory allocation failure");
+
+  struct epoll_event events[MAX_EVENTS];
+  while (!stop_daemon) {
+    int count = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
+
+    if (count < 0) {
+      if (errno == EINTR)
+        continue;
+      raise_error(ERROR_SYS, "epoll_wait failed: %s", strerror(errno));
+    }
+
+    for (int i = 0; i < count; i++) {
+      connection *conn = events[i].data.ptr;
+
+      if (!conn) {
+        accept_connections(listen_fd, epoll_fd);
+        continue;
+      }
+
+      //a client that sends requests without reading the replies is not
+      //read from until they drain
+      bool alive = true;
+      if ((events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+          && !output_backed_up(conn))
+        alive = read_requests(conn, stream, &response);
+      if (alive)
+        alive = flush_responses(conn);
+
+      if (conn->handed_off) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+        close_connection(conn);
+        continue;
+      } else if (!alive) {
+        close_connection(conn);
+        continue;
+      }
+
+      //only ask for writability while responses are waiting
+      event.events = output_backed_up(conn) ? 0 : EPOLLIN;
+      if (conn->out_pos < conn->out_len)
+        event.events |= EPOLLOUT;
+      event.data.ptr = conn;
+      epoll_ctl(epoll_fd, EPOLL_CTL_MOD, conn->fd, &event);
+    }
+  }
+
+  fclose(stream);
+  free(response);
+  close(listen_fd);
+  unlink(socket_path);
+}
+
+void handle_stop_signal(int signum) {
+  (void)signum;
+  stop_daemon = 1;
+}
+
+int open_socket(char *socket_path) {
+  struct sockaddr_un addr;
+
+  if (strlen(socket_path) >= sizeof(addr.sun_path))
+    raise_error(ERROR_SYS, "socket path '%s' is too long", socket_path);
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, socket_path);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0)
+    raise_error(ERROR_SYS, "could not create socket: %s", strerror(errno));
+
+  if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    if (errno != EADDRINUSE)
+      raise_error(ERROR_SYS, "could not bind socket '%s': %s", socket_path,
+                  strerror(errno));
+
+    //replace the socket only if nobody is listening on it anymore
+    int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (probe >= 0 && connect(probe, (struct sockaddr *)&addr,
+                              sizeof(addr)) == 0)
+      raise_error(ERROR_SYS, "socket '%s' is already in use", socket_path);
+    if (probe >= 0)
+      close(probe);
+
+    unlink(socket_path);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+      raise_error(ERROR_SYS, "could not bind socket '%s': %s", socket_path,
+                  strerror(errno));
+  }
+
+  if (listen(fd, SOMAXCONN) < 0)
+    raise_error(ERROR_SYS, "could not listen on socket '%s': %s",
+                socket_path, strerror(errno));
+
+  return fd;
+}
+
+void accept_connections(int listen_fd, int epoll_fd) {
+  for (;;) {
+    int fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+    if (fd < 0) //EAGAIN once the backlog is drained
+      return;
+
+    connection *conn = calloc(1, sizeof(connection));
+    if (!conn) {
+      close(fd);
+      return;
+    }
+    conn->fd = fd;
+
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = conn;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0)
+      close_connection(conn);
+  }
+}
+
+void close_connection(connection *conn) {
+  if (!conn->handed_off)
+    close(conn->fd); //also removes it from the epoll set
+  free(conn->in);
+  free(conn->out);
+  free(conn);
+}
+
+bool read_requests(connection *conn, FILE *stream, char **response) {
+  bool at_eof = false;
+
+  //stop once there is enough to work on; the rest waits for the next call
+  while (conn->in_len < MAX_PENDING_INPUT) {
+    if (conn->in_size - conn->in_len < READ_SIZE) {
+      size_t new_size = conn->in_len + READ_SIZE;
+      char *in = realloc(conn->in, new_size);
+      if (!in)
+        return false;
+      conn->in = in;
+      conn->in_size = new_size;
+    }
+
+    ssize_t count = read(conn->fd, conn->in + conn->in_len,
+                         conn->in_size - conn->in_len - 1);
+    if (count > 0) {
+      conn->in_len += count;
+      continue;
+    } else if (count == 0) {
+      at_eof = true;
+    } else if (errno == EINTR) {
+      continue;
+    } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+      return false;
+    }
+    break;
+  }
+
+  //answer every complete line, in order
+  size_t start = 0;
+  for (size_t i = 0; i < conn->in_len; i++) {
+    if (conn->in[i] != '\n')
+      continue;
+
+    conn->in[i] = '\0';
+    if (i > start && conn->in[i - 1] == '\r')
+      conn->in[i - 1] = '\0';
+
+    if (!strcmp(conn->in + start, RING_REQUEST)) {
+      //switch this client over to shared memory
+      conn->handed_off = start_ring(conn->fd);
+      return conn->handed_off;
+    }
+
+    if (i - start > MAX_REQUEST_LENGTH)
+      fprintf(stream, "Error: request is too long\n");
+    else
+      serve_request(conn->in + start, stream);
+    start = i + 1;
+  }
+
+  //a final unterminated line still counts as a request
+  if (at_eof && start < conn->in_len) {
+    conn->in[conn->in_len] = '\0';
+    if (conn->in_len - start > MAX_REQUEST_LENGTH)
+      fprintf(stream, "Error: request is too long\n");
+    else
+      serve_request(conn->in + start, stream);
+    start = conn->in_len;
+  }
+
+  memmove(conn->in, conn->in + start, conn->in_len - start);
+  conn->in_len -= start;
+
+  if (conn->in_len > MAX_REQUEST_LENGTH) {
+    fprintf(stream, "Error: request is too long\n");
+    conn->in_len = 0;
+    at_eof = true;
+  }
+
+  fflush(stream);
+  long length = ftell(stream);
+  if (length > 0)
+    append_output(conn, *response, length);
+  fseek(stream, 0, SEEK_SET);
+
+  if (at_eof)
+    conn->closing = true;
+  return true;
+}
+
+bool flush_responses(connection *conn) {
+  while (conn->out_pos < conn->out_len) {
+    ssize_t count = write(conn->fd, conn->out + conn->out_pos,
+                          conn->out_len - conn->out_pos);
+
+    if (count > 0)
+      conn->out_pos += count;
+    else if (count < 0 && errno == EINTR)
+      continue;
+    else if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+      return true;
+    else
+      return false;
+  }
+
+  conn->out_pos = conn->out_len = 0;
+  return !conn->closing;
+}
+
+void append_output(connection *conn, char *data, size_t length) {
+  if (conn->out_pos > 0) { //reclaim space already sent
+    memmove(conn->out, conn->out + conn->out_pos,
+            conn->out_len - conn->out_pos);
+    conn->out_len -= conn->out_pos;
+    conn->out_pos = 0;
+  }
+
+  if (conn->out_len + length > conn->out_size) {
+    size_t new_size = 2 * (conn->out_len + length);
+    char *out = realloc(conn->out, new_size);
+    if (!out)
+      raise_error(ERROR_SYS, "memory allocation failure");
+    conn->out = out;
+    conn->out_size = new_size;
+  }
+
+  memcpy(conn->out + conn->out_len, data, length);
+  conn->out_len += length;
+}
+
+bool output_backed_up(connection *conn) {
+  return conn->out_len - conn->out_pos > MAX_PENDING_OUTPUT;
+}
+
+bool start_ring(int fd) {
+  int ring_fd = memfd_create("ccalc-ring", MFD_CLOEXEC);
+  if (ring_fd < 0)
+    return false;
+
+  ring_header *ring = MAP_FAILED;
+  if (ftruncate(ring_fd, sizeof(ring_header)) == 0)
+    ring = mmap(NULL, sizeof(ring_header), PROT_READ | PROT_WRITE,
+                MAP_SHARED, ring_fd, 0);
+  if (ring == MAP_FAILED) {
+    close(ring_fd);
+    return false;
+  }
+
+  //the new memfd is zero-filled, so every slot starts out free
+  ring->magic = RING_MAGIC;
+  ring->slots = RING_SLOTS;
+
+  //pass the ring to the client along with a one-line acknowledgment
+  char reply[] = "ring\n";
+  char control[CMSG_SPACE(sizeof(int))];
+  struct iovec iov = { reply, sizeof(reply) - 1 };
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+  memcpy(CMSG_DATA(cmsg), &ring_fd, sizeof(int));
+
+  ssize_t sent = sendmsg(fd, &msg, MSG_NOSIGNAL);
+  close(ring_fd);
+
+  pthread_t thread;
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+  //the thread takes over both the socket and the mapping
+  ring_service *service = malloc(sizeof(ring_service));
+  bool started = sent >= 0 && service;
+  if (started) {
+    service->fd = fd;
+    service->ring = ring;
+    started = pthread_create(&thread, &attr, serve_ring, service) == 0;
+  }
+  pthread_attr_destroy(&attr);
+
+  if (!started) {
+    munmap(ring, sizeof(ring_header));
+    free(service);
+  }
+  return started;
+}
+
+void *serve_ring(void *arg) {
+  ring_service *service = arg;
+  int fd = service->fd;
+  ring_header *ring = service->ring;
+  free(service);
+
+  char *response = NULL;
+  size_t response_size = 0;
+  FILE *stream = open_memstream(&response, &response_size);
+  char request[RING_TEXT_SIZE];
+  uint32_t tail = 0;
+
+  while (stream && !atomic_load(&ring->closed)) {
+    ring_slot *slot = &ring->slot[tail % RING_SLOTS];
+
+    //spin briefly, then sleep until the client rings the doorbell
+    int spins = 0;
+    while (atomic_load_explicit(&slot->state, memory_order_acquire)
+           != SLOT_SUBMITTED && !atomic_load(&ring->closed)) {
+      if (++spins < ring_spin_limit())
+        continue;
+
+      atomic_store(&ring->server_waiting, 1);
+      if (atomic_load(&slot->state) != SLOT_SUBMITTED)
+        ring_wait(&ring->server_waiting, 1, 1000);
+      atomic_store(&ring->server_waiting, 0);
+      spins = 0;
+
+      if (client_gone(fd))
+        atomic_store(&ring->closed, 1);
+    }
+    if (atomic_load(&ring->closed))
+      break;
+
+    //the client can still write to the slot, so the request is copied
+    //out of shared memory before it is looked at
+    uint32_t request_length = slot->length;
+    if (request_length >= RING_TEXT_SIZE)
+      request_length = RING_TEXT_SIZE - 1;
+    memcpy(request, slot->text, request_length);
+    request[request_length] = '\0';
+    serve_request(request, stream);
+
+    fflush(stream);
+    long length = ftell(stream) - 1; //drop the newline
+    fseek(stream, 0, SEEK_SET);
+    if (length >= RING_TEXT_SIZE) {
+      strcpy(response, "Error: response is too long");
+      length = strlen(response);
+    }
+
+    memcpy(slot->text, response, length);
+    slot->text[length] = '\0';
+    slot->length = length;
+    atomic_store(&slot->state, SLOT_DONE);
+    tail++;
+
+    //a waiting client is woken once the ring drains, not for every slot
+    ring_slot *next = &ring->slot[tail % RING_SLOTS];
+    if (atomic_load(&next->state) != SLOT_SUBMITTED
+        && atomic_load(&ring->client_waiting)
+        && atomic_exchange(&ring->client_waiting, 0))
+      ring_wake(&ring->client_waiting);
+  }
+
+  if (stream)
+    fclose(stream);
+  free(response);
+  munmap(ring, sizeof(ring_header));
+  close(fd);
+  return NULL;
+}
+
+bool client_gone(int fd) {
+  struct pollfd pfd;
+  pfd.fd = fd;
+  pfd.events = POLLRDHUP;
+  return poll(&pfd, 1, 0) > 0;
+}
+
+int run_client(char *socket_path, char *expression, options *opts) {
+  //every request repeats our options so the daemon can apply them
+  char prefix[128];
+  int prefix_length = format_options(prefix, sizeof(prefix) - 4, opts);
+  strcpy(prefix + prefix_length, " -- ");
+  prefix_length += 4;
+
+  if (opts->use_ring)
+    return run_ring_client(socket_path, expression, prefix);
+
+  struct sockaddr_un addr;
+
+  if (strlen(socket_path) >= sizeof(addr.sun_path))
+    raise_error(ERROR_SYS, "socket path '%s' is too long", socket_path);
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, socket_path);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+    raise_error(ERROR_SYS, "could not connect to '%s': %s", socket_path,
+                strerror(errno));
+
+  signal(SIGPIPE, SIG_IGN);
+
+  if (expression) {
+    write_all(fd, prefix, prefix_length);
+    write_all(fd, expression, strlen(expression));
+    write_all(fd, "\n", 1);
+    shutdown(fd, SHUT_WR);
+  }
+
+  //stream stdin lines to the daemon while relaying its responses
+  struct pollfd fds[2];
+  fds[0].fd = fd;
+  fds[0].events = POLLIN;
+  fds[1].fd = expression ? -1 : STDIN_FILENO;
+  fds[1].events = POLLIN;
+
+  char in[READ_SIZE];
+  char line[MAX_REQUEST_LENGTH];
+  size_t line_len = 0;
+  char reply[READ_SIZE];
+  size_t reply_len = 0;
+
+  while (fds[0].fd >= 0) {
+    if (poll(fds, 2, -1) < 0) {
+      if (errno == EINTR)
+        continue;
+      raise_error(ERROR_SYS, "poll failed: %s", strerror(errno));
+    }
+
+    if (fds[1].revents) {
+      ssize_t count = read(STDIN_FILENO, in, sizeof(in));
+      bool done = count <= 0;
+
+      for (ssize_t i = 0; i < count && !done; i++) {
+        if (in[i] != '\n') {
+          if (line_len < sizeof(line))
+            line[line_len++] = in[i];
+          continue;
+        }
+
+        if (line_len == 0) { //an empty line ends input, as in batch mode
+          done = true;
+          break;
+        }
+        write_all(fd, prefix, prefix_length);
+        write_all(fd, line, line_len);
+        write_all(fd, "\n", 1);
+        line_len = 0;
+      }
+
+      if (done) {
+        if (line_len > 0) {
+          write_all(fd, prefix, prefix_length);
+          write_all(fd, line, line_len);
+          write_all(fd, "\n", 1);
+        }
+        shutdown(fd, SHUT_WR);
+        fds[1].fd = -1;
+      }
+    }
+
+    if (fds[0].revents) {
+      ssize_t count = read(fd, reply + reply_len, sizeof(reply) - reply_len);
+
+      if (count <= 0) {
+        fds[0].fd = -1;
+        continue;
+      }
+      reply_len += count;
+
+      //print complete responses; stop at the first error
+      size_t start = 0;
+      for (size_t i = 0; i < reply_len; i++) {
+        if (reply[i] != '\n')
+          continue;
+
+        if (!strncmp(reply + start, "Error: ", 7)) {
+          fflush(stdout); //keep the error after the results before it
+          fwrite(reply + start, 1, i + 1 - start, stderr);
+          close(fd);
+          return ERROR_EXPR;
+        }
+        fwrite(reply + start, 1, i + 1 - start, stdout);
+        start = i + 1;
+      }
+
+      memmove(reply, reply + start, reply_len - start);
+      reply_len -= start;
+      if (reply_len == sizeof(reply))
+        raise_error(ERROR_SYS, "response from daemon is too long");
+    }
+  }
+
+  close(fd);
+  return SUCCESS;
+}
+
+void write_all(int fd, char *data, size_t length) {
+  while (length > 0) {
+    ssize_t count = write(fd, data, length);
+
+    if (count < 0 && errno == EINTR)
+      continue;
+    if (count <= 0)
+      raise_error(ERROR_SYS, "could not send request: %s", strerror(errno));
+
+    data += count;
+    length -= count;
+  }
+}
+
+int run_ring_client(char *socket_path, char *expression, char *prefix) {
+  ring_client client;
+
+  if (ring_connect(&client, socket_path) < 0)
+    raise_error(ERROR_SYS, "could not set up ring with '%s': %s",
+                socket_path, strerror(errno));
+
+  int prefix_length = strlen(prefix);
+  char request[RING_TEXT_SIZE];
+  char response[RING_TEXT_SIZE];
+  char *line = NULL;
+  size_t line_size = 0;
+  bool done = false;
+  int status = SUCCESS;
+
+  //keep the ring full, collecting the oldest response whenever it is not
+  while (status == SUCCESS && (!done || client.tail != client.head)) {
+    if (!done && client.head - client.tail < RING_SLOTS) {
+      ssize_t length;
+
+      if (expression) {
+        line = expression;
+        length = strlen(expression);
+        expression = NULL;
+      } else {
+        length = getline(&line, &line_size, stdin);
+        if (length > 0 && line[length - 1] == '\n')
+          line[--length] = '\0';
+      }
+
+      if (length <= 0) { //an empty line ends input, as in batch mode
+        done = true;
+        continue;
+      }
+      if (prefix_length + length >= RING_TEXT_SIZE)
+        raise_error(ERROR_SYS, "expression is too long for the ring");
+
+      memcpy(request, prefix, prefix_length);
+      memcpy(request + prefix_length, line, length + 1);
+      ring_submit(&client, request);
+      continue;
+    }
+
+    if (ring_collect(&client, response, sizeof(response)) < 0)
+      raise_error(ERROR_SYS, "lost connection to daemon at '%s': %s",
+                  socket_path, strerror(errno));
+
+    //stop at the first error, as the socket client and batch mode do;
+    //requests already in the ring are abandoned with it
+    if (!strncmp(response, "Error: ", 7)) {
+      fflush(stdout);
+      fprintf(stderr, "%s\n", response);
+      status = ERROR_EXPR;
+      break;
+    }
+    printf("%s\n", response);
+  }
+
+  if (line_size > 0)
+    free(line);
+  ring_disconnect(&client);
+  return status;
+}
+
+#else //no epoll or Unix domain sockets: only serve_request is available
+
+void run_daemon(char *socket_path) {
+  (void)socket_path;
+  raise_error(ERROR_SYS, "--daemon is not supported on this system");
+}
+
+int run_client(char *socket_path, char *expression, options *opts) {
+  (void)socket_path;
+  (void)expression;
+  (void)opts;
+  raise_error(ERROR_SYS, "--connect is not supported on this system");
+  return ERROR_SYS;
+}
+
+#endif
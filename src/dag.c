@@ -0,0 +1,468 @@
+/* ccalc -- evaluate C-style expressions from the command line.
+   Copyright (C) 2015-2017 Gregory Kikola.
+
+   This file is part of ccalc.
+
+   ccalc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   ccalc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with ccalc.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Written by Gregory Kikola <gkikola@gmail.com>. */
+
+#include <setjmp.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/time.h>
+
+#include "dag.h"
+#include "error.h"
+#include "evaluate.h"
+#include "output.h"
+#include "plan.h"
+#include "profile.h"
+#include "stats.h"
+
+#define READ_SIZE 65536
+#define INITIAL_NODES 256
+#define UNSHARED (-2) //next for a node kept out of the buckets
+
+int intern_node(expr_dag *dag, dag_node *node, bool shared);
+bool same_node(dag_node *a, dag_node *b);
+unsigned long hash_node(dag_node *node);
+unsigned long mix_hash(unsigned long hash, unsigned long word);
+void grow_dag(expr_dag *dag);
+char *read_input(size_t *length);
+int compile_line(expr_dag *dag, char *line, options *opts,
+                 plan_cache *plans, char **template, int *template_size);
+
+expr_dag *new_dag() {
+  expr_dag *dag = malloc(sizeof(expr_dag));
+  if (!dag)
+    raise_error(ERROR_SYS, "memory allocation failure");
+
+  dag->nodes = NULL;
+  dag->num_nodes = 0;
+  dag->max_nodes = 0;
+  dag->buckets = NULL;
+  dag->num_buckets = 0;
+  dag->total_nodes = 0;
+  grow_dag(dag);
+  return dag;
+}
+
+void free_dag(expr_dag *dag) {
+  if (!dag)
+    return;
+
+  free(dag->nodes);
+  free(dag->buckets);
+  free(dag);
+}
+
+int dag_add_tree(expr_dag *dag, expr_node *tree, value params[],
+                 int num_params) {
+  dag_node node;
+  bool shared = true;
+
+  node.type = tree->type;
+  node.op = tree->op;
+  node.id[0] = '\0';
+  node.argc = 0;
+  node.done = false;
+  dag->total_nodes++;
+
+  switch (tree->type) {
+  case NODE_VARIABLE: //a literal taken out of the line
+    if (!params) { //nothing to bind, so it stays a variable
+      node.index = tree->index;
+      break;
+    }
+    if (tree->index >= num_params)
+      raise_error(ERROR_EXPR, "no value for column $%d", tree->index + 1);
+    node.type = NODE_CONSTANT;
+    node.val = params[tree->index];
+    break;
+
+  case NODE_CONSTANT:
+    node.val = tree->val;
+    if (node.val.type == WIDE) //the tree may be freed before the DAG is
+      value_set_wide(&node.val, *tree->val.data.wvalue);
+    break;
+
+  case NODE_FUNCTION:
+    strcpy(node.id, tree->id);
+
+    //a call to rand() is never the same as another, and neither is
+    //anything that uses its result
+    shared = is_pure_function(tree->id);
+    //fall through
+  case NODE_OPERATOR:
+  case NODE_CONDITIONAL:
+    node.argc = tree->argc;
+    for (int i = 0; i < tree->argc; i++)
+      node.args[i] = dag_add_tree(dag, tree->args[i], params, num_params);
+    break;
+  }
+
+  return intern_node(dag, &node, shared);
+}
+
+void dag_evaluate(expr_dag *dag, int index, options *opts, value *result) {
+  value argv[MAX_ARGUMENTS];
+  dag_node *node = &dag->nodes[index];
+
+  if (node->done) {
+    *result = node->val;
+    return;
+  }
+
+  //operands are evaluated left to right, as the parser would have
+  for (int i = 0; i < node->argc; i++)
+    dag_evaluate(dag, node->args[i], opts, &argv[i]);
+
+  switch (node->type) {
+  case NODE_OPERATOR:
+    if (is_unary_operator(node->op))
+      apply_operator(node->op, NULL, &argv[0], result);
+    else
+      apply_operator(node->op, &argv[0], &argv[1], result);
+    break;
+
+  case NODE_CONDITIONAL:
+    conditional(&argv[0], &argv[1], &argv[2], result);
+    break;
+
+  case NODE_FUNCTION:
+    call_function(node->id, result, node->argc, argv, opts->degrees);
+    break;
+
+  default:
+    *result = node->val;
+    break;
+  }
+
+  node->val = *result;
+  node->done = true;
+}
+
+void run_batch(options *opts) {
+  size_t length;
+  phase previous = profile_switch(PHASE_IO);
+  char *buffer = read_input(&length);
+  profile_switch(previous);
+
+  //split the input into lines; like the line-by-line mode, stop at the
+  //first empty line
+  char **lines = NULL;
+  int num_lines = 0, max_lines = 0;
+
+  char *pos = buffer;
+  char *end = buffer + length;
+  while (pos < end && *pos != '\n') {
+    char *newline = memchr(pos, '\n', end - pos);
+    if (!newline)
+      newline = end;
+    *newline = '\0';
+
+    if (num_lines == max_lines) {
+      max_lines = max_lines ? 2 * max_lines : 1024;
+      lines = realloc(lines, max_lines * sizeof(char *));
+      if (!lines)
+        raise_error(ERROR_SYS, "memory allocation failure");
+    }
+    lines[num_lines++] = pos;
+    pos = newline + 1;
+  }
+
+  //build one DAG from every line before evaluating any of them
+  expr_dag *dag = new_dag();
+  int *roots = malloc((num_lines + 1) * sizeof(int));
+  char *template = NULL;
+  int template_size = 0;
+  if (!roots)
+    raise_error(ERROR_SYS, "memory allocation failure");
+
+  //lines of the same shape share one compiled plan
+  plan_cache *plans = NULL;
+  if (opts->plan_cache_size > 0)
+    plans = new_plan_cache(opts->plan_cache_size);
+
+  for (int i = 0; i < num_lines; i++)
+    roots[i] = compile_line(dag, lines[i], opts, plans, &template,
+                            &template_size);
+  free(template);
+
+  for (int i = 0; i < num_lines; i++) {
+    value result;
+    struct timeval tv_start, tv_end;
+    value_set_int(&result, 0);
+    stats.lines++;
+
+    if (opts->show_time)
+      gettimeofday(&tv_start, NULL);
+
+    uint64_t start = stats.enabled ? read_clock() : 0;
+    previous = profile_switch(PHASE_EVALUATE);
+    jmp_buf trap;
+    jmp_buf *prev_trap = error_trap;
+    error_trap = &trap;
+    if (roots[i] < 0 || setjmp(trap)) {
+      //evaluate the line on its own, so that it fails just as it would
+      //have without --batch
+      error_trap = prev_trap;
+      evaluate(lines[i], &result, opts);
+    } else {
+      dag_evaluate(dag, roots[i], opts, &result);
+      error_trap = prev_trap;
+    }
+
+    profile_switch(previous);
+    uint64_t latency = stats.enabled ? read_clock() - start : 0;
+
+    if (opts->show_time)
+      gettimeofday(&tv_end, NULL);
+
+    if (opts->profile) {
+      print_profiled(stdout, &result, opts,
+                     opts->show_time ? &tv_start : NULL, &tv_end);
+    } else {
+      print_value(stdout, &result, opts);
+      if (opts->show_time)
+        print_elapsed(stdout, &tv_start, &tv_end);
+      printf("\n");
+    }
+
+    record_line(lines[i], latency);
+  }
+
+  if (opts->show_stats) { //--stats reports on them at exit
+    stats.dag = dag;
+    stats.plans = plans;
+  } else {
+    free_dag(dag);
+    free_plan_cache(plans);
+  }
+
+  free(roots);
+  free(lines);
+  free(buffer);
+}
+
+int intern_node(expr_dag *dag, dag_node *node, bool shared) {
+  node->hash = hash_node(node);
+
+  for (int i = 0; i < node->argc && shared; i++)
+    shared = dag->nodes[node->args[i]].next != UNSHARED;
+
+  int bucket = node->hash & (dag->num_buckets - 1);
+  if (shared) {
+    for (int i = dag->buckets[bucket]; i >= 0; i = dag->nodes[i].next) {
+      if (dag->nodes[i].hash == node->hash && same_node(&dag->nodes[i], node))
+        return i;
+    }
+  }
+
+  if (dag->num_nodes == dag->max_nodes) {
+    grow_dag(dag);
+    bucket = node->hash & (dag->num_buckets - 1);
+  }
+
+  int index = dag->num_nodes++;
+  dag->nodes[index] = *node;
+  if (shared) {
+    dag->nodes[index].next = dag->buckets[bucket];
+    dag->buckets[bucket] = index;
+  } else {
+    dag->nodes[index].next = UNSHARED;
+  }
+  return index;
+}
+
+bool same_node(dag_node *a, dag_node *b) {
+  if (a->type != b->type || a->argc != b->argc)
+    return false;
+
+  switch (a->type) {
+  case NODE_CONSTANT:
+    if (a->val.type == BIG && b->val.type == BIG) //the limbs are elsewhere
+      return big_compare(a->val.data.bvalue, b->val.data.bvalue) == 0;
+    if (a->val.type == BIGFLOAT && b->val.type == BIGFLOAT)
+      return bf_compare(a->val.data.bfvalue, b->val.data.bfvalue) == 0;
+
+    if (a->val.type == WIDE && b->val.type == WIDE)
+      return *a->val.data.wvalue == *b->val.data.wvalue;
+
+    //compare bits, so that 0.0 and -0.0 stay apart
+    return a->val.type == b->val.type
+      && memcmp(&a->val.data, &b->val.data, sizeof(number)) == 0;
+  case NODE_VARIABLE:
+    return a->index == b->index;
+  case NODE_OPERATOR:
+    if (a->op != b->op)
+      return false;
+    break;
+  case NODE_FUNCTION:
+    if (strcmp(a->id, b->id) != 0)
+      return false;
+    break;
+  default:
+    break;
+  }
+
+  return memcmp(a->args, b->args, a->argc * sizeof(int)) == 0;
+}
+
+unsigned long hash_node(dag_node *node) {
+  unsigned long hash = 14695981039346656037UL;
+  unsigned long bits;
+
+  hash = mix_hash(hash, node->type);
+  switch (node->type) {
+  case NODE_CONSTANT:
+    memcpy(&bits, &node->val.data, sizeof(bits));
+    hash = mix_hash(hash, node->val.type);
+    if (node->val.type == WIDE) { //the 128 bits, not where they are
+      unsigned __int128 wide = *node->val.data.wvalue;
+      hash = mix_hash(hash, (unsigned long)(wide >> 64));
+      bits = (unsigned long)wide;
+    }
+    hash = mix_hash(hash, bits);
+    break;
+  case NODE_VARIABLE:
+    hash = mix_hash(hash, node->index);
+    break;
+  case NODE_OPERATOR:
+    hash = mix_hash(hash, node->op);
+    break;
+  case NODE_FUNCTION:
+    for (char *c = node->id; *c; c++)
+      hash = mix_hash(hash, *c);
+    break;
+  default:
+    break;
+  }
+
+  for (int i = 0; i < node->argc; i++)
+    hash = mix_hash(hash, node->args[i]);
+
+  //the bits of a double that differ are mostly high ones, and a multiply
+  //only carries bits upward, so fold them down before the hash is masked
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdUL;
+  return hash ^ (hash >> 33);
+}
+
+unsigned long mix_hash(unsigned long hash, unsigned long word) {
+  //FNV-1a, a word at a time rather than a byte
+  hash ^= word;
+  return hash * 1099511628211UL;
+}
+
+void grow_dag(expr_dag *dag) {
+  dag->max_nodes = dag->max_nodes ? 2 * dag->max_nodes : INITIAL_NODES;
+  dag->nodes = realloc(dag->nodes, dag->max_nodes * sizeof(dag_node));
+
+  //keep the buckets at most half full
+  free(dag->buckets);
+  dag->num_buckets = 2 * dag->max_nodes;
+  dag->buckets = malloc(dag->num_buckets * sizeof(int));
+  if (!dag->nodes || !dag->buckets)
+    raise_error(ERROR_SYS, "memory allocation failure");
+
+  for (int i = 0; i < dag->num_buckets; i++)
+    dag->buckets[i] = -1;
+
+  for (int i = 0; i < dag->num_nodes; i++) {
+    dag_node *node = &dag->nodes[i];
+    if (node->next == UNSHARED)
+      continue;
+
+    int bucket = node->hash & (dag->num_buckets - 1);
+    node->next = dag->buckets[bucket];
+    dag->buckets[bucket] = i;
+  }
+}
+
+char *read_input(size_t *length) {
+  size_t size = READ_SIZE;
+  char *buffer = malloc(size + 1);
+  *length = 0;
+
+  if (!buffer)
+    raise_error(ERROR_SYS, "memory allocation failure");
+
+  size_t count;
+  while ((count = fread(buffer + *length, 1, size - *length, stdin)) > 0) {
+    *length += count;
+    if (*length == size) {
+      size *= 2;
+      buffer = realloc(buffer, size + 1);
+      if (!buffer)
+        raise_error(ERROR_SYS, "memory allocation failure");
+    }
+  }
+
+  buffer[*length] = '\0';
+  return buffer;
+}
+
+//returns the line's root in the DAG, or -1 if the line has to be
+//evaluated on its own
+int compile_line(expr_dag *dag, char *line, options *opts,
+                 plan_cache *plans, char **template, int *template_size) {
+  value params[MAX_PARAMS];
+  expr_node *volatile tree = NULL; //only if it is not kept in plans
+  volatile int root = -1;
+
+  //a placeholder is never more than four times the size of its literal
+  int size = 4 * strlen(line) + 16;
+  if (size > *template_size) {
+    free(*template);
+    *template = malloc(size);
+    *template_size = size;
+    if (!*template)
+      raise_error(ERROR_SYS, "memory allocation failure");
+  }
+
+  phase previous = profile_switch(PHASE_LEX);
+
+  jmp_buf trap;
+  jmp_buf *prev_trap = error_trap;
+  error_trap = &trap;
+  if (setjmp(trap)) {
+    error_trap = prev_trap;
+    free_node(tree);
+    profile_switch(previous);
+    return -1;
+  }
+
+  int num_params = normalize_expression(line, opts, *template, size, params,
+                                        MAX_PARAMS);
+  profile_switch(PHASE_PARSE);
+  if (num_params >= 0 && plans) {
+    root = dag_add_tree(dag, get_plan(plans, *template, opts), params,
+                        num_params);
+  } else if (num_params >= 0) {
+    tree = compile_expression(*template, opts, NULL, 0);
+    root = dag_add_tree(dag, tree, params, num_params);
+  }
+
+  error_trap = prev_trap;
+  free_node(tree);
+  profile_switch(previous);
+  return root;
+}
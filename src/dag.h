@@ -0,0 +1,70 @@
+/* ccalc -- evaluate C-style expressions from the command line.
+   Copyright (C) 2015-2017 Gregory Kikola.
+
+   This file is part of ccalc.
+
+   ccalc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   ccalc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with ccalc.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Written by Gregory Kikola <gkikola@gmail.com>. */
+
+#ifndef CCALC_DAG_H
+#define CCALC_DAG_H
+
+#include <stdbool.h>
+
+#include "compile.h"
+#include "options.h"
+#include "value.h"
+
+//One node of a DAG built from the trees of many expressions. Nodes are
+//hash-consed: a subexpression that appears in several expressions, with
+//the same literals, is stored once and its value computed once. Children
+//always come before their parents in the node array.
+typedef struct {
+  node_type type;
+  operator_type op;
+  char id[MAX_IDENTIFIER_LENGTH + 1];
+  int argc;
+  int args[MAX_ARGUMENTS];
+
+  int index; //of a variable left unbound
+  value val; //the literal, or the result once evaluated
+  bool done;
+
+  unsigned long hash;
+  int next; //next node in the same bucket, or -1 at the end
+} dag_node;
+
+typedef struct {
+  dag_node *nodes;
+  int num_nodes;
+  int max_nodes;
+
+  int *buckets;
+  int num_buckets;
+
+  long total_nodes; //nodes added, counting every repeat
+} expr_dag;
+
+expr_dag *new_dag();
+void free_dag(expr_dag *dag);
+
+int dag_add_tree(expr_dag *dag, expr_node *tree, value params[],
+                 int num_params);
+void dag_evaluate(expr_dag *dag, int index, options *opts, value *result);
+
+void run_batch(options *opts);
+
+#endif
@@ -24,10 +24,23 @@
 #include <stdlib.h>
 
 #include "error.h"
+#include "stats.h"
+
+_Thread_local jmp_buf *error_trap = NULL;
+_Thread_local char error_message[ERROR_MESSAGE_SIZE];
 
 void raise_error(int exit_code, char *fmt_str, ...) {
   va_list vargs;
 
+  if (error_trap) { //caller wants to recover from the error
+    va_start(vargs, fmt_str);
+    vsnprintf(error_message, ERROR_MESSAGE_SIZE, fmt_str, vargs);
+    va_end(vargs);
+
+    longjmp(*error_trap, exit_code);
+  }
+
+  fflush(stdout); //so that output comes before the error that ends it
   fprintf(stderr, "Error: ");
   
   va_start(vargs, fmt_str);
@@ -36,5 +49,12 @@ void raise_error(int exit_code, char *fmt_str, ...) {
 
   fprintf(stderr, "\n");
 
+  if (stats.enabled) { //--stats counts errors by kind
+    va_start(vargs, fmt_str);
+    vsnprintf(error_message, ERROR_MESSAGE_SIZE, fmt_str, vargs);
+    va_end(vargs);
+    count_error(fmt_str, error_message);
+  }
+
   exit(exit_code);
 }
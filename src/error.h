@@ -22,10 +22,19 @@
 #ifndef CCALC_ERROR_H
 #define CCALC_ERROR_H
 
+#include <setjmp.h>
+
 #define SUCCESS 0
 #define ERROR_EXPR 1
 #define ERROR_SYS 2
 
+#define ERROR_MESSAGE_SIZE 256
+
+//when error_trap is set, raise_error stores the message and jumps there
+//instead of exiting the program; each thread has its own trap
+extern _Thread_local jmp_buf *error_trap;
+extern _Thread_local char error_message[ERROR_MESSAGE_SIZE];
+
 void raise_error(int exit_code, char *fmt_str, ...);
 
 #endif
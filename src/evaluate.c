@@ -23,17 +23,18 @@
 #include <stdbool.h>
 #include <string.h>
 
+#include "compile.h"
 #include "error.h"
 #include "evaluate.h"
 
-#define MAX_IDENTIFIER_LENGTH 32
-#define MAX_ARGUMENTS 8
+#define MAX_COLUMN 65536
 
 typedef enum {
   TOKEN_UNKNOWN,
   TOKEN_END,
   TOKEN_IDENTIFIER,
   TOKEN_LITERAL,
+  TOKEN_VARIABLE,
   TOKEN_LEFT_PAREN,
   TOKEN_RIGHT_PAREN,
   TOKEN_QMARK,
@@ -68,52 +69,216 @@ typedef struct Parser {
   int pos;
   options *program_opts;
 
+  //variables are only recognized when compiling
+  bool compiling;
+  bool folding; //compute constant subexpressions while parsing
+  char **var_names;
+  int num_vars;
+
   token_type cur_token;
   char str_value[MAX_IDENTIFIER_LENGTH + 1];
   value numeric_value;
 } parser;
 
-bool is_whitespace(char c);
+//result of parsing a subexpression: a constant value if it could be
+//computed right away, otherwise a node to be executed later
+typedef struct {
+  value val;
+  expr_node *node;
+} term;
+
+void init_parser(parser *parse, char *expr, options *opts);
+void expect_end(parser *parse);
 
 void get_token(parser *parse);
 token_type peek_token(parser *parse);
 void get_identifier(parser *parse);
 void get_literal(parser *parse);
-
-void parse_expression(parser *parse, value *result);
-void parse_conditional_expression(parser *parse, value *result);
-void parse_logical_or_expression(parser *parse, value *result);
-void parse_logical_and_expression(parser *parse, value *result);
-void parse_inclusive_or_expression(parser *parse, value *result);
-void parse_exclusive_or_expression(parser *parse, value *result);
-void parse_and_expression(parser *parse, value *result);
-void parse_equality_expression(parser *parse, value *result);
-void parse_relational_expression(parser *parse, value *result);
-void parse_shift_expression(parser *parse, value *result);
-void parse_additive_expression(parser *parse, value *result);
-void parse_multiplicative_expression(parser *parse, value *result);
-void parse_unary_expression(parser *parse, value *result);
-void parse_exponential_expression(parser *parse, value *result);
-void parse_primary(parser *parse, value *result);
+void append_digit(value *result, int base, int digit);
+void get_variable(parser *parse);
+
+expr_node *term_node(term *t);
+void combine(operator_type op, term *left, term *right, term *result);
+void combine_conditional(term *condition, term *on_true, term *on_false,
+                         term *result);
+
+void parse_expression(parser *parse, term *result);
+void parse_conditional_expression(parser *parse, term *result);
+void parse_logical_or_expression(parser *parse, term *result);
+void parse_logical_and_expression(parser *parse, term *result);
+void parse_inclusive_or_expression(parser *parse, term *result);
+void parse_exclusive_or_expression(parser *parse, term *result);
+void parse_and_expression(parser *parse, term *result);
+void parse_equality_expression(parser *parse, term *result);
+void parse_relational_expression(parser *parse, term *result);
+void parse_shift_expression(parser *parse, term *result);
+void parse_additive_expression(parser *parse, term *result);
+void parse_multiplicative_expression(parser *parse, term *result);
+void parse_unary_expression(parser *parse, term *result);
+void parse_exponential_expression(parser *parse, term *result);
+void parse_primary(parser *parse, term *result);
 
 void evaluate(char *expr, value *result, options *opts) {
   parser parse;
-  parse.expr = expr;
-  parse.pos = 0;
-  parse.program_opts = opts;
+  term parsed;
+  init_parser(&parse, expr, opts);
+
+  parse_expression(&parse, &parsed);
+  *result = parsed.val;
+
+  expect_end(&parse);
+}
+
+expr_node *compile_expression(char *expr, options *opts,
+                              char *var_names[], int num_vars) {
+  parser parse;
+  term parsed;
+  init_parser(&parse, expr, opts);
+  parse.compiling = true;
+  parse.var_names = var_names;
+  parse.num_vars = num_vars;
+
+  parse_expression(&parse, &parsed);
+  expect_end(&parse);
+
+  return term_node(&parsed);
+}
+
+expr_node *parse_unfolded(char *expr, options *opts, char *var_names[],
+                          int num_vars) {
+  //like compile_expression, but every literal and constant gets a node of
+  //its own, so the tree is exactly what the parser read
+  parser parse;
+  term parsed;
+  init_parser(&parse, expr, opts);
+  parse.compiling = true;
+  parse.folding = false;
+  parse.var_names = var_names;
+  parse.num_vars = num_vars;
+
+  parse_expression(&parse, &parsed);
+  expect_end(&parse);
+
+  return term_node(&parsed);
+}
+
+int normalize_expression(char *expr, options *opts, char *normal, int size,
+                         value params[], int max_params) {
+  //Rewrite expr with a single space between tokens. When params is given,
+  //each literal becomes a $N placeholder and its value goes in params, so
+  //expressions that only differ in their numbers normalize alike. Returns
+  //the number of literals taken out, or -1 if they or the text don't fit.
+  parser parse;
+  init_parser(&parse, expr, opts);
+
+  int length = 0;
+  int num_params = 0;
+  normal[0] = '\0';
+  while (true) {
+    while (is_whitespace(expr[parse.pos]))
+      parse.pos++;
+    int start = parse.pos;
+
+    get_token(&parse);
+    if (parse.cur_token == TOKEN_END)
+      break;
+
+    //take the token as it was written, without the whitespace after it
+    char *text = expr + start;
+    int text_length = parse.pos - start;
+    while (text_length > 0 && is_whitespace(text[text_length - 1]))
+      text_length--;
+
+    char placeholder[16];
+    if (params && parse.cur_token == TOKEN_LITERAL) {
+      if (num_params == max_params)
+        return -1;
+      params[num_params++] = parse.numeric_value;
+
+      //write out $N by hand, this is done for every literal of every line
+      char *end = placeholder + sizeof(placeholder);
+      text = end;
+      for (int n = num_params; n > 0; n /= 10)
+        *--text = '0' + n % 10;
+      *--text = '$';
+      text_length = end - text;
+    }
 
-  parse_expression(&parse, result);
+    //leave room for the separator and the terminator
+    if (length + text_length + 2 > size)
+      return -1;
+    if (length > 0)
+      normal[length++] = ' ';
+    memcpy(normal + length, text, text_length);
+    length += text_length;
+    normal[length] = '\0';
+  }
+
+  return num_params;
+}
+
+void init_parser(parser *parse, char *expr, options *opts) {
+  parse->expr = expr;
+  parse->pos = 0;
+  parse->program_opts = opts;
+  parse->compiling = false;
+  parse->folding = true;
+  parse->var_names = NULL;
+  parse->num_vars = 0;
+}
 
+void expect_end(parser *parse) {
   //next token should be TOKEN_END
-  get_token(&parse);
+  get_token(parse);
   
-  switch (parse.cur_token) {
+  switch (parse->cur_token) {
   case TOKEN_END:
     break;
   case TOKEN_RIGHT_PAREN:
     raise_error(ERROR_EXPR, "unmatched parenthesis ')'");
   default:
-    raise_error(ERROR_EXPR, "unexpected token '%s'", parse.str_value);
+    raise_error(ERROR_EXPR, "unexpected token '%s'", parse->str_value);
+  }
+}
+
+expr_node *term_node(term *t) {
+  if (!t->node) {
+    t->node = new_node(NODE_CONSTANT);
+    t->node->val = t->val;
+    value_keep_wide(&t->node->val, &t->node->wide);
+  }
+  return t->node;
+}
+
+void combine(operator_type op, term *left, term *right, term *result) {
+  if (!right->node && (!left || !left->node)) { //fold it now
+    apply_operator(op, left ? &left->val : NULL, &right->val, &result->val);
+    result->node = NULL;
+  } else {
+    expr_node *node = new_node(NODE_OPERATOR);
+    node->op = op;
+    if (left)
+      node->args[node->argc++] = term_node(left);
+    node->args[node->argc++] = term_node(right);
+
+    result->node = node;
+  }
+}
+
+void combine_conditional(term *condition, term *on_true, term *on_false,
+                         term *result) {
+  if (!condition->node && !on_true->node && !on_false->node) {
+    conditional(&condition->val, &on_true->val, &on_false->val,
+                &result->val);
+    result->node = NULL;
+  } else {
+    expr_node *node = new_node(NODE_CONDITIONAL);
+    node->argc = 3;
+    node->args[0] = term_node(condition);
+    node->args[1] = term_node(on_true);
+    node->args[2] = term_node(on_false);
+
+    result->node = node;
   }
 }
 
@@ -144,6 +309,10 @@ void get_token(parser *parse) {
     get_literal(parse);
     break;
 
+  case TOKEN_VARIABLE:
+    get_variable(parse);
+    break;
+
   case TOKEN_LEFT_PAREN:
   case TOKEN_RIGHT_PAREN:
   case TOKEN_QMARK:
@@ -223,6 +392,12 @@ token_type peek_token(parser *parse) {
       return TOKEN_QMARK;
     case ':':
       return TOKEN_COLON;
+    case '$':
+      if (parse->compiling)
+        return TOKEN_VARIABLE;
+
+      raise_error(ERROR_EXPR, "unexpected character '%c'", next_ch);
+      return TOKEN_UNKNOWN;
     case ',':
       return TOKEN_OP_COMMA;
     case '+':
@@ -368,7 +543,7 @@ void get_literal(parser *parse) {
   while(!done) {
     char cur_ch = parse->expr[parse->pos];
 
-    if (result.type == INT) {
+    if (result.type != FLOAT) {
       switch(cur_ch) {
       default:
 	done = true;
@@ -382,7 +557,7 @@ void get_literal(parser *parse) {
           raise_error(ERROR_EXPR, "unexpected digit '%c' in octal constant",
 		      cur_ch);
 
-	result.data.ivalue = base * result.data.ivalue + (cur_ch - '0');
+	append_digit(&result, base, cur_ch - '0');
 	break;
       case 'A':
       case 'B':
@@ -398,7 +573,7 @@ void get_literal(parser *parse) {
           raise_error(ERROR_EXPR, "unexpected digit '%c' in octal constant",
 		      cur_ch);
 
-	result.data.ivalue = base * result.data.ivalue + (10 + cur_ch - 'A');
+	append_digit(&result, base, 10 + cur_ch - 'A');
 	break;
       case 'a':
       case 'b':
@@ -414,7 +589,7 @@ void get_literal(parser *parse) {
 	  raise_error(ERROR_EXPR, "unexpected digit '%c' in octal constant",
 		      cur_ch);
 
-	result.data.ivalue = base * result.data.ivalue + (10 + cur_ch - 'a');
+	append_digit(&result, base, 10 + cur_ch - 'a');
 	break;
       case 'E':
       case 'e':
@@ -425,11 +600,10 @@ void get_literal(parser *parse) {
           raise_error(ERROR_EXPR, "unexpected digit '%c' in octal constant",
                       cur_ch);
         else if (base != 10) //this 'e' is a digit
-          result.data.ivalue = base * result.data.ivalue
-            + (10 + cur_ch - ((cur_ch == 'E') ? 'A' : 'a'));
+          append_digit(&result, base,
+                       10 + cur_ch - ((cur_ch == 'E') ? 'A' : 'a'));
         else { //we've encountered an exponent
-          result.type = FLOAT;
-          result.data.fvalue = (double) result.data.ivalue;
+          value_set_float(&result, value_get_float(&result));
           reading_exponent = true;
 
           if (parse->expr[parse->pos + 1] == '+') {
@@ -451,8 +625,7 @@ void get_literal(parser *parse) {
         else if (base == 2)
 	  raise_error(ERROR_EXPR, "binary constant must be an integer");
 
-	result.type = FLOAT;
-	result.data.fvalue = (double) result.data.ivalue;
+	value_set_float(&result, value_get_float(&result));
 	break;
       }
     } else if (result.type == FLOAT && reading_exponent) {
@@ -503,6 +676,11 @@ void get_literal(parser *parse) {
     result.data.fvalue *= pow(10, float_exponent);
   }
 
+  //with --digits, read again to more than a double holds
+  if (result.type == FLOAT && bigfloats_enabled())
+    value_set_decimal(&result, parse->expr + start_pos,
+		      parse->pos - start_pos);
+
   parse->cur_token = TOKEN_LITERAL;
   parse->numeric_value.type = result.type;
   parse->numeric_value.data = result.data;
@@ -515,6 +693,27 @@ void get_literal(parser *parse) {
   parse->str_value[length] = '\0';
 }
 
+//Adds a digit to an integer literal. Past a long int the digits go on
+//into a BIG value with --bigint, and otherwise wrap around as before.
+void append_digit(value *result, int base, int digit) {
+  long int ivalue;
+
+  if (result->type == INT
+      && !__builtin_mul_overflow(result->data.ivalue, base, &ivalue)
+      && !__builtin_add_overflow(ivalue, digit, &ivalue)) {
+    result->data.ivalue = ivalue;
+  } else if (bigints_enabled()) {
+    value factor, addend;
+    value_set_int(&factor, base);
+    value_set_int(&addend, digit);
+    multiply(result, &factor, result);
+    add(result, &addend, result);
+  } else {
+    result->data.ivalue = (unsigned long int)result->data.ivalue * base
+      + digit;
+  }
+}
+
 void get_identifier(parser *parse) {
   int length = 0;
   
@@ -537,7 +736,36 @@ void get_identifier(parser *parse) {
   parse->str_value[length] = '\0';
 }
 
-void parse_expression(parser *parse, value *result) {  
+void get_variable(parser *parse) {
+  int start_pos = parse->pos;
+  long index = 0;
+
+  //skip the '$' and read the column number
+  parse->pos++;
+  while (parse->expr[parse->pos] >= '0' && parse->expr[parse->pos] <= '9') {
+    if (index < MAX_COLUMN)
+      index = 10 * index + (parse->expr[parse->pos] - '0');
+    parse->pos++;
+  }
+
+  int length = parse->pos - start_pos;
+  if (length >= MAX_IDENTIFIER_LENGTH)
+    length = MAX_IDENTIFIER_LENGTH - 1;
+  strncpy(parse->str_value, parse->expr + start_pos, length);
+  parse->str_value[length] = '\0';
+
+  if (length == 1)
+    raise_error(ERROR_EXPR, "expected column number after '$'");
+  else if (index < 1 || index > MAX_COLUMN)
+    raise_error(ERROR_EXPR, "invalid column '%s'", parse->str_value);
+
+  parse->cur_token = TOKEN_VARIABLE;
+  value_set_int(&parse->numeric_value, index);
+}
+
+void parse_expression(parser *parse, term *result) {
+  term left, right;
+
   parse_conditional_expression(parse, result);
 
   bool done = false;
@@ -551,22 +779,24 @@ void parse_expression(parser *parse, value *result) {
       get_token(parse);
 
       //evaluate right side, discard everything to the left of the comma
-      parse_conditional_expression(parse, result);
+      left = *result;
+      parse_conditional_expression(parse, &right);
+      combine(OP_COMMA, &left, &right, result);
 
       break;
     }
   }
 }
 
-void parse_conditional_expression(parser *parse, value *result) {
-  value left;
+void parse_conditional_expression(parser *parse, term *result) {
+  term left;
 
   parse_logical_or_expression(parse, result);
   left = *result;
 
   if (peek_token(parse) == TOKEN_QMARK) {
     //this is a conditional expression
-    value on_true, on_false;
+    term on_true, on_false;
     get_token(parse);
 
     //read first value
@@ -587,12 +817,12 @@ void parse_conditional_expression(parser *parse, value *result) {
     //read second value
     parse_conditional_expression(parse, &on_false);
 
-    conditional(&left, &on_true, &on_false, result);
+    combine_conditional(&left, &on_true, &on_false, result);
   }
 }
 
-void parse_logical_or_expression(parser *parse, value *result) {
-  value left, right;
+void parse_logical_or_expression(parser *parse, term *result) {
+  term left, right;
   
   parse_logical_and_expression(parse, result);
   left = *result;
@@ -606,7 +836,7 @@ void parse_logical_or_expression(parser *parse, value *result) {
     case TOKEN_OP_OR:
       get_token(parse);
       parse_logical_and_expression(parse, &right);
-      or(&left, &right, result);
+      combine(OP_OR, &left, &right, result);
       
       left = *result;
       break;
@@ -614,8 +844,8 @@ void parse_logical_or_expression(parser *parse, value *result) {
   }  
 }
 
-void parse_logical_and_expression(parser *parse, value *result) {
-  value left, right;
+void parse_logical_and_expression(parser *parse, term *result) {
+  term left, right;
 
   parse_inclusive_or_expression(parse, result);
   left = *result;
@@ -629,7 +859,7 @@ void parse_logical_and_expression(parser *parse, value *result) {
     case TOKEN_OP_AND:
       get_token(parse);
       parse_inclusive_or_expression(parse, &right);
-      and(&left, &right, result);
+      combine(OP_AND, &left, &right, result);
       
       left = *result;
       break;
@@ -637,8 +867,8 @@ void parse_logical_and_expression(parser *parse, value *result) {
   }
 }
 
-void parse_inclusive_or_expression(parser *parse, value *result) {
-  value left, right;
+void parse_inclusive_or_expression(parser *parse, term *result) {
+  term left, right;
   
   parse_exclusive_or_expression(parse, result);
   left = *result;
@@ -652,7 +882,7 @@ void parse_inclusive_or_expression(parser *parse, value *result) {
     case TOKEN_OP_BIT_OR:
       get_token(parse);
       parse_exclusive_or_expression(parse, &right);
-      bit_or(&left, &right, result);
+      combine(OP_BIT_OR, &left, &right, result);
       
       left = *result;
       break;
@@ -660,8 +890,8 @@ void parse_inclusive_or_expression(parser *parse, value *result) {
   }
 }
 
-void parse_exclusive_or_expression(parser *parse, value *result) {
-  value left, right;
+void parse_exclusive_or_expression(parser *parse, term *result) {
+  term left, right;
 
   parse_and_expression(parse, result);
   left = *result;
@@ -675,7 +905,7 @@ void parse_exclusive_or_expression(parser *parse, value *result) {
     case TOKEN_OP_BIT_XOR:
       get_token(parse);
       parse_and_expression(parse, &right);
-      bit_xor(&left, &right, result);
+      combine(OP_BIT_XOR, &left, &right, result);
       
       left = *result;
       break;
@@ -683,8 +913,8 @@ void parse_exclusive_or_expression(parser *parse, value *result) {
   }
 }
 
-void parse_and_expression(parser *parse, value *result) {
-  value left, right;
+void parse_and_expression(parser *parse, term *result) {
+  term left, right;
 
   parse_equality_expression(parse, result);
   left = *result;
@@ -698,7 +928,7 @@ void parse_and_expression(parser *parse, value *result) {
     case TOKEN_OP_BIT_AND:
       get_token(parse);
       parse_equality_expression(parse, &right);
-      bit_and(&left, &right, result);
+      combine(OP_BIT_AND, &left, &right, result);
       
       left = *result;
       break;
@@ -706,8 +936,8 @@ void parse_and_expression(parser *parse, value *result) {
   }
 }
 
-void parse_equality_expression(parser *parse, value *result) {
-  value left, right;
+void parse_equality_expression(parser *parse, term *result) {
+  term left, right;
 
   parse_relational_expression(parse, result);
   left = *result;
@@ -722,7 +952,7 @@ void parse_equality_expression(parser *parse, value *result) {
     case TOKEN_OP_EQUAL:
       get_token(parse);
       parse_relational_expression(parse, &right);
-      equal(&left, &right, result);
+      combine(OP_EQUAL, &left, &right, result);
       
       left = *result;
       break;
@@ -730,7 +960,7 @@ void parse_equality_expression(parser *parse, value *result) {
     case TOKEN_OP_NOT_EQUAL:
       get_token(parse);
       parse_relational_expression(parse, &right);
-      not_equal(&left, &right, result);
+      combine(OP_NOT_EQUAL, &left, &right, result);
       
       left = *result;
       break;
@@ -738,8 +968,8 @@ void parse_equality_expression(parser *parse, value *result) {
   }
 }
 
-void parse_relational_expression(parser *parse, value *result) {
-  value left, right;
+void parse_relational_expression(parser *parse, term *result) {
+  term left, right;
 
   parse_shift_expression(parse, result);
   left = *result;
@@ -754,7 +984,7 @@ void parse_relational_expression(parser *parse, value *result) {
     case TOKEN_OP_LESS_THAN:
       get_token(parse);
       parse_shift_expression(parse, &right);
-      less_than(&left, &right, result);
+      combine(OP_LESS_THAN, &left, &right, result);
       
       left = *result;
       break;
@@ -762,7 +992,7 @@ void parse_relational_expression(parser *parse, value *result) {
     case TOKEN_OP_LESS_THAN_EQ:
       get_token(parse);
       parse_shift_expression(parse, &right);
-      less_than_eq(&left, &right, result);
+      combine(OP_LESS_THAN_EQ, &left, &right, result);
       
       left = *result;
       break;
@@ -770,7 +1000,7 @@ void parse_relational_expression(parser *parse, value *result) {
     case TOKEN_OP_GREATER_THAN:
       get_token(parse);
       parse_shift_expression(parse, &right);
-      greater_than(&left, &right, result);
+      combine(OP_GREATER_THAN, &left, &right, result);
       
       left = *result;
       break;
@@ -778,7 +1008,7 @@ void parse_relational_expression(parser *parse, value *result) {
     case TOKEN_OP_GREATER_THAN_EQ:
       get_token(parse);
       parse_shift_expression(parse, &right);
-      greater_than_eq(&left, &right, result);
+      combine(OP_GREATER_THAN_EQ, &left, &right, result);
       
       left = *result;
       break;
@@ -786,8 +1016,8 @@ void parse_relational_expression(parser *parse, value *result) {
   }
 }
 
-void parse_shift_expression(parser *parse, value *result) {
-  value left, right;
+void parse_shift_expression(parser *parse, term *result) {
+  term left, right;
 
   parse_additive_expression(parse, result);
   left = *result;
@@ -802,7 +1032,7 @@ void parse_shift_expression(parser *parse, value *result) {
     case TOKEN_OP_BIT_SHIFT_LEFT:
       get_token(parse);
       parse_additive_expression(parse, &right);
-      bit_shift_left(&left, &right, result);
+      combine(OP_BIT_SHIFT_LEFT, &left, &right, result);
       
       left = *result;
       break;
@@ -810,7 +1040,7 @@ void parse_shift_expression(parser *parse, value *result) {
     case TOKEN_OP_BIT_SHIFT_RIGHT:
       get_token(parse);
       parse_additive_expression(parse, &right);
-      bit_shift_right(&left, &right, result);
+      combine(OP_BIT_SHIFT_RIGHT, &left, &right, result);
       
       left = *result;
       break;
@@ -818,8 +1048,8 @@ void parse_shift_expression(parser *parse, value *result) {
   }
 }
 
-void parse_additive_expression(parser *parse, value *result) {
-  value left, right;
+void parse_additive_expression(parser *parse, term *result) {
+  term left, right;
   
   parse_multiplicative_expression(parse, result);
   left = *result;
@@ -834,7 +1064,7 @@ void parse_additive_expression(parser *parse, value *result) {
     case TOKEN_OP_PLUS:
       get_token(parse);
       parse_multiplicative_expression(parse, &right);
-      add(&left, &right, result);
+      combine(OP_ADD, &left, &right, result);
       
       left = *result;
       break;
@@ -842,7 +1072,7 @@ void parse_additive_expression(parser *parse, value *result) {
     case TOKEN_OP_MINUS:
       get_token(parse);
       parse_multiplicative_expression(parse, &right);
-      subtract(&left, &right, result);
+      combine(OP_SUBTRACT, &left, &right, result);
       
       left = *result;
       break;
@@ -850,8 +1080,8 @@ void parse_additive_expression(parser *parse, value *result) {
   }
 }
 
-void parse_multiplicative_expression(parser *parse, value *result) {
-  value left, right;
+void parse_multiplicative_expression(parser *parse, term *result) {
+  term left, right;
 
   parse_unary_expression(parse, result);
   left = *result;
@@ -866,7 +1096,7 @@ void parse_multiplicative_expression(parser *parse, value *result) {
     case TOKEN_OP_TIMES:
       get_token(parse);
       parse_unary_expression(parse, &right);
-      multiply(&left, &right, result);
+      combine(OP_MULTIPLY, &left, &right, result);
       
       left = *result;
       break;
@@ -874,7 +1104,7 @@ void parse_multiplicative_expression(parser *parse, value *result) {
     case TOKEN_OP_DIVIDE:
       get_token(parse);
       parse_unary_expression(parse, &right);
-      divide(&left, &right, result);
+      combine(OP_DIVIDE, &left, &right, result);
       
       left = *result;
       break;
@@ -882,7 +1112,7 @@ void parse_multiplicative_expression(parser *parse, value *result) {
     case TOKEN_OP_IDIVIDE:
       get_token(parse);
       parse_unary_expression(parse, &right);
-      int_divide(&left, &right, result);
+      combine(OP_INT_DIVIDE, &left, &right, result);
 
       left = *result;
       break;
@@ -890,7 +1120,7 @@ void parse_multiplicative_expression(parser *parse, value *result) {
     case TOKEN_OP_MOD:
       get_token(parse);
       parse_unary_expression(parse, &right);
-      modulo(&left, &right, result);
+      combine(OP_MODULO, &left, &right, result);
       
       left = *result;
       break;
@@ -898,8 +1128,8 @@ void parse_multiplicative_expression(parser *parse, value *result) {
   }
 }
 
-void parse_unary_expression(parser *parse, value *result) {
-  value operand;
+void parse_unary_expression(parser *parse, term *result) {
+  term operand;
 
   switch (peek_token(parse)) {
   default:
@@ -914,25 +1144,25 @@ void parse_unary_expression(parser *parse, value *result) {
   case TOKEN_OP_MINUS:
     get_token(parse);
     parse_unary_expression(parse, &operand);
-    negate(&operand, result);
+    combine(OP_NEGATE, NULL, &operand, result);
     break;
 
   case TOKEN_OP_BIT_NOT:
     get_token(parse);
     parse_unary_expression(parse, &operand);
-    bit_not(&operand, result);
+    combine(OP_BIT_NOT, NULL, &operand, result);
     break;
 
   case TOKEN_OP_NOT:
     get_token(parse);
     parse_unary_expression(parse, &operand);
-    not(&operand, result);
+    combine(OP_NOT, NULL, &operand, result);
     break;
   }
 }
 
-void parse_exponential_expression(parser *parse, value *result) {
-  value left, right;
+void parse_exponential_expression(parser *parse, term *result) {
+  term left, right;
 
   parse_primary(parse, result);
   left = *result;
@@ -946,7 +1176,7 @@ void parse_exponential_expression(parser *parse, value *result) {
     case TOKEN_OP_POW:
       get_token(parse);
       parse_unary_expression(parse, &right);
-      power(&left, &right, result);
+      combine(OP_POWER, &left, &right, result);
       
       left = *result;
       break;
@@ -954,7 +1184,7 @@ void parse_exponential_expression(parser *parse, value *result) {
   }
 }
 
-void parse_primary(parser *parse, value *result) {
+void parse_primary(parser *parse, term *result) {
   get_token(parse);
 
   switch (parse->cur_token) {
@@ -970,7 +1200,7 @@ void parse_primary(parser *parse, value *result) {
     //is this a function or a constant?
     if (peek_token(parse) == TOKEN_LEFT_PAREN) {      
       int argc = 0;
-      value argv[MAX_ARGUMENTS];
+      term argv[MAX_ARGUMENTS];
       char id[MAX_IDENTIFIER_LENGTH + 1];
 
       strncpy(id, parse->str_value, MAX_IDENTIFIER_LENGTH + 1);
@@ -1007,15 +1237,60 @@ void parse_primary(parser *parse, value *result) {
       if (parse->cur_token != TOKEN_RIGHT_PAREN)
 	raise_error(ERROR_EXPR, "unmatched parenthesis '('");
 
-      //call the function
-      call_function(id, result, argc, argv, parse->program_opts->degrees);
-    } else {    
-      get_constant(parse->str_value, result);
+      //call the function now if we can, otherwise compile the call
+      bool constant = !parse->compiling
+        || (parse->folding && is_pure_function(id));
+      for (int i = 0; i < argc; i++)
+        constant = constant && !argv[i].node;
+
+      if (constant) {
+        value args[MAX_ARGUMENTS];
+        for (int i = 0; i < argc; i++)
+          args[i] = argv[i].val;
+
+        call_function(id, &result->val, argc, args,
+                      parse->program_opts->degrees);
+        result->node = NULL;
+      } else {
+        expr_node *node = new_node(NODE_FUNCTION);
+        strcpy(node->id, id);
+        node->argc = argc;
+        for (int i = 0; i < argc; i++)
+          node->args[i] = term_node(&argv[i]);
+
+        result->node = node;
+      }
+    } else {
+      result->node = NULL;
+
+      //bound variables hide constants of the same name
+      for (int i = 0; i < parse->num_vars; i++) {
+        if (parse->var_names[i] && !strcmp(parse->var_names[i],
+                                           parse->str_value)) {
+          result->node = new_node(NODE_VARIABLE);
+          result->node->index = i;
+          break;
+        }
+      }
+
+      if (!result->node) {
+        get_constant(parse->str_value, &result->val);
+        if (!parse->folding)
+          term_node(result);
+      }
     }
     break;
 
   case TOKEN_LITERAL:
-    *result = parse->numeric_value;
+    result->val = parse->numeric_value;
+    result->node = NULL;
+    if (!parse->folding)
+      term_node(result);
+    break;
+
+  case TOKEN_VARIABLE:
+    result->node = new_node(NODE_VARIABLE);
+    result->node->index = value_get_int(&parse->numeric_value) - 1;
     break;
 
   case TOKEN_LEFT_PAREN:
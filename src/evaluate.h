@@ -22,9 +22,17 @@
 #ifndef CCALC_EVALUATE_H
 #define CCALC_EVALUATE_H
 
+#include "compile.h"
 #include "options.h"
 #include "value.h"
 
+bool is_whitespace(char c);
 void evaluate(char *expr, value *result, options *opts);
+expr_node *compile_expression(char *expr, options *opts,
+                              char *var_names[], int num_vars);
+expr_node *parse_unfolded(char *expr, options *opts, char *var_names[],
+                          int num_vars);
+int normalize_expression(char *expr, options *opts, char *normal, int size,
+                         value params[], int max_params);
 
 #endif
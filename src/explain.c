@@ -0,0 +1,397 @@
+/* ccalc -- evaluate C-style expressions from the command line.
+   Copyright (C) 2015-2017 Gregory Kikola.
+
+   This file is part of ccalc.
+
+   ccalc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   ccalc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with ccalc.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Written by Gregory Kikola <gkikola@gmail.com>. */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "compile.h"
+#include "dag.h"
+#include "error.h"
+#include "evaluate.h"
+#include "explain.h"
+
+//types a node can have, as a set: an expression like 7 / $1 may give
+//either, depending on its operands
+#define TYPE_INT 1
+#define TYPE_FLOAT 2
+#define TYPE_EITHER (TYPE_INT | TYPE_FLOAT)
+
+//every call goes through call_function(), which looks the name up
+#define CALL_COST 5
+
+#define LABEL_SIZE 256
+
+typedef enum {
+  RESULT_FLOAT,
+  RESULT_INT,
+  RESULT_SAME, //the type of its argument
+  RESULT_ROUNDED, //an int if the result fits in one
+  RESULT_ARITHMETIC, //like +: an int if every argument is
+  RESULT_POWER, //like **
+  RESULT_REMAINDER,
+} result_rule;
+
+//Rough cost of each builtin relative to an integer addition, for
+//comparing formulations of a formula rather than predicting time.
+typedef struct {
+  char *name;
+  int cost;
+  result_rule rule;
+} builtin;
+
+static builtin builtins[] = {
+  { "pow", 20, RESULT_POWER },
+  { "powmod", 30, RESULT_INT },
+  { "sqrt", 4, RESULT_FLOAT },
+  { "cbrt", 20, RESULT_FLOAT },
+  { "abs", 1, RESULT_SAME },
+  { "floor", 2, RESULT_ROUNDED },
+  { "ceil", 2, RESULT_ROUNDED },
+  { "trunc", 2, RESULT_ROUNDED },
+  { "round", 2, RESULT_ROUNDED },
+  { "sin", 15, RESULT_FLOAT },
+  { "cos", 15, RESULT_FLOAT },
+  { "tan", 20, RESULT_FLOAT },
+  { "asin", 20, RESULT_FLOAT },
+  { "acos", 20, RESULT_FLOAT },
+  { "atan", 15, RESULT_FLOAT },
+  { "atan2", 25, RESULT_FLOAT },
+  { "exp", 10, RESULT_FLOAT },
+  { "exp2", 20, RESULT_POWER },
+  { "log", 10, RESULT_FLOAT },
+  { "log10", 12, RESULT_FLOAT },
+  { "log2", 10, RESULT_FLOAT },
+  { "rand", 10, RESULT_INT },
+  { "hypot", 10, RESULT_FLOAT },
+  { "expm1", 12, RESULT_FLOAT },
+  { "log1p", 12, RESULT_FLOAT },
+  { "sinh", 20, RESULT_FLOAT },
+  { "cosh", 20, RESULT_FLOAT },
+  { "tanh", 20, RESULT_FLOAT },
+  { "asinh", 25, RESULT_FLOAT },
+  { "acosh", 25, RESULT_FLOAT },
+  { "atanh", 25, RESULT_FLOAT },
+  { "erf", 15, RESULT_FLOAT },
+  { "erfc", 15, RESULT_FLOAT },
+  { "lgamma", 40, RESULT_FLOAT },
+  { "tgamma", 40, RESULT_FLOAT },
+  { "factorial", 40, RESULT_ROUNDED },
+  { "binomial", 40, RESULT_ROUNDED },
+  { "fmod", 10, RESULT_ARITHMETIC },
+  { "remainder", 10, RESULT_REMAINDER },
+  { "nextafter", 3, RESULT_FLOAT },
+  { "max", 1, RESULT_ARITHMETIC },
+  { "min", 1, RESULT_ARITHMETIC },
+};
+
+//a node of a tree with its type and cost worked out
+typedef struct annotated {
+  expr_node *node;
+  int type;
+  int cost; //of this node alone
+  int total; //including its operands
+  int argc;
+  struct annotated *args[MAX_ARGUMENTS];
+} annotated;
+
+builtin *find_builtin(char *name);
+int node_cost(node_type type, operator_type op, char *id);
+int node_type_of(node_type type, operator_type op, char *id, value *val,
+                 int argc, int arg_types[]);
+int arithmetic_type(int left, int right);
+char *type_name(int type);
+
+annotated *annotate(expr_node *node);
+void free_annotated(annotated *a);
+void print_tree(FILE *stream, annotated *a, int depth);
+int print_plan(FILE *stream, expr_dag *dag);
+void instruction_text(char *text, int size, dag_node *node, int index);
+
+void explain(FILE *stream, char *expr, options *opts, char *var_names[],
+             int num_vars) {
+  int size = 4 * strlen(expr) + 16;
+  char *tokens = malloc(size);
+  if (!tokens)
+    raise_error(ERROR_SYS, "memory allocation failure");
+
+  //the parser reports any error in the expression here, before anything
+  //has been printed
+  normalize_expression(expr, opts, tokens, size, NULL, 0);
+  expr_node *parsed = parse_unfolded(expr, opts, var_names, num_vars);
+  expr_node *folded = compile_expression(expr, opts, var_names,
+                                         num_vars);
+
+  fprintf(stream, "tokens: %s\n", tokens);
+
+  annotated *a = annotate(parsed);
+  int parsed_cost = a->total;
+  fprintf(stream, "%-40s %-9s %6s\n", "parsed:", "type", "cost");
+  print_tree(stream, a, 1);
+  free_annotated(a);
+
+  a = annotate(folded);
+  int folded_cost = a->total;
+  fprintf(stream, "%-40s %-9s %6s\n", "folded:", "type", "cost");
+  print_tree(stream, a, 1);
+  free_annotated(a);
+
+  //common subexpressions are merged by building a DAG, as --batch does
+  expr_dag *dag = new_dag();
+  dag_add_tree(dag, folded, NULL, 0);
+  fprintf(stream, "%-40s %-9s %6s\n", "plan:", "type", "cost");
+  int plan_cost = print_plan(stream, dag);
+  fprintf(stream, "%d instructions for %ld nodes; estimated cost %d parsed, "
+          "%d folded, %d planned\n", dag->num_nodes, dag->total_nodes,
+          parsed_cost, folded_cost, plan_cost);
+
+  free_dag(dag);
+  free_node(folded);
+  free_node(parsed);
+  free(tokens);
+}
+
+builtin *find_builtin(char *name) {
+  for (int i = 0; i < (int)(sizeof(builtins) / sizeof(builtin)); i++) {
+    if (!strcmp(builtins[i].name, name))
+      return &builtins[i];
+  }
+  return NULL;
+}
+
+int node_cost(node_type type, operator_type op, char *id) {
+  builtin *b;
+
+  switch (type) {
+  case NODE_OPERATOR:
+    switch (op) {
+    case OP_COMMA:
+      return 0;
+    case OP_DIVIDE:
+    case OP_INT_DIVIDE:
+    case OP_MODULO:
+      return 4;
+    case OP_POWER:
+      return 20;
+    default:
+      return 1;
+    }
+  case NODE_CONDITIONAL:
+    return 1;
+  case NODE_FUNCTION:
+    b = find_builtin(id);
+    return CALL_COST + (b ? b->cost : 0);
+  default:
+    return 0;
+  }
+}
+
+//follows the promotion rules in value.c
+int node_type_of(node_type type, operator_type op, char *id, value *val,
+                 int argc, int arg_types[]) {
+  builtin *b;
+
+  switch (type) {
+  case NODE_CONSTANT:
+    return (val->type != FLOAT && val->type != BIGFLOAT) ? TYPE_INT
+      : TYPE_FLOAT;
+  case NODE_VARIABLE: //a column may hold either
+    return TYPE_EITHER;
+  case NODE_CONDITIONAL:
+    return arg_types[1] | arg_types[2];
+  case NODE_OPERATOR:
+    switch (op) {
+    case OP_COMMA:
+      return arg_types[1];
+    case OP_ADD:
+    case OP_SUBTRACT:
+    case OP_MULTIPLY:
+      return arithmetic_type(arg_types[0], arg_types[1]);
+    case OP_NEGATE:
+      return arg_types[0];
+    case OP_DIVIDE: //an int only when it divides evenly
+    case OP_POWER: //a float for a negative exponent
+      return arg_types[0] == TYPE_FLOAT || arg_types[1] == TYPE_FLOAT
+        ? TYPE_FLOAT : TYPE_EITHER;
+    default: //comparisons, logic and bitwise operators
+      return TYPE_INT;
+    }
+  case NODE_FUNCTION:
+    b = find_builtin(id);
+    if (!b || argc == 0)
+      return b && b->rule == RESULT_INT ? TYPE_INT : TYPE_EITHER;
+
+    switch (b->rule) {
+    case RESULT_FLOAT:
+      return TYPE_FLOAT;
+    case RESULT_INT:
+      return TYPE_INT;
+    case RESULT_SAME:
+      return arg_types[0];
+    case RESULT_ROUNDED:
+      return arg_types[0] == TYPE_INT ? TYPE_INT : TYPE_EITHER;
+    case RESULT_ARITHMETIC:
+      return argc < 2 ? TYPE_EITHER
+        : arithmetic_type(arg_types[0], arg_types[1]);
+    case RESULT_POWER:
+      for (int i = 0; i < argc; i++) {
+        if (arg_types[i] == TYPE_FLOAT)
+          return TYPE_FLOAT;
+      }
+      return TYPE_EITHER;
+    case RESULT_REMAINDER:
+      return argc == 2 && (arg_types[0] & arg_types[1] & TYPE_INT)
+        ? TYPE_EITHER : TYPE_FLOAT;
+    }
+  }
+  return TYPE_EITHER;
+}
+
+int arithmetic_type(int left, int right) {
+  if (left == TYPE_FLOAT || right == TYPE_FLOAT)
+    return TYPE_FLOAT;
+  if (left == TYPE_INT && right == TYPE_INT)
+    return TYPE_INT;
+  return TYPE_EITHER;
+}
+
+char *type_name(int type) {
+  switch (type) {
+  case TYPE_INT:
+    return "int";
+  case TYPE_FLOAT:
+    return "float";
+  default:
+    return "int|float";
+  }
+}
+
+annotated *annotate(expr_node *node) {
+  annotated *a = malloc(sizeof(annotated));
+  if (!a)
+    raise_error(ERROR_SYS, "memory allocation failure");
+
+  int arg_types[MAX_ARGUMENTS];
+  a->node = node;
+  a->argc = node->argc;
+  a->cost = node_cost(node->type, node->op, node->id);
+  a->total = a->cost;
+  for (int i = 0; i < node->argc; i++) {
+    a->args[i] = annotate(node->args[i]);
+    arg_types[i] = a->args[i]->type;
+    a->total += a->args[i]->total;
+  }
+
+  a->type = node_type_of(node->type, node->op, node->id, &node->val,
+                         node->argc, arg_types);
+  return a;
+}
+
+void free_annotated(annotated *a) {
+  for (int i = 0; i < a->argc; i++)
+    free_annotated(a->args[i]);
+  free(a);
+}
+
+void print_tree(FILE *stream, annotated *a, int depth) {
+  char label[LABEL_SIZE];
+  int indent = 2 * depth;
+
+  node_label(label, sizeof(label), a->node, NULL);
+  fprintf(stream, "%*s%-*s %-9s %6d\n", indent, "",
+          40 - indent > 0 ? 40 - indent : 0, label, type_name(a->type),
+          a->total);
+
+  for (int i = 0; i < a->argc; i++)
+    print_tree(stream, a->args[i], depth + 1);
+}
+
+//prints the DAG as one instruction per node, operands first, and returns
+//the total cost
+int print_plan(FILE *stream, expr_dag *dag) {
+  int *types = malloc((dag->num_nodes + 1) * sizeof(int));
+  int total = 0;
+  if (!types)
+    raise_error(ERROR_SYS, "memory allocation failure");
+
+  for (int i = 0; i < dag->num_nodes; i++) {
+    dag_node *node = &dag->nodes[i];
+    char text[LABEL_SIZE];
+    int arg_types[MAX_ARGUMENTS];
+
+    for (int j = 0; j < node->argc; j++)
+      arg_types[j] = types[node->args[j]];
+    types[i] = node_type_of(node->type, node->op, node->id, &node->val,
+                            node->argc, arg_types);
+
+    int cost = node_cost(node->type, node->op, node->id);
+    total += cost;
+
+    instruction_text(text, sizeof(text), node, i);
+    fprintf(stream, "  %-38s %-9s %6d\n", text, type_name(types[i]), cost);
+  }
+
+  free(types);
+  return total;
+}
+
+void instruction_text(char *text, int size, dag_node *node, int index) {
+  int length = snprintf(text, size, "%%%d = ", index);
+
+  switch (node->type) {
+  case NODE_CONSTANT:
+    if (node->val.type == INT)
+      snprintf(text + length, size - length, "%ld", node->val.data.ivalue);
+    else if (node->val.type == WIDE)
+      wide_to_string(value_get_wide(&node->val), text + length,
+                     size - length);
+    else if (node->val.type == BIG)
+      big_to_string(node->val.data.bvalue, text + length, size - length);
+    else if (node->val.type == BIGFLOAT)
+      bigfloat_to_string(node->val.data.bfvalue, text + length,
+                         size - length);
+    else
+      snprintf(text + length, size - length, "%g", node->val.data.fvalue);
+    break;
+  case NODE_VARIABLE:
+    snprintf(text + length, size - length, "$%d", node->index + 1);
+    break;
+  case NODE_OPERATOR:
+    if (node->argc == 1)
+      snprintf(text + length, size - length, "%s%%%d",
+               operator_symbol(node->op), node->args[0]);
+    else
+      snprintf(text + length, size - length, "%%%d %s %%%d", node->args[0],
+               operator_symbol(node->op), node->args[1]);
+    break;
+  case NODE_CONDITIONAL:
+    snprintf(text + length, size - length, "%%%d ? %%%d : %%%d",
+             node->args[0], node->args[1], node->args[2]);
+    break;
+  case NODE_FUNCTION:
+    length += snprintf(text + length, size - length, "%s(", node->id);
+    for (int i = 0; i < node->argc && length < size; i++)
+      length += snprintf(text + length, size - length, "%s%%%d",
+                         i ? ", " : "", node->args[i]);
+    if (length < size)
+      snprintf(text + length, size - length, ")");
+    break;
+  }
+}
@@ -0,0 +1,108 @@
+/* ccalc -- evaluate C-style expressions from the command line.
+   Copyright (C) 2015-2017 Gregory Kikola.
+
+   This file is part of ccalc.
+
+   ccalc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   ccalc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with ccalc.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Written by Gregory Kikola <gkikola@gmail.com>. */
+
+#include <string.h>
+
+#include "histogram.h"
+
+#define BAR_WIDTH 40
+
+int bucket_index(uint64_t value);
+uint64_t bucket_high(int index);
+
+void histogram_init(histogram *h) {
+  memset(h, 0, sizeof(histogram));
+  h->min = UINT64_MAX;
+}
+
+void histogram_add(histogram *h, uint64_t value) {
+  h->counts[bucket_index(value)]++;
+  h->total++;
+  h->sum += value;
+  if (value < h->min)
+    h->min = value;
+  if (value > h->max)
+    h->max = value;
+}
+
+uint64_t histogram_percentile(histogram *h, double percent) {
+  long rank = (long)(percent / 100.0 * h->total + 0.5);
+  if (rank < 1)
+    rank = 1;
+
+  long seen = 0;
+  for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+    seen += h->counts[i];
+    if (seen >= rank) { //every value in the bucket counts as its highest
+      uint64_t high = bucket_high(i);
+      return high < h->max ? high : h->max;
+    }
+  }
+  return h->max;
+}
+
+void print_histogram(FILE *stream, histogram *h, char *unit) {
+  //one row for each power of two that has anything in it
+  long most = 0;
+  long rows[64] = { 0 };
+  for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+    if (!h->counts[i])
+      continue;
+    int row = 63 - __builtin_clzll(bucket_high(i) | 1);
+    rows[row] += h->counts[i];
+    if (rows[row] > most)
+      most = rows[row];
+  }
+
+  for (int row = 0; row < 64; row++) {
+    if (!rows[row])
+      continue;
+
+    char range[64];
+    uint64_t low = row ? (uint64_t)1 << row : 0;
+    uint64_t high = ((uint64_t)2 << row) - 1;
+    snprintf(range, sizeof(range), "%llu-%llu %s", (unsigned long long)low,
+             (unsigned long long)high, unit);
+
+    int width = (int)((double)rows[row] / most * BAR_WIDTH + 0.5);
+    fprintf(stream, "  %28s %10ld ", range, rows[row]);
+    for (int i = 0; i < width; i++)
+      fputc('#', stream);
+    fputc('\n', stream);
+  }
+}
+
+int bucket_index(uint64_t value) {
+  //the highest HISTOGRAM_SUB_BITS + 1 bits pick the bucket; below
+  //2 * HISTOGRAM_SUB_BUCKETS each value has a bucket of its own
+  int top = value ? 63 - __builtin_clzll(value) : 0;
+  int shift = top > HISTOGRAM_SUB_BITS ? top - HISTOGRAM_SUB_BITS : 0;
+  return shift * HISTOGRAM_SUB_BUCKETS + (int)(value >> shift);
+}
+
+uint64_t bucket_high(int index) {
+  if (index < 2 * HISTOGRAM_SUB_BUCKETS)
+    return index;
+
+  int shift = index / HISTOGRAM_SUB_BUCKETS - 1;
+  uint64_t mantissa = index - shift * HISTOGRAM_SUB_BUCKETS;
+  return ((mantissa + 1) << shift) - 1;
+}
@@ -0,0 +1,47 @@
+/* ccalc -- evaluate C-style expressions from the command line.
+   Copyright (C) 2015-2017 Gregory Kikola.
+
+   This file is part of ccalc.
+
+   ccalc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   ccalc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with ccalc.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Written by Gregory Kikola <gkikola@gmail.com>. */
+
+#ifndef CCALC_HISTOGRAM_H
+#define CCALC_HISTOGRAM_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+//Every power of two is split into 2^HISTOGRAM_SUB_BITS buckets, so a value
+//is recorded to within about 3% however large it is.
+#define HISTOGRAM_SUB_BITS 5
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_BUCKETS ((65 - HISTOGRAM_SUB_BITS) * HISTOGRAM_SUB_BUCKETS)
+
+typedef struct {
+  long counts[HISTOGRAM_BUCKETS];
+  long total;
+  uint64_t min;
+  uint64_t max;
+  double sum;
+} histogram;
+
+void histogram_init(histogram *h);
+void histogram_add(histogram *h, uint64_t value);
+uint64_t histogram_percentile(histogram *h, double percent);
+void print_histogram(FILE *stream, histogram *h, char *unit);
+
+#endif
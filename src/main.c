@@ -19,30 +19,53 @@
 
 /* Written by Gregory Kikola <gkikola@gmail.com>. */
 
+#include <errno.h>
 #include <math.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
 
 #include <sys/time.h>
 #include <unistd.h>
 
+#include "arena.h"
+#include "cache.h"
+#include "columns.h"
+#include "daemon.h"
+#include "dag.h"
 #include "error.h"
 #include "evaluate.h"
+#include "explain.h"
+#include "memo.h"
 #include "options.h"
+#include "output.h"
+#include "plan.h"
+#include "profile.h"
+#include "repeat.h"
+#include "stats.h"
 #include "value.h"
 
 #define BUFFER_SIZE 128
+#define ARENA_CHUNK_SIZE 4096
+#define SHORT_EXPRESSION_SIZE 256
+#define MAX_DIGITS 1000000
 
-void process_expression(char *expression, options *opts);
+//what process_expression() keeps from one expression to the next
+typedef struct {
+  options *opts;
+  arena *mem;
+  memo_cache *memo;
+  plan_cache *plans;
+  cache_file *cache;
+} line_context;
+
+void process_expression(char *expression, line_context *ctx);
 
-void print_value(value *val, options *opts);
-void print_int(long value, int base, bool uppercase);
 void print_version();
 
-ssize_t readline(char **lineptr, size_t *n, FILE *stream);
+ssize_t readline(char **lineptr, size_t *n, arena *mem, FILE *stream);
 
 int main(int argc, char *argv[]) {
   //parse program arguments
@@ -51,7 +74,13 @@ int main(int argc, char *argv[]) {
 
   read_options(argc, argv, &expr_index, &opts);
 
-  if (opts.show_help) { //help text was shown, now exit
+  if (opts.show_help) { //show help text, now exit
+    print_help();
+    return 0;
+  }
+
+  if (opts.show_usage) {
+    print_usage();
     return 0;
   }
   
@@ -62,9 +91,73 @@ int main(int argc, char *argv[]) {
 
   if (opts.precision < 0)
     raise_error(ERROR_EXPR, "precision cannot be less than 0");
+  if (opts.plan_cache_size < 0)
+    raise_error(ERROR_EXPR, "plan cache size cannot be less than 0");
+  if (opts.repeat < 0)
+    raise_error(ERROR_EXPR, "repeat count cannot be less than 0");
+  if (opts.memo_size < 0)
+    raise_error(ERROR_EXPR, "memo size cannot be less than 0");
+  if (opts.cache_size <= 0)
+    raise_error(ERROR_EXPR, "cache size must be greater than 0");
+  if (opts.show_cache_stats && !opts.cache_file)
+    raise_error(ERROR_EXPR, "--cache-stats requires --cache");
+  if (opts.digits < 0)
+    raise_error(ERROR_EXPR, "digits cannot be less than 0");
+  if (opts.digits > MAX_DIGITS)
+    raise_error(ERROR_EXPR, "digits cannot be more than %d", MAX_DIGITS);
+  if (opts.digits && (opts.batch || opts.column_separator || opts.cache_file
+                      || opts.daemon_socket || opts.connect_socket))
+    raise_error(ERROR_EXPR, "--digits cannot be used with --batch, --columns,"
+                " --cache, --daemon or --connect");
+  if (opts.bigint && (opts.batch || opts.column_separator || opts.cache_file
+                      || opts.daemon_socket || opts.connect_socket))
+    raise_error(ERROR_EXPR, "--bigint cannot be used with --batch, --columns,"
+                " --cache, --daemon or --connect");
+
+  //memory for the current line, reclaimed all at once before the next;
+  //it outlives main() so that --stats can report on it at exit. The
+  //128-bit integers made while evaluating a line live here too.
+  static arena line_arena;
+  arena_init(&line_arena, ARENA_CHUNK_SIZE);
+  set_wide_arena(&line_arena);
+
+  //integers past 128 bits are kept with the rest of the line, and so are
+  //floats with --digits, which needs big integers anyway
+  if (opts.digits)
+    opts.bigint = true;
+  if (opts.bigint)
+    enable_bigints(&line_arena);
+  if (opts.digits)
+    enable_bigfloats(opts.digits);
+
+  if (opts.show_stats) {
+    stats.mem = &line_arena;
+    start_stats();
+    atexit(print_stats);
+  }
+
+  if (opts.profile) {
+    start_profile();
+    atexit(print_profile);
+  }
+
+  if (opts.daemon_socket) { //serve requests until we are told to stop
+    run_daemon(opts.daemon_socket);
+    return 0;
+  }
+
+  line_context ctx = { &opts, &line_arena, NULL, NULL, NULL };
+
+  //results shared with other ccalc processes through a file
+  if (opts.cache_file) {
+    ctx.cache = open_cache(opts.cache_file, opts.cache_size);
 
-  //seed RNG
-  srand(time(NULL));
+    if (opts.show_cache_stats) {
+      print_cache_stats(stdout, ctx.cache);
+      close_cache(ctx.cache);
+      return 0;
+    }
+  }
   
   char *expression = NULL;
   int expr_length = 0;
@@ -74,198 +167,160 @@ int main(int argc, char *argv[]) {
     expr_length += strlen(argv[i]);
   }
 
-  if (expr_length > 0) { //copy expression string
-    expression = malloc(expr_length + 1);
-
-    if (!expression)
-      raise_error(ERROR_EXPR, "memory allocation error");
-
-    expression[0] = '\0';
-
-    for (int i = expr_index; i < argc; i++) {
-      strcat(expression, argv[i]);
+  if (expr_length > 0) {
+    //Most of the time ccalc is started for a single expression, so startup
+    //is most of what it costs. An expression in one argument is used where
+    //it is, and a short one split across arguments is joined on the stack.
+    char short_expression[SHORT_EXPRESSION_SIZE];
+    if (argc - expr_index == 1) {
+      expression = argv[expr_index];
+    } else {
+      if (expr_length < SHORT_EXPRESSION_SIZE)
+        expression = short_expression;
+      else
+        expression = arena_alloc(&line_arena, expr_length + 1);
+      expression[0] = '\0';
+
+      for (int i = expr_index; i < argc; i++) {
+        strcat(expression, argv[i]);
+      }
     }
 
-    process_expression(expression, &opts);
+    int status = SUCCESS;
+    if (opts.connect_socket) {
+      status = run_client(opts.connect_socket, expression, &opts);
+    } else if (opts.column_separator) {
+      run_columns(expression, &opts);
+    } else {
+      //a buffer of our own spares stdio from allocating one and from
+      //checking what stdout is connected to
+      static char output_buffer[BUFSIZ];
+      setvbuf(stdout, output_buffer, _IOFBF, sizeof(output_buffer));
+      process_expression(expression, &ctx);
+      fflush(stdout); //before anything printed at exit
+    }
 
-    if (expression)
-      free(expression);
+    close_cache(ctx.cache);
+    arena_free(&line_arena);
+    return status;
+  } else if (opts.column_separator) {
+    raise_error(ERROR_EXPR, "an expression is required with --columns");
+  } else if (opts.connect_socket) { //let the daemon evaluate each line
+    return run_client(opts.connect_socket, NULL, &opts);
+  } else if (opts.batch) { //read every line, then evaluate them together
+    run_batch(&opts);
   } else { //no expression given, read from standard input
     bool done = false;
     size_t n;
 
+    //repeated lines reuse their result, and lines of the same shape share
+    //one compiled plan; neither may keep a --bigint value past its line
+    if (opts.memo_size > 0 && !opts.bigint)
+      ctx.memo = new_memo_cache(opts.memo_size);
+    stats.memo = ctx.memo;
+
+    if (opts.plan_cache_size > 0 && !opts.bigint)
+      ctx.plans = new_plan_cache(opts.plan_cache_size);
+    stats.plans = ctx.plans;
+
     while (!done) {
       expression = NULL;
       n = 0;
-      expr_length = readline(&expression, &n, stdin);
+      phase previous = profile_switch(PHASE_IO);
+      expr_length = readline(&expression, &n, &line_arena, stdin);
+      profile_switch(previous);
 
       if (expr_length > 0) //we have something to evaluate
-	process_expression(expression, &opts);
+	process_expression(expression, &ctx);
       else //reached eof
 	done = true;
 
-      if (expression)
-	free(expression);
+      arena_reset(&line_arena);
+    }
+
+    if (!opts.show_stats) { //otherwise --stats reports on them at exit
+      free_memo_cache(ctx.memo);
+      free_plan_cache(ctx.plans);
     }
   }
 
+  close_cache(ctx.cache);
+  arena_free(&line_arena);
   return 0;
 }
 
-void process_expression(char *expression, options *opts) {
+void process_expression(char *expression, line_context *ctx) {
+  options *opts = ctx->opts;
   value result_value;
   struct timeval tv_start, tv_end;
   value_set_int(&result_value, 0);
+  stats.lines++;
 
-  if (opts->show_time)
-    gettimeofday(&tv_start, NULL);
-  
-  evaluate(expression, &result_value, opts);
+  if (opts->explain)
+    explain(stdout, expression, opts, NULL, 0);
 
   if (opts->show_time)
-    gettimeofday(&tv_end, NULL);
+    gettimeofday(&tv_start, NULL);
 
-  //print the calculated value
-  print_value(&result_value, opts);
+  uint64_t start = stats.enabled ? read_clock() : 0;
+  phase previous = profile_switch(PHASE_EVALUATE);
   
-  //show the elapsed time if requested
-  if (opts->show_time) {
-    int sec = 0, usec = 0;
-
-    sec = tv_end.tv_sec - tv_start.tv_sec;
-    if (tv_end.tv_usec < tv_start.tv_usec) {
-      --sec;
-      usec = 1000000 - (tv_start.tv_usec - tv_end.tv_usec);
-    } else {
-      usec = tv_end.tv_usec - tv_start.tv_usec;
-    }
-
-    printf(" (time: %d.%06d seconds)", sec, usec);
+  //expressions that call rand() get no key and are always evaluated
+  char *key = NULL;
+  if (ctx->memo || ctx->cache)
+    key = memo_key(expression, opts, ctx->mem);
+
+  bool found = false;
+  if (key && ctx->memo)
+    found = memo_lookup(ctx->memo, key, &result_value);
+
+  if (key && ctx->cache && !found) {
+    found = cache_lookup(ctx->cache, key, &result_value);
+    if (found && ctx->memo)
+      memo_store(ctx->memo, key, &result_value);
   }
 
-  printf("\n");
-}
-
-void print_value(value *val, options *opts) {
-  if (opts->boolean) { // -- boolean value --
-    bool result;
-
-    if (val->type == INT)
-      result = value_get_int(val);
+  if (!found) {
+    if (opts->profile)
+      evaluate_profiled(expression, &result_value, opts, ctx->plans, ctx->mem);
+    else if (ctx->plans)
+      evaluate_planned(ctx->plans, expression, &result_value, opts, ctx->mem);
     else
-      result = value_get_float(val);
-
-    if (opts->uppercase)
-      printf("%s", result ? "TRUE" : "FALSE");
-    else
-      printf("%s", result ? "true" : "false");
-  } else if (val->type == INT) { // -- integer value --
-    long svalue = value_get_int(val);
-    unsigned long uvalue;
-
-    if (opts->radix <= 1)
-      raise_error(ERROR_EXPR, "radix cannot be less than 2");
-
-    if (svalue < 0) { //negative number, need to print minus sign
-      printf("-");
-      uvalue = -svalue;
-    } else {
-      uvalue = svalue;
-    }
-
-    if (uvalue == 0) {
-      printf("0");
-    } else {
-      int num_digits = floor(log(uvalue) / log(opts->radix)) + 2;
-      int *digit_str = malloc(num_digits * sizeof(int));
-      int place = num_digits - 1;
+      evaluate(expression, &result_value, opts);
 
-      if (!digit_str)
-	raise_error(ERROR_SYS, "memory allocation failed");
-
-      //compute digits
-      while (place >= 0) {
-	digit_str[place--] = uvalue % opts->radix;
-	uvalue /= opts->radix;
-      }
-
-      //find first nonzero digit
-      int start = 0;
-      while (start < num_digits && digit_str[start] == 0)
-	start++;
-      
-      //print each digit
-      for (int i = start; i < num_digits; i++) {
-	//print spacer
-	if (i > start) {
-	  if (opts->grouping > 0 && (num_digits - i) % opts->grouping == 0) {
-	    printf(" ");
-
-	    if (opts->radix > 16)
-	      printf(": ");
-	  } else if (opts->radix > 16)
-	    printf(":");
-	}
-      
-	int cur_digit = digit_str[i];
-
-	if (opts->radix <= 16 && cur_digit >= 10) {
-	  if (opts->uppercase)
-	    printf("%c", 'A' + (cur_digit - 10));
-	  else
-	    printf("%c", 'a' + (cur_digit - 10));
-	} else {
-	  printf("%d", cur_digit);
-	}
-      }
+    if (key && ctx->memo)
+      memo_store(ctx->memo, key, &result_value);
+    if (key && ctx->cache)
+      cache_store(ctx->cache, key, &result_value);
+  }
 
-      free(digit_str);
-    }
-  } else { // -- floating-point value --
-    double value = value_get_float(val);
-    bool sci_not = false;
+  profile_switch(previous);
+  uint64_t latency = stats.enabled ? read_clock() - start : 0;
 
-    if (value < 0) { //print minus sign for negative number
-      printf("-");
-      value = -value;
-    }
+  if (opts->show_time)
+    gettimeofday(&tv_end, NULL);
 
-    if (opts->sci_notation || (value > 0 && value < 1.e-6) || value >= 1.e9)
-      sci_not = true;
+  if (opts->profile) { //formatting and writing are timed apart
+    print_profiled(stdout, &result_value, opts,
+                   opts->show_time ? &tv_start : NULL, &tv_end);
+  } else {
+    //print the calculated value
+    print_value(stdout, &result_value, opts);
+  
+    //show the elapsed time if requested
+    if (opts->show_time)
+      print_elapsed(stdout, &tv_start, &tv_end);
 
-    int max_len = abs(floor(log10(value + 1))) + opts->precision + 12;
-    char flt_str[max_len];
+    printf("\n");
+  }
 
-    if (sci_not)
-      snprintf(flt_str, max_len, "%.*e", opts->precision, value);
-    else
-      snprintf(flt_str, max_len, "%.*f", opts->precision, value);
-
-    int str_len = strlen(flt_str);
-    
-    //determine location of decimal point
-    int dec_pos = 0;
-    while (dec_pos < str_len && flt_str[dec_pos] != '.')
-      dec_pos++;
-
-    //print the string
-    bool in_exponent = false;
-    for (int i = 0; i < str_len; i++) {
-      if (flt_str[i] == 'E' || flt_str[i] == 'e')
-	in_exponent = true;
-      
-      //print spacers
-      if (!in_exponent && opts->grouping > 0) {
-	if (i > 0 && i < dec_pos && (dec_pos - i) % opts->grouping == 0)
-	  printf(" ");
-	else if (i > dec_pos + 1 && (i - dec_pos - 1) % opts->grouping == 0)
-	  printf(" ");
-      }
+  record_line(expression, latency);
 
-      //print digit from number string
-      printf("%c", flt_str[i]);
-    }
-  }
+  //one sample says little about a fast expression, so take many
+  if (opts->repeat > 0)
+    time_repeated(stdout, expression, opts);
+  if (opts->profile_expr)
+    profile_tree(stdout, expression, opts);
 }
 
 void print_version() {
@@ -281,8 +336,9 @@ Written by Gregory Kikola <gkikola@gmail.com>.\n");
 }
 
 //readline function based on GNU getline
-//we're avoiding getline in order to maintain portability
-ssize_t readline(char **lineptr, size_t *n, FILE *stream) {
+//we're avoiding getline in order to maintain portability; the line is
+//allocated from mem and lasts until the arena is reset
+ssize_t readline(char **lineptr, size_t *n, arena *mem, FILE *stream) {
   if (lineptr == NULL || n == NULL) {
     raise_error(ERROR_SYS, "unexpected NULL pointer");
     return -1;
@@ -291,40 +347,34 @@ ssize_t readline(char **lineptr, size_t *n, FILE *stream) {
   //allocate initial memory if necessary
   if (*lineptr == NULL || *n == 0) {
     *n = BUFFER_SIZE;
-    *lineptr = (char *)malloc(*n);
-    if (*lineptr == NULL) {
-      raise_error(ERROR_SYS, "memory allocation failure");
-      return -1;
-    }
+    *lineptr = arena_alloc(mem, *n);
   }
 
   if (feof(stream) || ferror(stream))
     return -1;
 
-  char buffer[BUFFER_SIZE];
   ssize_t read = 0;
   for (;;) {
-    if (!fgets(buffer, BUFFER_SIZE, stream))
-      return read;
-
-    int length = strlen(buffer);
-    
-    if (length <= 0)
-      return read;
-    else if (buffer[length - 1] == '\n') {
-      buffer[length - 1] == '\0';
-      --length;
+    int c = getc(stream);
+    if (c == EOF) {
+      //--stats reports on SIGUSR1 while we wait for a line, too
+      if (ferror(stream) && errno == EINTR) {
+	clearerr(stream);
+	check_stats();
+	continue;
+      }
+      break;
+    } else if (c == '\n') {
+      break;
     }
 
-    strcpy(*lineptr + read, buffer);
-    read += length;
-
-    if (length + 1 < BUFFER_SIZE) {
-      return read;
+    if (read + 1 >= (ssize_t)*n) {
+      *lineptr = arena_grow(mem, *lineptr, *n, *n * 2);
+      *n *= 2;
     }
-
-    *lineptr = (char *)realloc(*lineptr, read + BUFFER_SIZE);
+    (*lineptr)[read++] = c;
   }
 
+  (*lineptr)[read] = '\0';
   return read;
 }
@@ -0,0 +1,161 @@
+/* ccalc -- evaluate C-style expressions from the command line.
+   Copyright (C) 2015-2017 Gregory Kikola.
+
+   This file is part of ccalc.
+
+   ccalc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   ccalc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with ccalc.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Written by Gregory Kikola <gkikola@gmail.com>. */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "compile.h"
+#include "error.h"
+#include "evaluate.h"
+#include "memo.h"
+#include "plan.h"
+
+bool is_word_char(char c);
+bool calls_impure_function(char *key);
+
+memo_cache *new_memo_cache(int capacity) {
+  memo_cache *memo = malloc(sizeof(memo_cache));
+  if (!memo)
+    raise_error(ERROR_SYS, "memory allocation failure");
+
+  //probing wraps around with a mask
+  memo->capacity = 1;
+  while (memo->capacity < capacity)
+    memo->capacity *= 2;
+
+  memo->entries = calloc(memo->capacity, sizeof(memo_entry));
+  if (!memo->entries)
+    raise_error(ERROR_SYS, "memory allocation failure");
+
+  memo->size = 0;
+  memo->hits = 0;
+  memo->misses = 0;
+  return memo;
+}
+
+void free_memo_cache(memo_cache *memo) {
+  if (!memo)
+    return;
+
+  free(memo->entries);
+  free(memo);
+}
+
+char *memo_key(char *expr, options *opts, arena *mem) {
+  //the options that change the value go in front of the expression
+  char *key = arena_alloc(mem, strlen(expr) + 2);
+  int length = 0;
+  key[length++] = 'a' + opts->caret_exp + 2 * opts->degrees;
+
+  //Drop whitespace wherever that cannot join two tokens into one: a
+  //space stays between two word characters, between two operator
+  //characters, and between an e and a sign, which could make an exponent.
+  bool space = false;
+  for (char *c = expr; *c; c++) {
+    if (is_whitespace(*c)) {
+      space = true;
+      continue;
+    }
+
+    char last = key[length - 1];
+    if (space && length > 1
+        && (is_word_char(*c) == is_word_char(last)
+            || ((*c == '+' || *c == '-') && (last == 'e' || last == 'E'))))
+      key[length++] = ' ';
+    key[length++] = *c;
+    space = false;
+  }
+  key[length] = '\0';
+
+  if (length >= MEMO_KEY_SIZE || calls_impure_function(key + 1))
+    return NULL;
+  return key;
+}
+
+bool memo_lookup(memo_cache *memo, char *key, value *result) {
+  unsigned long hash = hash_key(key);
+
+  for (int i = 0; i < MEMO_PROBES; i++) {
+    memo_entry *entry = &memo->entries[(hash + i) & (memo->capacity - 1)];
+    if (!entry->hash) //nothing is stored past an empty entry
+      break;
+
+    if (entry->hash == hash && !strcmp(entry->key, key)) {
+      *result = entry->result;
+      memo->hits++;
+      return true;
+    }
+  }
+
+  memo->misses++;
+  return false;
+}
+
+void memo_store(memo_cache *memo, char *key, value *result) {
+  unsigned long hash = hash_key(key);
+
+  memo_entry *entry = NULL;
+  for (int i = 0; i < MEMO_PROBES && !entry; i++) {
+    memo_entry *probe = &memo->entries[(hash + i) & (memo->capacity - 1)];
+    if (!probe->hash)
+      entry = probe;
+  }
+
+  if (entry)
+    memo->size++;
+  else //no room nearby, so give up the home slot
+    entry = &memo->entries[hash & (memo->capacity - 1)];
+
+  entry->hash = hash;
+  entry->result = *result;
+  value_keep_wide(&entry->result, &entry->wide);
+  strcpy(entry->key, key);
+}
+
+bool is_word_char(char c) {
+  return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z')
+    || (c >= '0' && c <= '9') || c == '_' || c == '.';
+}
+
+bool calls_impure_function(char *key) {
+  char identifier[MAX_IDENTIFIER_LENGTH + 1];
+
+  for (char *c = key; *c; ) {
+    if (!is_word_char(*c)) {
+      c++;
+      continue;
+    }
+
+    //numbers are words too, but only identifiers can name a function
+    bool is_identifier = !(*c >= '0' && *c <= '9') && *c != '.';
+    int length = 0;
+    for (; is_word_char(*c); c++) {
+      if (length < MAX_IDENTIFIER_LENGTH)
+        identifier[length++] = *c;
+    }
+    identifier[length] = '\0';
+
+    if (is_identifier && !is_pure_function(identifier))
+      return true;
+  }
+  return false;
+}
@@ -0,0 +1,64 @@
+/* ccalc -- evaluate C-style expressions from the command line.
+   Copyright (C) 2015-2017 Gregory Kikola.
+
+   This file is part of ccalc.
+
+   ccalc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   ccalc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with ccalc.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Written by Gregory Kikola <gkikola@gmail.com>. */
+
+#ifndef CCALC_MEMO_H
+#define CCALC_MEMO_H
+
+#include <stdbool.h>
+
+#include "arena.h"
+#include "options.h"
+#include "value.h"
+
+#define DEFAULT_MEMO_SIZE 4096
+#define MEMO_KEY_SIZE 112
+#define MEMO_PROBES 8
+
+//A remembered result. Keys are stored in the entry itself so the table
+//never allocates after it is created; longer expressions are not
+//remembered at all.
+typedef struct {
+  unsigned long hash; //zero while the entry is empty
+  value result;
+  wide_int wide; //where a WIDE result is kept
+  char key[MEMO_KEY_SIZE];
+} memo_entry;
+
+//Results of whole expressions, in an open-addressing table of fixed
+//size. A new result takes the first free entry near its home slot, or
+//replaces the entry in its home slot once that whole stretch is taken.
+typedef struct {
+  memo_entry *entries;
+  int capacity;
+  int size;
+
+  long hits;
+  long misses;
+} memo_cache;
+
+memo_cache *new_memo_cache(int capacity);
+void free_memo_cache(memo_cache *memo);
+
+char *memo_key(char *expr, options *opts, arena *mem);
+bool memo_lookup(memo_cache *memo, char *key, value *result);
+void memo_store(memo_cache *memo, char *key, value *result);
+
+#endif
@@ -0,0 +1,103 @@
+/* ccalc -- evaluate C-style expressions from the command line.
+   Copyright (C) 2015-2017 Gregory Kikola.
+
+   This file is part of ccalc.
+
+   ccalc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   ccalc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with ccalc.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Written by Gregory Kikola <gkikola@gmail.com>. */
+
+#ifndef CCALC_NANBOX_H
+#define CCALC_NANBOX_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+//An 8-byte value, half the size of the tagged value struct, for arrays
+//of values on the hot path.
+//
+//Doubles are stored as themselves, with every NaN replaced by the
+//single canonical NaN BOX_NAN. That leaves the other NaN bit patterns
+//free to carry integers:
+//
+//  sign, exponent and quiet bit set (BOX_INT_TAG): a 51-bit integer in
+//  two's complement, covering [BOX_INT_MIN, BOX_INT_MAX] without any
+//  extra storage;
+//
+//  positive quiet NaN with bit 50 set (BOX_BIG_TAG): an index into a
+//  side table of values kept by the owner of the array, for the rare
+//  integers that need all 64 bits or more.
+typedef uint64_t boxed_value;
+
+#define BOX_NAN 0x7ff8000000000000
+#define BOX_INT_TAG 0xfff8000000000000
+#define BOX_BIG_TAG 0x7ffc000000000000
+#define BOX_BIG_MASK 0xfffc000000000000
+#define BOX_INT_PAYLOAD 0x0007ffffffffffff
+#define BOX_BIG_PAYLOAD 0x0003ffffffffffff
+
+#define BOX_INT_MIN (-(1L << 50))
+#define BOX_INT_MAX ((1L << 50) - 1)
+
+static inline bool box_is_int(boxed_value box) {
+  return (box & BOX_INT_TAG) == BOX_INT_TAG;
+}
+
+static inline bool box_is_big(boxed_value box) {
+  return (box & BOX_BIG_MASK) == BOX_BIG_TAG;
+}
+
+static inline bool box_is_float(boxed_value box) {
+  return !box_is_int(box) && !box_is_big(box);
+}
+
+static inline bool box_fits_int(long int ivalue) {
+  return ivalue >= BOX_INT_MIN && ivalue <= BOX_INT_MAX;
+}
+
+static inline boxed_value box_int(long int ivalue) {
+  return BOX_INT_TAG | ((uint64_t)ivalue & BOX_INT_PAYLOAD);
+}
+
+static inline long int unbox_int(boxed_value box) {
+  //shift the payload's sign bit up to the top and back to extend it
+  return (int64_t)(box << 13) >> 13;
+}
+
+static inline boxed_value box_big(long int index) {
+  return BOX_BIG_TAG | (uint64_t)index;
+}
+
+static inline long int unbox_big(boxed_value box) {
+  return box & BOX_BIG_PAYLOAD;
+}
+
+static inline boxed_value box_float(double fvalue) {
+  boxed_value box;
+
+  if (fvalue != fvalue)
+    return BOX_NAN;
+  memcpy(&box, &fvalue, sizeof(box));
+  return box;
+}
+
+static inline double unbox_float(boxed_value box) {
+  double fvalue;
+  memcpy(&fvalue, &box, sizeof(fvalue));
+  return fvalue;
+}
+
+#endif
@@ -24,32 +24,56 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "cache.h"
 #include "error.h"
+#include "memo.h"
 #include "options.h"
-
-void print_usage();
-void print_help();
+#include "plan.h"
 
 void read_options(int argc, char *argv[], int *expr_index, options *opts) {
   //set default options
   opts->radix = 10;
   opts->precision = 6;
   opts->grouping = -1;
+  opts->plan_cache_size = DEFAULT_PLAN_CACHE_SIZE;
+  opts->memo_size = DEFAULT_MEMO_SIZE;
+  opts->cache_size = DEFAULT_CACHE_SIZE;
+  opts->repeat = 0;
+  opts->digits = 0;
+  opts->batch = false;
+  opts->bigint = false;
   opts->boolean = false;
   opts->caret_exp = false;
   opts->degrees = false;
   opts->sci_notation = false;
+  opts->profile = false;
+  opts->explain = false;
   opts->show_time = false;
+  opts->show_stats = false;
+  opts->show_cache_stats = false;
   opts->show_help = false;
+  opts->show_usage = false;
   opts->show_version = false;
   opts->uppercase = false;
+  opts->use_ring = false;
+  opts->column_separator = '\0';
+  opts->profile_expr = '\0';
+  opts->daemon_socket = NULL;
+  opts->connect_socket = NULL;
+  opts->cache_file = NULL;
 
   int i;
+  char *column_format = NULL;
+  char *profile_format = NULL;
   bool read_argument = false;
   int *arg = &opts->radix;
+  char **str_arg = NULL;
   for (i = 1; i < argc; ++i) {
     if (read_argument) {
-      *arg = atoi(argv[i]);
+      if (str_arg)
+        *str_arg = argv[i];
+      else
+        *arg = atoi(argv[i]);
       read_argument = false;
       continue;
     }
@@ -61,40 +85,83 @@ void read_options(int argc, char *argv[], int *expr_index, options *opts) {
     if (c == '-') { //'--': long option
       //extract option name
       int arg_length = strlen(argv[i]);
-      char* option = malloc(arg_length + 1);
-      if (!option)
-        raise_error(ERROR_SYS, "memory allocation error");
+      char option[arg_length + 1];
       strcpy(option, argv[i]);
       
       char* eq = strchr(option, '=');      
       if (eq)
         *eq = '\0';
       int opt_length = strlen(option);
+      str_arg = NULL;
       
       if (!strcmp(argv[i], "--")) { //end of options
         ++i;
         break;
+      } else if (!strcmp(option, "--batch")) {
+        opts->batch = true;
+      } else if (!strcmp(option, "--bigint")) {
+        opts->bigint = true;
       } else if (!strcmp(option, "--binary")) {
         opts->radix = 2;
       } else if (!strcmp(option, "--bool")) {
         opts->boolean = true;
+      } else if (!strcmp(option, "--cache")) {
+        read_argument = true;
+        str_arg = &opts->cache_file;
+      } else if (!strcmp(option, "--cache-size")) {
+        read_argument = true;
+        arg = &opts->cache_size;
+      } else if (!strcmp(option, "--cache-stats")) {
+        opts->show_cache_stats = true;
       } else if (!strcmp(option, "--caret-exp")) {
         opts->caret_exp = true;
+      } else if (!strcmp(option, "--columns")) {
+        read_argument = true;
+        str_arg = &column_format;
+      } else if (!strcmp(option, "--connect")) {
+        read_argument = true;
+        str_arg = &opts->connect_socket;
+      } else if (!strcmp(option, "--daemon")) {
+        read_argument = true;
+        str_arg = &opts->daemon_socket;
       } else if (!strcmp(option, "--degrees")) {
         opts->degrees = true;
+      } else if (!strcmp(option, "--digits")) {
+        read_argument = true;
+        arg = &opts->digits;
+      } else if (!strcmp(option, "--explain")) {
+        opts->explain = true;
       } else if (!strcmp(option, "--grouping")) {
         read_argument = true;
         arg = &opts->grouping;
+      } else if (!strcmp(option, "--memo")) {
+        read_argument = true;
+        arg = &opts->memo_size;
       } else if (!strcmp(option, "--octal")) {
         opts->radix = 8;
+      } else if (!strcmp(option, "--plan-cache")) {
+        read_argument = true;
+        arg = &opts->plan_cache_size;
       } else if (!strcmp(option, "--precision")) {
         read_argument = true;
         arg = &opts->precision;
+      } else if (!strcmp(option, "--profile")) {
+        opts->profile = true;
+      } else if (!strcmp(option, "--profile-expr")) {
+        read_argument = true;
+        str_arg = &profile_format;
       } else if (!strcmp(option, "--radix")) {
         read_argument = true;
         arg = &opts->radix;
+      } else if (!strcmp(option, "--repeat")) {
+        read_argument = true;
+        arg = &opts->repeat;
+      } else if (!strcmp(option, "--ring")) {
+        opts->use_ring = true;
       } else if (!strcmp(option, "--scientific-notation")) {
         opts->sci_notation = true;
+      } else if (!strcmp(option, "--stats")) {
+        opts->show_stats = true;
       } else if (!strcmp(option, "--time")) {
         opts->show_time = true;
       } else if (!strcmp(option, "--uppercase")) {
@@ -102,12 +169,10 @@ void read_options(int argc, char *argv[], int *expr_index, options *opts) {
       } else if (!strcmp(option, "--hexadecimal")) {
         opts->radix = 16;
       } else if (!strcmp(option, "--help")) {
-        print_help();
         opts->show_help = true;
         return;
       } else if (!strcmp(option, "--usage")) {
-        print_usage();
-        opts->show_help = true;
+        opts->show_usage = true;
         return;
       } else if (!strcmp(option, "--version")) {
         opts->show_version = true;
@@ -126,16 +191,18 @@ void read_options(int argc, char *argv[], int *expr_index, options *opts) {
             raise_error(ERROR_SYS, "expected argument for option '%s'",
                         option);
           
-          *arg = atoi(val);
+          if (str_arg)
+            *str_arg = val;
+          else
+            *arg = atoi(val);
           read_argument = false;
         }
       }
-
-      free(option);
     } else if (!isalpha(c) && c != '?' && c != '=') { //not an option
       break;
     } else { //short options
       int length = strlen(argv[i]);
+      str_arg = NULL;
       for (int pos = 1; pos < length; ++pos) {
         switch (argv[i][pos]) {
         case 'b':
@@ -175,7 +242,6 @@ void read_options(int argc, char *argv[], int *expr_index, options *opts) {
           opts->radix = 16;
           break;
         case '?':
-          print_help();
           opts->show_help = true;
           return;
         case '=':
@@ -203,8 +269,29 @@ void read_options(int argc, char *argv[], int *expr_index, options *opts) {
     } //end else
   }
 
+  if (read_argument && str_arg)
+    raise_error(ERROR_SYS, "expected argument for option '%s'", argv[i - 1]);
+
   *expr_index = i;
 
+  if (column_format) {
+    if (!strcmp(column_format, "csv"))
+      opts->column_separator = ',';
+    else if (!strcmp(column_format, "tsv"))
+      opts->column_separator = '\t';
+    else
+      raise_error(ERROR_SYS, "unknown column format '%s'", column_format);
+  }
+
+  if (profile_format) {
+    if (!strcmp(profile_format, "tree"))
+      opts->profile_expr = 't';
+    else if (!strcmp(profile_format, "folded"))
+      opts->profile_expr = 'f';
+    else
+      raise_error(ERROR_SYS, "unknown profile format '%s'", profile_format);
+  }
+
   //set default grouping if user didn't specify otherwise
   if (opts->grouping < 0) {
     switch (opts->radix) {
@@ -222,13 +309,29 @@ void read_options(int argc, char *argv[], int *expr_index, options *opts) {
   }
 }
 
+int format_options(char *buffer, int size, options *opts) {
+  //write options back out in a form read_options will accept
+  return snprintf(buffer, size, "-r %d -p %d -g %d%s%s%s%s%s%s",
+                  opts->radix, opts->precision, opts->grouping,
+                  opts->boolean ? " --bool" : "",
+                  opts->caret_exp ? " -c" : "",
+                  opts->degrees ? " -d" : "",
+                  opts->sci_notation ? " -s" : "",
+                  opts->show_time ? " -t" : "",
+                  opts->uppercase ? " -u" : "");
+}
+
 void print_usage() {
   printf("\
-Usage: ccalc [-bcdostux?] [-g DIGITS] [-p DIGITS] [-r RADIX] [--binary]\n\
-            [--bool] [--caret-exp] [--degrees] [--grouping=DIGITS] [--octal]\n\
-            [--precision=DIGITS] [--radix=RADIX] [--scientific-notation]\n\
-            [--time] [--uppercase] [--hexadecimal] [--help] [--usage]\n\
-            [--version] EXPRESSION\n");
+Usage: ccalc [-bcdostux?] [-g DIGITS] [-p DIGITS] [-r RADIX] [--batch]\n\
+            [--bigint] [--binary] [--bool] [--cache=FILE]\n\
+            [--cache-size=ENTRIES] [--cache-stats] [--caret-exp]\n\
+            [--columns=FORMAT] [--connect=SOCKET] [--daemon=SOCKET]\n\
+            [--degrees] [--digits=DIGITS] [--explain] [--grouping=DIGITS]\n\
+            [--memo=SIZE] [--octal] [--plan-cache=SIZE] [--precision=DIGITS]\n\
+            [--profile] [--profile-expr=FORMAT] [--radix=RADIX] [--repeat=N]\n\
+            [--ring] [--scientific-notation] [--stats] [--time] [--uppercase]\n\
+            [--hexadecimal] [--help] [--usage] [--version] EXPRESSION\n");
 }
 
 void print_help() {
@@ -237,21 +340,71 @@ Usage: ccalc [OPTION...] EXPRESSION\n\
 Evaluate the C-style EXPRESSION and display the result. If no expression is\n\
 given, read from standard input.\n\
 \n\
+      --batch                Read every line from standard input first, then\n\
+                             evaluate each distinct subexpression only once\n\
+      --bigint               Keep integer results exact at any size, rather\n\
+                             than moving to floating point past 128 bits\n\
   -b, --binary               Print integer results in binary (base 2)\n\
       --bool                 Interpret the result as a boolean value and\n\
                              print true or false\n\
+      --cache=FILE           Look up and store results of expressions that do\n\
+                             not call rand() in FILE, which any number of\n\
+                             ccalc processes can share\n\
+      --cache-size=ENTRIES   Give a new cache file room for ENTRIES results\n\
+                             (default 16384)\n\
+      --cache-stats          Print the size and hit ratio of the cache file\n\
+                             and exit\n\
   -c, --caret-exp            Use caret ^ for exponentiation rather than for\n\
                              bitwise XOR\n\
+      --columns=FORMAT       Read rows of numbers in FORMAT (csv or tsv) from\n\
+                             standard input and evaluate EXPRESSION once for\n\
+                             each row, with columns bound to header names or\n\
+                             to $1, $2, ...\n\
+      --connect=SOCKET       Send the expression to the ccalc daemon\n\
+                             listening on SOCKET and print its reply\n\
+      --daemon=SOCKET        Serve requests on the Unix domain socket SOCKET\n\
+                             instead of evaluating an expression\n\
   -d, --degrees              Use degrees instead of radians for trigonometric\n\
                              functions\n\
+      --digits=DIGITS        Compute floating-point results to DIGITS\n\
+                             significant digits rather than in double\n\
+                             precision, and print that many; implies --bigint\n\
+      --explain              Before each result, print the tokens, the parsed\n\
+                             and folded trees and the evaluation plan, with\n\
+                             the inferred type and estimated cost of each node\n\
   -g, --grouping=DIGITS      Group each set of DIGITS digits and separate\n\
                              each group with spaces (use 0 for no grouping)\n\
+      --memo=SIZE            When reading from standard input, remember the\n\
+                             results of up to SIZE expressions that do not\n\
+                             call rand() (default 4096, 0 to disable)\n\
   -o, --octal                Print integer results in octal (base 8)\n\
+      --plan-cache=SIZE      When reading from standard input, keep compiled\n\
+                             plans for up to SIZE expression shapes (default\n\
+                             256, 0 to disable)\n\
   -p, --precision=DIGITS     Print floating-point results with DIGITS digits\n\
                              after the decimal point (default 6)\n\
+      --profile              Print the time spent lexing, parsing,\n\
+                             evaluating, formatting and reading and writing,\n\
+                             with hardware counters where permitted, to\n\
+                             standard error on exit\n\
+      --profile-expr=FORMAT  After each result, evaluate the expression\n\
+                             repeatedly and print the time spent in each\n\
+                             node as a tree or as folded stacks for flame\n\
+                             graphs (FORMAT is tree or folded)\n\
   -r, --radix=RADIX          Print integer results in base RADIX\n\
+      --repeat=N             After each result, time N more evaluations and\n\
+                             print the minimum, median, 99th percentile and\n\
+                             mean in nanoseconds for parsing, evaluating and\n\
+                             both at once\n\
+      --ring                 With --connect, exchange requests with the\n\
+                             daemon through shared memory\n\
   -s, --scientific-notation  Always print floating-point results in\n\
                              scientific notation, [-]d.ddde±dd\n\
+      --stats                Print lines evaluated, throughput, a latency\n\
+                             histogram, the slowest lines, errors, memory\n\
+                             allocations, memo and plan cache use and\n\
+                             --batch node counts to standard error on exit\n\
+                             or on SIGUSR1\n\
   -t, --time                 Show how much time the computation took\n\
   -u, --uppercase            Use uppercase rather than lowercase letters for\n\
                              digits in bases greater than 10\n\
@@ -28,16 +28,37 @@ typedef struct {
   int radix;
   int precision;
   int grouping;
+  int plan_cache_size;
+  int memo_size;
+  int cache_size;
+  int repeat;
+  int digits; //significant digits of floats, or 0 for doubles
+  bool batch;
+  bool bigint;
   bool boolean;
   bool caret_exp;
   bool degrees;
+  bool explain;
   bool sci_notation;
+  bool profile;
   bool show_time;
+  bool show_stats;
+  bool show_cache_stats;
   bool show_help;
+  bool show_usage;
   bool show_version;
   bool uppercase;
+  bool use_ring;
+  char column_separator;
+  char profile_expr; //'t' for an annotated tree, 'f' for folded stacks
+  char *daemon_socket;
+  char *connect_socket;
+  char *cache_file;
 } options;
 
 void read_options(int argc, char *argv[], int *expr_index, options *opts);
+int format_options(char *buffer, int size, options *opts);
+void print_usage();
+void print_help();
 
 #endif
@@ -0,0 +1,248 @@
+/* ccalc -- evaluate C-style expressions from the command line.
+   Copyright (C) 2015-2017 Gregory Kikola.
+
+   This file is part of ccalc.
+
+   ccalc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   ccalc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with ccalc.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Written by Gregory Kikola <gkikola@gmail.com>. */
+
+#include <limits.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "error.h"
+#include "output.h"
+
+void print_digits(FILE *stream, int digits[], size_t num_digits,
+                  options *opts);
+void print_bigfloat(FILE *stream, const bigfloat *x, options *opts);
+void print_float_string(FILE *stream, const char *flt_str, options *opts);
+
+void print_value(FILE *stream, value *val, options *opts) {
+  if (opts->boolean) { // -- boolean value --
+    bool result;
+
+    if (val->type == INT)
+      result = value_get_int(val);
+    else if (val->type == BIGFLOAT) //which may be too small for a double
+      result = val->data.bfvalue->mantissa.length != 0;
+    else
+      result = value_get_float(val);
+
+    if (opts->uppercase)
+      fprintf(stream, "%s", result ? "TRUE" : "FALSE");
+    else
+      fprintf(stream, "%s", result ? "true" : "false");
+  } else if (val->type == BIGFLOAT) { // -- float to --digits --
+    print_bigfloat(stream, val->data.bfvalue, opts);
+  } else if (val->type == BIG) { // -- integer of any size --
+    size_t num_digits;
+
+    if (opts->radix <= 1)
+      raise_error(ERROR_EXPR, "radix cannot be less than 2");
+
+    int *digits = big_to_digits(val->data.bvalue, opts->radix, &num_digits);
+    if (val->data.bvalue->negative)
+      putc('-', stream);
+    print_digits(stream, digits, num_digits, opts);
+    free(digits);
+  } else if (val->type != FLOAT) { // -- integer value --
+    wide_int svalue = value_get_wide(val);
+    unsigned __int128 wide_uvalue;
+
+    if (opts->radix <= 1)
+      raise_error(ERROR_EXPR, "radix cannot be less than 2");
+
+    if (svalue < 0) { //negative number, need to print minus sign
+      fprintf(stream, "-");
+      wide_uvalue = -(unsigned __int128)svalue;
+    } else {
+      wide_uvalue = svalue;
+    }
+
+    if (wide_uvalue == 0) {
+      fprintf(stream, "0");
+    } else {
+      //even in binary there is at most one digit per bit
+      int num_digits = floor(log(wide_uvalue) / log(opts->radix)) + 2;
+      int digit_str[CHAR_BIT * sizeof(unsigned __int128) + 2];
+      int place = num_digits - 1;
+
+      //compute digits, dividing in 64 bits once the rest fits
+      while (place >= 0 && wide_uvalue > ULONG_MAX) {
+	digit_str[place--] = wide_uvalue % opts->radix;
+	wide_uvalue /= opts->radix;
+      }
+
+      unsigned long uvalue = wide_uvalue;
+      while (place >= 0) {
+	digit_str[place--] = uvalue % opts->radix;
+	uvalue /= opts->radix;
+      }
+
+      //find first nonzero digit
+      int start = 0;
+      while (start < num_digits && digit_str[start] == 0)
+	start++;
+
+      print_digits(stream, digit_str + start, num_digits - start, opts);
+    }
+  } else { // -- floating-point value --
+    double value = value_get_float(val);
+    bool sci_not = false;
+
+    if (value < 0) { //print minus sign for negative number
+      fprintf(stream, "-");
+      value = -value;
+    }
+
+    if (opts->sci_notation || (value > 0 && value < 1.e-6) || value >= 1.e9)
+      sci_not = true;
+
+    //nan and inf need no room for digits
+    int max_len = opts->precision + 12;
+    if (isfinite(value))
+      max_len += abs(floor(log10(value + 1)));
+    char flt_str[max_len];
+
+    if (sci_not)
+      snprintf(flt_str, max_len, "%.*e", opts->precision, value);
+    else
+      snprintf(flt_str, max_len, "%.*f", opts->precision, value);
+
+    print_float_string(stream, flt_str, opts);
+  }
+}
+
+//A BIGFLOAT with as many significant digits as --digits asked for. Like
+//a double, it is in fixed notation from 1e-6 up to 1e9, as long as the
+//digits reach the decimal point, and otherwise in scientific notation.
+void print_bigfloat(FILE *stream, const bigfloat *x, options *opts) {
+  size_t num_digits = opts->digits;
+  long exp10;
+  int *digits = bf_to_decimal(x, num_digits, &exp10);
+  bool sci_not = opts->sci_notation || exp10 < -6 || exp10 >= 9
+    || exp10 >= (long)num_digits;
+
+  //the digits, the zeros before them, the point and the exponent
+  char *flt_str = malloc(num_digits + 32);
+  if (!flt_str)
+    raise_error(ERROR_SYS, "memory allocation failure");
+
+  int length = 0;
+  if (sci_not) {
+    for (size_t i = 0; i < num_digits; i++) {
+      flt_str[length++] = '0' + digits[i];
+      if (i == 0 && num_digits > 1)
+        flt_str[length++] = '.';
+    }
+    length += sprintf(flt_str + length, "e%+03ld", exp10);
+  } else if (exp10 >= 0) {
+    for (size_t i = 0; i < num_digits; i++) {
+      flt_str[length++] = '0' + digits[i];
+      if ((long)i == exp10 && i < num_digits - 1)
+        flt_str[length++] = '.';
+    }
+  } else {
+    flt_str[length++] = '0';
+    flt_str[length++] = '.';
+    for (long i = -1; i > exp10; i--)
+      flt_str[length++] = '0';
+    for (size_t i = 0; i < num_digits; i++)
+      flt_str[length++] = '0' + digits[i];
+  }
+  flt_str[length] = '\0';
+
+  if (x->mantissa.negative)
+    fprintf(stream, "-");
+  print_float_string(stream, flt_str, opts);
+  free(flt_str);
+  free(digits);
+}
+
+//a formatted float, with spacers between groups of digits on either side
+//of the decimal point
+void print_float_string(FILE *stream, const char *flt_str, options *opts) {
+  int str_len = strlen(flt_str);
+  
+  //determine location of decimal point
+  int dec_pos = 0;
+  while (dec_pos < str_len && flt_str[dec_pos] != '.')
+    dec_pos++;
+
+  //print the string
+  bool in_exponent = false;
+  for (int i = 0; i < str_len; i++) {
+    if (flt_str[i] == 'E' || flt_str[i] == 'e')
+      in_exponent = true;
+    
+    //print spacers
+    if (!in_exponent && opts->grouping > 0) {
+      if (i > 0 && i < dec_pos && (dec_pos - i) % opts->grouping == 0)
+	fprintf(stream, " ");
+      else if (i > dec_pos + 1 && (i - dec_pos - 1) % opts->grouping == 0)
+	fprintf(stream, " ");
+    }
+
+    //print digit from number string
+    fprintf(stream, "%c", flt_str[i]);
+  }
+}
+
+//Digits of an integer, most significant first, with spacers between
+//groups. A radix past 16 has no letters left, so its digits are written
+//in decimal and separated by colons.
+void print_digits(FILE *stream, int digits[], size_t num_digits,
+                  options *opts) {
+  for (size_t i = 0; i < num_digits; i++) {
+    //print spacer
+    if (i > 0) {
+      if (opts->grouping > 0 && (num_digits - i) % opts->grouping == 0) {
+	putc(' ', stream);
+
+	if (opts->radix > 16)
+	  fputs(": ", stream);
+      } else if (opts->radix > 16)
+	putc(':', stream);
+    }
+
+    int cur_digit = digits[i];
+
+    if (opts->radix <= 16 && cur_digit >= 10)
+      putc((opts->uppercase ? 'A' : 'a') + (cur_digit - 10), stream);
+    else if (cur_digit < 10)
+      putc('0' + cur_digit, stream);
+    else
+      fprintf(stream, "%d", cur_digit);
+  }
+}
+
+void print_elapsed(FILE *stream, struct timeval *start, struct timeval *end) {
+  int sec = 0, usec = 0;
+
+  sec = end->tv_sec - start->tv_sec;
+  if (end->tv_usec < start->tv_usec) {
+    --sec;
+    usec = 1000000 - (start->tv_usec - end->tv_usec);
+  } else {
+    usec = end->tv_usec - start->tv_usec;
+  }
+
+  fprintf(stream, " (time: %d.%06d seconds)", sec, usec);
+}
@@ -0,0 +1,198 @@
+/* ccalc -- evaluate C-style expressions from the command line.
+   Copyright (C) 2015-2017 Gregory Kikola.
+
+   This file is part of ccalc.
+
+   ccalc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   ccalc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with ccalc.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Written by Gregory Kikola <gkikola@gmail.com>. */
+
+#include <setjmp.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "error.h"
+#include "evaluate.h"
+#include "plan.h"
+
+plan *find_plan(plan_cache *cache, unsigned long hash, char *template);
+plan *add_plan(plan_cache *cache, unsigned long hash, char *template,
+               options *opts);
+void remove_plan(plan_cache *cache, plan *old);
+void unlink_plan(plan_cache *cache, plan *p);
+void push_plan(plan_cache *cache, plan *p);
+
+plan_cache *new_plan_cache(int capacity) {
+  plan_cache *cache = malloc(sizeof(plan_cache));
+  if (!cache)
+    raise_error(ERROR_SYS, "memory allocation failure");
+
+  //keep the buckets at most half full
+  cache->num_buckets = 1;
+  while (cache->num_buckets < 2 * capacity)
+    cache->num_buckets *= 2;
+
+  cache->buckets = calloc(cache->num_buckets, sizeof(plan *));
+  if (!cache->buckets)
+    raise_error(ERROR_SYS, "memory allocation failure");
+
+  cache->newest = cache->oldest = NULL;
+  cache->size = 0;
+  cache->capacity = capacity;
+  cache->hits = 0;
+  cache->misses = 0;
+  cache->evictions = 0;
+  return cache;
+}
+
+void free_plan_cache(plan_cache *cache) {
+  if (!cache)
+    return;
+
+  while (cache->oldest)
+    remove_plan(cache, cache->oldest);
+  free(cache->buckets);
+  free(cache);
+}
+
+void evaluate_planned(plan_cache *cache, char *expr, value *result,
+                      options *opts, arena *mem) {
+  value params[MAX_PARAMS];
+
+  //a placeholder is never more than four times the size of its literal
+  int size = 4 * strlen(expr) + 16;
+  char *template = arena_alloc(mem, size);
+
+  jmp_buf trap;
+  jmp_buf *prev_trap = error_trap;
+  error_trap = &trap;
+  if (setjmp(trap)) {
+    //let the parser find the first error, just as it would have without
+    //the cache
+    error_trap = prev_trap;
+    evaluate(expr, result, opts);
+    return;
+  }
+
+  int num_params = normalize_expression(expr, opts, template, size, params,
+                                        MAX_PARAMS);
+  if (num_params < 0) { //too many literals to bind
+    error_trap = prev_trap;
+    evaluate(expr, result, opts);
+    return;
+  }
+
+  execute(get_plan(cache, template, opts), params, num_params, opts, result);
+  error_trap = prev_trap;
+}
+
+expr_node *get_plan(plan_cache *cache, char *template, options *opts) {
+  unsigned long hash = hash_key(template);
+  plan *p = find_plan(cache, hash, template);
+  if (p) {
+    cache->hits++;
+  } else {
+    cache->misses++;
+    p = add_plan(cache, hash, template, opts);
+  }
+  return p->tree;
+}
+
+unsigned long hash_key(char *key) {
+  //FNV-1a, never zero so that zero can mark an empty entry
+  unsigned long hash = 14695981039346656037UL;
+  for (char *c = key; *c; c++) {
+    hash ^= (unsigned char)*c;
+    hash *= 1099511628211UL;
+  }
+  return hash ? hash : 1;
+}
+
+plan *find_plan(plan_cache *cache, unsigned long hash, char *template) {
+  plan *p = cache->buckets[hash & (cache->num_buckets - 1)];
+
+  while (p && (p->hash != hash || strcmp(p->template, template)))
+    p = p->next;
+
+  if (p && p != cache->newest) { //mark it as the most recently used
+    unlink_plan(cache, p);
+    push_plan(cache, p);
+  }
+  return p;
+}
+
+plan *add_plan(plan_cache *cache, unsigned long hash, char *template,
+               options *opts) {
+  //compile first, so a template that fails takes no room
+  expr_node *tree = compile_expression(template, opts, NULL, 0);
+
+  if (cache->size == cache->capacity) {
+    remove_plan(cache, cache->oldest);
+    cache->evictions++;
+  }
+
+  plan *p = malloc(sizeof(plan));
+  char *copy = malloc(strlen(template) + 1);
+  if (!p || !copy)
+    raise_error(ERROR_SYS, "memory allocation failure");
+  strcpy(copy, template);
+
+  p->hash = hash;
+  p->template = copy;
+  p->tree = tree;
+
+  int bucket = hash & (cache->num_buckets - 1);
+  p->next = cache->buckets[bucket];
+  cache->buckets[bucket] = p;
+  push_plan(cache, p);
+  cache->size++;
+  return p;
+}
+
+void remove_plan(plan_cache *cache, plan *old) {
+  plan **link = &cache->buckets[old->hash & (cache->num_buckets - 1)];
+  while (*link != old)
+    link = &(*link)->next;
+  *link = old->next;
+
+  unlink_plan(cache, old);
+  cache->size--;
+
+  free_node(old->tree);
+  free(old->template);
+  free(old);
+}
+
+void unlink_plan(plan_cache *cache, plan *p) {
+  if (p->newer)
+    p->newer->older = p->older;
+  else
+    cache->newest = p->older;
+
+  if (p->older)
+    p->older->newer = p->newer;
+  else
+    cache->oldest = p->newer;
+}
+
+void push_plan(plan_cache *cache, plan *p) {
+  p->newer = NULL;
+  p->older = cache->newest;
+  if (cache->newest)
+    cache->newest->newer = p;
+  else
+    cache->oldest = p;
+  cache->newest = p;
+}
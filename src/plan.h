@@ -0,0 +1,68 @@
+/* ccalc -- evaluate C-style expressions from the command line.
+   Copyright (C) 2015-2017 Gregory Kikola.
+
+   This file is part of ccalc.
+
+   ccalc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   ccalc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with ccalc.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Written by Gregory Kikola <gkikola@gmail.com>. */
+
+#ifndef CCALC_PLAN_H
+#define CCALC_PLAN_H
+
+#include "arena.h"
+#include "compile.h"
+#include "options.h"
+#include "value.h"
+
+#define DEFAULT_PLAN_CACHE_SIZE 256
+#define MAX_PARAMS 64
+
+//A plan is an expression compiled with its literals replaced by the
+//parameters $1, $2, ..., so one plan serves every line of the same shape.
+typedef struct plan {
+  unsigned long hash;
+  char *template;
+  expr_node *tree;
+
+  struct plan *next; //next plan in the same bucket
+  struct plan *newer;
+  struct plan *older;
+} plan;
+
+//The cache keeps at most capacity plans and drops the one used least
+//recently to make room for a new shape.
+typedef struct {
+  plan **buckets;
+  int num_buckets;
+  plan *newest;
+  plan *oldest;
+  int size;
+  int capacity;
+
+  long hits;
+  long misses;
+  long evictions;
+} plan_cache;
+
+plan_cache *new_plan_cache(int capacity);
+void free_plan_cache(plan_cache *cache);
+
+void evaluate_planned(plan_cache *cache, char *expr, value *result,
+                      options *opts, arena *mem);
+expr_node *get_plan(plan_cache *cache, char *template, options *opts);
+unsigned long hash_key(char *key);
+
+#endif
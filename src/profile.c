@@ -0,0 +1,506 @@
+/* ccalc -- evaluate C-style expressions from the command line.
+   Copyright (C) 2015-2017 Gregory Kikola.
+
+   This file is part of ccalc.
+
+   ccalc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   ccalc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with ccalc.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Written by Gregory Kikola <gkikola@gmail.com>. */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef HAVE_LINUX_PERF_EVENT_H
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "compile.h"
+#include "error.h"
+#include "evaluate.h"
+#include "output.h"
+#include "profile.h"
+#include "stats.h"
+
+#define FOLDED_STACK_SIZE 4096
+
+run_profile profile;
+
+//what one node of a compiled expression has cost, and how often it ran
+typedef struct node_profile {
+  expr_node *node;
+  long calls;
+  uint64_t nanoseconds; //including its operands
+  int size; //nodes in this subtree, each of which was timed
+  int argc;
+  struct node_profile *args[MAX_ARGUMENTS];
+} node_profile;
+
+//self time summed over every node with the same label
+typedef struct {
+  char label[MAX_IDENTIFIER_LENGTH + 3];
+  double self;
+  long calls;
+} label_total;
+
+static char *phase_names[NUM_PHASES] = {
+  "other", "lex", "parse", "evaluate", "format", "i/o"
+};
+
+void read_counters(uint64_t counts[]);
+void open_counters();
+
+node_profile *new_node_profile(expr_node *node);
+void free_node_profile(node_profile *p);
+void execute_timed(node_profile *p, value vars[], int num_vars, options *opts,
+                   value *result);
+uint64_t clock_overhead();
+double inclusive_time(node_profile *p, uint64_t overhead);
+double self_time(node_profile *p, uint64_t overhead);
+void print_node_tree(FILE *stream, node_profile *p, int depth, double total,
+                     value vars[], uint64_t overhead);
+void print_folded(FILE *stream, node_profile *p, char *stack, int length,
+                  value vars[], uint64_t overhead);
+int add_label_totals(label_total totals[], int count, int max,
+                     node_profile *p, uint64_t overhead);
+int compare_label_totals(const void *a, const void *b);
+
+void start_profile() {
+  memset(&profile, 0, sizeof(run_profile));
+  profile.enabled = true;
+  profile.current = PHASE_OTHER;
+  profile.counter_fd = -1;
+
+  open_counters();
+  profile.last_time = read_clock();
+  read_counters(profile.last_counts);
+}
+
+phase profile_switch(phase next) {
+  if (!profile.enabled || next == profile.current)
+    return next;
+
+  uint64_t now = read_clock();
+  uint64_t counts[NUM_COUNTERS];
+  read_counters(counts);
+
+  phase_totals *totals = &profile.phases[profile.current];
+  totals->nanoseconds += now - profile.last_time;
+  for (int i = 0; i < NUM_COUNTERS; i++)
+    totals->counts[i] += counts[i] - profile.last_counts[i];
+
+  phase previous = profile.current;
+  profile.current = next;
+  profile.phases[next].entries++;
+  profile.last_time = now;
+  memcpy(profile.last_counts, counts, sizeof(counts));
+  return previous;
+}
+
+void print_profile() {
+  profile_switch(PHASE_OTHER); //charge whatever ran last
+  fflush(stdout); //keep the report after any results
+
+  uint64_t total = 0;
+  for (int i = 0; i < NUM_PHASES; i++)
+    total += profile.phases[i].nanoseconds;
+
+  bool counters = profile.counter_fd >= 0;
+  fprintf(stderr, "profile: %ld lines in %.3f ms\n", stats.lines,
+          total / 1e6);
+  fprintf(stderr, "%-9s %8s %14s %10s %6s", "phase", "entries", "time (ns)",
+          "ns/line", "share");
+  if (counters)
+    fprintf(stderr, " %14s %14s %5s %12s %12s", "cycles", "instructions",
+            "IPC", "br-misses", "cache-misses");
+  fprintf(stderr, "\n");
+
+  for (int i = 0; i < NUM_PHASES; i++) {
+    phase_totals *totals = &profile.phases[i];
+    fprintf(stderr, "%-9s %8ld %14llu %10.0f %5.1f%%", phase_names[i],
+            totals->entries, (unsigned long long)totals->nanoseconds,
+            stats.lines ? (double)totals->nanoseconds / stats.lines : 0.0,
+            total ? 100.0 * totals->nanoseconds / total : 0.0);
+
+    if (counters) {
+      uint64_t cycles = totals->counts[COUNTER_CYCLES];
+      uint64_t instructions = totals->counts[COUNTER_INSTRUCTIONS];
+      fprintf(stderr, " %14llu %14llu %5.2f %12llu %12llu",
+              (unsigned long long)cycles, (unsigned long long)instructions,
+              cycles ? (double)instructions / cycles : 0.0,
+              (unsigned long long)totals->counts[COUNTER_BRANCH_MISSES],
+              (unsigned long long)totals->counts[COUNTER_CACHE_MISSES]);
+    }
+    fprintf(stderr, "\n");
+  }
+
+  if (!counters)
+    fprintf(stderr, "hardware counters unavailable: %s\n",
+            strerror(profile.counter_error));
+}
+
+void evaluate_profiled(char *expr, value *result, options *opts,
+                       plan_cache *plans, arena *mem) {
+  value params[MAX_PARAMS];
+  expr_node *volatile tree = NULL; //only if it is not kept in plans
+
+  //a placeholder is never more than four times the size of its literal
+  int size = 4 * strlen(expr) + 16;
+  char *template = arena_alloc(mem, size);
+
+  phase previous = profile_switch(PHASE_LEX);
+
+  jmp_buf trap;
+  jmp_buf *prev_trap = error_trap;
+  error_trap = &trap;
+  if (setjmp(trap)) {
+    //the phases can't be told apart here, but the parser will stop at the
+    //first error just as it would have without --profile
+    error_trap = prev_trap;
+    free_node(tree);
+    profile_switch(PHASE_EVALUATE);
+    evaluate(expr, result, opts);
+    profile_switch(previous);
+    return;
+  }
+
+  //lex the whole line up front, taking its literals out as parameters, so
+  //that parsing and evaluating can each be timed on their own
+  int num_params = normalize_expression(expr, opts, template, size, params,
+                                        MAX_PARAMS);
+  if (num_params < 0) //too many literals to bind, so evaluate it whole
+    longjmp(trap, 1);
+
+  profile_switch(PHASE_PARSE);
+  expr_node *plan;
+  if (plans)
+    plan = get_plan(plans, template, opts);
+  else
+    plan = tree = compile_expression(template, opts, NULL, 0);
+
+  profile_switch(PHASE_EVALUATE);
+  execute(plan, params, num_params, opts, result);
+
+  error_trap = prev_trap;
+  free_node(tree);
+  profile_switch(previous);
+}
+
+void print_profiled(FILE *stream, value *val, options *opts,
+                    struct timeval *start, struct timeval *end) {
+  static FILE *buffer = NULL;
+  static char *text;
+  static size_t size;
+
+  //format into memory and write it out separately, so each is timed
+  //on its own
+  phase previous = profile_switch(PHASE_FORMAT);
+  if (!buffer && !(buffer = open_memstream(&text, &size)))
+    raise_error(ERROR_SYS, "memory allocation failure");
+
+  rewind(buffer);
+  print_value(buffer, val, opts);
+  if (start)
+    print_elapsed(buffer, start, end);
+  fputc('\n', buffer);
+  fflush(buffer);
+  long length = ftell(buffer);
+
+  profile_switch(PHASE_IO);
+  fwrite(text, 1, length, stream);
+  profile_switch(previous);
+}
+
+void profile_tree(FILE *stream, char *expr, options *opts) {
+  value params[MAX_PARAMS];
+
+  //time the tree that is left once the literals are taken out, since
+  //folding them would leave nothing to attribute
+  int size = 4 * strlen(expr) + 16;
+  char *template = malloc(size);
+  if (!template)
+    raise_error(ERROR_SYS, "memory allocation failure");
+
+  int num_params = normalize_expression(expr, opts, template, size, params,
+                                        MAX_PARAMS);
+  if (num_params < 0) { //too many literals, so profile it as written
+    strcpy(template, expr);
+    num_params = 0;
+  }
+
+  expr_node *tree = compile_expression(template, opts, NULL, 0);
+  node_profile *root = new_node_profile(tree);
+
+  value result;
+  uint64_t start = read_clock();
+  long evaluations = 0;
+  do {
+    execute_timed(root, params, num_params, opts, &result);
+    evaluations++;
+  } while (read_clock() - start < PROFILE_TREE_NS);
+
+  uint64_t overhead = clock_overhead();
+  double total = inclusive_time(root, overhead);
+
+  if (opts->profile_expr == 'f') { //folded stacks, for flame graphs
+    char stack[FOLDED_STACK_SIZE];
+    print_folded(stream, root, stack, 0, params, overhead);
+  } else {
+    fprintf(stream, "%ld evaluations, %.1f ns each\n", evaluations,
+            total / evaluations);
+    fprintf(stream, "%10s %10s %7s %12s  %s\n", "total ns", "self ns",
+            "share", "calls", "node");
+    print_node_tree(stream, root, 0, total, params, overhead);
+
+    label_total totals[64];
+    int count = add_label_totals(totals, 0, 64, root, overhead);
+    qsort(totals, count, sizeof(label_total), compare_label_totals);
+
+    fprintf(stream, "%10s %7s %12s  %s\n", "self ns", "share", "calls",
+            "function or operator");
+    for (int i = 0; i < count; i++)
+      fprintf(stream, "%10.1f %6.1f%% %12ld  %s\n",
+              totals[i].self / evaluations,
+              total > 0 ? 100.0 * totals[i].self / total : 0.0,
+              totals[i].calls, totals[i].label);
+  }
+
+  free_node_profile(root);
+  free_node(tree);
+  free(template);
+}
+
+node_profile *new_node_profile(expr_node *node) {
+  node_profile *p = malloc(sizeof(node_profile));
+  if (!p)
+    raise_error(ERROR_SYS, "memory allocation failure");
+
+  p->node = node;
+  p->calls = 0;
+  p->nanoseconds = 0;
+  p->size = 1;
+  p->argc = node->argc;
+  for (int i = 0; i < node->argc; i++) {
+    p->args[i] = new_node_profile(node->args[i]);
+    p->size += p->args[i]->size;
+  }
+  return p;
+}
+
+void free_node_profile(node_profile *p) {
+  for (int i = 0; i < p->argc; i++)
+    free_node_profile(p->args[i]);
+  free(p);
+}
+
+//execute() with every node timed
+void execute_timed(node_profile *p, value vars[], int num_vars, options *opts,
+                   value *result) {
+  value argv[MAX_ARGUMENTS];
+  expr_node *node = p->node;
+  uint64_t start = read_clock();
+
+  for (int i = 0; i < node->argc; i++)
+    execute_timed(p->args[i], vars, num_vars, opts, &argv[i]);
+
+  switch (node->type) {
+  case NODE_CONSTANT:
+    *result = node->val;
+    break;
+  case NODE_VARIABLE:
+    *result = vars[node->index];
+    break;
+  case NODE_OPERATOR:
+    if (is_unary_operator(node->op))
+      apply_operator(node->op, NULL, &argv[0], result);
+    else
+      apply_operator(node->op, &argv[0], &argv[1], result);
+    break;
+  case NODE_CONDITIONAL:
+    conditional(&argv[0], &argv[1], &argv[2], result);
+    break;
+  case NODE_FUNCTION:
+    call_function(node->id, result, node->argc, argv, opts->degrees);
+    break;
+  }
+
+  p->nanoseconds += read_clock() - start;
+  p->calls++;
+}
+
+//the least time seen between two reads of the clock
+uint64_t clock_overhead() {
+  uint64_t least = UINT64_MAX;
+  for (int i = 0; i < 1000; i++) {
+    uint64_t start = read_clock();
+    uint64_t elapsed = read_clock() - start;
+    if (elapsed < least)
+      least = elapsed;
+  }
+  return least;
+}
+
+//total time for the node, less what timing it and its operands cost: the
+//node's own measurement takes about one overhead, and each operand's two
+//reads of the clock fall wholly inside it
+double inclusive_time(node_profile *p, uint64_t overhead) {
+  double time = p->nanoseconds
+    - (double)overhead * (2 * p->size - 1) * p->calls;
+  return time > 0 ? time : 0;
+}
+
+double self_time(node_profile *p, uint64_t overhead) {
+  double time = inclusive_time(p, overhead);
+  for (int i = 0; i < p->argc; i++)
+    time -= inclusive_time(p->args[i], overhead);
+  return time > 0 ? time : 0;
+}
+
+void print_node_tree(FILE *stream, node_profile *p, int depth, double total,
+                     value vars[], uint64_t overhead) {
+  char label[MAX_IDENTIFIER_LENGTH + 3];
+  node_label(label, sizeof(label), p->node, vars);
+
+  double time = inclusive_time(p, overhead);
+  fprintf(stream, "%10.1f %10.1f %6.1f%% %12ld  %*s%s\n",
+          p->calls ? time / p->calls : 0.0,
+          p->calls ? self_time(p, overhead) / p->calls : 0.0,
+          total > 0 ? 100.0 * time / total : 0.0, p->calls, 2 * depth, "",
+          label);
+
+  for (int i = 0; i < p->argc; i++)
+    print_node_tree(stream, p->args[i], depth + 1, total, vars, overhead);
+}
+
+void print_folded(FILE *stream, node_profile *p, char *stack, int length,
+                  value vars[], uint64_t overhead) {
+  char label[MAX_IDENTIFIER_LENGTH + 3];
+  node_label(label, sizeof(label), p->node, vars);
+
+  int added = snprintf(stack + length, FOLDED_STACK_SIZE - length, "%s%s",
+                       length ? ";" : "", label);
+  if (length + added >= FOLDED_STACK_SIZE) { //too deep to name
+    stack[length] = '\0';
+    return;
+  }
+
+  fprintf(stream, "%s %.0f\n", stack, self_time(p, overhead));
+  for (int i = 0; i < p->argc; i++)
+    print_folded(stream, p->args[i], stack, length + added, vars, overhead);
+  stack[length] = '\0';
+}
+
+int add_label_totals(label_total totals[], int count, int max,
+                     node_profile *p, uint64_t overhead) {
+  //literals are not worth a row of their own
+  if (p->node->type != NODE_CONSTANT && p->node->type != NODE_VARIABLE) {
+    char label[MAX_IDENTIFIER_LENGTH + 3];
+    node_label(label, sizeof(label), p->node, NULL);
+
+    int i = 0;
+    while (i < count && strcmp(totals[i].label, label))
+      i++;
+    if (i == count && count < max) {
+      strcpy(totals[count].label, label);
+      totals[count].self = 0;
+      totals[count].calls = 0;
+      count++;
+    }
+
+    if (i < count) {
+      totals[i].self += self_time(p, overhead);
+      totals[i].calls += p->calls;
+    }
+  }
+
+  for (int i = 0; i < p->argc; i++)
+    count = add_label_totals(totals, count, max, p->args[i], overhead);
+  return count;
+}
+
+int compare_label_totals(const void *a, const void *b) {
+  double x = ((const label_total *)a)->self;
+  double y = ((const label_total *)b)->self;
+  return (x < y) - (x > y); //most time first
+}
+
+//monotonic time in nanoseconds
+uint64_t read_clock() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+void read_counters(uint64_t counts[]) {
+#ifdef HAVE_LINUX_PERF_EVENT_H
+  uint64_t group[NUM_COUNTERS + 1]; //the count, then each value
+
+  if (profile.counter_fd >= 0
+      && read(profile.counter_fd, group, sizeof(group)) == sizeof(group)) {
+    memcpy(counts, group + 1, NUM_COUNTERS * sizeof(uint64_t));
+    return;
+  }
+#endif
+  memset(counts, 0, NUM_COUNTERS * sizeof(uint64_t));
+}
+
+void open_counters() {
+#ifdef HAVE_LINUX_PERF_EVENT_H
+  static uint64_t configs[NUM_COUNTERS] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_BRANCH_MISSES,
+    PERF_COUNT_HW_CACHE_MISSES,
+  };
+  int fds[NUM_COUNTERS];
+
+  for (int i = 0; i < NUM_COUNTERS; i++) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = configs[i];
+    attr.read_format = PERF_FORMAT_GROUP;
+    attr.disabled = i == 0; //the whole group starts with its leader
+    attr.exclude_kernel = 1; //allowed to unprivileged users
+    attr.exclude_hv = 1;
+
+    fds[i] = syscall(SYS_perf_event_open, &attr, 0, -1,
+                     i == 0 ? -1 : fds[0], 0);
+    if (fds[i] < 0) { //not permitted, or not supported here
+      profile.counter_error = errno;
+      for (int j = 0; j < i; j++)
+        close(fds[j]);
+      return;
+    }
+  }
+
+  profile.counter_fd = fds[0];
+  ioctl(profile.counter_fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  ioctl(profile.counter_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#else
+  profile.counter_error = ENOSYS;
+#endif
+}
@@ -0,0 +1,90 @@
+/* ccalc -- evaluate C-style expressions from the command line.
+   Copyright (C) 2015-2017 Gregory Kikola.
+
+   This file is part of ccalc.
+
+   ccalc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   ccalc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with ccalc.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Written by Gregory Kikola <gkikola@gmail.com>. */
+
+#ifndef CCALC_PROFILE_H
+#define CCALC_PROFILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <sys/time.h>
+
+#include "arena.h"
+#include "options.h"
+#include "plan.h"
+#include "value.h"
+
+typedef enum {
+  PHASE_OTHER,
+  PHASE_LEX,
+  PHASE_PARSE,
+  PHASE_EVALUATE,
+  PHASE_FORMAT,
+  PHASE_IO,
+  NUM_PHASES
+} phase;
+
+typedef enum {
+  COUNTER_CYCLES,
+  COUNTER_INSTRUCTIONS,
+  COUNTER_BRANCH_MISSES,
+  COUNTER_CACHE_MISSES,
+  NUM_COUNTERS
+} counter;
+
+typedef struct {
+  long entries;
+  uint64_t nanoseconds;
+  uint64_t counts[NUM_COUNTERS];
+} phase_totals;
+
+//Time, and hardware counters if the kernel allows them, are charged to
+//the current phase each time the program moves to another.
+//--profile-expr evaluates an expression over and over for this long
+#define PROFILE_TREE_NS 100000000
+
+typedef struct {
+  bool enabled;
+  phase current;
+  uint64_t last_time;
+  uint64_t last_counts[NUM_COUNTERS];
+  phase_totals phases[NUM_PHASES];
+
+  int counter_fd; //leader of the counter group, or -1
+  int counter_error; //errno from opening the counters
+} run_profile;
+
+extern run_profile profile;
+
+void start_profile();
+phase profile_switch(phase next);
+void print_profile();
+uint64_t read_clock();
+
+void evaluate_profiled(char *expr, value *result, options *opts,
+                       plan_cache *plans, arena *mem);
+void print_profiled(FILE *stream, value *val, options *opts,
+                    struct timeval *start, struct timeval *end);
+
+void profile_tree(FILE *stream, char *expr, options *opts);
+
+#endif
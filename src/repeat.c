@@ -0,0 +1,167 @@
+/* ccalc -- evaluate C-style expressions from the command line.
+   Copyright (C) 2015-2017 Gregory Kikola.
+
+   This file is part of ccalc.
+
+   ccalc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   ccalc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with ccalc.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Written by Gregory Kikola <gkikola@gmail.com>. */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "compile.h"
+#include "error.h"
+#include "evaluate.h"
+#include "plan.h"
+#include "profile.h"
+#include "repeat.h"
+
+#define SCRATCH_SIZE 4096
+
+typedef enum {
+  STEP_PARSE,
+  STEP_EVALUATE,
+  STEP_TOTAL,
+  NUM_STEPS
+} step;
+
+typedef struct {
+  char *expr;
+  char *template;
+  options *opts;
+  value params[MAX_PARAMS];
+  int num_params;
+  expr_node *tree;
+  arena scratch; //128-bit results, dropped after each sample
+} timing_state;
+
+void run_step(timing_state *state, step s, int count);
+double time_step(timing_state *state, step s, int count);
+int calibrate(timing_state *state, step s);
+void print_timing(FILE *stream, char *label, double samples[], int count);
+int compare_doubles(const void *a, const void *b);
+
+void time_repeated(FILE *stream, char *expr, options *opts) {
+  timing_state state;
+  state.expr = expr;
+  state.opts = opts;
+
+  //take the literals out so that the tree left to evaluate is not just
+  //the folded result
+  int size = 4 * strlen(expr) + 16;
+  state.template = malloc(size);
+  if (!state.template)
+    raise_error(ERROR_SYS, "memory allocation failure");
+
+  state.num_params = normalize_expression(expr, opts, state.template, size,
+                                          state.params, MAX_PARAMS);
+  if (state.num_params < 0) { //too many literals, so time it as written
+    strcpy(state.template, expr);
+    state.num_params = 0;
+  }
+  state.tree = compile_expression(state.template, opts, NULL, 0);
+  arena_init(&state.scratch, SCRATCH_SIZE);
+  arena *prev_arena = set_wide_arena(&state.scratch);
+
+  int num_samples = opts->repeat;
+  int warm_up = num_samples / 10 + 1;
+  double *samples = malloc(num_samples * sizeof(double));
+  if (!samples)
+    raise_error(ERROR_SYS, "memory allocation failure");
+
+  static char *labels[NUM_STEPS] = { "parse", "evaluate", "total" };
+  for (step s = 0; s < NUM_STEPS; s++) {
+    int count = calibrate(&state, s);
+
+    for (int i = 0; i < warm_up; i++)
+      run_step(&state, s, count);
+
+    for (int i = 0; i < num_samples; i++)
+      samples[i] = time_step(&state, s, count);
+
+    print_timing(stream, labels[s], samples, num_samples);
+  }
+  fprintf(stream, "(%d samples after %d to warm up)\n", num_samples,
+          warm_up);
+
+  set_wide_arena(prev_arena);
+  arena_free(&state.scratch);
+  free_node(state.tree);
+  free(state.template);
+  free(samples);
+}
+
+void run_step(timing_state *state, step s, int count) {
+  value result;
+
+  for (int i = 0; i < count; i++) {
+    switch (s) {
+    case STEP_PARSE:
+      free_node(compile_expression(state->template, state->opts, NULL, 0));
+      break;
+    case STEP_EVALUATE:
+      execute(state->tree, state->params, state->num_params, state->opts,
+              &result);
+      break;
+    default: //what ccalc does without a plan: parse and evaluate at once
+      evaluate(state->expr, &result, state->opts);
+      break;
+    }
+  }
+  arena_reset(&state->scratch);
+}
+
+//returns nanoseconds per evaluation
+double time_step(timing_state *state, step s, int count) {
+  uint64_t start = read_clock();
+  run_step(state, s, count);
+  return (double)(read_clock() - start) / count;
+}
+
+//finds how many evaluations make a sample long enough to time
+int calibrate(timing_state *state, step s) {
+  int count = 1;
+  while (count < (1 << 24)
+         && time_step(state, s, count) * count < MIN_SAMPLE_NS)
+    count *= 2;
+  return count;
+}
+
+void print_timing(FILE *stream, char *label, double samples[], int count) {
+  double sum = 0.0, squares = 0.0;
+  for (int i = 0; i < count; i++)
+    sum += samples[i];
+  double mean = sum / count;
+  for (int i = 0; i < count; i++)
+    squares += (samples[i] - mean) * (samples[i] - mean);
+  double stddev = count > 1 ? sqrt(squares / (count - 1)) : 0.0;
+
+  qsort(samples, count, sizeof(double), compare_doubles);
+  double median = count % 2 ? samples[count / 2]
+    : (samples[count / 2 - 1] + samples[count / 2]) / 2;
+  int p99 = (int)ceil(0.99 * count) - 1;
+
+  fprintf(stream, "%-8s min %.1f ns, median %.1f ns, p99 %.1f ns, "
+          "mean %.1f ± %.1f ns\n", label, samples[0], median, samples[p99],
+          mean, stddev);
+}
+
+int compare_doubles(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
@@ -0,0 +1,35 @@
+/* ccalc -- evaluate C-style expressions from the command line.
+   Copyright (C) 2015-2017 Gregory Kikola.
+
+   This file is part of ccalc.
+
+   ccalc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   ccalc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with ccalc.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Written by Gregory Kikola <gkikola@gmail.com>. */
+
+#ifndef CCALC_REPEAT_H
+#define CCALC_REPEAT_H
+
+#include <stdio.h>
+
+#include "options.h"
+
+//each timed sample runs the expression enough times to take at least this
+//long, so that reading the clock is lost in the noise
+#define MIN_SAMPLE_NS 2000
+
+void time_repeated(FILE *stream, char *expr, options *opts);
+
+#endif
@@ -0,0 +1,200 @@
+/* ccalc -- evaluate C-style expressions from the command line.
+   Copyright (C) 2015-2017 Gregory Kikola.
+
+   This file is part of ccalc.
+
+   ccalc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   ccalc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with ccalc.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Written by Gregory Kikola <gkikola@gmail.com>. */
+
+//This file is the reference client for the shared-memory transport and
+//depends only on the C library, so it can be copied into other programs.
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <linux/futex.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "ring.h"
+
+int ring_connect(ring_client *client, char *socket_path) {
+  struct sockaddr_un addr;
+
+  if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+    errno = ENAMETOOLONG;
+    return -1;
+  }
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, socket_path);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0)
+    return -1;
+  if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0
+      || write(fd, RING_REQUEST "\n", sizeof(RING_REQUEST)) < 0) {
+    close(fd);
+    return -1;
+  }
+
+  //the daemon answers with one line and the ring's file descriptor
+  char reply[64];
+  char control[CMSG_SPACE(sizeof(int))];
+  struct iovec iov = { reply, sizeof(reply) - 1 };
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+
+  ssize_t count = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+  struct cmsghdr *cmsg = (count > 0) ? CMSG_FIRSTHDR(&msg) : NULL;
+  if (!cmsg || cmsg->cmsg_type != SCM_RIGHTS) {
+    close(fd);
+    errno = EPROTO;
+    return -1;
+  }
+
+  int ring_fd;
+  memcpy(&ring_fd, CMSG_DATA(cmsg), sizeof(int));
+  client->ring = mmap(NULL, sizeof(ring_header), PROT_READ | PROT_WRITE,
+                      MAP_SHARED, ring_fd, 0);
+  close(ring_fd);
+
+  if (client->ring == MAP_FAILED || client->ring->magic != RING_MAGIC) {
+    close(fd);
+    errno = EPROTO;
+    return -1;
+  }
+
+  client->socket_fd = fd;
+  client->head = 0;
+  client->tail = 0;
+  return 0;
+}
+
+int ring_submit(ring_client *client, char *request) {
+  ring_slot *slot = &client->ring->slot[client->head % RING_SLOTS];
+  size_t length = strlen(request);
+
+  if (length >= RING_TEXT_SIZE) {
+    errno = EMSGSIZE;
+    return -1;
+  } else if (atomic_load_explicit(&slot->state, memory_order_acquire)
+             != SLOT_FREE) { //every slot is in flight
+    errno = EAGAIN;
+    return -1;
+  }
+
+  memcpy(slot->text, request, length + 1);
+  slot->length = length;
+  atomic_store(&slot->state, SLOT_SUBMITTED);
+  client->head++;
+
+  //ring the doorbell only if the daemon went to sleep
+  if (atomic_load(&client->ring->server_waiting)
+      && atomic_exchange(&client->ring->server_waiting, 0))
+    ring_wake(&client->ring->server_waiting);
+
+  return 0;
+}
+
+static int peer_gone(ring_client *client) {
+  struct pollfd pfd;
+  pfd.fd = client->socket_fd;
+  pfd.events = POLLRDHUP;
+  return poll(&pfd, 1, 0) > 0;
+}
+
+int ring_collect(ring_client *client, char *response, size_t size) {
+  ring_slot *slot = &client->ring->slot[client->tail % RING_SLOTS];
+
+  if (client->tail == client->head) { //nothing outstanding
+    errno = EINVAL;
+    return -1;
+  }
+
+  for (int spins = 0;
+       atomic_load_explicit(&slot->state, memory_order_acquire) != SLOT_DONE;
+       spins++) {
+    if (spins < ring_spin_limit())
+      continue;
+
+    atomic_store(&client->ring->client_waiting, 1);
+    if (atomic_load(&slot->state) != SLOT_DONE)
+      ring_wait(&client->ring->client_waiting, 1, 100);
+    atomic_store(&client->ring->client_waiting, 0);
+
+    //the daemon holds the socket open for as long as it serves the ring,
+    //so a hangup there means this slot will never be answered
+    if (atomic_load(&slot->state) != SLOT_DONE && peer_gone(client)) {
+      errno = EPIPE;
+      return -1;
+    }
+  }
+
+  size_t length = slot->length;
+  if (length >= size)
+    length = size - 1;
+  memcpy(response, slot->text, length);
+  response[length] = '\0';
+
+  atomic_store_explicit(&slot->state, SLOT_FREE, memory_order_release);
+  client->tail++;
+  return length;
+}
+
+void ring_disconnect(ring_client *client) {
+  atomic_store(&client->ring->closed, 1);
+  atomic_store(&client->ring->server_waiting, 0);
+  ring_wake(&client->ring->server_waiting);
+
+  munmap(client->ring, sizeof(ring_header));
+  close(client->socket_fd);
+}
+
+int ring_spin_limit() {
+  static int limit = -1;
+
+  //spinning only helps when the other side can run at the same time
+  if (limit < 0)
+    limit = (sysconf(_SC_NPROCESSORS_ONLN) > 1) ? RING_SPIN_LIMIT : 0;
+  return limit;
+}
+
+void ring_wait(_Atomic uint32_t *word, uint32_t value, int timeout_ms) {
+  struct timespec timeout;
+  timeout.tv_sec = timeout_ms / 1000;
+  timeout.tv_nsec = (timeout_ms % 1000) * 1000000L;
+
+  syscall(SYS_futex, word, FUTEX_WAIT, value, &timeout, NULL, 0);
+}
+
+void ring_wake(_Atomic uint32_t *word) {
+  syscall(SYS_futex, word, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
@@ -0,0 +1,78 @@
+/* ccalc -- evaluate C-style expressions from the command line.
+   Copyright (C) 2015-2017 Gregory Kikola.
+
+   This file is part of ccalc.
+
+   ccalc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   ccalc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with ccalc.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Written by Gregory Kikola <gkikola@gmail.com>. */
+
+#ifndef CCALC_RING_H
+#define CCALC_RING_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+//A ring is a memfd shared between the daemon and one local client. The
+//client writes a request into the next free slot and marks it submitted;
+//the daemon evaluates it and writes the response into the same slot. Both
+//sides only sleep on a futex once they run out of work, so a busy ring
+//involves no system calls at all.
+
+#define RING_MAGIC 0x63636172
+#define RING_SLOTS 64
+#define RING_TEXT_SIZE 504
+
+#define RING_REQUEST "#ring"
+#define RING_SPIN_LIMIT 4096
+
+enum { SLOT_FREE, SLOT_SUBMITTED, SLOT_DONE };
+
+typedef struct {
+  _Atomic uint32_t state;
+  uint32_t length;
+  char text[RING_TEXT_SIZE];
+} ring_slot;
+
+typedef struct {
+  uint32_t magic;
+  uint32_t slots;
+
+  //futex words: set by a side that is about to sleep
+  _Atomic uint32_t server_waiting __attribute__((aligned(64)));
+  _Atomic uint32_t client_waiting __attribute__((aligned(64)));
+  _Atomic uint32_t closed;
+
+  ring_slot slot[RING_SLOTS] __attribute__((aligned(64)));
+} ring_header;
+
+typedef struct {
+  ring_header *ring;
+  int socket_fd;
+  uint32_t head; //next slot to submit
+  uint32_t tail; //next slot to collect
+} ring_client;
+
+int ring_connect(ring_client *client, char *socket_path);
+int ring_submit(ring_client *client, char *request);
+int ring_collect(ring_client *client, char *response, size_t size);
+void ring_disconnect(ring_client *client);
+
+int ring_spin_limit();
+void ring_wait(_Atomic uint32_t *word, uint32_t value, int timeout_ms);
+void ring_wake(_Atomic uint32_t *word);
+
+#endif
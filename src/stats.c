@@ -0,0 +1,203 @@
+/* ccalc -- evaluate C-style expressions from the command line.
+   Copyright (C) 2015-2017 Gregory Kikola.
+
+   This file is part of ccalc.
+
+   ccalc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   ccalc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with ccalc.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Written by Gregory Kikola <gkikola@gmail.com>. */
+
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "profile.h"
+#include "stats.h"
+
+run_stats stats = { 0 };
+volatile sig_atomic_t stats_requested = 0;
+
+void request_stats(int signum);
+void add_slow_line(char *expr, int length, uint64_t nanoseconds);
+
+void start_stats() {
+  stats.enabled = true;
+  stats.start_time = read_clock();
+  histogram_init(&stats.latency);
+
+  //the report is printed between lines, and a read that the signal
+  //interrupts returns early so that it can be printed while we wait
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = request_stats;
+  action.sa_flags = 0;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGUSR1, &action, NULL);
+}
+
+void record_line(char *expr, uint64_t nanoseconds) {
+  if (!stats.enabled)
+    return;
+
+  int length = strcspn(expr, "\n"); //lines may keep their newline
+  stats.timed_lines++;
+  stats.bytes += length + 1;
+  histogram_add(&stats.latency, nanoseconds);
+  add_slow_line(expr, length, nanoseconds);
+  check_stats();
+}
+
+//--columns evaluates a block of rows at once, so each row is counted with
+//an even share of the block's time
+void record_rows(char *expr, long bytes, int rows, uint64_t nanoseconds) {
+  if (!stats.enabled)
+    return;
+
+  uint64_t share = nanoseconds / rows;
+  stats.timed_lines += rows;
+  stats.bytes += bytes;
+  for (int i = 0; i < rows; i++)
+    histogram_add(&stats.latency, share);
+  add_slow_line(expr, strlen(expr), share);
+  check_stats();
+}
+
+//print the report if SIGUSR1 asked for one
+void check_stats() {
+  if (stats_requested) {
+    stats_requested = 0;
+    print_stats();
+  }
+}
+
+void count_error(char *kind, char *message) {
+  for (int i = 0; i < stats.num_error_kinds; i++) {
+    if (stats.errors[i].kind == kind) {
+      stats.errors[i].count++;
+      return;
+    }
+  }
+
+  if (stats.num_error_kinds == MAX_ERROR_KINDS)
+    return;
+
+  error_count *error = &stats.errors[stats.num_error_kinds++];
+  error->kind = kind;
+  error->count = 1;
+  snprintf(error->message, sizeof(error->message), "%s", message);
+}
+
+void print_stats() {
+  fflush(stdout); //keep the report after any results
+  fprintf(stderr, "lines: %ld\n", stats.lines);
+
+  if (stats.enabled) {
+    double seconds = (read_clock() - stats.start_time) / 1e9;
+    fprintf(stderr, "throughput: %.0f lines/s, %.0f bytes/s over %.3f s\n",
+            seconds > 0 ? stats.timed_lines / seconds : 0.0,
+            seconds > 0 ? stats.bytes / seconds : 0.0, seconds);
+  }
+
+  if (stats.enabled && stats.timed_lines) {
+    histogram *h = &stats.latency;
+    fprintf(stderr, "latency: min %llu ns, mean %.0f ns, p50 %llu ns, "
+            "p90 %llu ns, p99 %llu ns, p99.9 %llu ns, max %llu ns\n",
+            (unsigned long long)h->min, h->sum / h->total,
+            (unsigned long long)histogram_percentile(h, 50),
+            (unsigned long long)histogram_percentile(h, 90),
+            (unsigned long long)histogram_percentile(h, 99),
+            (unsigned long long)histogram_percentile(h, 99.9),
+            (unsigned long long)h->max);
+    print_histogram(stderr, h, "ns");
+
+    fprintf(stderr, "slowest lines:\n");
+    for (int i = 0; i < stats.num_slowest; i++)
+      fprintf(stderr, "  %12llu ns  %s\n",
+              (unsigned long long)stats.slowest[i].nanoseconds,
+              stats.slowest[i].text);
+  }
+
+  for (int i = 0; i < stats.num_error_kinds; i++)
+    fprintf(stderr, "errors: %ld %s\n", stats.errors[i].count,
+            stats.errors[i].message);
+
+  if (stats.mem) {
+    fprintf(stderr, "allocations: %ld (%ld from the heap)\n",
+            stats.mem->allocations, stats.mem->heap_allocations);
+    fprintf(stderr, "arena resets: %ld\n", stats.mem->resets);
+    fprintf(stderr, "arena peak: %zu bytes\n", stats.mem->peak);
+  }
+
+  if (stats.memo) {
+    memo_cache *memo = stats.memo;
+    long lookups = memo->hits + memo->misses;
+    fprintf(stderr, "memo: %ld hits, %ld misses (%.1f%% hit ratio)\n",
+            memo->hits, memo->misses,
+            lookups ? 100.0 * memo->hits / lookups : 0.0);
+    fprintf(stderr, "memo size: %d of %d results\n", memo->size,
+            memo->capacity);
+  }
+
+  if (stats.plans) {
+    plan_cache *plans = stats.plans;
+    long lookups = plans->hits + plans->misses;
+    fprintf(stderr, "plan cache: %ld hits, %ld misses (%.1f%% hit ratio)\n",
+            plans->hits, plans->misses,
+            lookups ? 100.0 * plans->hits / lookups : 0.0);
+    fprintf(stderr, "plan cache size: %d of %d plans, %ld evicted\n",
+            plans->size, plans->capacity, plans->evictions);
+  }
+
+  if (stats.dag) {
+    expr_dag *dag = stats.dag;
+    fprintf(stderr, "batch nodes: %d unique of %ld (%.1f%% shared)\n",
+            dag->num_nodes, dag->total_nodes,
+            dag->total_nodes ?
+            100.0 * (dag->total_nodes - dag->num_nodes) / dag->total_nodes
+            : 0.0);
+  }
+}
+
+void request_stats(int signum) {
+  (void)signum;
+  stats_requested = 1;
+}
+
+void add_slow_line(char *expr, int length, uint64_t nanoseconds) {
+  //the list is kept sorted, slowest first
+  int pos = stats.num_slowest;
+  if (pos == SLOWEST_LINES) {
+    if (nanoseconds <= stats.slowest[pos - 1].nanoseconds)
+      return;
+    pos--;
+  } else {
+    stats.num_slowest++;
+  }
+
+  while (pos > 0 && stats.slowest[pos - 1].nanoseconds < nanoseconds) {
+    stats.slowest[pos] = stats.slowest[pos - 1];
+    pos--;
+  }
+
+  slow_line *line = &stats.slowest[pos];
+  line->nanoseconds = nanoseconds;
+  if (length < SLOW_TEXT_SIZE) {
+    memcpy(line->text, expr, length);
+    line->text[length] = '\0';
+  } else { //show that it was cut short
+    memcpy(line->text, expr, SLOW_TEXT_SIZE - 4);
+    strcpy(line->text + SLOW_TEXT_SIZE - 4, "...");
+  }
+}
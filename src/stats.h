@@ -0,0 +1,82 @@
+/* ccalc -- evaluate C-style expressions from the command line.
+   Copyright (C) 2015-2017 Gregory Kikola.
+
+   This file is part of ccalc.
+
+   ccalc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   ccalc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with ccalc.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Written by Gregory Kikola <gkikola@gmail.com>. */
+
+#ifndef CCALC_STATS_H
+#define CCALC_STATS_H
+
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "dag.h"
+#include "histogram.h"
+#include "memo.h"
+#include "plan.h"
+
+#define SLOWEST_LINES 10
+#define SLOW_TEXT_SIZE 64
+#define MAX_ERROR_KINDS 16
+
+typedef struct {
+  uint64_t nanoseconds;
+  char text[SLOW_TEXT_SIZE];
+} slow_line;
+
+typedef struct {
+  char *kind; //the format string the error was raised with
+  char message[64]; //the first message of that kind
+  long count;
+} error_count;
+
+//counters for --stats, reported on stderr when the program exits or
+//receives SIGUSR1
+typedef struct {
+  long lines;
+  arena *mem; //allocator for per-line memory, if there is one
+  memo_cache *memo;
+  plan_cache *plans;
+  expr_dag *dag; //the graph built by --batch
+
+  //per-line latency, only kept once start_stats() is called
+  bool enabled;
+  uint64_t start_time;
+  long timed_lines;
+  long bytes;
+  histogram latency;
+  slow_line slowest[SLOWEST_LINES];
+  int num_slowest;
+
+  error_count errors[MAX_ERROR_KINDS];
+  int num_error_kinds;
+} run_stats;
+
+extern run_stats stats;
+extern volatile sig_atomic_t stats_requested;
+
+void start_stats();
+void record_line(char *expr, uint64_t nanoseconds);
+void record_rows(char *expr, long bytes, int rows, uint64_t nanoseconds);
+void check_stats();
+void count_error(char *kind, char *message);
+void print_stats();
+
+#endif
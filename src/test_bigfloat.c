@@ -0,0 +1,327 @@
+/* ccalc -- evaluate C-style expressions from the command line.
+   Copyright (C) 2015-2017 Gregory Kikola.
+
+   This file is part of ccalc.
+
+   ccalc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   ccalc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with ccalc.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Written by Gregory Kikola <gkikola@gmail.com>. */
+
+//Checks the bigfloat module. The constants are compared against their
+//published digits, pi from several threads against pi from one, each
+//function at double precision against the C library, and at high
+//precision against identities that tie the functions to each other.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bigfloat.h"
+
+#define BITS_PER_DIGIT 3.3219280948873623
+
+typedef bool (*function)(bigfloat *, const bigfloat *, size_t);
+
+typedef struct {
+  char *name;
+  function precise;
+  double (*libm)(double);
+  double low, high;
+} function_test;
+
+function_test function_tests[] = {
+  {"sqrt", bf_sqrt, sqrt, 0, 1e6},
+  {"cbrt", bf_cbrt, cbrt, -1e6, 1e6},
+  {"exp", bf_exp, exp, -700, 700},
+  {"expm1", bf_expm1, expm1, -2, 2},
+  {"log", bf_log, log, 1e-6, 1e6},
+  {"log2", bf_log2, log2, 1e-6, 1e6},
+  {"log10", bf_log10, log10, 1e-6, 1e6},
+  {"log1p", bf_log1p, log1p, -0.5, 2},
+  {"sin", bf_sin, sin, -100, 100},
+  {"cos", bf_cos, cos, -100, 100},
+  {"tan", bf_tan, tan, -1.5, 1.5},
+  {"asin", bf_asin, asin, -1, 1},
+  {"acos", bf_acos, acos, -1, 1},
+  {"atan", bf_atan, atan, -100, 100},
+  {"sinh", bf_sinh, sinh, -20, 20},
+  {"cosh", bf_cosh, cosh, -20, 20},
+  {"tanh", bf_tanh, tanh, -20, 20},
+  {"asinh", bf_asinh, asinh, -100, 100},
+  {"acosh", bf_acosh, acosh, 1, 100},
+  {"atanh", bf_atanh, atanh, -0.99, 0.99},
+};
+
+//the first 100 significant digits of each
+char pi_digits[] = "3141592653589793238462643383279502884197169399375105820974"
+  "944592307816406286208998628034825342117068";
+char e_digits[] = "27182818284590452353602874713526624977572470936999595749669"
+  "67627724076630353547594571382178525166427";
+char phi_digits[] = "1618033988749894848204586834365638117720309179805762862135"
+  "448622705260462818902449707207204189391137";
+
+void check_constants(void);
+void check_threads(void);
+void check_functions(void);
+void check_identities(void);
+void check_decimal(void);
+bool digits_are(const bigfloat *x, const char *digits);
+bool close_to(const bigfloat *a, const bigfloat *b, size_t bits);
+double next_double(double low, double high);
+
+uint64_t random_state = 0x9e3779b97f4a7c15;
+
+int main() {
+  check_constants();
+  printf("pi, e and phi agree with their digits\n");
+  check_threads();
+  printf("pi from threads agrees with pi from one\n");
+  check_functions();
+  printf("functions agree with the C library\n");
+  check_identities();
+  printf("functions agree with each other at 2000 digits\n");
+  check_decimal();
+  printf("decimal conversion round-trips\n");
+  return 0;
+}
+
+void check_constants(void) {
+  size_t bits = 100 * BITS_PER_DIGIT + 16;
+  bigfloat x;
+  bf_init(&x);
+
+  bf_pi(&x, bits);
+  assert(digits_are(&x, pi_digits));
+  bf_e(&x, bits);
+  assert(digits_are(&x, e_digits));
+  bf_phi(&x, bits);
+  assert(digits_are(&x, phi_digits));
+
+  //rounded from the cache
+  bf_pi(&x, 30 * BITS_PER_DIGIT);
+  assert(fabs(bf_get_double(&x) - M_PI) < 1e-15);
+
+  bf_free(&x);
+}
+
+//the cache would answer the second call from the first, so it asks for
+//more bits and rounds back
+void check_threads(void) {
+  size_t bits = 5000 * BITS_PER_DIGIT;
+  bigfloat one, many;
+  bf_init(&one);
+  bf_init(&many);
+
+  max_threads = 1;
+  bf_pi(&one, bits);
+  max_threads = 4;
+  parallel_terms = 8;
+  bf_pi(&many, bits + 1000);
+  bf_round(&many, &many, bits);
+  assert(bf_compare(&one, &many) == 0);
+
+  max_threads = 0;
+  parallel_terms = 1024;
+  bf_free(&one);
+  bf_free(&many);
+}
+
+void check_functions(void) {
+  int num_tests = sizeof(function_tests) / sizeof(function_tests[0]);
+  bigfloat x, r;
+  bf_init(&x);
+  bf_init(&r);
+
+  for (int i = 0; i < num_tests; i++) {
+    function_test *test = &function_tests[i];
+    for (int trial = 0; trial < 50; trial++) {
+      double d = next_double(test->low, test->high);
+      bf_set_double(&x, d);
+      assert(test->precise(&r, &x, 80));
+      double want = test->libm(d), got = bf_get_double(&r);
+      if (fabs(got - want) > 1e-14 * fabs(want) + 1e-300) {
+        printf("%s(%.17g) = %.17g, not %.17g\n", test->name, d, got, want);
+        assert(false);
+      }
+    }
+  }
+
+  //out of their domains
+  bf_set_double(&x, -1);
+  assert(!bf_log(&r, &x, 80) && !bf_sqrt(&r, &x, 80));
+  assert(!bf_acosh(&r, &x, 80) && !bf_atanh(&r, &x, 80));
+  bf_set_double(&x, 1.5);
+  assert(!bf_asin(&r, &x, 80) && !bf_acos(&r, &x, 80));
+
+  bf_free(&x);
+  bf_free(&r);
+}
+
+void check_identities(void) {
+  size_t bits = 2000 * BITS_PER_DIGIT;
+  bigfloat x, a, b, c, pi;
+  bf_init(&x);
+  bf_init(&a);
+  bf_init(&b);
+  bf_init(&c);
+  bf_init(&pi);
+  bf_pi(&pi, bits);
+
+  for (int trial = 0; trial < 6; trial++) {
+    bf_set_double(&x, next_double(-10, 10));
+    bf_set_double(&a, next_double(0, 1));
+    bf_multiply(&x, &x, &a, bits);
+
+    //exp(log |x|) = |x|
+    x.mantissa.negative = false;
+    assert(bf_log(&a, &x, bits));
+    assert(bf_exp(&a, &a, bits));
+    assert(close_to(&a, &x, bits));
+
+    //sin^2 + cos^2 = 1
+    assert(bf_sin(&a, &x, bits) && bf_cos(&b, &x, bits));
+    bf_multiply(&a, &a, &a, bits);
+    bf_multiply(&b, &b, &b, bits);
+    bf_add(&a, &a, &b, bits);
+    bf_set_double(&c, 1);
+    assert(close_to(&a, &c, bits));
+
+    //sin(x + pi) = -sin x
+    bf_add(&a, &x, &pi, bits);
+    assert(bf_sin(&a, &a, bits) && bf_sin(&b, &x, bits));
+    bf_negate(&b, &b);
+    assert(close_to(&a, &b, bits - 8));
+  }
+
+  //4 atan(1) = pi, and atan(tan x) = x for x below pi/2
+  bf_set_double(&x, 1);
+  assert(bf_atan(&a, &x, bits));
+  bf_shift(&a, &a, 2);
+  assert(close_to(&a, &pi, bits));
+  bf_set_double(&x, 1.25);
+  assert(bf_tan(&a, &x, bits) && bf_atan(&a, &a, bits));
+  assert(close_to(&a, &x, bits));
+
+  //sqrt(2)^2 = 2, and 2^(1/2) is the same root
+  bf_set_double(&x, 2);
+  assert(bf_sqrt(&a, &x, bits));
+  bf_set_double(&c, 0.5);
+  assert(bf_pow(&b, &x, &c, bits));
+  assert(close_to(&a, &b, bits));
+  bf_multiply(&a, &a, &a, bits);
+  assert(close_to(&a, &x, bits));
+
+  //10.5 - 3 * 3 and 10.5 - 4 * 3, the quotient truncated and then nearest
+  bf_set_double(&a, 10.5);
+  bf_set_double(&b, 3);
+  bf_fmod(&c, &a, &b, bits);
+  assert(bf_get_double(&c) == 1.5);
+  bf_remainder(&c, &a, &b, bits);
+  assert(bf_get_double(&c) == -1.5);
+
+  //the square root of a square is exact
+  bf_set_double(&x, 12345);
+  bf_multiply(&a, &x, &x, bits);
+  assert(bf_sqrt(&a, &a, bits) && bf_compare(&a, &x) == 0);
+
+  bf_free(&x);
+  bf_free(&a);
+  bf_free(&b);
+  bf_free(&c);
+  bf_free(&pi);
+}
+
+void check_decimal(void) {
+  char text[64];
+  bigint digits;
+  bigfloat x;
+  big_init(&digits);
+  bf_init(&x);
+
+  for (int trial = 0; trial < 50; trial++) {
+    //a 40-digit integer with no leading zero, at a power of ten
+    big_set_wide(&digits, 0);
+    bigint ten = { (uint64_t[]){ 10 }, 1, 0, false };
+    for (int i = 0; i < 40; i++) {
+      text[i] = '0' + (i ? random_state % 10 : 1 + random_state % 9);
+      next_double(0, 1);
+      bigint digit = { (uint64_t[]){ text[i] - '0' }, 1, 0, false };
+      big_multiply(&digits, &digits, &ten);
+      big_add(&digits, &digits, &digit);
+    }
+    long exp10 = (long)(random_state % 2001) - 1000;
+
+    bf_from_decimal(&x, &digits, exp10 - 39, 40 * BITS_PER_DIGIT + 16);
+    long got_exp10;
+    int *got = bf_to_decimal(&x, 40, &got_exp10);
+    assert(got_exp10 == exp10);
+    for (int i = 0; i < 40; i++)
+      assert(got[i] == text[i] - '0');
+    free(got);
+  }
+
+  //rounding can carry into a new digit: 9.96 to two digits is 10
+  big_set_wide(&digits, 996);
+  bf_from_decimal(&x, &digits, -2, 64);
+  long exp10;
+  int *got = bf_to_decimal(&x, 2, &exp10);
+  assert(exp10 == 1 && got[0] == 1 && got[1] == 0);
+  free(got);
+
+  big_free(&digits);
+  bf_free(&x);
+}
+
+bool digits_are(const bigfloat *x, const char *digits) {
+  size_t n = strlen(digits);
+  long exp10;
+  int *got = bf_to_decimal(x, n, &exp10);
+  bool same = exp10 == 0;
+  for (size_t i = 0; i < n; i++)
+    same = same && got[i] == digits[i] - '0';
+  free(got);
+  return same;
+}
+
+//within a few ulps at the given precision
+bool close_to(const bigfloat *a, const bigfloat *b, size_t bits) {
+  bigfloat d;
+  bf_init(&d);
+  bf_subtract(&d, a, b, bits);
+  long scale = bf_magnitude(b);
+  if (scale < 1)
+    scale = 1;
+  bool close = !d.mantissa.length
+    || bf_magnitude(&d) < scale - (long)bits + 8;
+  bf_free(&d);
+  return close;
+}
+
+double next_double(double low, double high) {
+  //xorshift64*
+  random_state ^= random_state >> 12;
+  random_state ^= random_state << 25;
+  random_state ^= random_state >> 27;
+  uint64_t r = random_state * 0x2545f4914f6cdd1d;
+  return low + (high - low) * (r >> 11) * 0x1p-53;
+}
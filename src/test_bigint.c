@@ -0,0 +1,354 @@
+/* ccalc -- evaluate C-style expressions from the command line.
+   Copyright (C) 2015-2017 Gregory Kikola.
+
+   This file is part of ccalc.
+
+   ccalc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   ccalc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with ccalc.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Written by Gregory Kikola <gkikola@gmail.com>. */
+
+//Checks the bigint module. Each multiplication algorithm is forced in
+//turn by lowering the thresholds and compared against schoolbook
+//multiplication, Newton division is checked against the identity
+//a = q b + r, square roots against r^2 <= a < (r + 1)^2, and the fast
+//radix conversion against the plain one.
+//Operands mix random limbs with runs of zeros and all-ones limbs, where
+//carries and borrows travel furthest.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bigint.h"
+
+#define NUM_TRIALS 40
+#define MAX_LIMBS 2500
+
+typedef struct {
+  char *name;
+  size_t karatsuba;
+  size_t toom3;
+  size_t ntt;
+} multiply_test;
+
+multiply_test multiply_tests[] = {
+  {"karatsuba", 4, SIZE_MAX, SIZE_MAX},
+  {"toom3", 4, 4, SIZE_MAX},
+  {"ntt", 4, 4, 4},
+  {"default", 32, 256, 40000},
+};
+
+void random_bigint(bigint *x, size_t length);
+uint64_t next_random(void);
+void use_schoolbook(void);
+void check_multiply(multiply_test *test);
+void check_divide(void);
+void check_sqrt(void);
+void check_digits(void);
+void check_small(void);
+
+uint64_t random_state = 0x9e3779b97f4a7c15;
+
+int main() {
+  int num_tests = sizeof(multiply_tests) / sizeof(multiply_tests[0]);
+
+  for (int i = 0; i < num_tests; i++) {
+    check_multiply(&multiply_tests[i]);
+    printf("%-10s multiplication agrees with schoolbook\n",
+           multiply_tests[i].name);
+    fflush(stdout);
+  }
+
+  check_divide();
+  printf("%-10s division agrees with schoolbook\n", "newton");
+  check_sqrt();
+  printf("%-10s square roots are floors\n", "newton");
+  check_digits();
+  printf("%-10s radix conversion agrees with schoolbook\n", "recursive");
+  check_small();
+  printf("128-bit results agree with __int128\n");
+  return 0;
+}
+
+void random_bigint(bigint *x, size_t length) {
+  uint64_t *limbs = malloc((length + 1) * sizeof(uint64_t));
+  assert(limbs);
+
+  for (size_t i = 0; i < length; i++) {
+    uint64_t r = next_random();
+    switch (r % 8) {
+    case 0: limbs[i] = 0; break;
+    case 1: limbs[i] = UINT64_MAX; break;
+    default: limbs[i] = next_random(); break;
+    }
+  }
+
+  //borrow, then copy so that the result is stripped and owns its limbs
+  bigint view = { limbs, length, 0, next_random() & 1 };
+  while (view.length && !limbs[view.length - 1])
+    view.length--;
+  if (!view.length)
+    view.negative = false;
+  big_copy(x, &view);
+  free(limbs);
+}
+
+uint64_t next_random(void) {
+  //xorshift64*
+  random_state ^= random_state >> 12;
+  random_state ^= random_state << 25;
+  random_state ^= random_state >> 27;
+  return random_state * 0x2545f4914f6cdd1d;
+}
+
+void use_schoolbook(void) {
+  karatsuba_threshold = toom3_threshold = ntt_threshold = SIZE_MAX;
+  newton_threshold = radix_threshold = SIZE_MAX;
+}
+
+void check_multiply(multiply_test *test) {
+  bigint a, b, want, got;
+  big_init(&a);
+  big_init(&b);
+  big_init(&want);
+  big_init(&got);
+
+  for (int trial = 0; trial < NUM_TRIALS; trial++) {
+    //sizes spread over orders of magnitude, some of them lopsided
+    size_t an = 1 + next_random() % (1 + (MAX_LIMBS >> (trial % 8)));
+    size_t bn = (trial % 3) ? an : 1 + next_random() % an;
+    random_bigint(&a, an);
+    random_bigint(&b, bn);
+
+    use_schoolbook();
+    big_multiply(&want, &a, &b);
+
+    karatsuba_threshold = test->karatsuba;
+    toom3_threshold = test->toom3;
+    ntt_threshold = test->ntt;
+    big_multiply(&got, &a, &b);
+    assert(big_compare(&got, &want) == 0);
+
+    //squaring is its own case for the transform
+    use_schoolbook();
+    big_multiply(&want, &a, &a);
+    karatsuba_threshold = test->karatsuba;
+    toom3_threshold = test->toom3;
+    ntt_threshold = test->ntt;
+    big_multiply(&got, &a, &a);
+    assert(big_compare(&got, &want) == 0);
+  }
+
+  big_free(&a);
+  big_free(&b);
+  big_free(&want);
+  big_free(&got);
+}
+
+void check_divide(void) {
+  bigint a, b, q, r, t, plain_q, plain_r;
+  big_init(&a);
+  big_init(&b);
+  big_init(&q);
+  big_init(&r);
+  big_init(&t);
+  big_init(&plain_q);
+  big_init(&plain_r);
+
+  for (int trial = 0; trial < NUM_TRIALS; trial++) {
+    size_t an = 1 + next_random() % (1 + (MAX_LIMBS >> (trial % 6)));
+    size_t bn = 1 + next_random() % an;
+    random_bigint(&a, an);
+    do
+      random_bigint(&b, bn);
+    while (b.length == 0);
+
+    use_schoolbook();
+    big_divide(&plain_q, &plain_r, &a, &b);
+
+    karatsuba_threshold = toom3_threshold = 4;
+    ntt_threshold = 64;
+    newton_threshold = 4;
+    big_divide(&q, &r, &a, &b);
+    assert(big_compare(&q, &plain_q) == 0);
+    assert(big_compare(&r, &plain_r) == 0);
+
+    //a = q b + r, with r smaller than b and of the sign of a
+    big_multiply(&t, &q, &b);
+    big_add(&t, &t, &r);
+    assert(big_compare(&t, &a) == 0);
+    assert(r.length == 0 || r.negative == a.negative);
+    bigint abs_r = r, abs_b = b;
+    abs_r.negative = abs_b.negative = false;
+    assert(big_compare(&abs_r, &abs_b) < 0);
+  }
+
+  big_free(&a);
+  big_free(&b);
+  big_free(&q);
+  big_free(&r);
+  big_free(&t);
+  big_free(&plain_q);
+  big_free(&plain_r);
+}
+
+void check_sqrt(void) {
+  bigint a, r, t;
+  big_init(&a);
+  big_init(&r);
+  big_init(&t);
+  bigint one = { (uint64_t[]){ 1 }, 1, 0, false };
+
+  for (int trial = 0; trial < NUM_TRIALS; trial++) {
+    size_t n = 1 + next_random() % (1 + (MAX_LIMBS >> (trial % 6)));
+    random_bigint(&a, n);
+    a.negative = false;
+    if (trial % 4 < 2) //perfect squares, and one less
+      big_multiply(&a, &a, &a);
+    if (trial % 4 == 1)
+      big_subtract(&a, &a, &one);
+    if (a.negative)
+      big_set_wide(&a, 0);
+
+    big_sqrt(&r, &a);
+    big_multiply(&t, &r, &r);
+    assert(big_compare(&t, &a) <= 0);
+    big_add(&t, &r, &one);
+    big_multiply(&t, &t, &t);
+    assert(big_compare(&t, &a) > 0);
+  }
+
+  big_free(&a);
+  big_free(&r);
+  big_free(&t);
+}
+
+void check_digits(void) {
+  int radixes[] = { 2, 8, 10, 16, 36 };
+  bigint x;
+  big_init(&x);
+
+  for (int trial = 0; trial < NUM_TRIALS / 2; trial++) {
+    size_t n = 1 + next_random() % (1 + (MAX_LIMBS / 4 >> (trial % 6)));
+    int radix = radixes[trial % 5];
+    size_t want_n, got_n;
+    random_bigint(&x, n);
+
+    use_schoolbook();
+    int *want = big_to_digits(&x, radix, &want_n);
+
+    karatsuba_threshold = toom3_threshold = 4;
+    ntt_threshold = 64;
+    newton_threshold = radix_threshold = 4;
+    int *got = big_to_digits(&x, radix, &got_n);
+
+    assert(got_n == want_n);
+    assert(memcmp(got, want, got_n * sizeof(int)) == 0);
+    assert(got_n == 1 || got[0] != 0);
+    free(want);
+    free(got);
+  }
+
+  //10^200 is a one and 200 zeros
+  big_set_wide(&x, 10);
+  big_power(&x, &x, 200);
+  size_t n;
+  int *digits = big_to_digits(&x, 10, &n);
+  assert(n == 201 && digits[0] == 1);
+  for (size_t i = 1; i < n; i++)
+    assert(digits[i] == 0);
+  free(digits);
+
+  big_set_wide(&x, 0);
+  digits = big_to_digits(&x, 10, &n);
+  assert(n == 1 && digits[0] == 0);
+  free(digits);
+
+  big_free(&x);
+}
+
+void check_small(void) {
+  __int128 values[] = { 0, 1, -1, 2, -3, 1000000007, -123456789012345678,
+                        (__int128)1 << 100, -((__int128)1 << 90) - 12345 };
+  int num_values = sizeof(values) / sizeof(values[0]);
+  bigint a, b, r;
+  big_init(&a);
+  big_init(&b);
+  big_init(&r);
+
+  for (int i = 0; i < num_values; i++) {
+    big_set_wide(&a, values[i]);
+    assert(big_fits_wide(&a) && big_get_wide(&a) == values[i]);
+    assert(big_get_double(&a) == (double)values[i]);
+
+    for (int j = 0; j < num_values; j++) {
+      __int128 x = values[i], y = values[j];
+      big_set_wide(&b, y);
+
+      big_bitwise(&r, &a, &b, '&');
+      assert(big_get_wide(&r) == (x & y));
+      big_bitwise(&r, &a, &b, '|');
+      assert(big_get_wide(&r) == (x | y));
+      big_bitwise(&r, &a, &b, '^');
+      assert(big_get_wide(&r) == (x ^ y));
+      assert(big_compare(&a, &b) == (x > y) - (x < y));
+
+      if (y) {
+        big_divide(&r, NULL, &a, &b);
+        assert(big_get_wide(&r) == x / y);
+        big_divide(NULL, &r, &a, &b);
+        assert(big_get_wide(&r) == x % y);
+      }
+    }
+
+    for (int count = 0; count < 130; count += 7) {
+      big_shift_right(&r, &a, count);
+      assert(big_get_wide(&r) == values[i] >> (count < 127 ? count : 127));
+    }
+  }
+
+  //2^127 just misses; -2^127 just fits
+  big_set_wide(&a, 1);
+  big_shift_left(&a, &a, 127);
+  assert(!big_fits_wide(&a));
+  big_negate(&a, &a);
+  assert(big_fits_wide(&a));
+
+  //30! = 265252859812191058636308480000000
+  big_product_range(&r, 1, 30);
+  __int128 factorial = 1;
+  for (int i = 2; i <= 30; i++)
+    factorial *= i;
+  assert(big_get_wide(&r) == factorial);
+
+  //2^1000 converts exactly, and a bigint too large for a double overflows
+  big_set_wide(&a, 3);
+  big_shift_left(&a, &a, 1000);
+  assert(big_get_double(&a) == ldexp(3.0, 1000));
+  big_shift_left(&a, &a, 100);
+  assert(isinf(big_get_double(&a)));
+
+  big_free(&a);
+  big_free(&b);
+  big_free(&r);
+}
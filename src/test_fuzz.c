@@ -0,0 +1,944 @@
+/* ccalc -- evaluate C-style expressions from the command line.
+   Copyright (C) 2015-2017 Gregory Kikola.
+
+   This file is part of ccalc.
+
+   ccalc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   ccalc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with ccalc.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Written by Gregory Kikola <gkikola@gmail.com>. */
+
+//Differential fuzzer. Random expressions are evaluated by every way ccalc
+//has of evaluating one: the parser's own interpreter, a compiled and
+//folded tree, a plan with its literals bound as parameters, the shared
+//DAG used by --batch and the block kernels used by --columns. Each result
+//is checked against a reference evaluation written directly in C.
+//
+//Each random shape is filled with LANES different sets of literals, so
+//the block kernels see whole vectors of mixed ints and floats. Parsing
+//takes longer than the rest, so only one lane in PARSE_EVERY goes through
+//the interpreter and the folded tree; the others are bound straight to
+//the plan that the first lane's text compiles to. Literals
+//are chosen to suit the operator they feed, so that most cases get past
+//the type checks and division by zero to the arithmetic itself.
+//
+//The block kernels compute ** and some functions with vmath, which may
+//differ from libm in the last bits. A shape uses at most one of them,
+//and each of its lanes may match either the reference with libm or the
+//same reference with vmath, since a block whose lanes mix ints and
+//floats still goes through libm.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <limits.h>
+#include <math.h>
+#include <setjmp.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "batch.h"
+#include "compile.h"
+#include "dag.h"
+#include "error.h"
+#include "evaluate.h"
+#include "options.h"
+#include "plan.h"
+#include "value.h"
+#include "vmath.h"
+
+#define DEFAULT_SHAPES 2000
+#define LANES 64
+#define MAX_DEPTH 6
+#define PARSE_EVERY 4 //one lane in this many is also parsed
+#define MAX_LITERALS 16 //past this, every new node is a literal
+#define TEXT_SIZE 1024
+
+//what a literal should be, for the operator it feeds
+#define WANT_INT 1
+#define WANT_NONZERO 2
+
+//sets the trap for the next error; nonzero once it has been sprung
+#define trapped(trap) setjmp(*(trap))
+
+#define COUNT(array) ((int)(sizeof(array) / sizeof(array[0])))
+#define BOTH_INT(a, b) ((a).type != FLOAT && (b).type != FLOAT)
+#define AS_FLOAT(v) ((v).type == FLOAT ? (v).data.fvalue : (double)wide_of(v))
+
+typedef enum {
+  FUZZ_LITERAL,
+  FUZZ_UNARY,
+  FUZZ_BINARY,
+  FUZZ_CONDITIONAL,
+  FUZZ_FUNCTION,
+} fuzz_kind;
+
+typedef struct fuzz_node {
+  fuzz_kind kind;
+  char *symbol; //operator or function name
+  int slot; //which literal, for literals
+  int wants; //WANT_INT and WANT_NONZERO, for literals
+  int argc;
+  struct fuzz_node *args[3];
+} fuzz_node;
+
+typedef enum { RESULT_OK, RESULT_ERROR } result_status;
+
+typedef struct {
+  result_status status;
+  value val;
+} outcome;
+
+char *unary_ops[] = { "-", "!", "~" };
+char *binary_ops[] = { "+", "-", "*", "/", "//", "%", "**", "<", "<=", ">",
+                       ">=", "==", "!=", "&&", "||", "&", "|", "^", "<<",
+                       ">>", "," };
+//the functions that --columns hands to vmath have one, except for pow and
+//exp2, which keep integer powers exact
+typedef struct {
+  char *name;
+  int argc;
+  double (*libm)(double);
+  vector_function vector;
+} fuzz_function;
+
+fuzz_function functions[] = {
+  { "abs", 1, NULL, NULL }, { "floor", 1, NULL, NULL },
+  { "min", 2, NULL, NULL }, { "max", 2, NULL, NULL },
+  { "powmod", 3, NULL, NULL },
+  { "sqrt", 1, sqrt, vector_sqrt }, { "exp", 1, exp, vector_exp },
+  { "log", 1, log, vector_log }, { "log2", 1, log2, vector_log2 },
+  { "log10", 1, log10, vector_log10 }, { "sin", 1, sin, vector_sin },
+  { "cos", 1, cos, vector_cos }, { "tan", 1, tan, vector_tan },
+  { "erf", 1, erf, vector_erf }, { "exp2", 1, NULL, vector_exp2 },
+  { "pow", 2, NULL, NULL },
+};
+
+uint64_t random_state = 88172645463325252UL;
+options opts;
+long num_cases, num_errors, num_evaluations;
+
+uint64_t next_random();
+fuzz_node *random_tree(int depth, int *num_literals, int wants,
+                       bool *uses_vmath);
+int child_wants(fuzz_node *node, int wants, int arg);
+bool is_vmath(fuzz_function *function);
+void literal_wants(fuzz_node *node, int wants[]);
+void free_tree(fuzz_node *node);
+void random_literal(value *val, int wants);
+char *write_text(char *text, char *end, fuzz_node *node, value literals[]);
+char *write_string(char *text, char *end, char *str);
+char *write_literal(char *text, char *end, value *val);
+outcome reference(fuzz_node *node, value literals[], bool vmath);
+wide_int wide_of(value v);
+void set_integer(value *val, wide_int wvalue);
+void set_arithmetic(value *val, bool overflow, wide_int *wvalue,
+                    double fvalue);
+void set_negated(value *val, wide_int wvalue);
+void reference_unary(char *op, value a, outcome *out);
+void reference_binary(char *op, value a, value b, outcome *out, bool vmath);
+void reference_function(char *name, int argc, outcome args[], outcome *out,
+                        bool vmath);
+void reference_power(value a, value b, outcome *out);
+void reference_power_mod(value a, value b, value m, outcome *out);
+void run_shape(fuzz_node *tree, int num_literals, bool uses_vmath);
+bool run_block(block_program *prog, value_block columns[], fuzz_node *tree,
+               value literals[][MAX_PARAMS], int num_literals, bool lanes[],
+               outcome expected[], outcome expected_vmath[]);
+char *lane_text(char *text, fuzz_node *tree, value literals[]);
+bool same_outcome(outcome *expected, outcome *got);
+void report(char *backend, char *text, outcome *expected, outcome *got);
+void print_outcome(outcome *out);
+
+int main(int argc, char *argv[]) {
+  long shapes = (argc > 1) ? atol(argv[1]) : DEFAULT_SHAPES;
+  if (argc > 2)
+    random_state ^= strtoull(argv[2], NULL, 0) * 0x9e3779b97f4a7c15UL;
+
+  char *args[] = { "test_fuzz", NULL };
+  int expr_index;
+  read_options(1, args, &expr_index, &opts);
+
+  //128-bit results only need to last as long as their shape
+  arena mem;
+  arena_init(&mem, 4096);
+  set_wide_arena(&mem);
+
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  for (long i = 0; i < shapes; i++) {
+    int num_literals = 0;
+    bool uses_vmath = false;
+    fuzz_node *tree = random_tree(0, &num_literals, 0, &uses_vmath);
+    run_shape(tree, num_literals, uses_vmath);
+    free_tree(tree);
+    arena_reset(&mem);
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  double seconds = (end.tv_sec - start.tv_sec)
+    + (end.tv_nsec - start.tv_nsec) / 1.e9;
+  printf("%ld cases (%ld errors) in %.2f s, %.0f cases/s, "
+         "%.0f evaluations/s\n", num_cases, num_errors, seconds,
+         num_cases / seconds, num_evaluations / seconds);
+  return 0;
+}
+
+uint64_t next_random() {
+  random_state ^= random_state << 13;
+  random_state ^= random_state >> 7;
+  random_state ^= random_state << 17;
+  return random_state;
+}
+
+fuzz_node *random_tree(int depth, int *num_literals, int wants,
+                       bool *uses_vmath) {
+  fuzz_node *node = malloc(sizeof(fuzz_node));
+  if (!node)
+    raise_error(ERROR_SYS, "memory allocation failure");
+
+  //a divisor that is a literal is one that can be kept from being zero
+  int choice = next_random() % 10;
+  if (depth >= MAX_DEPTH || *num_literals >= MAX_LITERALS
+      || (depth > 0 && choice < 3)
+      || ((wants & WANT_NONZERO) && choice < 8)) {
+    node->kind = FUZZ_LITERAL;
+    node->slot = (*num_literals)++;
+    node->wants = wants;
+    node->argc = 0;
+    return node;
+  }
+
+  if (choice < 4) {
+    node->kind = FUZZ_UNARY;
+    node->symbol = unary_ops[next_random() % COUNT(unary_ops)];
+    node->argc = 1;
+  } else if (choice < 8) {
+    node->kind = FUZZ_BINARY;
+    do { //where an integer is wanted, / and ** would often give a float
+      node->symbol = binary_ops[next_random() % COUNT(binary_ops)];
+    } while (((wants & WANT_INT) && (!strcmp(node->symbol, "/")
+                                      || !strcmp(node->symbol, "**")))
+             || (*uses_vmath && !strcmp(node->symbol, "**")));
+    *uses_vmath |= !strcmp(node->symbol, "**");
+    node->argc = 2;
+  } else if (choice < 9) {
+    node->kind = FUZZ_CONDITIONAL;
+    node->argc = 3;
+  } else {
+    node->kind = FUZZ_FUNCTION;
+    fuzz_function *function;
+    do { //only one call that vmath may change, and no floats for integers
+      function = &functions[next_random() % COUNT(functions)];
+    } while ((*uses_vmath && is_vmath(function))
+             || ((wants & WANT_INT) && (function->libm || function->vector
+                                        || !strcmp(function->name, "pow"))));
+    *uses_vmath |= is_vmath(function);
+    node->symbol = function->name;
+    node->argc = function->argc;
+  }
+
+  for (int i = 0; i < node->argc; i++)
+    node->args[i] = random_tree(depth + 1, num_literals,
+                                child_wants(node, wants, i), uses_vmath);
+  return node;
+}
+
+//The operators that need integers want them all the way down through
+//the ones that keep integers integers, and divisors want to be nonzero.
+//Comparisons and floats start over.
+int child_wants(fuzz_node *node, int wants, int arg) {
+  char *op = node->symbol;
+
+  switch (node->kind) {
+  case FUZZ_CONDITIONAL:
+    return (arg == 0) ? 0 : wants & WANT_INT;
+  case FUZZ_UNARY:
+    return (*op == '~') ? WANT_INT : (*op == '-') ? wants & WANT_INT : 0;
+  case FUZZ_FUNCTION:
+    if (!strcmp(op, "powmod"))
+      return (arg == 2) ? WANT_INT | WANT_NONZERO : WANT_INT;
+    if (!strcmp(op, "abs") || !strcmp(op, "min") || !strcmp(op, "max"))
+      return wants & WANT_INT;
+    return 0;
+  default:
+    break;
+  }
+
+  if (!strcmp(op, "%") || !strcmp(op, "//"))
+    return (arg == 1) ? WANT_INT | WANT_NONZERO : WANT_INT;
+  if (!strcmp(op, "/"))
+    return (arg == 1) ? WANT_NONZERO : 0;
+  if (!strcmp(op, "&") || !strcmp(op, "|") || !strcmp(op, "^")
+      || !strcmp(op, "<<") || !strcmp(op, ">>"))
+    return WANT_INT;
+  if (!strcmp(op, "+") || !strcmp(op, "-") || !strcmp(op, "*")
+      || !strcmp(op, ","))
+    return wants & WANT_INT;
+  return 0;
+}
+
+bool is_vmath(fuzz_function *function) {
+  return (function->vector && function->vector != vector_sqrt)
+    || !strcmp(function->name, "pow");
+}
+
+void literal_wants(fuzz_node *node, int wants[]) {
+  if (node->kind == FUZZ_LITERAL)
+    wants[node->slot] = node->wants;
+  for (int i = 0; i < node->argc; i++)
+    literal_wants(node->args[i], wants);
+}
+
+void free_tree(fuzz_node *node) {
+  for (int i = 0; i < node->argc; i++)
+    free_tree(node->args[i]);
+  free(node);
+}
+
+//Mostly small numbers, where the operators behave differently for each
+//sign and for zero, with some wide integers that do not fit in a NaN box.
+//Floats are whole or halves, which the parser reads exactly. An operator
+//that wants an integer still gets a float now and then, to check that
+//it fails.
+void random_literal(value *val, int wants) {
+  int choice = next_random() % 100;
+
+  if ((wants & WANT_INT) ? choice == 0 : choice < 30) {
+    val->type = FLOAT;
+    val->data.fvalue = (next_random() % 2000) / 2.0;
+  } else if (choice < 40) {
+    val->type = INT;
+    val->data.ivalue = next_random() % 4;
+  } else if (choice < 50) {
+    val->type = INT;
+    val->data.ivalue = next_random() >> 2;
+  } else {
+    val->type = INT;
+    val->data.ivalue = next_random() % 1000;
+  }
+
+  if ((wants & WANT_NONZERO) && val->type == INT && val->data.ivalue == 0)
+    val->data.ivalue = 1;
+  else if ((wants & WANT_NONZERO) && val->type == FLOAT
+           && val->data.fvalue == 0.0)
+    val->data.fvalue = 0.5;
+}
+
+//writes node as ccalc source, with every operation in parentheses so that
+//precedence cannot change it; this is done by hand since snprintf would
+//take longer than evaluating the result
+char *write_text(char *text, char *end, fuzz_node *node, value literals[]) {
+  switch (node->kind) {
+  case FUZZ_LITERAL:
+    return write_literal(text, end, &literals[node->slot]);
+  case FUZZ_UNARY:
+    text = write_string(text, end, "(");
+    text = write_string(text, end, node->symbol);
+    break;
+  case FUZZ_FUNCTION:
+    text = write_string(text, end, node->symbol);
+    text = write_string(text, end, "(");
+    break;
+  default:
+    text = write_string(text, end, "(");
+    break;
+  }
+
+  for (int i = 0; i < node->argc; i++) {
+    if (i > 0 && node->kind == FUZZ_BINARY) {
+      text = write_string(text, end, " ");
+      text = write_string(text, end, node->symbol);
+      text = write_string(text, end, " ");
+    } else if (i > 0 && node->kind == FUZZ_FUNCTION) {
+      text = write_string(text, end, ", ");
+    } else if (i > 0) {
+      text = write_string(text, end, (i == 1) ? " ? " : " : ");
+    }
+    text = write_text(text, end, node->args[i], literals);
+  }
+  return write_string(text, end, ")");
+}
+
+char *write_string(char *text, char *end, char *str) {
+  while (*str && text < end)
+    *text++ = *str++;
+  return text;
+}
+
+//literals are never negative, and floats are whole or halves
+char *write_literal(char *text, char *end, value *val) {
+  char digits[32];
+  char *start = digits + sizeof(digits) - 1;
+  *start = '\0';
+
+  unsigned long whole = (val->type == INT) ? (unsigned long)val->data.ivalue
+    : (unsigned long)val->data.fvalue;
+  if (val->type == FLOAT) {
+    *--start = (val->data.fvalue != whole) ? '5' : '0';
+    *--start = '.';
+  }
+  do {
+    *--start = '0' + whole % 10;
+    whole /= 10;
+  } while (whole);
+
+  return write_string(text, end, start);
+}
+
+outcome reference(fuzz_node *node, value literals[], bool vmath) {
+  outcome args[3], out = { RESULT_OK };
+
+  if (node->kind == FUZZ_LITERAL) {
+    out.val = literals[node->slot];
+    return out;
+  }
+
+  //every operand is evaluated, even the branch a conditional discards, so
+  //an error anywhere is an error
+  for (int i = 0; i < node->argc; i++) {
+    args[i] = reference(node->args[i], literals, vmath);
+    if (args[i].status > out.status)
+      out.status = args[i].status;
+  }
+  if (out.status != RESULT_OK)
+    return out;
+
+  value a = args[0].val, b = args[node->argc - 1].val;
+  switch (node->kind) {
+  case FUZZ_CONDITIONAL:
+    if (a.type == FLOAT ? a.data.fvalue != 0.0 : wide_of(a) != 0)
+      out.val = args[1].val;
+    else
+      out.val = args[2].val;
+    break;
+  case FUZZ_UNARY:
+    reference_unary(node->symbol, a, &out);
+    break;
+  case FUZZ_FUNCTION:
+    reference_function(node->symbol, node->argc, args, &out, vmath);
+    break;
+  default:
+    reference_binary(node->symbol, a, b, &out, vmath);
+    break;
+  }
+  return out;
+}
+
+//read from the stored copy, not through value.c
+wide_int wide_of(value v) {
+  if (v.type == INT)
+    return v.data.ivalue;
+  if (v.type == FLOAT) //callers look at a float themselves
+    return 0;
+  return *v.data.wvalue;
+}
+
+//an INT when it fits in a long int, else WIDE; only value.c may make
+//the stored copy a WIDE value points to
+void set_integer(value *val, wide_int wvalue) {
+  if (wvalue == (long)wvalue) {
+    val->type = INT;
+    val->data.ivalue = wvalue;
+  } else {
+    value_set_wide(val, wvalue);
+  }
+}
+
+//the exact result, or the float one if the exact one needed over 128 bits;
+//wvalue is read only after a checked operation has written it
+void set_arithmetic(value *val, bool overflow, wide_int *wvalue,
+                    double fvalue) {
+  if (overflow) {
+    val->type = FLOAT;
+    val->data.fvalue = fvalue;
+  } else {
+    set_integer(val, *wvalue);
+  }
+}
+
+//-2^127 is the one integer whose negation needs a float
+void set_negated(value *val, wide_int wvalue) {
+  wide_int negated;
+  bool overflow = __builtin_sub_overflow((wide_int)0, wvalue, &negated);
+  set_arithmetic(val, overflow, &negated, -(double)wvalue);
+}
+
+void reference_unary(char *op, value a, outcome *out) {
+  wide_int wa = wide_of(a);
+
+  out->val.type = INT;
+  if (*op == '!') {
+    out->val.data.ivalue = (a.type == FLOAT) ? !a.data.fvalue : !wa;
+  } else if (*op == '~') {
+    if (a.type != FLOAT)
+      set_integer(&out->val, ~wa);
+    else
+      out->status = RESULT_ERROR;
+  } else if (a.type == FLOAT) {
+    out->val.type = FLOAT;
+    out->val.data.fvalue = -a.data.fvalue;
+  } else {
+    set_negated(&out->val, wa);
+  }
+}
+
+//Integer arithmetic is exact in 128 bits and a float past that. A shift
+//by a negative count goes the other way, and a right shift past the
+//width of the value leaves only the sign.
+void reference_binary(char *op, value a, value b, outcome *out, bool vmath) {
+  wide_int wa = wide_of(a), wb = wide_of(b), wr;
+  double fa = AS_FLOAT(a), fb = AS_FLOAT(b);
+  long *ir = &out->val.data.ivalue;
+  double *fr = &out->val.data.fvalue;
+  bool ints = BOTH_INT(a, b);
+
+  out->val.type = INT;
+  if (!strcmp(op, ",")) {
+    out->val = b;
+  } else if (!strcmp(op, "+") || !strcmp(op, "-") || !strcmp(op, "*")) {
+    if (!ints) {
+      out->val.type = FLOAT;
+      *fr = (*op == '+') ? fa + fb : (*op == '-') ? fa - fb : fa * fb;
+    } else if (*op == '+') {
+      set_arithmetic(&out->val, __builtin_add_overflow(wa, wb, &wr), &wr,
+                     fa + fb);
+    } else if (*op == '-') {
+      set_arithmetic(&out->val, __builtin_sub_overflow(wa, wb, &wr), &wr,
+                     fa - fb);
+    } else {
+      set_arithmetic(&out->val, __builtin_mul_overflow(wa, wb, &wr), &wr,
+                     fa * fb);
+    }
+  } else if (!strcmp(op, "/")) {
+    if (fb == 0) {
+      out->status = RESULT_ERROR;
+    } else if (ints && wb == -1) {
+      set_negated(&out->val, wa);
+    } else if (ints && wa % wb == 0) {
+      set_integer(&out->val, wa / wb);
+    } else {
+      out->val.type = FLOAT;
+      *fr = fa / fb;
+    }
+  } else if (!strcmp(op, "//") || !strcmp(op, "%")) {
+    if (!ints || wb == 0)
+      out->status = RESULT_ERROR;
+    else if (wb == -1 && *op == '/')
+      set_negated(&out->val, wa);
+    else if (wb == -1) //ccalc defines LONG_MIN % -1, which C does not
+      *ir = 0;
+    else
+      set_integer(&out->val, (*op == '/') ? wa / wb : wa % wb);
+  } else if (!strcmp(op, "**") && vmath && !ints) {
+    out->val.type = FLOAT;
+    vector_pow(fr, &fa, &fb, 1);
+  } else if (!strcmp(op, "**")) {
+    reference_power(a, b, out);
+  } else if (!strcmp(op, "<<") || !strcmp(op, ">>")) {
+    bool left = (*op == '<') == (wb >= 0);
+    unsigned __int128 count = (wb < 0) ? -(unsigned __int128)wb
+                                       : (unsigned __int128)wb;
+    if (!ints)
+      out->status = RESULT_ERROR;
+    else if (!left)
+      set_integer(&out->val, wa >> ((count > 127) ? 127 : count));
+    else if (wa == 0)
+      *ir = 0;
+    else if (count <= 127 && (wr = (unsigned __int128)wa << count) >> count
+             == wa)
+      set_integer(&out->val, wr);
+    else
+      set_arithmetic(&out->val, true, NULL,
+                     ldexp(fa, (count > 2048) ? 2048 : count));
+  } else if (!strcmp(op, "&&")) {
+    *ir = ints ? wa && wb : fa && fb;
+  } else if (!strcmp(op, "||")) {
+    *ir = ints ? wa || wb : fa || fb;
+  } else if (!strcmp(op, "==")) {
+    *ir = ints ? wa == wb : fa == fb;
+  } else if (!strcmp(op, "!=")) {
+    *ir = ints ? wa != wb : fa != fb;
+  } else if (!strcmp(op, "<")) {
+    *ir = ints ? wa < wb : fa < fb;
+  } else if (!strcmp(op, "<=")) {
+    *ir = ints ? wa <= wb : fa <= fb;
+  } else if (!strcmp(op, ">")) {
+    *ir = ints ? wa > wb : fa > fb;
+  } else if (!strcmp(op, ">=")) {
+    *ir = ints ? wa >= wb : fa >= fb;
+  } else if (!ints) { //the bitwise operators need integers
+    out->status = RESULT_ERROR;
+  } else if (!strcmp(op, "&")) {
+    set_integer(&out->val, wa & wb);
+  } else if (!strcmp(op, "|")) {
+    set_integer(&out->val, wa | wb);
+  } else {
+    set_integer(&out->val, wa ^ wb);
+  }
+}
+
+//With vmath, the functions that have a kernel use it, just as a block
+//does when its lanes are all ints or all floats
+void reference_function(char *name, int argc, outcome args[], outcome *out,
+                        bool vmath) {
+  value a = args[0].val, b = args[argc - 1].val;
+  bool ints = BOTH_INT(a, b);
+  wide_int wa = wide_of(a);
+  double fa = AS_FLOAT(a), fb = AS_FLOAT(b);
+
+  fuzz_function *function = functions;
+  while (strcmp(function->name, name))
+    function++;
+
+  if (!strcmp(name, "powmod")) {
+    reference_power_mod(a, args[1].val, args[2].val, out);
+    return;
+  }
+
+  out->val.type = ints ? INT : FLOAT;
+  if (function->libm) {
+    out->val.type = FLOAT;
+    if (vmath)
+      function->vector(&out->val.data.fvalue, &fa, 1);
+    else
+      out->val.data.fvalue = function->libm(fa);
+  } else if (!strcmp(name, "exp2") || !strcmp(name, "pow")) {
+    value base = a;
+    if (argc == 1) {
+      base.type = INT;
+      base.data.ivalue = 2;
+    }
+
+    //integer powers stay exact either way
+    if (!vmath || BOTH_INT(base, b))
+      reference_power(base, b, out);
+    else if (argc == 1)
+      vector_exp2(&out->val.data.fvalue, &fb, 1);
+    else
+      vector_pow(&out->val.data.fvalue, &fa, &fb, 1);
+  } else if (!strcmp(name, "abs")) {
+    if (a.type == FLOAT)
+      out->val.data.fvalue = fabs(a.data.fvalue);
+    else if (wa < 0)
+      set_negated(&out->val, wa);
+    else
+      out->val = a;
+  } else if (!strcmp(name, "floor")) {
+    if (a.type != FLOAT) {
+      out->val = a;
+    } else {
+      //stays a float when it will not fit in a long int
+      double result = floor(a.data.fvalue);
+      out->val.data.fvalue = result;
+      if (result >= nextafter(LONG_MIN + 0.5, 0)
+          && result <= nextafter(LONG_MAX + 0.5, 0)) {
+        out->val.type = INT;
+        out->val.data.ivalue = result;
+      }
+    }
+  } else if (!strcmp(name, "min")) {
+    if (ints)
+      out->val = (wa < wide_of(b)) ? a : b;
+    else
+      out->val.data.fvalue = fmin(AS_FLOAT(a), AS_FLOAT(b));
+  } else {
+    if (ints)
+      out->val = (wa > wide_of(b)) ? a : b;
+    else
+      out->val.data.fvalue = fmax(AS_FLOAT(a), AS_FLOAT(b));
+  }
+
+  if (out->status == RESULT_OK && out->val.type == FLOAT
+      && !isfinite(out->val.data.fvalue))
+    out->status = RESULT_ERROR;
+}
+
+//an integer for a nonnegative integer exponent, unless it overflows 128
+//bits
+void reference_power(value a, value b, outcome *out) {
+  if (BOTH_INT(a, b) && wide_of(b) >= 0) {
+    wide_int base = wide_of(a), exp = wide_of(b), result = 1;
+    bool overflow = false;
+
+    //exponents go up to 2^127, too many to multiply out for these
+    if (base == -1)
+      result = (exp % 2) ? -1 : 1;
+    else if (base == 0 || base == 1)
+      result = (exp == 0) ? 1 : base;
+    else
+      for (wide_int i = 0; i < exp && !overflow; i++)
+        overflow = __builtin_mul_overflow(result, base, &result);
+
+    if (!overflow) {
+      set_integer(&out->val, result);
+      return;
+    }
+  }
+
+  out->val.type = FLOAT;
+  out->val.data.fvalue = pow(AS_FLOAT(a), AS_FLOAT(b));
+}
+
+//by repeated multiplication, a different route from ccalc's
+void reference_power_mod(value a, value b, value m, outcome *out) {
+  if (a.type != INT || b.type != INT || m.type != INT || b.data.ivalue < 0
+      || m.data.ivalue == 0) {
+    out->status = RESULT_ERROR;
+    return;
+  }
+
+  unsigned __int128 modulus = (m.data.ivalue < 0)
+    ? -(unsigned __int128)m.data.ivalue : (unsigned __int128)m.data.ivalue;
+  __int128 base = a.data.ivalue % (__int128)modulus;
+  unsigned __int128 factor = (base < 0) ? (unsigned __int128)base + modulus
+                                         : (unsigned __int128)base;
+  unsigned __int128 result = 1 % modulus;
+  for (long exp = b.data.ivalue; exp; exp /= 2) {
+    if (exp % 2)
+      result = result * factor % modulus;
+    factor = factor * factor % modulus;
+  }
+
+  out->val.type = INT;
+  out->val.data.ivalue = result;
+}
+
+void run_shape(fuzz_node *tree, int num_literals, bool uses_vmath) {
+  static value literals[LANES][MAX_PARAMS];
+  static value_block columns[MAX_PARAMS];
+  value params[MAX_PARAMS];
+  char text[TEXT_SIZE];
+  outcome expected[LANES], expected_vmath[LANES];
+  bool lanes[LANES];
+  int wants[MAX_PARAMS];
+  char template[TEXT_SIZE];
+  expr_node *volatile plan = NULL;
+  block_program *volatile prog = NULL;
+  expr_dag *dag = new_dag();
+  int roots[LANES];
+  jmp_buf trap;
+  outcome got;
+
+  literal_wants(tree, wants);
+  error_trap = &trap;
+  for (int lane = 0; lane < LANES; lane++) {
+    for (int i = 0; i < num_literals; i++)
+      random_literal(&literals[lane][i], wants[i]);
+    expected[lane] = reference(tree, literals[lane], false);
+    expected_vmath[lane] = uses_vmath ? reference(tree, literals[lane], true)
+      : expected[lane];
+    num_cases++;
+    num_errors += expected[lane].status == RESULT_ERROR;
+
+    //parsing costs more than everything else put together, so only some
+    //lanes are written out and parsed; the first one gives the plan
+    if (lane % PARSE_EVERY == 0) {
+      lane_text(text, tree, literals[lane]);
+      num_evaluations += 2;
+
+      //the interpreter, which evaluates as it parses
+      got.status = RESULT_ERROR;
+      if (!trapped(&trap)) {
+        evaluate(text, &got.val, &opts);
+        got.status = RESULT_OK;
+      }
+      if (!same_outcome(&expected[lane], &got))
+        report("evaluate", text, &expected[lane], &got);
+
+      //a compiled tree, folded down to a constant
+      got.status = RESULT_ERROR;
+      if (!trapped(&trap)) {
+        expr_node *folded = compile_expression(text, &opts, NULL, 0);
+        execute(folded, NULL, 0, &opts, &got.val);
+        free_node(folded);
+        got.status = RESULT_OK;
+      }
+      if (!same_outcome(&expected[lane], &got))
+        report("compile_expression", text, &expected[lane], &got);
+
+      //the same shape with its literals taken out as parameters, which is
+      //what the plan cache runs; they come out in the order they were
+      //written, so the other lanes use their literals as they are
+      int num_params = normalize_expression(text, &opts, template, TEXT_SIZE,
+                                            params, MAX_PARAMS);
+      bool same = num_params == num_literals;
+      for (int i = 0; same && i < num_params; i++)
+        same = params[i].type == literals[lane][i].type
+          && params[i].data.ivalue == literals[lane][i].data.ivalue;
+      if (!same) {
+        printf("literals not taken out of %s\n", text);
+        exit(1);
+      }
+      if (!plan)
+        plan = compile_expression(template, &opts, NULL, 0);
+    }
+
+    got.status = RESULT_ERROR;
+    if (!trapped(&trap)) {
+      execute(plan, literals[lane], num_literals, &opts, &got.val);
+      got.status = RESULT_OK;
+    }
+    if (!same_outcome(&expected[lane], &got))
+      report("execute", lane_text(text, tree, literals[lane]),
+             &expected[lane], &got);
+
+    roots[lane] = dag_add_tree(dag, plan, literals[lane], num_literals);
+  }
+
+  //every lane shares one DAG, as the lines of --batch do
+  for (volatile int lane = 0; lane < LANES; lane++) {
+    got.status = RESULT_ERROR;
+    if (!trapped(&trap)) {
+      dag_evaluate(dag, roots[lane], &opts, &got.val);
+      got.status = RESULT_OK;
+    }
+    if (!same_outcome(&expected[lane], &got))
+      report("dag_evaluate", lane_text(text, tree, literals[lane]),
+             &expected[lane], &got);
+  }
+  num_evaluations += 3 * LANES;
+
+  //and every lane at once through the block kernels, as --columns does;
+  //an error in any lane fails the whole block, so then the lanes that
+  //succeed go through again without the others
+  prog = new_block_program(plan);
+  bool any_failed = false;
+  for (int lane = 0; lane < LANES; lane++) {
+    lanes[lane] = true;
+    any_failed |= expected[lane].status != RESULT_OK;
+  }
+  if (!run_block(prog, columns, tree, literals, num_literals, lanes,
+                 expected, expected_vmath) && !any_failed) {
+    printf("execute_block: %s in a block where every lane succeeds, such "
+           "as %s\n", error_message, lane_text(text, tree, literals[0]));
+    exit(1);
+  }
+
+  if (any_failed) {
+    for (int lane = 0; lane < LANES; lane++)
+      lanes[lane] = expected[lane].status == RESULT_OK;
+    if (!run_block(prog, columns, tree, literals, num_literals, lanes,
+                   expected, expected_vmath)) {
+      printf("execute_block: %s in the lanes that succeed on their own, "
+             "such as %s\n", error_message,
+             lane_text(text, tree, literals[0]));
+      exit(1);
+    }
+  }
+  error_trap = NULL;
+
+  free_block_program(prog);
+  free_node(plan);
+  free_dag(dag);
+}
+
+//Runs the lanes that are set through the block kernels, packed together,
+//and checks each result. Returns false if the block raised an error.
+bool run_block(block_program *prog, value_block columns[], fuzz_node *tree,
+               value literals[][MAX_PARAMS], int num_literals, bool lanes[],
+               outcome expected[], outcome expected_vmath[]) {
+  volatile int count = 0;
+  for (int i = 0; i < num_literals; i++)
+    block_init(&columns[i]);
+  for (int lane = 0; lane < LANES; lane++) {
+    if (!lanes[lane])
+      continue;
+    for (int i = 0; i < num_literals; i++)
+      block_set_lane(&columns[i], count, &literals[lane][i]);
+    count++;
+  }
+
+  jmp_buf trap;
+  jmp_buf *prev_trap = error_trap;
+  bool ran = false;
+  error_trap = &trap;
+  if (count > 0 && !trapped(&trap)) {
+    value_block *results = execute_block(prog, columns, num_literals, count,
+                                         &opts);
+    error_trap = prev_trap;
+    ran = true;
+
+    outcome got = { RESULT_OK };
+    int row = 0;
+    for (int lane = 0; lane < LANES; lane++) {
+      if (!lanes[lane])
+        continue;
+      block_get_lane(results, row++, &got.val);
+      if (!same_outcome(&expected[lane], &got)
+          && !same_outcome(&expected_vmath[lane], &got)) {
+        char text[TEXT_SIZE];
+        report("execute_block", lane_text(text, tree, literals[lane]),
+               &expected[lane], &got);
+      }
+    }
+  }
+  error_trap = prev_trap;
+
+  for (int i = 0; i < num_literals; i++)
+    block_release(&columns[i]);
+  return ran || count == 0;
+}
+
+//writes out the expression for one lane
+char *lane_text(char *text, fuzz_node *tree, value literals[]) {
+  *write_text(text, text + TEXT_SIZE - 1, tree, literals) = '\0';
+  return text;
+}
+
+bool same_outcome(outcome *expected, outcome *got) {
+  if (expected->status != got->status)
+    return false;
+  if (expected->status == RESULT_ERROR)
+    return true;
+  if (expected->val.type != got->val.type)
+    return false;
+
+  if (got->val.type != FLOAT)
+    return wide_of(expected->val) == wide_of(got->val);
+  else if (isnan(expected->val.data.fvalue))
+    return isnan(got->val.data.fvalue);
+  else
+    return expected->val.data.fvalue == got->val.data.fvalue;
+}
+
+void report(char *backend, char *text, outcome *expected, outcome *got) {
+  printf("%s: %s\n  expected ", backend, text);
+  print_outcome(expected);
+  printf("\n  got ");
+  print_outcome(got);
+  printf("\n");
+  exit(1);
+}
+
+void print_outcome(outcome *out) {
+  char wide_text[48];
+
+  if (out->status == RESULT_ERROR) {
+    printf("an error");
+  } else if (out->val.type == INT) {
+    printf("%ld (int)", out->val.data.ivalue);
+  } else if (out->val.type == WIDE) {
+    wide_to_string(wide_of(out->val), wide_text, sizeof(wide_text));
+    printf("%s (wide)", wide_text);
+  } else {
+    printf("%.17g (float)", out->val.data.fvalue);
+  }
+}
@@ -0,0 +1,250 @@
+/* ccalc -- evaluate C-style expressions from the command line.
+   Copyright (C) 2015-2017 Gregory Kikola.
+
+   This file is part of ccalc.
+
+   ccalc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   ccalc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with ccalc.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Written by Gregory Kikola <gkikola@gmail.com>. */
+
+//Compares the vectorized math functions against libm. Every function is
+//run over random arguments drawn from the range where the vector code is
+//used and from the whole range of doubles, and the largest error found
+//is checked against the bound documented in vmath.h.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "vmath.h"
+
+#define BATCH_SIZE 1024
+#define NUM_BATCHES 400
+
+typedef struct {
+  char *name;
+  vector_function vector;
+  double (*scalar)(double);
+  double low;
+  double high;
+  double max_ulp;
+} unary_test;
+
+unary_test unary_tests[] = {
+  {"sqrt", vector_sqrt, sqrt, 0.0, 1.0e300, 0.0},
+  {"exp", vector_exp, exp, -745.0, 710.0, 1.0},
+  {"exp2", vector_exp2, exp2, -1075.0, 1024.0, 1.0},
+  {"log", vector_log, log, 0.0, 1.0e300, 1.0},
+  {"log2", vector_log2, log2, 0.0, 1.0e300, 1.0},
+  {"log10", vector_log10, log10, 0.0, 1.0e300, 1.0},
+  {"sin", vector_sin, sin, -1.0e6, 1.0e6, 1.0},
+  {"cos", vector_cos, cos, -1.0e6, 1.0e6, 1.0},
+  {"tan", vector_tan, tan, -1.0e6, 1.0e6, 2.0},
+  {"erf", vector_erf, erf, -7.0, 7.0, 1.0},
+};
+
+double ulp_error(double got, double want);
+double random_double(double low, double high);
+double random_bits(void);
+uint64_t next_random(void);
+double check_unary(unary_test *test);
+double check_pow(void);
+void check_exact(void);
+
+uint64_t random_state = 0x9e3779b97f4a7c15;
+
+int main() {
+  int num_tests = sizeof(unary_tests) / sizeof(unary_tests[0]);
+
+  for (int i = 0; i < num_tests; i++) {
+    double error = check_unary(&unary_tests[i]);
+    printf("%-6s max error %.3f ulp\n", unary_tests[i].name, error);
+    fflush(stdout);
+    assert(error <= unary_tests[i].max_ulp);
+  }
+
+  double error = check_pow();
+  printf("%-6s max error %.3f ulp\n", "pow", error);
+  fflush(stdout);
+  assert(error <= 1.0);
+
+  check_exact();
+
+  printf("%d functions checked against libm.\n", num_tests + 1);
+  return 0;
+}
+
+double ulp_error(double got, double want) {
+  if (isnan(want) || isnan(got))
+    return (isnan(want) && isnan(got)) ? 0.0 : INFINITY;
+  if (got == want)
+    return 0.0;
+  if (isinf(want) || isinf(got))
+    return INFINITY;
+
+  int exponent;
+  frexp(want, &exponent);
+  double ulp = ldexp(1.0, (exponent - 53 < -1074) ? -1074 : exponent - 53);
+  return fabs(got - want) / ulp;
+}
+
+double random_double(double low, double high) {
+  //half uniform over the range, half spread over its orders of magnitude
+  uint64_t r = next_random();
+  double unit = (r >> 11) * 0x1p-53;
+
+  if (r & 1)
+    return low + (high - low) * unit;
+
+  double limit = fmax(fabs(low), fabs(high));
+  double x = limit * pow(2.0, -60.0 * unit);
+  if (low < 0 && (r & 2))
+    x = -x;
+  return (x < low) ? low : (x > high) ? high : x;
+}
+
+double random_bits(void) {
+  uint64_t r = next_random();
+  double x;
+  memcpy(&x, &r, sizeof(x));
+  return x;
+}
+
+uint64_t next_random(void) {
+  //xorshift64*
+  random_state ^= random_state >> 12;
+  random_state ^= random_state << 25;
+  random_state ^= random_state >> 27;
+  return random_state * 0x2545f4914f6cdd1d;
+}
+
+double check_unary(unary_test *test) {
+  double x[BATCH_SIZE], out[BATCH_SIZE];
+  double worst = 0.0;
+
+  for (int batch = 0; batch < NUM_BATCHES; batch++) {
+    //every tenth batch tries arbitrary bit patterns, including infinities,
+    //NaNs and subnormals
+    for (int i = 0; i < BATCH_SIZE; i++)
+      x[i] = (batch % 10 == 9) ? random_bits()
+                               : random_double(test->low, test->high);
+
+    test->vector(out, x, BATCH_SIZE);
+
+    for (int i = 0; i < BATCH_SIZE; i++) {
+      double error = ulp_error(out[i], test->scalar(x[i]));
+      if (error > worst) {
+        worst = error;
+        if (error > test->max_ulp)
+          fprintf(stderr, "%s(%a) = %a, libm gives %a\n", test->name, x[i], out[i],
+                 test->scalar(x[i]));
+      }
+    }
+  }
+
+  return worst;
+}
+
+double check_pow(void) {
+  double x[BATCH_SIZE], y[BATCH_SIZE], out[BATCH_SIZE];
+  double worst = 0.0;
+
+  for (int batch = 0; batch < NUM_BATCHES; batch++) {
+    for (int i = 0; i < BATCH_SIZE; i++) {
+      if (batch % 10 == 9) {
+        x[i] = random_bits();
+        y[i] = random_bits();
+      } else {
+        //keep most results in range
+        x[i] = random_double(0.0, 1.0e10);
+        double limit = 700.0 / fmax(fabs(log(x[i])), 1.0e-3);
+        y[i] = random_double(-limit, limit);
+        if (batch % 10 == 8) //negative bases and whole exponents
+          x[i] = -x[i], y[i] = round(y[i]);
+      }
+    }
+
+    vector_pow(out, x, y, BATCH_SIZE);
+
+    for (int i = 0; i < BATCH_SIZE; i++) {
+      double error = ulp_error(out[i], pow(x[i], y[i]));
+      if (error > worst) {
+        worst = error;
+        if (error > 1.0)
+          fprintf(stderr, "pow(%a, %a) = %a, libm gives %a\n", x[i], y[i], out[i],
+                 pow(x[i], y[i]));
+      }
+    }
+  }
+
+  return worst;
+}
+
+void check_exact(void) {
+  //results that are exactly representable must come out exactly
+  double x[BATCH_SIZE], y[BATCH_SIZE], out[BATCH_SIZE];
+
+  for (int i = 0; i <= 22; i++) {
+    x[i] = pow(10.0, i);
+    y[i] = i;
+  }
+
+  vector_log10(out, x, 23);
+  for (int i = 0; i <= 22; i++)
+    assert(out[i] == i);
+
+  for (int i = 0; i <= 22; i++)
+    x[i] = 10.0;
+  vector_pow(out, x, y, 23);
+  for (int i = 0; i <= 22; i++)
+    assert(out[i] == pow(10.0, i));
+
+  for (int i = 0; i < 200; i++)
+    y[i] = i - 100;
+  vector_exp2(out, y, 200);
+  for (int i = 0; i < 200; i++)
+    assert(out[i] == ldexp(1.0, i - 100));
+
+  vector_log2(x, out, 200);
+  for (int i = 0; i < 200; i++)
+    assert(x[i] == i - 100);
+
+  for (int i = 0; i < 200; i++)
+    x[i] = (double)i * i;
+  vector_sqrt(out, x, 200);
+  for (int i = 0; i < 200; i++)
+    assert(out[i] == i);
+
+  x[0] = 0.0;
+  x[1] = -0.0;
+  x[2] = 1.0;
+  vector_exp(out, x, 2);
+  assert(out[0] == 1.0 && out[1] == 1.0);
+  vector_log(out, x + 2, 1);
+  assert(out[0] == 0.0);
+  vector_sin(out, x, 2);
+  assert(out[0] == 0.0 && !signbit(out[0]) && signbit(out[1]));
+  vector_cos(out, x, 2);
+  assert(out[0] == 1.0 && out[1] == 1.0);
+  vector_erf(out, x, 2);
+  assert(out[0] == 0.0 && signbit(out[1]));
+}
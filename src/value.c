@@ -19,14 +19,20 @@
 
 /* Written by Gregory Kikola <gkikola@gmail.com>. */
 
+#include <ctype.h>
 #include <float.h>
 #include <limits.h>
 #include <math.h>
+#include <stdatomic.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
+#include "bigfloat.h"
+#include "bigint.h"
 #include "error.h"
 #include "value.h"
 
@@ -38,6 +44,56 @@
 #define E 2.7182818284590452353602874
 #endif
 
+//With --bigint, results past this many bits still become floats, as they
+//would past 128 bits without it; this is a number of 20 million digits.
+#define MAX_BIG_BITS (1L << 26)
+
+//Decimal exponents past this make a literal infinite or zero in all but
+//name, as past MAX_BIG_BITS in binary; the literal keeps its double.
+#define MAX_DECIMAL_EXPONENT 20000000L
+
+static arena *big_arena = NULL; //where BIG values live, once enabled
+
+//With --digits, the bits a BIGFLOAT result is rounded to: enough for the
+//digits asked for and a word more, so that the roundings along the way
+//stay out of sight. 0 while floats are doubles.
+static size_t precise_bits = 0;
+
+//Where WIDE values live on each thread: the arena given to
+//set_wide_arena(), or else one the thread keeps for itself and never
+//resets, which is enough for callers that evaluate only a few expressions.
+#define WIDE_CHUNK_SIZE 4096
+static _Thread_local arena *wide_arena = NULL;
+static _Thread_local arena own_wide_arena;
+
+//integer results too large for 128 bits are BIG values from now on,
+//allocated from mem
+void enable_bigints(arena *mem) {
+  big_arena = mem;
+}
+
+bool bigints_enabled(void) {
+  return big_arena != NULL;
+}
+
+//WIDE values made on this thread are allocated from mem from now on;
+//returns the arena used until now, or NULL
+arena *set_wide_arena(arena *mem) {
+  arena *previous = wide_arena;
+  wide_arena = mem;
+  return previous;
+}
+
+//float results are BIGFLOAT values from now on, good to the given number
+//of significant digits; they live in the arena given to enable_bigints()
+void enable_bigfloats(int digits) {
+  precise_bits = ceil(digits * log2(10)) + 64;
+}
+
+bool bigfloats_enabled(void) {
+  return precise_bits != 0;
+}
+
 void value_set_int(value *val, long int ivalue) {
   number data;
   
@@ -54,10 +110,156 @@ void value_set_float(value *val, double fvalue) {
   val->type = FLOAT;
 }
 
+void value_set_wide(value *val, wide_int wvalue) {
+  if (wvalue >= LONG_MIN && wvalue <= LONG_MAX) {
+    value_set_int(val, wvalue);
+  } else {
+    if (!wide_arena) {
+      if (!own_wide_arena.chunk_size)
+	arena_init(&own_wide_arena, WIDE_CHUNK_SIZE);
+      wide_arena = &own_wide_arena;
+    }
+
+    wide_int *copy = arena_alloc(wide_arena, sizeof(wide_int));
+    *copy = wvalue;
+    val->data.wvalue = copy;
+    val->type = WIDE;
+  }
+}
+
+//for a value kept past the reset of the arena it was made in, such as a
+//constant in a compiled tree; storage has to live as long as val does
+void value_keep_wide(value *val, wide_int *storage) {
+  if (val->type == WIDE) {
+    *storage = *val->data.wvalue;
+    val->data.wvalue = storage;
+  }
+}
+
+void value_set_big(value *val, const bigint *x) {
+  if (big_fits_wide(x)) {
+    value_set_wide(val, big_get_wide(x));
+    return;
+  }
+
+  //the limbs follow the header, and belong to the arena
+  bigint *copy = arena_alloc(big_arena,
+                             sizeof(bigint) + x->length * sizeof(uint64_t));
+  copy->limbs = (uint64_t *)(copy + 1);
+  memcpy(copy->limbs, x->limbs, x->length * sizeof(uint64_t));
+  copy->length = x->length;
+  copy->capacity = 0;
+  copy->negative = x->negative;
+
+  val->data.bvalue = copy;
+  val->type = BIG;
+}
+
+//Copies x into the arena as value_set_big does, or makes a double of it
+//if its exponent is past MAX_BIG_BITS either way.
+void value_set_bigfloat(value *val, const bigfloat *x) {
+  long magnitude = bf_magnitude(x);
+  if (x->mantissa.length
+      && (magnitude > MAX_BIG_BITS || magnitude < -MAX_BIG_BITS)) {
+    value_set_float(val, bf_get_double(x));
+    return;
+  }
+
+  bigfloat *copy = arena_alloc(big_arena, sizeof(bigfloat)
+			       + x->mantissa.length * sizeof(uint64_t));
+  copy->mantissa.limbs = (uint64_t *)(copy + 1);
+  memcpy(copy->mantissa.limbs, x->mantissa.limbs,
+	 x->mantissa.length * sizeof(uint64_t));
+  copy->mantissa.length = x->mantissa.length;
+  copy->mantissa.capacity = 0;
+  copy->mantissa.negative = x->mantissa.negative;
+  copy->exponent = x->exponent;
+
+  val->data.bfvalue = copy;
+  val->type = BIGFLOAT;
+}
+
+//digits = digits * 10^n + chunk, for the n digits of chunk
+static void add_digits(bigint *digits, uint64_t *chunk, uint64_t *scale,
+		       int *n) {
+  bigint x = { scale, 1, 0, false };
+  big_multiply(digits, digits, &x);
+  x = (bigint){ chunk, *chunk ? 1 : 0, 0, false };
+  big_add(digits, digits, &x);
+  *chunk = 0;
+  *scale = 1;
+  *n = 0;
+}
+
+//A decimal literal, such as 1.5e-3, read to the precision of --digits
+//rather than to the nearest double. val keeps the double it was parsed
+//to if the exponent is out of range.
+void value_set_decimal(value *val, const char *str, int length) {
+  bigint digits;
+  uint64_t chunk_limb, scale_limb;
+  long exp10 = 0, exponent = 0;
+  bool fraction = false, negative_exponent = false;
+  int i = 0, chunk_digits = 0;
+
+  big_init(&digits);
+  chunk_limb = 0;
+  scale_limb = 1;
+  for (; i < length && (isdigit(str[i]) || str[i] == '.'); i++) {
+    if (str[i] == '.') {
+      fraction = true;
+      continue;
+    }
+    chunk_limb = chunk_limb * 10 + (str[i] - '0');
+    scale_limb *= 10;
+    if (fraction)
+      exp10--;
+
+    //eighteen digits at a time, which fit a limb
+    if (++chunk_digits == 18)
+      add_digits(&digits, &chunk_limb, &scale_limb, &chunk_digits);
+  }
+  add_digits(&digits, &chunk_limb, &scale_limb, &chunk_digits);
+
+  if (i < length && (str[i] == 'e' || str[i] == 'E')) {
+    i++;
+    if (i < length && (str[i] == '+' || str[i] == '-'))
+      negative_exponent = str[i++] == '-';
+    for (; i < length && isdigit(str[i]); i++)
+      if (exponent <= MAX_DECIMAL_EXPONENT)
+	exponent = exponent * 10 + (str[i] - '0');
+  }
+  exp10 += negative_exponent ? -exponent : exponent;
+
+  if (exp10 >= -MAX_DECIMAL_EXPONENT && exp10 <= MAX_DECIMAL_EXPONENT) {
+    bigfloat x;
+    bf_init(&x);
+    bf_from_decimal(&x, &digits, exp10, precise_bits);
+    value_set_bigfloat(val, &x);
+    bf_free(&x);
+  }
+  big_free(&digits);
+}
+
+//the integer part of a BIGFLOAT, truncated as a conversion in C would
+static wide_int bigfloat_to_wide(const bigfloat *x) {
+  bigint r;
+  big_init(&r);
+  bf_get_integer(&r, x, 't');
+  wide_int wvalue = big_get_wide(&r);
+  big_free(&r);
+  return wvalue;
+}
+
 long int value_get_int(value *val) {
   switch (val->type) {
   case INT:
     return val->data.ivalue;
+  case WIDE: //the low bits, as a conversion in C would give
+    return (long int)*val->data.wvalue;
+  case BIG:
+    return big_get_wide(val->data.bvalue);
+  case BIGFLOAT:
+    return bigfloat_to_wide(val->data.bfvalue);
   default:
   case FLOAT:
     return (long int)val->data.fvalue;
@@ -68,14 +270,161 @@ double value_get_float(value *val) {
   switch (val->type) {
   case INT:
     return val->data.ivalue;
+  case WIDE:
+    return value_get_wide(val);
+  case BIG:
+    return big_get_double(val->data.bvalue);
+  case BIGFLOAT:
+    return bf_get_double(val->data.bfvalue);
   default:
   case FLOAT:
     return val->data.fvalue;
   }
 }
 
+wide_int value_get_wide(value *val) {
+  switch (val->type) {
+  case INT:
+    return val->data.ivalue;
+  case WIDE:
+    return *val->data.wvalue;
+  case BIG:
+    return big_get_wide(val->data.bvalue);
+  case BIGFLOAT:
+    return bigfloat_to_wide(val->data.bfvalue);
+  default:
+  case FLOAT:
+    return (wide_int)val->data.fvalue;
+  }
+}
+
+//in decimal, since printf has no conversion for 128-bit integers
+void wide_to_string(wide_int wvalue, char *str, int size) {
+  char digits[48];
+  char *start = digits + sizeof(digits) - 1;
+  unsigned __int128 magnitude = (wvalue < 0) ? -(unsigned __int128)wvalue
+    : (unsigned __int128)wvalue;
+
+  *start = '\0';
+  do {
+    *--start = '0' + magnitude % 10;
+    magnitude /= 10;
+  } while (magnitude);
+  if (wvalue < 0)
+    *--start = '-';
+
+  snprintf(str, size, "%s", start);
+}
+
+//A bigint for any integer value, which borrows the limbs of a BIG value
+//and keeps those of a smaller one in limbs. It lasts as long as both.
+void value_get_big(value *val, bigint *x, uint64_t limbs[2]) {
+  if (val->type == BIG) {
+    *x = *val->data.bvalue;
+    return;
+  }
+
+  wide_int wvalue = value_get_wide(val);
+  unsigned __int128 magnitude = (wvalue < 0) ? -(unsigned __int128)wvalue
+    : (unsigned __int128)wvalue;
+  limbs[0] = (uint64_t)magnitude;
+  limbs[1] = (uint64_t)(magnitude >> 64);
+
+  x->limbs = limbs;
+  x->length = limbs[1] ? 2 : limbs[0] ? 1 : 0;
+  x->capacity = 0;
+  x->negative = wvalue < 0;
+}
+
+//A bigfloat for any finite value, which borrows the limbs of a BIG or
+//BIGFLOAT value and keeps those of a smaller one in limbs, as
+//value_get_big does.
+void value_get_bigfloat(value *val, bigfloat *x, uint64_t limbs[2]) {
+  if (val->type == BIGFLOAT) {
+    *x = *val->data.bfvalue;
+    return;
+  }
+
+  x->exponent = 0;
+  if (val->type != FLOAT) {
+    value_get_big(val, &x->mantissa, limbs);
+    return;
+  }
+
+  //the 53 bits of the double, with its trailing zeros stripped
+  int exponent;
+  double fraction = frexp(fabs(val->data.fvalue), &exponent);
+  limbs[0] = (uint64_t)ldexp(fraction, 53);
+  x->mantissa.limbs = limbs;
+  x->mantissa.length = limbs[0] ? 1 : 0;
+  x->mantissa.capacity = 0;
+  x->mantissa.negative = limbs[0] && val->data.fvalue < 0;
+  if (limbs[0]) {
+    int zeros = __builtin_ctzll(limbs[0]);
+    limbs[0] >>= zeros;
+    x->exponent = exponent - 53 + zeros;
+  }
+}
+
+//with six significant digits, as %g writes a double
+void bigfloat_to_string(const bigfloat *x, char *str, int size) {
+  char text[32];
+  long exp10;
+  int *digits = bf_to_decimal(x, 6, &exp10);
+  int length = 0;
+
+  if (x->mantissa.negative)
+    text[length++] = '-';
+  for (int i = 0; i < 6; i++) {
+    text[length++] = '0' + digits[i];
+    if (i == 0)
+      text[length++] = '.';
+  }
+  free(digits);
+
+  //%g itself, within the range of a double
+  if (exp10 > -300 && exp10 < 300) {
+    snprintf(text + length, sizeof(text) - length, "e%ld", exp10);
+    snprintf(str, size, "%g", strtod(text, NULL));
+    return;
+  }
+
+  while (text[length - 1] == '0')
+    length--;
+  if (text[length - 1] == '.')
+    length--;
+  snprintf(text + length, sizeof(text) - length, "e%+03ld", exp10);
+  snprintf(str, size, "%s", text);
+}
+
+//in decimal, cut short like snprintf if it does not fit
+void big_to_string(const bigint *x, char *str, int size) {
+  size_t num_digits;
+  int *digits = big_to_digits(x, 10, &num_digits);
+  int length = 0;
+
+  if (x->negative && length < size - 1)
+    str[length++] = '-';
+  for (size_t i = 0; i < num_digits && length < size - 1; i++)
+    str[length++] = '0' + digits[i];
+  if (size > 0)
+    str[length] = '\0';
+  free(digits);
+}
+
+//a BIGFLOAT made an integer by bf_get_integer, a BIG value if need be
+static void precise_integer(value *val, char mode, value *result) {
+  bigint r;
+  big_init(&r);
+  bf_get_integer(&r, val->data.bfvalue, mode);
+  value_set_big(result, &r);
+  big_free(&r);
+}
+
 void round_to_int(value *x) {
-  if (x->type != INT) {
+  if (x->type == BIGFLOAT) {
+    precise_integer(x, 'r', x);
+  } else if (x->type == FLOAT) {
     double fval = value_get_float(x);
     
     //see if value will fit in a long int
@@ -83,9 +432,8 @@ void round_to_int(value *x) {
     double upper = nextafter(LONG_MAX + 0.5, 0);
     if (fval >= lower && fval <= upper) {
       x->type = INT;
-      x->data.ivalue = (fval >= 0)
-                         ? (long)(fval + 0.5)
-                         : (long)(fval - 0.5);
+      //adding 0.5 and truncating would be inexact past 2^52
+      x->data.ivalue = (long)round(fval);
     } else {
       x->type = FLOAT;
       x->data.fvalue = round(fval);
@@ -93,8 +441,24 @@ void round_to_int(value *x) {
   }
 }
 
+//a constant to the precision of --digits
+static void set_precise_constant(value *val,
+				 void (*constant)(bigfloat *, size_t)) {
+  bigfloat x;
+  bf_init(&x);
+  constant(&x, precise_bits);
+  value_set_bigfloat(val, &x);
+  bf_free(&x);
+}
+
 void get_constant(char *identifier, value *val) {
-  if (!strcmp(identifier, "PI")) {
+  if (precise_bits && !strcmp(identifier, "PI")) {
+    set_precise_constant(val, bf_pi);
+  } else if (precise_bits && !strcmp(identifier, "E")) {
+    set_precise_constant(val, bf_e);
+  } else if (precise_bits && !strcmp(identifier, "PHI")) {
+    set_precise_constant(val, bf_phi);
+  } else if (!strcmp(identifier, "PI")) {
     val->type = FLOAT;
     val->data.fvalue = PI;
   } else if (!strcmp(identifier, "E")) {
@@ -192,15 +556,207 @@ void get_constant(char *identifier, value *val) {
   }
 }
 
+//which of two integers is larger, as strcmp would say
+static int compare_integers(value *left, value *right) {
+  if (left->type == BIG || right->type == BIG) {
+    bigint a, b;
+    uint64_t a_limbs[2], b_limbs[2];
+
+    value_get_big(left, &a, a_limbs);
+    value_get_big(right, &b, b_limbs);
+    return big_compare(&a, &b);
+  }
+
+  wide_int x = value_get_wide(left), y = value_get_wide(right);
+  return (x > y) - (x < y);
+}
+
+static bool is_negative(value *val) {
+  if (val->type == BIG)
+    return val->data.bvalue->negative;
+  if (val->type == BIGFLOAT)
+    return val->data.bfvalue->mantissa.negative;
+  return value_get_wide(val) < 0;
+}
+
+static bool is_nonzero(value *val) {
+  if (val->type == BIGFLOAT)
+    return val->data.bfvalue->mantissa.length != 0;
+  if (val->type == FLOAT)
+    return val->data.fvalue != 0;
+  return val->type == BIG || value_get_wide(val) != 0;
+}
+
+static bool is_float(value *val) {
+  return val->type == FLOAT || val->type == BIGFLOAT;
+}
+
+static bool is_finite(value *val) {
+  return val->type != FLOAT || isfinite(val->data.fvalue);
+}
+
+//whether a float result is carried out to --digits: only with it, and
+//only when no operand is an infinite or NaN double, which a BIGFLOAT
+//cannot hold
+static bool goes_precise(value *left, value *right) {
+  return precise_bits && is_finite(left) && is_finite(right);
+}
+
+//whether a comparison needs more than doubles, when either side is a
+//BIGFLOAT and the other is no infinite or NaN double
+static bool compares_precise(value *left, value *right) {
+  return (left->type == BIGFLOAT || right->type == BIGFLOAT)
+    && is_finite(left) && is_finite(right);
+}
+
+static int compare_precise(value *left, value *right) {
+  bigfloat a, b;
+  uint64_t a_limbs[2], b_limbs[2];
+
+  value_get_bigfloat(left, &a, a_limbs);
+  value_get_bigfloat(right, &b, b_limbs);
+  return bf_compare(&a, &b);
+}
+
+typedef void (*bigfloat_operator)(bigfloat *, const bigfloat *,
+				  const bigfloat *, size_t);
+
+//an operation on two finite values to the precision of --digits
+static void precise_binary(bigfloat_operator op, value *left, value *right,
+			   value *result) {
+  bigfloat a, b, r;
+  uint64_t a_limbs[2], b_limbs[2];
+
+  value_get_bigfloat(left, &a, a_limbs);
+  value_get_bigfloat(right, &b, b_limbs);
+  bf_init(&r);
+  op(&r, &a, &b, precise_bits);
+  value_set_bigfloat(result, &r);
+  bf_free(&r);
+}
+
+//val as a BIGFLOAT, as an operation on floats would give it
+static void make_precise(value *val) {
+  bigfloat x, r;
+  uint64_t limbs[2];
+
+  if (val->type == BIGFLOAT)
+    return;
+  value_get_bigfloat(val, &x, limbs);
+  bf_init(&r);
+  bf_round(&r, &x, precise_bits);
+  value_set_bigfloat(val, &r);
+  bf_free(&r);
+}
+
+//pi / 180, to a word more than --digits so that angles in degrees lose
+//nothing on the way to radians
+static void radians_per_degree(bigfloat *r) {
+  bigfloat n;
+  uint64_t limb = 180;
+
+  n.mantissa = (bigint){ &limb, 1, 0, false };
+  n.exponent = 0;
+  bf_pi(r, precise_bits + 64);
+  bf_divide(r, r, &n, precise_bits + 64);
+}
+
+//a BIGFLOAT angle in radians made one in degrees
+static void precise_degrees(value *val) {
+  bigfloat scale, r;
+
+  if (val->type != BIGFLOAT)
+    return;
+  bf_init(&scale);
+  bf_init(&r);
+  radians_per_degree(&scale);
+  bf_divide(&r, val->data.bfvalue, &scale, precise_bits);
+  value_set_bigfloat(val, &r);
+  bf_free(&scale);
+  bf_free(&r);
+}
+
+typedef bool (*bigfloat_function)(bigfloat *, const bigfloat *, size_t);
+
+//the functions of one argument carried out to --digits, with 'i' for
+//those that take an angle and 'o' for those that give one
+static const struct {
+  char *name;
+  bigfloat_function function;
+  char angle;
+} precise_functions[] = {
+  { "sqrt", bf_sqrt, 0 }, { "cbrt", bf_cbrt, 0 },
+  { "sin", bf_sin, 'i' }, { "cos", bf_cos, 'i' }, { "tan", bf_tan, 'i' },
+  { "asin", bf_asin, 'o' }, { "acos", bf_acos, 'o' },
+  { "atan", bf_atan, 'o' },
+  { "exp", bf_exp, 0 }, { "log", bf_log, 0 }, { "log10", bf_log10, 0 },
+  { "log2", bf_log2, 0 }, { "expm1", bf_expm1, 0 },
+  { "log1p", bf_log1p, 0 },
+  { "sinh", bf_sinh, 0 }, { "cosh", bf_cosh, 0 }, { "tanh", bf_tanh, 0 },
+  { "asinh", bf_asinh, 0 }, { "acosh", bf_acosh, 0 },
+  { "atanh", bf_atanh, 0 },
+};
+
+//Evaluates a function of one argument to --digits. Returns false to
+//leave it to the double version: for a function not carried out this
+//way, an infinite or NaN argument, or a result that is undefined or out
+//of range, where the double version gives the error or the value.
+static bool precise_function(char *identifier, value *arg, value *result,
+			     bool degrees) {
+  int num_functions = sizeof(precise_functions)
+    / sizeof(precise_functions[0]);
+  int i = 0;
+
+  while (i < num_functions && strcmp(identifier, precise_functions[i].name))
+    i++;
+  if (i == num_functions || !is_finite(arg))
+    return false;
+
+  bigfloat x, r, scale;
+  uint64_t limbs[2];
+  char angle = degrees ? precise_functions[i].angle : 0;
+
+  value_get_bigfloat(arg, &x, limbs);
+  bf_init(&r);
+  bf_init(&scale);
+  if (angle)
+    radians_per_degree(&scale);
+  if (angle == 'i') {
+    bf_multiply(&r, &x, &scale, precise_bits + 64);
+    x = r;
+    bf_init(&r);
+  }
+
+  bool defined = precise_functions[i].function(&r, &x, precise_bits);
+  if (defined && angle == 'o')
+    bf_divide(&r, &r, &scale, precise_bits);
+  if (defined)
+    value_set_bigfloat(result, &r);
+
+  if (angle == 'i')
+    bf_free(&x);
+  bf_free(&r);
+  bf_free(&scale);
+  return defined;
+}
+
 void call_function(char *identifier, value *result, int argc, value argv[],
 		   bool degrees) {
   bool bad_args = false;
   double arg = 0.0;
 
+  if (precise_bits && argc == 1
+      && precise_function(identifier, &argv[0], result, degrees))
+    return;
+
   if (!strcmp(identifier, "pow")) {
     if (argc == 2) {
       power(&argv[0], &argv[1], result);
     } else bad_args = true;
+  } else if (!strcmp(identifier, "powmod")) {
+    if (argc == 3) {
+      power_mod(&argv[0], &argv[1], &argv[2], result);
+    } else bad_args = true;
   } else if (!strcmp(identifier, "sqrt")) {
     if (argc == 1) {
       result->type = FLOAT;
@@ -213,19 +769,22 @@ void call_function(char *identifier, value *result, int argc, value argv[],
     } else bad_args = true;
   } else if (!strcmp(identifier, "abs")) {
     if (argc == 1) {
-      if (argv[0].type == INT) {
-	result->type = INT;
-	result->data.ivalue = abs(value_get_int(&argv[0]));
-      } else if (argv[0].type == FLOAT) {
+      if (argv[0].type == FLOAT) {
 	result->type = FLOAT;
 	result->data.fvalue = fabs(value_get_float(&argv[0]));
+      } else if (is_negative(&argv[0])) {
+	negate(&argv[0], result); //abs(LONG_MIN) needs 128 bits
+      } else {
+	*result = argv[0];
       }
     } else bad_args = true;
   } else if (!strcmp(identifier, "floor")) {
     if (argc == 1) {
-      if (argv[0].type == INT) {
+      if (argv[0].type == BIGFLOAT) {
+	precise_integer(&argv[0], 'f', result);
+      } else if (argv[0].type != FLOAT) {
 	*result = argv[0];
-      } else if (argv[0].type == FLOAT) {
+      } else {
 	result->type = FLOAT;
 	result->data.fvalue = floor(value_get_float(&argv[0]));
 
@@ -235,9 +794,11 @@ void call_function(char *identifier, value *result, int argc, value argv[],
     } else bad_args = true;
   } else if (!strcmp(identifier, "ceil")) {
     if (argc == 1) {
-      if (argv[0].type == INT) {
+      if (argv[0].type == BIGFLOAT) {
+	precise_integer(&argv[0], 'c', result);
+      } else if (argv[0].type != FLOAT) {
 	*result = argv[0];
-      } else if (argv[0].type == FLOAT) {
+      } else {
 	result->type = FLOAT;
 	result->data.fvalue = ceil(value_get_float(&argv[0]));
 
@@ -247,9 +808,11 @@ void call_function(char *identifier, value *result, int argc, value argv[],
     } else bad_args = true;
   } else if (!strcmp(identifier, "trunc")) {
     if (argc == 1) {
-      if (argv[0].type == INT) {
+      if (argv[0].type == BIGFLOAT) {
+	precise_integer(&argv[0], 't', result);
+      } else if (argv[0].type != FLOAT) {
 	*result = argv[0];
-      } else if (argv[0].type == FLOAT) {
+      } else {
 	result->type = FLOAT;
 	result->data.fvalue = trunc(value_get_float(&argv[0]));
 
@@ -316,7 +879,12 @@ void call_function(char *identifier, value *result, int argc, value argv[],
 	result->data.fvalue *= 180 / PI;
     } else bad_args = true;
   } else if (!strcmp(identifier, "atan2")) {
-    if (argc == 2) {
+    if (argc == 2 && goes_precise(&argv[0], &argv[1])) {
+      precise_binary(bf_atan2, &argv[0], &argv[1], result);
+
+      if (degrees)
+	precise_degrees(result);
+    } else if (argc == 2) {
       result->type = FLOAT;
       result->data.fvalue = atan2(value_get_float(&argv[0]),
 				  value_get_float(&argv[1]));
@@ -354,11 +922,18 @@ void call_function(char *identifier, value *result, int argc, value argv[],
     } else bad_args = true;
   } else if (!strcmp(identifier, "rand")) {
     if (argc == 0) {
+      //seeded on first use, so that other expressions don't pay for it
+      static atomic_flag seeded = ATOMIC_FLAG_INIT;
+      if (!atomic_flag_test_and_set(&seeded))
+        srand(time(NULL));
+
       result->type = INT;
       result->data.ivalue = rand();
     } else bad_args = true;
   } else if (!strcmp(identifier, "hypot")) {
-    if (argc == 2) {
+    if (argc == 2 && goes_precise(&argv[0], &argv[1])) {
+      precise_binary(bf_hypot, &argv[0], &argv[1], result);
+    } else if (argc == 2) {
       result->type = FLOAT;
       result->data.fvalue = hypot(value_get_float(&argv[0]),
 				  value_get_float(&argv[1]));
@@ -423,10 +998,20 @@ void call_function(char *identifier, value *result, int argc, value argv[],
       result->type = FLOAT;
       result->data.fvalue = tgamma(value_get_float(&argv[0]));
     } else bad_args = true;
+  } else if (!strcmp(identifier, "factorial")) {
+    if (argc == 1) {
+      factorial(&argv[0], result);
+    } else bad_args = true;
+  } else if (!strcmp(identifier, "binomial")) {
+    if (argc == 2) {
+      binomial(&argv[0], &argv[1], result);
+    } else bad_args = true;
   } else if (!strcmp(identifier, "fmod")) {
     if (argc == 2) {
-      if (argv[0].type == INT && argv[1].type == INT) {
+      if (!is_float(&argv[0]) && !is_float(&argv[1])) {
         modulo(&argv[0], &argv[1], result);
+      } else if (goes_precise(&argv[0], &argv[1]) && is_nonzero(&argv[1])) {
+	precise_binary(bf_fmod, &argv[0], &argv[1], result);
       } else {
 	result->type = FLOAT;
 	result->data.fvalue = fmod(value_get_float(&argv[0]),
@@ -434,13 +1019,16 @@ void call_function(char *identifier, value *result, int argc, value argv[],
       }
     } else bad_args = true;
   } else if (!strcmp(identifier, "remainder")) {
-    if (argc == 2) {
+    if (argc == 2 && (is_float(&argv[0]) || is_float(&argv[1]))
+	&& goes_precise(&argv[0], &argv[1]) && is_nonzero(&argv[1])) {
+      precise_binary(bf_remainder, &argv[0], &argv[1], result);
+    } else if (argc == 2) {
       result->type = FLOAT;
       result->data.fvalue = remainder(value_get_float(&argv[0]),
 				      value_get_float(&argv[1]));
 
       //make an integer if possible
-      if (argv[0].type == INT && argv[1].type == INT)
+      if (!is_float(&argv[0]) && !is_float(&argv[1]))
 	round_to_int(result);
     } else bad_args = true;
   } else if (!strcmp(identifier, "nextafter")) {
@@ -451,12 +1039,13 @@ void call_function(char *identifier, value *result, int argc, value argv[],
     } else bad_args = true;
   } else if (!strcmp(identifier, "max")) {
     if (argc == 2) {
-      if (argv[0].type == INT && argv[1].type == INT) {
-	int x = value_get_int(&argv[0]);
-	int y = value_get_int(&argv[1]);
-	
-	result->type = INT;
-	result->data.ivalue = (x > y) ? x : y;
+      if (!is_float(&argv[0]) && !is_float(&argv[1])) {
+	*result = (compare_integers(&argv[0], &argv[1]) > 0) ? argv[0]
+	  : argv[1];
+      } else if (goes_precise(&argv[0], &argv[1])) {
+	*result = (compare_precise(&argv[0], &argv[1]) > 0) ? argv[0]
+	  : argv[1];
+	make_precise(result);
       } else {
 	result->type = FLOAT;
 	result->data.fvalue = fmax(value_get_float(&argv[0]),
@@ -465,12 +1054,13 @@ void call_function(char *identifier, value *result, int argc, value argv[],
     } else bad_args = true;
   } else if (!strcmp(identifier, "min")) {
     if (argc == 2) {
-      if (argv[0].type == INT && argv[1].type == INT) {
-	int x = value_get_int(&argv[0]);
-	int y = value_get_int(&argv[1]);
-	
-	result->type = INT;
-	result->data.ivalue = (x < y) ? x : y;
+      if (!is_float(&argv[0]) && !is_float(&argv[1])) {
+	*result = (compare_integers(&argv[0], &argv[1]) < 0) ? argv[0]
+	  : argv[1];
+      } else if (goes_precise(&argv[0], &argv[1])) {
+	*result = (compare_precise(&argv[0], &argv[1]) < 0) ? argv[0]
+	  : argv[1];
+	make_precise(result);
       } else {
 	result->type = FLOAT;
 	result->data.fvalue = fmin(value_get_float(&argv[0]),
@@ -493,48 +1083,191 @@ void call_function(char *identifier, value *result, int argc, value argv[],
   }
 }
 
+//the result of an integer operation, or the float result if it overflowed
+//even 128 bits
+static void set_checked(value *result, wide_int wvalue, bool overflow,
+			double fvalue) {
+  if (overflow)
+    value_set_float(result, fvalue);
+  else
+    value_set_wide(result, wvalue);
+}
+
+//the number of bits in the magnitude of an integer
+static size_t value_bits(value *val) {
+  if (val->type == BIG)
+    return big_bits(val->data.bvalue);
+
+  wide_int wvalue = value_get_wide(val);
+  unsigned __int128 magnitude = (wvalue < 0) ? -(unsigned __int128)wvalue
+    : (unsigned __int128)wvalue;
+  size_t bits = 0;
+  for (; magnitude; magnitude >>= 1)
+    bits++;
+  return bits;
+}
+
+typedef void (*big_operator)(bigint *, const bigint *, const bigint *);
+
+//An operation on two integers that needs more than 128 bits, with
+//--bigint. The result is computed on the heap and then copied to the
+//arena, which makes it smaller again if it can be.
+static void big_binary(big_operator op, value *left, value *right,
+		       value *result) {
+  bigint a, b, r;
+  uint64_t a_limbs[2], b_limbs[2];
+
+  value_get_big(left, &a, a_limbs);
+  value_get_big(right, &b, b_limbs);
+  big_init(&r);
+  op(&r, &a, &b);
+  value_set_big(result, &r);
+  big_free(&r);
+}
+
+static void big_quotient(bigint *r, const bigint *a, const bigint *b) {
+  big_divide(r, NULL, a, b);
+}
+
+static void big_remainder(bigint *r, const bigint *a, const bigint *b) {
+  big_divide(NULL, r, a, b);
+}
+
+static void big_and(bigint *r, const bigint *a, const bigint *b) {
+  big_bitwise(r, a, b, '&');
+}
+
+static void big_or(bigint *r, const bigint *a, const bigint *b) {
+  big_bitwise(r, a, b, '|');
+}
+
+static void big_xor(bigint *r, const bigint *a, const bigint *b) {
+  big_bitwise(r, a, b, '^');
+}
+
+//whether an integer operation moves to BIG values: with --bigint, when it
+//overflowed 128 bits or already has a BIG operand
+static bool goes_big(value *left, value *right, bool overflow) {
+  return big_arena && (overflow || left->type == BIG || right->type == BIG);
+}
+
 void add(value *left, value *right, value *result) {
-  if (left->type == FLOAT || right->type == FLOAT) {
+  long int ivalue;
+  wide_int wvalue = 0;
+
+  if ((is_float(left) || is_float(right)) && goes_precise(left, right)) {
+    precise_binary(bf_add, left, right, result);
+  } else if (is_float(left) || is_float(right)) {
     result->type = FLOAT;
     result->data.fvalue = value_get_float(left) + value_get_float(right);
+  } else if (left->type == INT && right->type == INT
+	     && !__builtin_add_overflow(left->data.ivalue, right->data.ivalue,
+					&ivalue)) {
+    value_set_int(result, ivalue);
   } else {
-    result->type = INT;
-    result->data.ivalue = value_get_int(left) + value_get_int(right);
+    bool overflow = __builtin_add_overflow(value_get_wide(left),
+					   value_get_wide(right), &wvalue);
+    if (goes_big(left, right, overflow))
+      big_binary(big_add, left, right, result);
+    else
+      set_checked(result, wvalue, overflow,
+		  value_get_float(left) + value_get_float(right));
   }
 }
 
 void subtract(value *left, value *right, value *result) {
-  if (left->type == FLOAT || right->type == FLOAT) {
+  long int ivalue;
+  wide_int wvalue = 0;
+
+  if ((is_float(left) || is_float(right)) && goes_precise(left, right)) {
+    precise_binary(bf_subtract, left, right, result);
+  } else if (is_float(left) || is_float(right)) {
     result->type = FLOAT;
     result->data.fvalue = value_get_float(left) - value_get_float(right);
+  } else if (left->type == INT && right->type == INT
+	     && !__builtin_sub_overflow(left->data.ivalue, right->data.ivalue,
+					&ivalue)) {
+    value_set_int(result, ivalue);
   } else {
-    result->type = INT;
-    result->data.ivalue = value_get_int(left) - value_get_int(right);
+    bool overflow = __builtin_sub_overflow(value_get_wide(left),
+					   value_get_wide(right), &wvalue);
+    if (goes_big(left, right, overflow))
+      big_binary(big_subtract, left, right, result);
+    else
+      set_checked(result, wvalue, overflow,
+		  value_get_float(left) - value_get_float(right));
   }
 }
 
 void multiply(value *left, value *right, value *result) {
-  if (left->type == FLOAT || right->type == FLOAT) {
+  long int ivalue;
+  wide_int wvalue = 0;
+
+  if ((is_float(left) || is_float(right)) && goes_precise(left, right)) {
+    precise_binary(bf_multiply, left, right, result);
+  } else if (is_float(left) || is_float(right)) {
     result->type = FLOAT;
     result->data.fvalue = value_get_float(left) * value_get_float(right);
+  } else if (left->type == INT && right->type == INT
+	     && !__builtin_mul_overflow(left->data.ivalue, right->data.ivalue,
+					&ivalue)) {
+    value_set_int(result, ivalue);
   } else {
-    result->type = INT;
-    result->data.ivalue = value_get_int(left) * value_get_int(right);
+    bool overflow = __builtin_mul_overflow(value_get_wide(left),
+					   value_get_wide(right), &wvalue);
+    if (goes_big(left, right, overflow)
+	&& value_bits(left) + value_bits(right) <= MAX_BIG_BITS)
+      big_binary(big_multiply, left, right, result);
+    else
+      set_checked(result, wvalue, overflow || left->type == BIG
+		  || right->type == BIG,
+		  value_get_float(left) * value_get_float(right));
+  }
+}
+
+//for two integers, the second nonzero
+static bool divides_evenly(value *left, value *right) {
+  if (left->type == INT && right->type == INT)
+    return right->data.ivalue == -1
+      || left->data.ivalue % right->data.ivalue == 0;
+
+  if (left->type == BIG || right->type == BIG) {
+    value rem;
+    big_binary(big_remainder, left, right, &rem);
+    return rem.type == INT && rem.data.ivalue == 0;
   }
+
+  wide_int divisor = value_get_wide(right);
+  return divisor == -1 || value_get_wide(left) % divisor == 0;
+}
+
+//The quotient of two integers, the second nonzero. Dividing by -1 is left
+//to negate(), since LONG_MIN / -1 needs more bits and the division itself
+//would trap.
+static void divide_integers(value *left, value *right, value *result) {
+  if (left->type == INT && right->type == INT && right->data.ivalue != -1)
+    value_set_int(result, left->data.ivalue / right->data.ivalue);
+  else if (left->type == BIG || right->type == BIG)
+    big_binary(big_quotient, left, right, result);
+  else if (value_get_wide(right) == -1)
+    negate(left, result);
+  else
+    value_set_wide(result, value_get_wide(left) / value_get_wide(right));
 }
 
 void divide(value *left, value *right, value *result) {
   //check for division by zero
   if ((right->type == INT && right->data.ivalue == 0)
-      || (right->type == FLOAT && right->data.fvalue == 0)) {
+      || (is_float(right) && !is_nonzero(right))) {
     raise_error(ERROR_EXPR, "division by zero");
   }
-  
+
   //use int division only if numerator is perfect multiple of denominator
-  if (left->type == INT && right->type == INT
-      && value_get_int(left) % value_get_int(right) == 0) {
-    result->type = INT;
-    result->data.ivalue = value_get_int(left) / value_get_int(right);
+  if (!is_float(left) && !is_float(right)
+      && divides_evenly(left, right)) {
+    divide_integers(left, right, result);
+  } else if (goes_precise(left, right)) {
+    precise_binary(bf_divide, left, right, result);
   } else {
     result->type = FLOAT;
     result->data.fvalue = value_get_float(left) / value_get_float(right);
@@ -543,112 +1276,414 @@ void divide(value *left, value *right, value *result) {
 
 void int_divide(value *left, value *right, value *result) {
   //make sure we have int operands
-  if (left->type == FLOAT || right->type == FLOAT)
+  if (is_float(left) || is_float(right))
     raise_error(ERROR_EXPR,
 		"integer division operator '//' requires integer operands");
 
   //check for div by zero
-  if (right->data.ivalue == 0)
+  if (right->type == INT && right->data.ivalue == 0)
     raise_error(ERROR_EXPR, "division by zero");
 
-  result->type = INT;
-  result->data.ivalue = value_get_int(left) / value_get_int(right);
+  divide_integers(left, right, result);
+}
+
+//exponentiation by squaring; squaring the base while bits of the exponent
+//remain can only overflow if the result would too
+static bool power_long(long int base, long int exp, long int *result) {
+  bool overflow = false;
+
+  *result = 1;
+  while (exp && !overflow) {
+    if (exp & 1)
+      overflow = __builtin_mul_overflow(*result, base, result);
+    exp >>= 1;
+    if (exp && !overflow)
+      overflow = __builtin_mul_overflow(base, base, &base);
+  }
+  return !overflow;
+}
+
+static bool power_wide(wide_int base, wide_int exp, wide_int *result) {
+  bool overflow = false;
+
+  *result = 1;
+  while (exp && !overflow) {
+    if (exp & 1)
+      overflow = __builtin_mul_overflow(*result, base, result);
+    exp >>= 1;
+    if (exp && !overflow)
+      overflow = __builtin_mul_overflow(base, base, &base);
+  }
+  return !overflow;
+}
+
+//With --bigint, a power that overflowed 128 bits, for a nonnegative
+//exponent. Only 0, 1 and -1 have powers small enough to take to a BIG
+//exponent. Returns false if the result would be too large.
+static bool power_big(value *left, value *right, value *result) {
+  size_t bits = value_bits(left);
+
+  if (bits <= 1) { //the exponent only matters through its parity
+    bool odd = (right->type == BIG) ? right->data.bvalue->limbs[0] & 1
+      : value_get_wide(right) & 1;
+    bool zero_exp = right->type != BIG && value_get_wide(right) == 0;
+    value_set_int(result, zero_exp ? 1 : odd ? value_get_int(left)
+		  : bits ? 1 : 0);
+    return true;
+  }
+
+  if (right->type == BIG
+      || value_get_wide(right) > (wide_int)(MAX_BIG_BITS / bits))
+    return false;
+
+  bigint base, r;
+  uint64_t limbs[2];
+  value_get_big(left, &base, limbs);
+  big_init(&r);
+  big_power(&r, &base, value_get_int(right));
+  value_set_big(result, &r);
+  big_free(&r);
+  return true;
+}
+
+//A power to --digits, by squaring for an integer exponent and as
+//exp(y log x) for a positive base otherwise. Returns false to leave the
+//rest to pow(), which gives the value or the error: a negative base to a
+//fractional power, zero to a negative one, or a result out of range.
+static bool precise_power(value *left, value *right, value *result) {
+  bigfloat base, exp, r;
+  uint64_t base_limbs[2], exp_limbs[2];
+
+  value_get_bigfloat(left, &base, base_limbs);
+  value_get_bigfloat(right, &exp, exp_limbs);
+  if (!base.mantissa.length)
+    return false;
+
+  //the bits of the result, from doubles near enough to say whether it is
+  //in range
+  long magnitude = bf_magnitude(&base);
+  double log_base = (magnitude > -1000 && magnitude < 1000)
+    ? log2(fabs(bf_get_double(&base))) : magnitude;
+  if (fabs(log_base * bf_get_double(&exp)) > MAX_BIG_BITS)
+    return false;
+
+  bool defined = true;
+  bf_init(&r);
+  if (exp.exponent >= 0 && bf_magnitude(&exp) < 63) //a long, normalized
+    bf_power(&r, &base, value_get_int(right), precise_bits);
+  else if (exp.exponent >= 0)
+    defined = false;
+  else
+    defined = bf_pow(&r, &base, &exp, precise_bits);
+  if (defined)
+    value_set_bigfloat(result, &r);
+  bf_free(&r);
+  return defined;
 }
 
 void power(value *left, value *right, value *result) {
-  if ((left->type == FLOAT || right->type == FLOAT)
-      || right->data.ivalue < 0) {
+  long int ivalue;
+  wide_int wvalue;
+
+  if ((is_float(left) || is_float(right) || is_negative(right))
+      && goes_precise(left, right) && precise_power(left, right, result)) {
+    return;
+  } else if (is_float(left) || is_float(right) || is_negative(right)) {
     result->type = FLOAT;
     result->data.fvalue = pow(value_get_float(left), value_get_float(right));
+  } else if (left->type == INT && right->type == INT
+	     && power_long(left->data.ivalue, right->data.ivalue, &ivalue)) {
+    value_set_int(result, ivalue);
+  } else if (left->type != BIG && right->type != BIG
+	     && power_wide(value_get_wide(left), value_get_wide(right),
+			   &wvalue)) {
+    value_set_wide(result, wvalue);
+  } else if (!big_arena || !power_big(left, right, result)) {
+    result->type = FLOAT;
+    result->data.fvalue = pow(value_get_float(left), value_get_float(right));
+  }
+}
+
+//Montgomery reduction: t * 2^-64 mod m, for odd m < 2^63 and t < m * 2^64,
+//where neg_inv * m == -1 (mod 2^64)
+static uint64_t reduce_mod(unsigned __int128 t, uint64_t m, uint64_t neg_inv) {
+  uint64_t u = (uint64_t)t * neg_inv;
+  uint64_t r = (t + (unsigned __int128)u * m) >> 64;
+  return (r >= m) ? r - m : r;
+}
+
+void power_mod(value *base, value *exp, value *mod, value *result) {
+  if (is_float(base) || is_float(exp) || is_float(mod))
+    raise_error(ERROR_EXPR, "function 'powmod' requires integer arguments");
+  if (base->type != INT || exp->type != INT || mod->type != INT)
+    raise_error(ERROR_EXPR,
+		"function 'powmod' requires arguments that fit in 64 bits");
+  if (exp->data.ivalue < 0)
+    raise_error(ERROR_EXPR,
+		"function 'powmod' requires a nonnegative exponent");
+  if (mod->data.ivalue == 0)
+    raise_error(ERROR_EXPR, "mod by zero");
+
+  //the result is taken modulo |m|, so it is never negative
+  uint64_t m = mod->data.ivalue;
+  if (mod->data.ivalue < 0)
+    m = -m;
+  uint64_t b = (base->data.ivalue < 0)
+    ? (m - -(uint64_t)base->data.ivalue % m) % m
+    : (uint64_t)base->data.ivalue % m;
+  uint64_t e = exp->data.ivalue;
+  uint64_t r = 1 % m;
+
+  if (m & 1) {
+    //in Montgomery form every product is reduced without a division
+    uint64_t neg_inv = m; //correct to 3 bits, doubling with each step
+    for (int i = 0; i < 5; i++)
+      neg_inv *= 2 - m * neg_inv;
+    neg_inv = -neg_inv;
+
+    uint64_t one = ((unsigned __int128)1 << 64) % m;
+    b = ((unsigned __int128)b << 64) % m;
+    r = one;
+    while (e) {
+      if (e & 1)
+	r = reduce_mod((unsigned __int128)r * b, m, neg_inv);
+      e >>= 1;
+      b = reduce_mod((unsigned __int128)b * b, m, neg_inv);
+    }
+    r = reduce_mod(r, m, neg_inv);
   } else {
-    int ivalue = 1;
-    int base = value_get_int(left);
-    int exp = value_get_int(right);
-    while (exp) {
-      if (exp & 1)
-	ivalue *= base;
-      exp >>= 1;
-      base *= base;
+    while (e) {
+      if (e & 1)
+	r = (unsigned __int128)r * b % m;
+      e >>= 1;
+      b = (unsigned __int128)b * b % m;
     }
+  }
 
-    result->type = INT;
-    result->data.ivalue = ivalue;
+  result->type = INT;
+  result->data.ivalue = r;
+}
+
+//a nonnegative integer argument that fits in a long int
+static long int count_argument(value *val, char *function) {
+  if (is_float(val))
+    raise_error(ERROR_EXPR, "function '%s' requires integer arguments",
+		function);
+  if (is_negative(val))
+    raise_error(ERROR_EXPR, "function '%s' requires nonnegative arguments",
+		function);
+  if (val->type != INT)
+    raise_error(ERROR_EXPR,
+		"function '%s' requires arguments that fit in 64 bits",
+		function);
+  return val->data.ivalue;
+}
+
+//for a factorial or binomial whose result is too large even for a double
+static void result_too_large(char *function) {
+  if (big_arena)
+    raise_error(ERROR_EXPR,
+		"result of function '%s' is past the %ld-bit limit of --bigint",
+		function, MAX_BIG_BITS);
+  raise_error(ERROR_EXPR, "result of function '%s' is too large", function);
+}
+
+//Exact in 128 bits up to 33!, and with --bigint up to where the result
+//has MAX_BIG_BITS bits, about 3 million!; otherwise from tgamma().
+void factorial(value *n, value *result) {
+  long int count = count_argument(n, "factorial");
+  wide_int wvalue = 1;
+  bool overflow = false;
+
+  for (long int i = 2; i <= count && !overflow; i++)
+    overflow = __builtin_mul_overflow(wvalue, i, &wvalue);
+
+  if (overflow && big_arena && lgamma(count + 1.0) / M_LN2 <= MAX_BIG_BITS) {
+    bigint r;
+    big_init(&r);
+    big_product_range(&r, 1, count);
+    value_set_big(result, &r);
+    big_free(&r);
+  } else {
+    double fvalue = tgamma(count + 1.0);
+    if (overflow && isinf(fvalue))
+      result_too_large("factorial");
+    set_checked(result, wvalue, overflow, fvalue);
+  }
+}
+
+//The number of ways to choose k things from n, 0 if k > n. It is built
+//up as C(n - k + i, i) for i = 1 to k, each step a multiplication and an
+//exact division. With --bigint, a result past 128 bits is the quotient
+//of two products taken by halves.
+void binomial(value *n, value *k, value *result) {
+  long int total = count_argument(n, "binomial");
+  long int chosen = count_argument(k, "binomial");
+
+  if (chosen > total) {
+    value_set_int(result, 0);
+    return;
+  }
+  if (chosen > total - chosen)
+    chosen = total - chosen;
+
+  wide_int wvalue = 1;
+  bool overflow = false;
+  for (long int i = 1; i <= chosen && !overflow; i++) {
+    //i / gcd(wvalue, i) divides total - chosen + i, so dividing first
+    //means that overflow is only ever a result too large
+    wide_int a = wvalue, b = i;
+    while (b) {
+      wide_int t = a % b;
+      a = b;
+      b = t;
+    }
+    overflow = __builtin_mul_overflow(wvalue / a,
+				      (total - chosen + i) / (i / a),
+				      &wvalue);
+  }
+
+  //the numerator has to fit as well as the result
+  if (overflow && big_arena && chosen * log2(total) <= MAX_BIG_BITS) {
+    bigint numerator, denominator;
+    big_init(&numerator);
+    big_init(&denominator);
+    big_product_range(&numerator, total - chosen + 1, total);
+    big_product_range(&denominator, 1, chosen);
+    big_divide(&numerator, NULL, &numerator, &denominator);
+    value_set_big(result, &numerator);
+    big_free(&numerator);
+    big_free(&denominator);
+  } else {
+    double fvalue = round(exp(lgamma(total + 1.0) - lgamma(chosen + 1.0)
+			      - lgamma(total - chosen + 1.0)));
+    if (overflow && isinf(fvalue))
+      result_too_large("binomial");
+    set_checked(result, wvalue, overflow, fvalue);
   }
 }
 
 void modulo(value *left, value *right, value *result) {
   //make sure arguments are ints and right value is nonzero
-  if (left->type == FLOAT || right->type == FLOAT) {
+  if (is_float(left) || is_float(right)) {
     raise_error(ERROR_EXPR, "modulo operator '%' requires integer operands");
-  } else if (right->data.ivalue == 0) {
+  } else if (right->type == INT && right->data.ivalue == 0) {
     raise_error(ERROR_EXPR, "mod by zero");
-  } else {
+  } else if (left->type == INT && right->type == INT) {
     result->type = INT;
-    result->data.ivalue = value_get_int(left) % value_get_int(right);
+    //LONG_MIN % -1 traps on some machines
+    result->data.ivalue = (value_get_int(right) == -1) ? 0
+      : value_get_int(left) % value_get_int(right);
+  } else if (left->type == BIG || right->type == BIG) {
+    big_binary(big_remainder, left, right, result);
+  } else {
+    wide_int divisor = value_get_wide(right);
+    value_set_wide(result, (divisor == -1) ? 0
+		   : value_get_wide(left) % divisor);
   }
 }
 
 void negate(value *right, value *result) {
-  if (right->type == FLOAT) {
+  wide_int wvalue = 0;
+
+  if (right->type == BIGFLOAT) {
+    bigfloat r;
+    bf_init(&r);
+    bf_negate(&r, right->data.bfvalue);
+    value_set_bigfloat(result, &r);
+    bf_free(&r);
+  } else if (right->type == FLOAT) {
     result->type = FLOAT;
     result->data.fvalue = -value_get_float(right);
+  } else if (right->type == INT && right->data.ivalue != LONG_MIN) {
+    value_set_int(result, -right->data.ivalue);
   } else {
-    result->type = INT;
-    result->data.ivalue = -value_get_int(right);
+    bool overflow = __builtin_sub_overflow((wide_int)0, value_get_wide(right),
+					   &wvalue);
+    value zero;
+    value_set_int(&zero, 0);
+    if (goes_big(&zero, right, overflow))
+      big_binary(big_subtract, &zero, right, result);
+    else
+      set_checked(result, wvalue, overflow, -value_get_float(right));
   }
 }
 
 void equal(value *left, value *right, value *result) {
   result->type = INT;
-  if (left->type == FLOAT || right->type == FLOAT) {
+  if (compares_precise(left, right)) {
+    result->data.ivalue = compare_precise(left, right) == 0;
+  } else if (left->type == FLOAT || right->type == FLOAT) {
     result->data.ivalue = value_get_float(left) == value_get_float(right);
-  } else {
+  } else if (left->type == INT && right->type == INT) {
     result->data.ivalue = value_get_int(left) == value_get_int(right);
+  } else {
+    result->data.ivalue = compare_integers(left, right) == 0;
   }
 }
 
 void not_equal(value *left, value *right, value *result) {
   result->type = INT;
-  if (left->type == FLOAT || right->type == FLOAT) {
+  if (compares_precise(left, right)) {
+    result->data.ivalue = compare_precise(left, right) != 0;
+  } else if (left->type == FLOAT || right->type == FLOAT) {
     result->data.ivalue = value_get_float(left) != value_get_float(right);
-  } else {
+  } else if (left->type == INT && right->type == INT) {
     result->data.ivalue = value_get_int(left) != value_get_int(right);
+  } else {
+    result->data.ivalue = compare_integers(left, right) != 0;
   }
 }
 
 void less_than(value *left, value *right, value *result) {
   result->type = INT;
-  if (left->type == FLOAT || right->type == FLOAT) {
+  if (compares_precise(left, right)) {
+    result->data.ivalue = compare_precise(left, right) < 0;
+  } else if (left->type == FLOAT || right->type == FLOAT) {
     result->data.ivalue = value_get_float(left) < value_get_float(right);
-  } else {
+  } else if (left->type == INT && right->type == INT) {
     result->data.ivalue = value_get_int(left) < value_get_int(right);
+  } else {
+    result->data.ivalue = compare_integers(left, right) < 0;
   }
 }
 
 void less_than_eq(value *left, value *right, value *result) {
   result->type = INT;
-  if (left->type == FLOAT || right->type == FLOAT) {
+  if (compares_precise(left, right)) {
+    result->data.ivalue = compare_precise(left, right) <= 0;
+  } else if (left->type == FLOAT || right->type == FLOAT) {
     result->data.ivalue = value_get_float(left) <= value_get_float(right);
-  } else {
+  } else if (left->type == INT && right->type == INT) {
     result->data.ivalue = value_get_int(left) <= value_get_int(right);
+  } else {
+    result->data.ivalue = compare_integers(left, right) <= 0;
   }
 }
 
 void greater_than(value *left, value *right, value *result) {
   result->type = INT;
-  if (left->type == FLOAT || right->type == FLOAT) {
+  if (compares_precise(left, right)) {
+    result->data.ivalue = compare_precise(left, right) > 0;
+  } else if (left->type == FLOAT || right->type == FLOAT) {
     result->data.ivalue = value_get_float(left) > value_get_float(right);
-  } else {
+  } else if (left->type == INT && right->type == INT) {
     result->data.ivalue = value_get_int(left) > value_get_int(right);
+  } else {
+    result->data.ivalue = compare_integers(left, right) > 0;
   }
 }
 
 void greater_than_eq(value *left, value *right, value *result) {
   result->type = INT;
-  if (left->type == FLOAT || right->type == FLOAT) {
+  if (compares_precise(left, right)) {
+    result->data.ivalue = compare_precise(left, right) >= 0;
+  } else if (left->type == FLOAT || right->type == FLOAT) {
     result->data.ivalue = value_get_float(left) >= value_get_float(right);
-  } else {
+  } else if (left->type == INT && right->type == INT) {
     result->data.ivalue = value_get_int(left) >= value_get_int(right);
+  } else {
+    result->data.ivalue = compare_integers(left, right) >= 0;
   }
 }
 
@@ -656,8 +1691,10 @@ void and(value *left, value *right, value *result) {
   result->type = INT;
   if (left->type == FLOAT || right->type == FLOAT) {
     result->data.ivalue = value_get_float(left) && value_get_float(right);
-  } else {
+  } else if (left->type == INT && right->type == INT) {
     result->data.ivalue = value_get_int(left) && value_get_int(right);
+  } else {
+    result->data.ivalue = is_nonzero(left) && is_nonzero(right);
   }
 }
 
@@ -665,8 +1702,10 @@ void or(value *left, value *right, value *result) {
   result->type = INT;
   if (left->type == FLOAT || right->type == FLOAT) {
     result->data.ivalue = value_get_float(left) || value_get_float(right);
-  } else {
+  } else if (left->type == INT && right->type == INT) {
     result->data.ivalue = value_get_int(left) || value_get_int(right);
+  } else {
+    result->data.ivalue = is_nonzero(left) || is_nonzero(right);
   }
 }
 
@@ -674,8 +1713,10 @@ void not(value *right, value *result) {
   result->type = INT;
   if (right->type == FLOAT) {
     result->data.ivalue = !value_get_float(right);
-  } else {
+  } else if (right->type == INT) {
     result->data.ivalue = !value_get_int(right);
+  } else {
+    result->data.ivalue = !is_nonzero(right);
   }
 }
 
@@ -683,9 +1724,13 @@ void bit_and(value *left, value *right, value *result) {
   if (left->type == INT && right->type == INT) {
     result->type = INT;
     result->data.ivalue = value_get_int(left) & value_get_int(right);
-  } else {
+  } else if (is_float(left) || is_float(right)) {
     raise_error(ERROR_EXPR,
 		"bitwise AND operator '&' requires integer operands");
+  } else if (left->type == BIG || right->type == BIG) {
+    big_binary(big_and, left, right, result);
+  } else {
+    value_set_wide(result, value_get_wide(left) & value_get_wide(right));
   }
 }
 
@@ -693,9 +1738,13 @@ void bit_or(value *left, value *right, value *result) {
   if (left->type == INT && right->type == INT) {
     result->type = INT;
     result->data.ivalue = value_get_int(left) | value_get_int(right);
-  } else {
+  } else if (is_float(left) || is_float(right)) {
     raise_error(ERROR_EXPR,
 		"bitwise OR operator '|' requires integer operands");
+  } else if (left->type == BIG || right->type == BIG) {
+    big_binary(big_or, left, right, result);
+  } else {
+    value_set_wide(result, value_get_wide(left) | value_get_wide(right));
   }
 }
 
@@ -703,9 +1752,13 @@ void bit_xor(value *left, value *right, value *result) {
   if (left->type == INT && right->type == INT) {
     result->type = INT;
     result->data.ivalue = value_get_int(left) ^ value_get_int(right);
-  } else {
+  } else if (is_float(left) || is_float(right)) {
     raise_error(ERROR_EXPR,
 		"bitwise XOR operator '^' requires integer operands");
+  } else if (left->type == BIG || right->type == BIG) {
+    big_binary(big_xor, left, right, result);
+  } else {
+    value_set_wide(result, value_get_wide(left) ^ value_get_wide(right));
   }
 }
 
@@ -713,36 +1766,105 @@ void bit_not(value *right, value *result) {
   if (right->type == INT) {
     result->type = INT;
     result->data.ivalue = ~value_get_int(right);
+  } else if (right->type == WIDE) {
+    value_set_wide(result, ~value_get_wide(right));
+  } else if (right->type == BIG) { //~x is x ^ -1
+    value all_ones;
+    value_set_int(&all_ones, -1);
+    big_binary(big_xor, right, &all_ones, result);
   } else {
     raise_error(ERROR_EXPR,
 		"bitwise NOT operator '~' requires an integer operand");
   }
 }
 
-void bit_shift_left(value *left, value *right, value *result) {
-  if (left->type == INT && right->type == INT) {
-    result->type = INT;
-    result->data.ivalue = value_get_int(left) << value_get_int(right);
+//a count of 128 bits is past any shift, so it is clamped to a long
+static long int shift_count(value *right) {
+  if (right->type == WIDE || right->type == BIG)
+    return is_negative(right) ? LONG_MIN : LONG_MAX;
+  return value_get_int(right);
+}
+
+//An arithmetic right shift. Past the width of the value every bit is
+//shifted out, leaving 0 or -1.
+static void shift_right(value *left, long int count, value *result) {
+  if (left->type == INT) {
+    value_set_int(result, left->data.ivalue >> ((count > 63) ? 63 : count));
+  } else if (left->type == BIG) {
+    bigint a, r;
+    uint64_t limbs[2];
+    value_get_big(left, &a, limbs);
+    big_init(&r);
+    big_shift_right(&r, &a, count);
+    value_set_big(result, &r);
+    big_free(&r);
   } else {
+    value_set_wide(result,
+		   value_get_wide(left) >> ((count > 127) ? 127 : count));
+  }
+}
+
+//A left shift that loses bits is a multiplication that overflowed, so it
+//moves to 128 bits and then to a float, or with --bigint to a BIG value.
+static void shift_left(value *left, long int count, value *result) {
+  if (left->type == INT && count < 64
+      && (long int)((unsigned long int)left->data.ivalue << count) >> count
+      == left->data.ivalue) {
+    value_set_int(result,
+		  (long int)((unsigned long int)left->data.ivalue << count));
+  } else {
+    wide_int wvalue = value_get_wide(left);
+    wide_int shifted = (unsigned __int128)wvalue << (count & 127);
+    bool overflow = left->type == BIG
+      || (wvalue != 0 && (count > 127 || shifted >> count != wvalue));
+
+    if (overflow && big_arena
+	&& count <= MAX_BIG_BITS - (long int)value_bits(left)) {
+      bigint a, r;
+      uint64_t limbs[2];
+      value_get_big(left, &a, limbs);
+      big_init(&r);
+      big_shift_left(&r, &a, count);
+      value_set_big(result, &r);
+      big_free(&r);
+    } else {
+      set_checked(result, shifted, overflow,
+		  ldexp(value_get_float(left), (count > 2048) ? 2048 : count));
+    }
+  }
+}
+
+//A negative count shifts the other way, so x << -n is x >> n.
+void bit_shift_left(value *left, value *right, value *result) {
+  if (is_float(left) || is_float(right))
     raise_error(ERROR_EXPR,
 		"bit shift operator '<<' requires integer operands");
-  }
+
+  long int count = shift_count(right);
+  if (count < 0)
+    shift_right(left, (count == LONG_MIN) ? LONG_MAX : -count, result);
+  else
+    shift_left(left, count, result);
 }
 
 void bit_shift_right(value *left, value *right, value *result) {
-  if (left->type == INT && right->type == INT) {
-    result->type = INT;
-    result->data.ivalue = value_get_int(left) >> value_get_int(right);
-  } else {
+  if (is_float(left) || is_float(right))
     raise_error(ERROR_EXPR,
 		"bit shift operator '>>' requires integer operands");
-  }
+
+  long int count = shift_count(right);
+  if (count < 0)
+    shift_left(left, (count == LONG_MIN) ? LONG_MAX : -count, result);
+  else
+    shift_right(left, count, result);
 }
 
 void conditional(value *condition, value *on_true, value *on_false,
 		 value *result) {
   if ((condition->type == INT && condition->data.ivalue)
-      || (condition->type == FLOAT && condition->data.fvalue != 0.0))
+      || (condition->type == FLOAT && condition->data.fvalue != 0.0)
+      || (condition->type == BIGFLOAT && is_nonzero(condition))
+      || condition->type == WIDE || condition->type == BIG) //never zero
     *result = *on_true;
   else
     *result = *on_false;
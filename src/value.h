@@ -22,20 +22,65 @@
 #ifndef CCALC_VALUE_H
 #define CCALC_VALUE_H
 
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "bigfloat.h"
+#include "bigint.h"
+
+typedef __int128 wide_int;
+
+//An integer result that does not fit in a long int is kept as a WIDE
+//value. Its 128 bits are stored out of line, so that a value stays 16
+//bytes, in the arena given to set_wide_arena() on the thread that made
+//it; like a BIG value it only lives until that arena is reset, and
+//anything kept longer takes a copy with value_keep_wide(). A WIDE value
+//never fits in a long int; value_set_wide makes an INT of anything that
+//does.
+//
+//With --bigint, an integer too large even for 128 bits is a BIG value
+//instead of a float. Its limbs are copied into the arena given to
+//enable_bigints(), so it only lives until that arena is reset, and like
+//WIDE it is never made of a number that fits in a smaller type.
+//
+//With --digits, a float is a BIGFLOAT instead, carried to the precision
+//given to enable_bigfloats() and kept in the same arena. A double still
+//stands for anything a BIGFLOAT cannot, such as infinity and NaN.
 typedef union {
   long int ivalue;
   double fvalue;
+  const wide_int *wvalue;
+  bigint *bvalue;
+  bigfloat *bfvalue;
 } number;
 
 typedef struct {
   number data;
-  enum { INT, FLOAT } type;
+  enum { INT, FLOAT, WIDE, BIG, BIGFLOAT } type;
 } value;
 
 void value_set_int(value *val, long int ivalue);
 void value_set_float(value *val, double fvalue);
+void value_set_wide(value *val, wide_int wvalue);
+void value_keep_wide(value *val, wide_int *storage);
+void value_set_big(value *val, const bigint *x);
+void value_set_bigfloat(value *val, const bigfloat *x);
+void value_set_decimal(value *val, const char *str, int length);
 long int value_get_int(value *val);
 double value_get_float(value *val);
+wide_int value_get_wide(value *val);
+void value_get_big(value *val, bigint *x, uint64_t limbs[2]);
+void value_get_bigfloat(value *val, bigfloat *x, uint64_t limbs[2]);
+void wide_to_string(wide_int wvalue, char *str, int size);
+void big_to_string(const bigint *x, char *str, int size);
+void bigfloat_to_string(const bigfloat *x, char *str, int size);
+
+void enable_bigints(arena *mem);
+bool bigints_enabled(void);
+arena *set_wide_arena(arena *mem);
+void enable_bigfloats(int digits);
+bool bigfloats_enabled(void);
 
 void round_to_int(value *x);
 
@@ -49,6 +94,9 @@ void multiply(value *left, value *right, value *result);
 void int_divide(value *left, value *right, value *result);
 void divide(value *left, value *right, value *result);
 void power(value *left, value *right, value *result);
+void power_mod(value *base, value *exp, value *mod, value *result);
+void factorial(value *n, value *result);
+void binomial(value *n, value *k, value *result);
 void modulo(value *left, value *right, value *result);
 void negate(value *right, value *result);
 void equal(value *left, value *right, value *result);
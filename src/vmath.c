@@ -0,0 +1,711 @@
+/* ccalc -- evaluate C-style expressions from the command line.
+   Copyright (C) 2015-2017 Gregory Kikola.
+
+   This file is part of ccalc.
+
+   ccalc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   ccalc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with ccalc.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Written by Gregory Kikola <gkikola@gmail.com>. */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "vmath.h"
+
+//adding and then subtracting 1.5 * 2^52 rounds to an integer, which is
+//left in the low bits of the sum
+#define SHIFT 6755399441055744.0
+#define SHIFT_BITS 0x4338000000000000
+#define EXPONENT_MASK 0xfff0000000000000
+#define SPLIT 134217729.0
+
+#define LN2 6.93147180559945286227e-01
+#define INV_LN2 1.44269504088896338700e+00
+#define LN2_HI 6.93147180369123816490e-01
+#define LN2_LO 1.90821492927058770002e-10
+#define LN2_TAIL 2.31904681384629955842e-17
+
+#define EXP_LIMIT 708.0
+#define EXP2_LIMIT 1021.0
+
+//exp polynomial, from fdlibm
+#define P1 1.66666666666666019037e-01
+#define P2 -2.77777777770155933842e-03
+#define P3 6.61375632143793436117e-05
+#define P4 -1.65339022054652515390e-06
+#define P5 4.13813679705723846039e-08
+
+//log polynomial, from fdlibm
+#define LG1 6.666666666666735130e-01
+#define LG2 3.999999999940941908e-01
+#define LG3 2.857142874366239149e-01
+#define LG4 2.222219843214978396e-01
+#define LG5 1.818357216161805012e-01
+#define LG6 1.531383769920937332e-01
+#define LG7 1.479819860511658591e-01
+
+#define SQRT1_2_BITS 0x3fe6a09e667f3bcd
+#define IVLN2_HI 1.44269504072144627571e+00
+#define IVLN2_LO 1.67517131648865118353e-10
+#define IVLN10_HI 4.34294481878168880939e-01
+#define IVLN10_LO 2.50829467116452752298e-11
+#define LOG10_2_HI 3.01029995663611771306e-01
+#define LOG10_2_LO 3.69423907715893078616e-13
+
+//sin and cos polynomials and the three-part pi/2 used to reduce their
+//arguments, from fdlibm
+#define S1 -1.66666666666666324348e-01
+#define S2 8.33333333332248946124e-03
+#define S3 -1.98412698298579493134e-04
+#define S4 2.75573137070700676789e-06
+#define S5 -2.50507602534068634195e-08
+#define S6 1.58969099521155010221e-10
+
+#define C1 4.16666666666666019037e-02
+#define C2 -1.38888888888741095749e-03
+#define C3 2.48015872894767294178e-05
+#define C4 -2.75573143513906633035e-07
+#define C5 2.08757232129817482790e-09
+#define C6 -1.13596475577881948265e-11
+
+#define INV_PIO2 6.36619772367581382433e-01
+#define PIO2_1 1.57079632673412561417e+00
+#define PIO2_2 6.07710050630396597660e-11
+#define PIO2_3 2.02226624871116645580e-21
+#define PIO2_3T 8.47842766036889956997e-32
+
+//each part of pi/2 has 33 significant bits, so multiples of it are exact
+//while the quotient fits in 20 bits
+#define TRIG_LIMIT 823549.0
+
+#define POW_Y_LIMIT 0x1p900
+
+//log(x) for pow is taken as log(c) + log(x/c), where c is the center of
+//one of LOG_TABLE_SIZE subintervals of [0.707, 1.414) and x/c is within
+//2^-8 of 1. The table was computed to 90 digits and holds 1/c rounded
+//to double, with -log of that value split into two doubles.
+#define LOG_TABLE_SIZE 128
+#define LOG_TABLE_BITS 7
+#define LOG_TABLE_OFFSET 0x3fe6955500000000
+
+typedef struct {
+  double invc;
+  double logc;
+  double logc_tail;
+} log_entry;
+
+//erf(x) = x + x * P(x^2) for |x| < 0.5 (Taylor series), and a degree-17
+//Taylor polynomial around the center of each interval of width 0.5 from
+//0.5 to 6 above that. Past 6, erf(x) rounds to 1.
+#define ERF_SMALL_DEGREE 12
+#define ERF_DEGREE 17
+#define ERF_INTERVALS 11
+
+const double erf_small[ERF_SMALL_DEGREE + 1] = {
+  0.1283791670955126,
+  -0.37612638903183754,
+  0.11283791670955126,
+  -0.026866170645131252,
+  0.005223977625442188,
+  -0.0008548327023450853,
+  0.00012055332981789664,
+  -1.492565035840625e-05,
+  1.6462114365889248e-06,
+  -1.6365844691234924e-07,
+  1.4807192815879218e-08,
+  -1.2290555301717928e-09,
+  9.422759064650411e-11
+};
+
+const double erf_table[ERF_INTERVALS][ERF_DEGREE + 1] = {
+  {0.7111556336535151, 0.6429310691952074, -0.4821983018964055,
+   0.026788794549800304, 0.1506869693426267, -0.053242729167728105,
+   -0.026872509532768433, 0.018435235177909452, 0.0023017883040209273,
+   -0.00396826044637477, 0.00018603225735249506, 0.0006239836743132585,
+   -0.00010618466494862627, -7.57456209347206e-05, 2.2117975642824626e-05,
+   7.166231694301993e-06, -3.252264713003685e-06, -5.034286680771006e-07},
+  {0.9229001282564583, 0.2365211224472908, -0.29565140305911347,
+   0.16753579506683097, -0.006159404230398197, -0.04718103640485019,
+   0.021301272963460433, 0.0036259826094427483, -0.005697678057620952,
+   0.0008776361752808411, 0.0007935114997568478, -0.00032395671499069396,
+   -5.2738032824946004e-05, 5.5828132785536196e-05, -3.0148435589627603e-06,
+   -6.409580608858307e-06, 1.353228718679766e-06, 5.079348144064654e-07},
+  {0.9866716712191824, 0.05277499593015037, -0.09235624287776316,
+   0.09015728471400689, -0.04810220983216831, 0.00662436146831575,
+   0.008963045098727362, -0.00605875147039124, 0.0007300512471403044,
+   0.000894181745354845, -0.00044275049925469434, -5.445490386117354e-06,
+   6.867167700726822e-05, -1.7720574652632584e-05, -4.625462096042058e-06,
+   3.2732503984500383e-06, -1.7638628012270578e-07, -3.247054421567266e-07},
+  {0.9985372834133188, 0.007142319022017983, -0.016070217799540463,
+   0.021724553691971366, -0.019083383636954297, 0.010657679165667459,
+   -0.0029043570710627813, -0.0006704559699518927, 0.0009994937126113928,
+   -0.00036938041770393946, -1.1466583164141507e-05, 6.51349432823389e-05,
+   -2.26882426454011e-05, -1.3320746753833096e-06, 3.4200230329645604e-06,
+   -8.610833786514346e-07, -1.5682298693348275e-07, 1.3648439859835954e-07},
+  {0.9998993780778803, 0.0005862772470937923, -0.001612262429507929,
+   0.0027603887050666057, -0.003258113659630606, 0.0027558084140736853,
+   -0.00165732740366605, 0.0006460409566724474, -8.901157121243978e-05,
+   -7.122311472315157e-05, 5.499699242438933e-05, -1.5843804712042587e-05,
+   -1.0711338137061364e-06, 2.68755471390732e-06, -9.145766511836599e-07,
+   2.599902759769022e-09, 1.0580689273108972e-07, -3.451839574679767e-08},
+  {0.9999956972205363, 2.9189025383581702e-05, -9.486433249664052e-05,
+   0.00019580971194819392, -0.00028656933775026826, 0.00031379722549089054,
+   -0.0002635285042150599, 0.0001699914145113912, -8.164763053013537e-05,
+   2.5913847005660593e-05, -2.328866237210874e-06, -2.864299460756217e-06,
+   1.9043540620324773e-06, -5.482373634736951e-07, 3.415163322790054e-09,
+   6.639710279972467e-08, -2.7372258733380318e-08, 3.1426537657346073e-09},
+  {0.9999998862727434, 8.814321912318039e-07, -3.305370717119265e-06,
+   7.96961606238756e-06, -1.3841239877936921e-05, 1.8370974998189114e-05,
+   -1.9272721446953215e-05, 1.627530274121437e-05, -1.1128227438398495e-05,
+   6.108880665651509e-06, -2.603308954634454e-06, 7.753483601441538e-07,
+   -9.015197438790608e-08, -5.733324505294767e-08, 4.260241086797881e-08,
+   -1.4202803665529217e-08, 1.6872829502859595e-09, 8.220961615130933e-10},
+  {0.9999999981494259, 1.6143993719507412e-08, -6.86119733079065e-08,
+   1.8901925979923262e-07, -3.787952693040671e-07, 5.872461798771443e-07,
+   -7.309200163448699e-07, 7.477252151146886e-07, -6.378323232711703e-07,
+   4.5700618015047133e-07, -2.750628401019148e-07, 1.377657287814025e-07,
+   -5.5907869992597255e-08, 1.712664555162862e-08, -3.0258541408386185e-09,
+   -4.057911503930884e-10, 5.685928650775004e-10, -2.3954005565715955e-10},
+  {0.9999999999815149, 1.7934357034341337e-10, -8.518819591312136e-10,
+   2.6378450138010383e-09, -5.9809212547337285e-09, 1.0572396879853772e-08,
+   -1.5144716058506144e-08, 1.8036305869912202e-08, -1.8172816922269425e-08,
+   1.5675358387690353e-08, -1.1660867459902382e-08, 7.505690524657273e-09,
+   -4.175206898701798e-09, 1.992617916086827e-09, -8.015568520213184e-10,
+   2.609475976217993e-10, -6.142267001878952e-11, 5.543448213978045e-12},
+  {0.9999999999998869, 1.2084074716006755e-12, -6.344139225903546e-12,
+   2.1801684800128854e-11, -5.5114709525037056e-11, 1.0920038456253917e-10,
+   -1.7640341711110032e-10, 2.386050341041412e-10, -2.7536837502359233e-10,
+   2.748676808961636e-10, -2.396566871589998e-10, 1.8378485359603671e-10,
+   -1.2450012763001698e-10, 7.463941860429059e-11, -3.956196470530362e-11,
+   1.8452304418895604e-11, -7.49376222594815e-12, 2.593319563942725e-12},
+  {0.9999999999999996, 4.938485140964219e-15, -2.8396289560544257e-14,
+   1.0720628160176492e-13, -2.9875262975155936e-13, 6.549691639480571e-13,
+   -1.175690196300027e-12, 1.775545997743364e-12, -2.300413758263223e-12,
+   2.5941725248862415e-12, -2.5743359577057163e-12, 2.2668502698927728e-12,
+   -1.782347272631223e-12, 1.2570078056760755e-12, -7.975073209089227e-13,
+   4.55792741517898e-13, -2.345585121932816e-13, 1.0840067646333407e-13}
+};
+
+const log_entry log_table[LOG_TABLE_SIZE] = {
+  {1.4130637948355824, -0.3457602511868243, 2.0674141238389908e-17},
+  {1.4053068097826924, -0.3402556488985558, 1.8800099124090546e-17},
+  {1.397634523402517, -0.33478118145199626, 1.23327155583422e-17},
+  {1.390045555987865, -0.32933652069753083, 1.2931994053206738e-17},
+  {1.3825385576362084, -0.32392134381654897, 2.3514508867878777e-17},
+  {1.3751122074491977, -0.318535333206592, -3.244095488023442e-20},
+  {1.3677652127578397, -0.3131781763695764, -2.5725853287165294e-17},
+  {1.3604963083723818, -0.30784956580299655, -2.3662030367908506e-19},
+  {1.3533042558559885, -0.30254919889400983, -1.7108280803308434e-17},
+  {1.3461878428213334, -0.2972767778163141, -2.426027002172896e-17},
+  {1.33914588224927, -0.29203200942972973, 2.3111588314048314e-17},
+  {1.3321772118287747, -0.2868146051824014, 2.0742210915036133e-17},
+  {1.3252806933173915, -0.28162428101553677, -1.515699276626327e-17},
+  {1.3184552119214417, -0.27646075727060676, -1.463766595814074e-17},
+  {1.311699675695285, -0.27132375859892705, -1.5298920447383268e-17},
+  {1.3050130149589576, -0.26621301387355173, -5.688997469298136e-18},
+  {1.298394181733531, -0.26112825610340673, -4.225060633440991e-18},
+  {1.2918421491935659, -0.2560692223495944, -8.747077684632702e-18},
+  {1.285355911136063, -0.2510356536438055, 1.426841153295753e-17},
+  {1.2789344814653318, -0.24602729490877442, -8.385266674397635e-18},
+  {1.2725768936932214, -0.24104389488071537, -2.1751742657142603e-18},
+  {1.2662822004541863, -0.23608520603368247, -5.287300428058624e-18},
+  {1.2600494730346725, -0.23115098450579583, 8.839711718381448e-18},
+  {1.2538778009163347, -0.22624099002727938, -1.3791381509741305e-17},
+  {1.2477662913326095, -0.22135498585025518, -1.0196103290566055e-17},
+  {1.2417140688381962, -0.21649273868024602, 1.2840172731936177e-17},
+  {1.2357202748910059, -0.2116540186093352, -5.730180320994423e-18},
+  {1.2297840674461575, -0.20683859905093396, 9.941727150474121e-18},
+  {1.2239046205616246, -0.20204625667611462, -1.3366023391385444e-17},
+  {1.2180811240151364, -0.19727677135145974, 4.486073861360142e-18},
+  {1.2123127829319658, -0.19252992607838734, -2.4632130043095066e-18},
+  {1.2065988174232438, -0.1878055069339096, -1.1822916821819821e-17},
+  {1.200938462234454, -0.18310330301278444, 8.855878145054678e-19},
+  {1.1953309664037737, -0.1784231063710196, -3.6062755976726965e-20},
+  {1.1897755929299434, -0.17376471197069468, 6.049503333298862e-18},
+  {1.1842716184493547, -0.1691279176260602, -4.2512578553099735e-18},
+  {1.1788183329220603, -0.16451252395088276, -1.3427987237515135e-17},
+  {1.173415039326418, -0.15991833430699778, 9.71144040311337e-19},
+  {1.1680610533620954, -0.15534515475403968, 9.6581012290418e-18},
+  {1.1627557031611688, -0.15079279400031675, -7.071413358994367e-18},
+  {1.1574983290070577, -0.14626106335479774, 3.405404163417754e-18},
+  {1.1522882830610515, -0.14174977668018215, 1.3201951731578424e-17},
+  {1.1471249290961891, -0.1372587503470255, -5.422994668328649e-18},
+  {1.14200764223826, -0.1327878031888878, 2.2631990473724533e-18},
+  {1.1369358087137076, -0.12833675645848233, -3.2713602354491285e-18},
+  {1.1319088256042211, -0.1239054337847947, 2.9813075261541605e-18},
+  {1.1269261006078082, -0.1194936611311486, 3.052265245971415e-18},
+  {1.1219870518061505, -0.11510126675419181, 1.9879377450555897e-19},
+  {1.1170911074380518, -0.11072808116377984, 2.0109655330498833e-18},
+  {1.1122377056787898, -0.10637393708373204, -4.866746811540408e-18},
+  {1.1074262944251967, -0.10203866941343954, 4.055840953233139e-18},
+  {1.1026563310862927, -0.09772211519030014, 5.0599711732022425e-19},
+  {1.0979272823793087, -0.09342411355296279, 2.9636620790906327e-18},
+  {1.093238624130933, -0.08914450570535584, -8.32973152919575e-19},
+  {1.0885898410836317, -0.084883134881484, 3.135478462510763e-18},
+  {1.0839804267068869, -0.08063984631097083, -1.5232598921060458e-18},
+  {1.079409883013214, -0.07641448718533075, -1.8271038102440688e-18},
+  {1.0748777203788094, -0.07220690662494808, -3.036290643449988e-18},
+  {1.0703834573687012, -0.06801695564675017, -4.358386957264274e-19},
+  {1.0659266205662674, -0.06384448713255457, 4.044408987181281e-18},
+  {1.0615067444069939, -0.05968935579807261, 2.3558372976775723e-18},
+  {1.0571233710163528, -0.05555141816255522, -3.3484759397859595e-18},
+  {1.0527760500516812, -0.05143053251906447, 3.2972055622228303e-18},
+  {1.0484643385479446, -0.047326558905354456, 2.7229620837732184e-18},
+  {1.0441878007672756, -0.043239359075347414, -3.0560756987429374e-18},
+  {1.039946008052179, -0.03916879647119037, -1.2293969817913309e-18},
+  {1.0357385386823021, -0.03511473619587892, 3.2330526557658788e-18},
+  {1.0315649777346665, -0.031077044986432552, 1.7182200619587231e-18},
+  {1.0274249169472651, -0.02705559118760989, -1.611534296884488e-19},
+  {1.0233179545859328, -0.02305024472615082, -2.6387256366865352e-20},
+  {1.0192436953143946, -0.019060877085531225, -1.3872415786882673e-18},
+  {1.0152017500674089, -0.015087361281220948, 1.5952894186683233e-19},
+  {1.011191735926914, -0.011129571836429625, 7.514791770765074e-19},
+  {1.0072132760011008, -0.0071873847583313905, 9.814509164701418e-20},
+  {1.003265999306328, -0.003260677514757037, 1.3827896059603214e-19},
+  {0.998050919751243, 0.0019509821774078653, 1.9242744157220462e-21},
+  {0.9909680541104001, 0.009072981185463909, 1.755697471739135e-20},
+  {0.9833549808923171, 0.0167851040919329, -7.546737410012706e-19},
+  {0.9758579901481317, 0.024438205052878612, 5.846221059935516e-19},
+  {0.9684744469658976, 0.032033180617487826, -7.655804052433092e-19},
+  {0.9612017955799839, 0.03957090706082743, -2.6224879228866196e-19},
+  {0.9540375564215221, 0.047052240990565715, 2.3558672840961573e-18},
+  {0.9469793232997828, 0.05447801993116642, -6.548501962893001e-19},
+  {0.940024760707751, 0.061849062886551724, 3.371988720966802e-18},
+  {0.9331716012455625, 0.06916617088217868, -5.125927779877815e-18},
+  {0.9264176431558292, 0.07643012748742867, 1.4155438304954405e-18},
+  {0.9197607479652262, 0.08364169931915849, -3.858054452625978e-18},
+  {0.9131988382270334, 0.09080163652722545, 5.653775165037241e-18},
+  {0.9067298953596261, 0.09791067326275278, -1.764626099696709e-18},
+  {0.9003519575761895, 0.10496952812986872, 6.053697975036437e-18},
+  {0.8940631179011972, 0.11197890462161267, 5.066219866096489e-18},
+  {0.8878615222694416, 0.11893949154067018, 6.295054673862052e-18},
+  {0.881745367703634, 0.12585196340556626, 5.674978898058594e-18},
+  {0.8757129005668128, 0.1327169808429157, 6.024441552700381e-20},
+  {0.8697624148860018, 0.13953519096630054, 7.30101015349373e-18},
+  {0.8638922507437503, 0.14630722774231955, 1.3289246023120372e-17},
+  {0.858100792734373, 0.15303371234432478, 2.215528941235588e-18},
+  {0.8523864684818703, 0.15971525349434162, 4.924188350931158e-18},
+  {0.846747747216675, 0.166352447793641, -1.2604649172688696e-17},
+  {0.8411831384085182, 0.1729458800424139, 1.1700617736366156e-17},
+  {0.8356911904528505, 0.1794961235489752, 9.223868935558907e-18},
+  {0.8302704894083851, 0.18600374042890735, 6.80818804619657e-18},
+  {0.8249196577834595, 0.19246928189453236, 4.292656664481476e-18},
+  {0.8196373533690242, 0.19889328853508645, 7.006215683205439e-18},
+  {0.814422268116184, 0.20527629058795227, 5.29787738820141e-18},
+  {0.8092731270563194, 0.21161880820128998, 3.188251116036485e-18},
+  {0.804188687261915, 0.21792135168839183, 3.516228426653344e-18},
+  {0.7991677368463171, 0.22418442177407086, -2.2696766631849123e-18},
+  {0.7942090940007286, 0.23040850983338249, 1.9769786063675732e-18},
+  {0.7893116060668334, 0.2365940981229622, 1.5695351823131643e-18},
+  {0.7844741486435229, 0.2427416600052535, -1.0130383806276084e-17},
+  {0.7796956247262712, 0.24885166016588348, -1.9809037627102824e-19},
+  {0.774974963877772, 0.2549245548244399, -1.5584185154178509e-18},
+  {0.7703111214285242, 0.26096079193888544, -1.1170629991682194e-17},
+  {0.7657030777061097, 0.26696081140383987, -1.9428973019608025e-17},
+  {0.7611498372919693, 0.27292504524294914, -4.085714905933461e-18},
+  {0.7566504283045403, 0.2788539177955512, 1.498864391690178e-17},
+  {0.7522039017076696, 0.2847478458978414, 2.0276183059708408e-17},
+  {0.747809330643269, 0.2906072390587303, 9.494962373467606e-18},
+  {0.7434658097872289, 0.2964324996305784, 9.352584127180296e-18},
+  {0.7391724547276468, 0.30222402297498774, -4.274364792189372e-18},
+  {0.7349284013644778, 0.3079821976238195, 4.996233270186369e-19},
+  {0.7307328053297467, 0.3137074054356031, -2.63611709878879e-17},
+  {0.7265848414275092, 0.31940002174749155, -1.1294431182446286e-18},
+  {0.7224837030927779, 0.3250604155229182, -2.1876396737842017e-17},
+  {0.7184286018686696, 0.33068894949509725, 1.0700213331858606e-17},
+  {0.7144187669010644, 0.3362859803065071, -8.555839833154063e-19},
+  {0.7104534444500906, 0.34185185864449397, -1.0183189223435168e-17}
+};
+
+static inline uint64_t as_bits(double x) {
+  uint64_t bits;
+  memcpy(&bits, &x, sizeof(bits));
+  return bits;
+}
+
+static inline double as_double(uint64_t bits) {
+  double x;
+  memcpy(&x, &bits, sizeof(x));
+  return x;
+}
+
+static inline int is_normal_positive(double x) {
+  return as_bits(x) - 0x0010000000000000 < 0x7fe0000000000000;
+}
+
+//a + b is exactly *sum + *error (Knuth)
+static inline void two_sum(double a, double b, double *sum, double *error) {
+  double s = a + b;
+  double b_virtual = s - a;
+  *error = (a - (s - b_virtual)) + (b - b_virtual);
+  *sum = s;
+}
+
+//a * b is exactly *product + *error (Dekker); needs |a|, |b| < 2^995
+static inline void two_product(double a, double b, double *product,
+                               double *error) {
+  double t = SPLIT * a;
+  double a_hi = t - (t - a);
+  double a_lo = a - a_hi;
+  t = SPLIT * b;
+  double b_hi = t - (t - b);
+  double b_lo = b - b_hi;
+
+  double p = a * b;
+  *error = ((a_hi * b_hi - p) + a_hi * b_lo + a_lo * b_hi) + a_lo * b_lo;
+  *product = p;
+}
+
+//exp(x + tail) for |x| <= EXP_LIMIT, where tail is a small correction
+static inline double exp_kernel(double x, double tail) {
+  double kd = x * INV_LN2 + SHIFT;
+  uint64_t k = as_bits(kd);
+  kd -= SHIFT;
+
+  double hi = x - kd * LN2_HI;
+  double lo = kd * LN2_LO - tail;
+  double r = hi - lo;
+  double z = r * r;
+  double c = r - z * (P1 + z * (P2 + z * (P3 + z * (P4 + z * P5))));
+  double y = 1.0 - ((lo - (r * c) / (2.0 - c)) - hi);
+
+  //scale by 2^k by adding k to the exponent field
+  return as_double(as_bits(y) + (k << 52));
+}
+
+//splits x into 2^k * (1 + f), with 1 + f in [sqrt(1/2), sqrt(2))
+static inline double log_reduce(double x, double *k) {
+  uint64_t bits = as_bits(x);
+  uint64_t tmp = bits - SQRT1_2_BITS;
+
+  *k = as_double(SHIFT_BITS + ((tmp >> 52) ^ 0x800)) - (SHIFT + 2048.0);
+  return as_double(bits - (tmp & EXPONENT_MASK)) - 1.0;
+}
+
+//log(1 + f) = f - *hfsq + (return value)
+static inline double log_kernel(double f, double *hfsq) {
+  double s = f / (2.0 + f);
+  double z = s * s;
+  double w = z * z;
+  double t1 = w * (LG2 + w * (LG4 + w * LG6));
+  double t2 = z * (LG1 + w * (LG3 + w * (LG5 + w * LG7)));
+
+  *hfsq = 0.5 * f * f;
+  return s * (*hfsq + t2 + t1);
+}
+
+//log(x) to about 2^-66 relative, as *tail plus the return value
+static inline double log_extended(double x, double *tail) {
+  uint64_t bits = as_bits(x);
+  uint64_t tmp = bits - LOG_TABLE_OFFSET;
+  int i = (tmp >> (52 - LOG_TABLE_BITS)) % LOG_TABLE_SIZE;
+  double k = as_double(SHIFT_BITS + ((tmp >> 52) ^ 0x800)) - (SHIFT + 2048.0);
+  double z = as_double(bits - (tmp & EXPONENT_MASK));
+
+  //z / c - 1 is exactly r + r_lo
+  double p, r_lo;
+  two_product(z, log_table[i].invc, &p, &r_lo);
+  double r = p - 1.0;
+
+  //k log(2) + log(c) + r - r^2/2, keeping every rounding error
+  double hi, e1, e2, e3, sq, sq_lo;
+  two_sum(k * LN2_HI, log_table[i].logc, &hi, &e1);
+  two_sum(hi, r, &hi, &e2);
+  two_product(r, r, &sq, &sq_lo);
+  two_sum(hi, -0.5 * sq, &hi, &e3);
+
+  //the rest of the log(1 + r) series is small enough for one double
+  double poly = r * sq * (1.0 / 3 - r * (0.25 - r * (0.2 - r * (1.0 / 6
+                 - r * (1.0 / 7 - r * 0.125)))));
+  double lo = k * LN2_LO + log_table[i].logc_tail + e1 + e2 + e3 + r_lo
+              - 0.5 * sq_lo - r * r_lo + poly;
+
+  double sum = hi + lo;
+  *tail = (hi - sum) + lo;
+  return sum;
+}
+
+//reduces x to *y + *tail in about [-pi/4, pi/4] and returns the quadrant
+static inline uint64_t trig_reduce(double x, double *y, double *tail) {
+  double kd = x * INV_PIO2 + SHIFT;
+  uint64_t quadrant = as_bits(kd);
+  kd -= SHIFT;
+
+  //x - k * PIO2_1 is exact, and so are the products; two_sum keeps the
+  //rounding error of each subtraction
+  double a, b, ea, eb;
+  two_sum(x - kd * PIO2_1, -(kd * PIO2_2), &a, &ea);
+  two_sum(a, -(kd * PIO2_3), &b, &eb);
+  two_sum(b, ea + eb - kd * PIO2_3T, y, tail);
+
+  return quadrant;
+}
+
+//sin(x + y) for |x| <= pi/4, with y a small correction
+static inline double sin_kernel(double x, double y) {
+  double z = x * x;
+  double v = z * x;
+  double r = S2 + z * (S3 + z * (S4 + z * (S5 + z * S6)));
+  return x - ((z * (0.5 * y - v * r) - y) - v * S1);
+}
+
+//cos(x + y) for |x| <= pi/4, with y a small correction
+static inline double cos_kernel(double x, double y) {
+  double z = x * x;
+  double w = z * z;
+  double r = z * (C1 + z * (C2 + z * C3)) + w * w * (C4 + z * (C5 + z * C6));
+  double hz = 0.5 * z;
+  w = 1.0 - hz;
+  return w + (((1.0 - w) - hz) + (z * r - x * y));
+}
+
+//y log(x) as the return value plus *tail; this is carried to extra
+//precision since exp magnifies any error in its argument
+static inline double pow_exponent(double x, double y, double *tail) {
+  double l_tail, p, e;
+  double l = log_extended(x, &l_tail);
+
+  two_product(y, l, &p, &e);
+  e += y * l_tail;
+
+  double z = p + e;
+  *tail = (p - z) + e;
+  return z;
+}
+
+static inline int pow_is_special(double x, double y, double z) {
+  return !(is_normal_positive(x) && fabs(y) < POW_Y_LIMIT
+           && fabs(z) <= EXP_LIMIT);
+}
+
+static inline double flip_sign(double x, uint64_t flip) {
+  return as_double(as_bits(x) ^ (flip << 63));
+}
+
+KERNEL void vector_sqrt(double *restrict out, double *restrict x, int count) {
+  for (int i = 0; i < count; i++)
+    out[i] = sqrt(x[i]);
+}
+
+KERNEL void vector_exp(double *restrict out, double *restrict x, int count) {
+  int special = 0;
+  for (int i = 0; i < count; i++) {
+    special |= !(fabs(x[i]) <= EXP_LIMIT);
+    out[i] = exp_kernel(x[i], 0.0);
+  }
+
+  for (int i = 0; special && i < count; i++) {
+    if (!(fabs(x[i]) <= EXP_LIMIT))
+      out[i] = exp(x[i]);
+  }
+}
+
+KERNEL void vector_exp2(double *restrict out, double *restrict x, int count) {
+  int special = 0;
+  for (int i = 0; i < count; i++) {
+    special |= !(fabs(x[i]) <= EXP2_LIMIT);
+
+    //x = k + r exactly, and 2^r = exp(r * log(2))
+    double kd = x[i] + SHIFT;
+    uint64_t k = as_bits(kd);
+    kd -= SHIFT;
+    double r = x[i] - kd;
+
+    double hi, lo;
+    two_product(r, LN2, &hi, &lo);
+    double y = exp_kernel(hi, lo + r * LN2_TAIL);
+    out[i] = as_double(as_bits(y) + (k << 52));
+  }
+
+  for (int i = 0; special && i < count; i++) {
+    if (!(fabs(x[i]) <= EXP2_LIMIT))
+      out[i] = exp2(x[i]);
+  }
+}
+
+KERNEL void vector_log(double *restrict out, double *restrict x, int count) {
+  int special = 0;
+  for (int i = 0; i < count; i++) {
+    double k, hfsq;
+    special |= !is_normal_positive(x[i]);
+
+    double f = log_reduce(x[i], &k);
+    double r = log_kernel(f, &hfsq);
+    out[i] = k * LN2_HI - ((hfsq - (r + k * LN2_LO)) - f);
+  }
+
+  for (int i = 0; special && i < count; i++) {
+    if (!is_normal_positive(x[i]))
+      out[i] = log(x[i]);
+  }
+}
+
+KERNEL void vector_log2(double *restrict out, double *restrict x, int count) {
+  int special = 0;
+  for (int i = 0; i < count; i++) {
+    double k, hfsq;
+    special |= !is_normal_positive(x[i]);
+
+    //f - hfsq is split so that its high part multiplies exactly
+    double f = log_reduce(x[i], &k);
+    double r = log_kernel(f, &hfsq);
+    double hi = as_double(as_bits(f - hfsq) & 0xffffffff00000000);
+    double lo = (f - hi) - hfsq + r;
+
+    double val_hi = hi * IVLN2_HI;
+    double val_lo = (lo + hi) * IVLN2_LO + lo * IVLN2_HI;
+    double w = k + val_hi;
+    val_lo += (k - w) + val_hi;
+    out[i] = val_lo + w;
+  }
+
+  for (int i = 0; special && i < count; i++) {
+    if (!is_normal_positive(x[i]))
+      out[i] = log2(x[i]);
+  }
+}
+
+KERNEL void vector_log10(double *restrict out, double *restrict x,
+                         int count) {
+  int special = 0;
+  for (int i = 0; i < count; i++) {
+    double k, hfsq;
+    special |= !is_normal_positive(x[i]);
+
+    double f = log_reduce(x[i], &k);
+    double r = log_kernel(f, &hfsq);
+    double hi = as_double(as_bits(f - hfsq) & 0xffffffff00000000);
+    double lo = (f - hi) - hfsq + r;
+
+    double val_hi = hi * IVLN10_HI;
+    double y2 = k * LOG10_2_HI;
+    double val_lo = k * LOG10_2_LO + (lo + hi) * IVLN10_LO + lo * IVLN10_HI;
+    double w = y2 + val_hi;
+    val_lo += (y2 - w) + val_hi;
+    out[i] = val_lo + w;
+  }
+
+  for (int i = 0; special && i < count; i++) {
+    if (!is_normal_positive(x[i]))
+      out[i] = log10(x[i]);
+  }
+}
+
+KERNEL void vector_sin(double *restrict out, double *restrict x, int count) {
+  int special = 0;
+  for (int i = 0; i < count; i++) {
+    double y, tail;
+    special |= !(fabs(x[i]) <= TRIG_LIMIT);
+
+    uint64_t n = trig_reduce(x[i], &y, &tail);
+    double s = sin_kernel(y, tail);
+    double c = cos_kernel(y, tail);
+    s = flip_sign((n & 1) ? c : s, (n >> 1) & 1);
+    out[i] = (x[i] == 0.0) ? x[i] : s; //keep the sign of zero
+  }
+
+  for (int i = 0; special && i < count; i++) {
+    if (!(fabs(x[i]) <= TRIG_LIMIT))
+      out[i] = sin(x[i]);
+  }
+}
+
+KERNEL void vector_cos(double *restrict out, double *restrict x, int count) {
+  int special = 0;
+  for (int i = 0; i < count; i++) {
+    double y, tail;
+    special |= !(fabs(x[i]) <= TRIG_LIMIT);
+
+    uint64_t n = trig_reduce(x[i], &y, &tail);
+    double s = sin_kernel(y, tail);
+    double c = cos_kernel(y, tail);
+    out[i] = flip_sign((n & 1) ? s : c, ((n + 1) >> 1) & 1);
+  }
+
+  for (int i = 0; special && i < count; i++) {
+    if (!(fabs(x[i]) <= TRIG_LIMIT))
+      out[i] = cos(x[i]);
+  }
+}
+
+KERNEL void vector_tan(double *restrict out, double *restrict x, int count) {
+  int special = 0;
+  for (int i = 0; i < count; i++) {
+    double y, tail;
+    special |= !(fabs(x[i]) <= TRIG_LIMIT);
+
+    uint64_t n = trig_reduce(x[i], &y, &tail);
+    double s = sin_kernel(y, tail);
+    double c = cos_kernel(y, tail);
+    double t = (n & 1) ? -c / s : s / c;
+    out[i] = (x[i] == 0.0) ? x[i] : t;
+  }
+
+  for (int i = 0; special && i < count; i++) {
+    if (!(fabs(x[i]) <= TRIG_LIMIT))
+      out[i] = tan(x[i]);
+  }
+}
+
+KERNEL void vector_erf(double *restrict out, double *restrict x, int count) {
+  int special = 0;
+  for (int i = 0; i < count; i++) {
+    double a = fabs(x[i]);
+    special |= isnan(x[i]);
+
+    double z = x[i] * x[i];
+    double p = erf_small[ERF_SMALL_DEGREE];
+    for (int j = ERF_SMALL_DEGREE - 1; j >= 0; j--)
+      p = p * z + erf_small[j];
+    double small = x[i] + x[i] * p;
+
+    int n = (int)(2.0 * fmax(fmin(a, 5.75), 0.5) - 1.0);
+    double t = a - (0.75 + 0.5 * n);
+    double q = erf_table[n][ERF_DEGREE];
+    for (int j = ERF_DEGREE - 1; j >= 0; j--)
+      q = q * t + erf_table[n][j];
+    double large = copysign((a < 6.0) ? q : 1.0, x[i]);
+
+    out[i] = (a < 0.5) ? small : large;
+  }
+
+  for (int i = 0; special && i < count; i++) {
+    if (isnan(x[i]))
+      out[i] = erf(x[i]);
+  }
+}
+
+KERNEL void vector_pow(double *restrict out, double *restrict x,
+                       double *restrict y, int count) {
+  int special = 0;
+  for (int i = 0; i < count; i++) {
+    double tail;
+    double z = pow_exponent(x[i], y[i], &tail);
+
+    special |= pow_is_special(x[i], y[i], z);
+    out[i] = exp_kernel(z, tail);
+  }
+
+  for (int i = 0; special && i < count; i++) {
+    double tail;
+    if (pow_is_special(x[i], y[i], pow_exponent(x[i], y[i], &tail)))
+      out[i] = pow(x[i], y[i]);
+  }
+}
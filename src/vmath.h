@@ -0,0 +1,71 @@
+/* ccalc -- evaluate C-style expressions from the command line.
+   Copyright (C) 2015-2017 Gregory Kikola.
+
+   This file is part of ccalc.
+
+   ccalc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   ccalc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with ccalc.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Written by Gregory Kikola <gkikola@gmail.com>. */
+
+#ifndef CCALC_VMATH_H
+#define CCALC_VMATH_H
+
+//Each kernel is built for several instruction sets (AVX-512, AVX2 and
+//the SSE2 baseline on x86-64) and the loader picks the best one for the
+//processor the program is running on.
+#ifdef HAVE_TARGET_CLONES
+#define KERNEL __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+#define KERNEL
+#endif
+
+//Vectorized versions of the libm functions used by ccalc. Each one
+//computes out[i] = f(x[i]) for a whole array at once. Arguments outside
+//the range handled by the vector code (non-finite values, results that
+//overflow or underflow, huge trig arguments, and so on) are passed to
+//libm, so every result is either within the error bound listed below or
+//exactly what libm returns.
+//
+//Maximum error, in units in the last place, measured against libm by
+//test_vmath:
+//
+//  vector_sqrt   0 (correctly rounded)
+//  vector_exp    1
+//  vector_exp2   1
+//  vector_log    1
+//  vector_log2   1
+//  vector_log10  1
+//  vector_sin    1
+//  vector_cos    1
+//  vector_tan    2
+//  vector_erf    1
+//  vector_pow    1
+typedef void (*vector_function)(double *restrict out, double *restrict x,
+                                int count);
+
+void vector_sqrt(double *restrict out, double *restrict x, int count);
+void vector_exp(double *restrict out, double *restrict x, int count);
+void vector_exp2(double *restrict out, double *restrict x, int count);
+void vector_log(double *restrict out, double *restrict x, int count);
+void vector_log2(double *restrict out, double *restrict x, int count);
+void vector_log10(double *restrict out, double *restrict x, int count);
+void vector_sin(double *restrict out, double *restrict x, int count);
+void vector_cos(double *restrict out, double *restrict x, int count);
+void vector_tan(double *restrict out, double *restrict x, int count);
+void vector_erf(double *restrict out, double *restrict x, int count);
+void vector_pow(double *restrict out, double *restrict x,
+                double *restrict y, int count);
+
+#endif